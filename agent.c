@@ -0,0 +1,826 @@
+#define _GNU_SOURCE
+#include "agent.h"
+#include "game.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+static long getMonotonicMs()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return now.tv_sec * 1000L + now.tv_nsec / 1000000L;
+}
+
+static int getRemainingMs(long deadline)
+{
+  long remaining = deadline - getMonotonicMs();
+
+  return remaining > 0 ? (int)remaining : 0;
+}
+
+/* Agent processes */
+
+// Run the command with sh, with its stdin and stdout
+// replaced by the files that are not negative
+static pid_t spawnAgentProcess(char *command, int inputFile, int outputFile)
+{
+  pid_t pid = fork();
+
+  if (pid == 0)
+  {
+    if (inputFile >= 0)
+    {
+      dup2(inputFile, STDIN_FILENO);
+    }
+    if (outputFile >= 0)
+    {
+      dup2(outputFile, STDOUT_FILENO);
+    }
+    execl("/bin/sh", "sh", "-c", command, (char *)NULL);
+    _exit(127);
+  }
+
+  return pid;
+}
+
+// Give the agent a moment to exit on its own, then kill it
+static void waitAgentProcess(pid_t pid)
+{
+  long deadline = getMonotonicMs() + AGENT_HANDSHAKE_TIMEOUT_MS / 10;
+
+  while (waitpid(pid, NULL, WNOHANG) == 0)
+  {
+    if (getMonotonicMs() > deadline)
+    {
+      kill(pid, SIGKILL);
+      waitpid(pid, NULL, 0);
+      break;
+    }
+    usleep(1000);
+  }
+}
+
+static bool isAgentProcessAlive(pid_t pid)
+{
+  return waitpid(pid, NULL, WNOHANG) == 0;
+}
+
+/* Pipe I/O */
+
+static void appendAgentMessage(struct PipeAgent *agent, size_t *length, char *format, ...)
+{
+  while (true)
+  {
+    va_list arguments;
+    va_start(arguments, format);
+    int written = vsnprintf(agent->message + *length, agent->messageCapacity - *length, format, arguments);
+    va_end(arguments);
+
+    if (written >= 0 && *length + written < agent->messageCapacity)
+    {
+      *length += written;
+      return;
+    }
+
+    agent->messageCapacity = agent->messageCapacity > 0 ? agent->messageCapacity * 2 : 4096;
+    agent->message = realloc(agent->message, agent->messageCapacity);
+    if (agent->message == NULL)
+    {
+      printf("Error: Memory allocation failed\n");
+      exit(1);
+    }
+  }
+}
+
+// Write the whole message with one write call when the pipe
+// has room, waiting for the agent to read until the deadline
+static bool writeAgentMessage(struct PipeAgent *agent, char *message, size_t length, long deadline)
+{
+  while (length > 0)
+  {
+    ssize_t written = write(agent->requestFile, message, length);
+
+    if (written > 0)
+    {
+      message += written;
+      length -= written;
+      continue;
+    }
+
+    if (written < 0 && errno != EAGAIN && errno != EINTR)
+    {
+      return false;
+    }
+
+    struct pollfd request = {agent->requestFile, POLLOUT, 0};
+    if (poll(&request, 1, getRemainingMs(deadline)) <= 0)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Next line of the agent without its '\n', valid until
+// the next call. NULL when the deadline passes first
+static char *readAgentLine(struct PipeAgent *agent, size_t *consumed, long deadline)
+{
+  // drop the line returned by the last call
+  memmove(agent->answer, agent->answer + *consumed, agent->answerLength - *consumed);
+  agent->answerLength -= *consumed;
+  *consumed = 0;
+
+  while (true)
+  {
+    char *end = memchr(agent->answer, '\n', agent->answerLength);
+    if (end != NULL)
+    {
+      *end = '\0';
+      *consumed = end - agent->answer + 1;
+      return agent->answer;
+    }
+
+    // a line longer than the buffer is not an answer
+    if (agent->answerLength == sizeof(agent->answer))
+    {
+      agent->answerLength = 0;
+    }
+
+    struct pollfd answer = {agent->answerFile, POLLIN, 0};
+    if (poll(&answer, 1, getRemainingMs(deadline)) <= 0)
+    {
+      return NULL;
+    }
+
+    ssize_t count = read(agent->answerFile, agent->answer + agent->answerLength, sizeof(agent->answer) - agent->answerLength);
+    if (count == 0 || (count < 0 && errno != EAGAIN && errno != EINTR))
+    {
+      // the agent closed its stdout or exited
+      agent->alive = false;
+      return NULL;
+    }
+
+    agent->answerLength += count > 0 ? count : 0;
+  }
+}
+
+/* Pipe agent process */
+
+// Run the command with sh and wait for its ready line
+bool startPipeAgent(struct PipeAgent *agent, char *command, int timeoutMs)
+{
+  int requestPipe[2];
+  int answerPipe[2];
+
+  memset(agent, 0, sizeof(struct PipeAgent));
+  agent->timeoutMs = timeoutMs > 0 ? timeoutMs : AGENT_TIMEOUT_MS;
+  pthread_mutex_init(&agent->lock, NULL);
+
+  if (pipe2(requestPipe, O_CLOEXEC) != 0)
+  {
+    printf("Error: Could not create the agent pipes\n");
+    return false;
+  }
+
+  if (pipe2(answerPipe, O_CLOEXEC) != 0)
+  {
+    printf("Error: Could not create the agent pipes\n");
+    close(requestPipe[0]);
+    close(requestPipe[1]);
+    return false;
+  }
+
+  // a dead agent should fail the write, not kill the engine
+  signal(SIGPIPE, SIG_IGN);
+
+  agent->pid = spawnAgentProcess(command, requestPipe[0], answerPipe[1]);
+  close(requestPipe[0]);
+  close(answerPipe[1]);
+  agent->requestFile = requestPipe[1];
+  agent->answerFile = answerPipe[0];
+
+  if (agent->pid < 0)
+  {
+    printf("Error: Could not start the agent\n");
+    close(agent->requestFile);
+    close(agent->answerFile);
+    return false;
+  }
+
+  fcntl(agent->requestFile, F_SETFL, O_NONBLOCK);
+  fcntl(agent->answerFile, F_SETFL, O_NONBLOCK);
+  agent->alive = true;
+
+  long deadline = getMonotonicMs() + AGENT_HANDSHAKE_TIMEOUT_MS;
+  size_t length = 0;
+  size_t consumed = 0;
+  appendAgentMessage(agent, &length, "ludo %d\n", AGENT_PROTOCOL_VERSION);
+
+  char *line = writeAgentMessage(agent, agent->message, length, deadline) ? readAgentLine(agent, &consumed, deadline) : NULL;
+  if (line == NULL || strcmp(line, "ready") != 0)
+  {
+    printf("Error: The agent did not answer the handshake\n");
+    stopPipeAgent(agent);
+    return false;
+  }
+
+  agent->answerLength -= consumed;
+  memmove(agent->answer, agent->answer + consumed, agent->answerLength);
+
+  return true;
+}
+
+void stopPipeAgent(struct PipeAgent *agent)
+{
+  if (agent->alive)
+  {
+    writeAgentMessage(agent, "quit\n", 5, getMonotonicMs() + agent->timeoutMs);
+  }
+
+  close(agent->requestFile);
+  close(agent->answerFile);
+  agent->alive = false;
+
+  waitAgentProcess(agent->pid);
+
+  free(agent->message);
+  agent->message = NULL;
+  pthread_mutex_destroy(&agent->lock);
+}
+
+/* Pipe batch evaluator */
+
+// Write the request line of the protocol without its '\n'
+// to line, which has room for AGENT_REQUEST_LINE_SIZE chars.
+// Returns the length of the line
+int formatDecisionRequest(char *line, struct DecisionRequest *request)
+{
+  int length = sprintf
+  (
+    line, "%d %d %d %d %d",
+    request->gameIndex, request->playerIndex, request->diceNumber,
+    request->legalMask, request->mysteryCellNo == EMPTY ? BASE : request->mysteryCellNo
+  );
+
+  for (int color = 0; color < PLAYER_NO; color++)
+  {
+    for (int pieceIndex = 0; pieceIndex < PIECE_NO; pieceIndex++)
+    {
+      length += sprintf(line + length, " %d", request->players[color].pieces[pieceIndex].cellNo);
+    }
+  }
+
+  for (int color = 0; color < PLAYER_NO; color++)
+  {
+    for (int pieceIndex = 0; pieceIndex < PIECE_NO; pieceIndex++)
+    {
+      length += sprintf(line + length, " %d", getPieceFlags(&request->players[color].pieces[pieceIndex], request->board));
+    }
+  }
+
+  return length;
+}
+
+// Parse "moves <batch> <actions>". Returns false for a line
+// of another batch, which is skipped
+static bool parseAgentMoves(char *line, uint64_t batchNo, int count, int *actions)
+{
+  char *cursor;
+
+  if (strncmp(line, "moves ", 6) != 0 || strtoull(line + 6, &cursor, 10) != batchNo)
+  {
+    return false;
+  }
+
+  for (int index = 0; index < count; index++)
+  {
+    char *end;
+    long action = strtol(cursor, &end, 10);
+
+    if (end == cursor)
+    {
+      break;
+    }
+
+    actions[index] = action >= 0 && action < PIECE_NO * 2 ? (int)action : EMPTY;
+    cursor = end;
+  }
+
+  return true;
+}
+
+// BatchEvaluator over a PipeAgent (the context). All
+// requests go out in one message and come back in one line
+void evaluatePipeAgentDecisions(void *context, struct DecisionRequest *requests, int count, int *actions)
+{
+  struct PipeAgent *agent = context;
+
+  for (int index = 0; index < count; index++)
+  {
+    actions[index] = EMPTY;
+  }
+
+  pthread_mutex_lock(&agent->lock);
+
+  agent->decisionCount += count;
+  agent->batchNo++;
+
+  if (!agent->alive)
+  {
+    pthread_mutex_unlock(&agent->lock);
+    return;
+  }
+
+  long deadline = getMonotonicMs() + agent->timeoutMs;
+  size_t length = 0;
+
+  appendAgentMessage(agent, &length, "decide %llu %d\n", (unsigned long long)agent->batchNo, count);
+  for (int index = 0; index < count; index++)
+  {
+    char line[AGENT_REQUEST_LINE_SIZE];
+
+    formatDecisionRequest(line, &requests[index]);
+    appendAgentMessage(agent, &length, "%s\n", line);
+  }
+
+  // part of the batch may be in the pipe, so the next batch
+  // would be read as the rest of this one. The agent is
+  // stopped and the behavior moves for the remaining games
+  if (!writeAgentMessage(agent, agent->message, length, deadline))
+  {
+    printf("Error: The agent did not read batch %llu in time and was stopped\n", (unsigned long long)agent->batchNo);
+    agent->timeoutCount++;
+    agent->alive = false;
+    kill(agent->pid, SIGKILL);
+    waitpid(agent->pid, NULL, 0);
+    pthread_mutex_unlock(&agent->lock);
+    return;
+  }
+
+  size_t consumed = 0;
+  char *line;
+  while ((line = readAgentLine(agent, &consumed, deadline)) != NULL)
+  {
+    if (parseAgentMoves(line, agent->batchNo, count, actions))
+    {
+      break;
+    }
+  }
+
+  if (line == NULL)
+  {
+    agent->timeoutCount++;
+
+    // answers that arrived before the deadline stay unused
+    for (int index = 0; index < count; index++)
+    {
+      actions[index] = EMPTY;
+    }
+  }
+
+  agent->answerLength -= consumed;
+  memmove(agent->answer, agent->answer + consumed, agent->answerLength);
+
+  pthread_mutex_unlock(&agent->lock);
+}
+
+/* Pipe reference agent */
+
+// The reference agents move the first legal action
+int selectReferenceAction(int legalMask)
+{
+  return legalMask != 0 ? __builtin_ctz(legalMask) : -1;
+}
+
+// Minimal agent speaking the protocol on stdin and stdout.
+// It moves the first legal action of every request, and
+// serves as an example for agents in other languages
+void runReferenceAgent()
+{
+  static char line[AGENT_READ_SIZE];
+
+  while (fgets(line, sizeof(line), stdin) != NULL)
+  {
+    unsigned long long batchNo;
+    int count;
+
+    if (strncmp(line, "ludo ", 5) == 0)
+    {
+      printf("ready\n");
+    }
+    else if (sscanf(line, "decide %llu %d", &batchNo, &count) == 2)
+    {
+      printf("moves %llu", batchNo);
+      for (int index = 0; index < count && fgets(line, sizeof(line), stdin) != NULL; index++)
+      {
+        int gameIndex, playerIndex, diceNumber, legalMask;
+        int action = -1;
+
+        if (sscanf(line, "%d %d %d %d", &gameIndex, &playerIndex, &diceNumber, &legalMask) == 4)
+        {
+          action = selectReferenceAction(legalMask);
+        }
+
+        printf(" %d", action);
+      }
+      printf("\n");
+    }
+    else if (strncmp(line, "quit", 4) == 0)
+    {
+      break;
+    }
+
+    fflush(stdout);
+  }
+}
+
+/* Shared memory rings */
+
+static void waitFutex(_Atomic uint32_t *address, uint32_t value, int timeoutMs)
+{
+  struct timespec timeout = {timeoutMs / 1000, (timeoutMs % 1000) * 1000000L};
+
+  syscall(SYS_futex, address, FUTEX_WAIT, value, &timeout, NULL, 0);
+}
+
+static void wakeFutex(_Atomic uint32_t *address)
+{
+  syscall(SYS_futex, address, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+static void publishShmRing(struct ShmRingIndex *index, uint32_t head)
+{
+  // sequentially consistent, so either the consumer sees the
+  // new head or the producer sees the consumer sleeping
+  atomic_store(&index->head, head);
+  if (atomic_load(&index->sleeping))
+  {
+    wakeFutex(&index->head);
+  }
+}
+
+// Head of the ring once it differs from tail, spinning for a
+// while before sleeping on the futex. Returns tail when
+// nothing arrived within timeoutMs
+static uint32_t waitShmRing(struct ShmRingIndex *index, uint32_t tail, int timeoutMs)
+{
+  for (int spin = 0; spin < SHM_AGENT_SPIN_NO; spin++)
+  {
+    uint32_t head = atomic_load_explicit(&index->head, memory_order_acquire);
+    if (head != tail)
+    {
+      return head;
+    }
+  }
+
+  atomic_store(&index->sleeping, 1);
+  uint32_t head = atomic_load(&index->head);
+  if (head == tail && timeoutMs > 0)
+  {
+    waitFutex(&index->head, tail, timeoutMs);
+    head = atomic_load(&index->head);
+  }
+  atomic_store(&index->sleeping, 0);
+
+  return head;
+}
+
+/* Shared memory agent process */
+
+// Create the region, run the command with its name and wait
+// for the agent to mark it ready. The name is unlinked once
+// the agent has mapped the region
+bool startShmAgent(struct ShmAgent *agent, char *command, int timeoutMs)
+{
+  static _Atomic int regionNo = 0;
+
+  memset(agent, 0, sizeof(struct ShmAgent));
+  agent->timeoutMs = timeoutMs > 0 ? timeoutMs : AGENT_TIMEOUT_MS;
+  pthread_mutex_init(&agent->lock, NULL);
+  snprintf(agent->name, sizeof(agent->name), "/ludo-agent-%d-%d", (int)getpid(), atomic_fetch_add(&regionNo, 1));
+
+  int file = shm_open(agent->name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (file < 0)
+  {
+    printf("Error: Could not create the shared memory %s\n", agent->name);
+    return false;
+  }
+
+  void *mapping = MAP_FAILED;
+  if (ftruncate(file, sizeof(struct ShmAgentRegion)) == 0)
+  {
+    mapping = mmap(NULL, sizeof(struct ShmAgentRegion), PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+  }
+  close(file);
+
+  if (mapping == MAP_FAILED)
+  {
+    printf("Error: Could not map the shared memory %s\n", agent->name);
+    shm_unlink(agent->name);
+    return false;
+  }
+
+  agent->region = mapping;
+  agent->region->magic = SHM_AGENT_MAGIC;
+  agent->region->version = AGENT_PROTOCOL_VERSION;
+  agent->region->enginePid = getpid();
+  atomic_store(&agent->region->state, SHM_AGENT_WAITING);
+
+  setenv(SHM_AGENT_ENVIRONMENT, agent->name, 1);
+  agent->pid = spawnAgentProcess(command, -1, -1);
+  unsetenv(SHM_AGENT_ENVIRONMENT);
+
+  long deadline = getMonotonicMs() + AGENT_HANDSHAKE_TIMEOUT_MS;
+  while (agent->pid > 0 && atomic_load(&agent->region->state) == SHM_AGENT_WAITING && getRemainingMs(deadline) > 0)
+  {
+    waitFutex(&agent->region->state, SHM_AGENT_WAITING, 10);
+  }
+
+  shm_unlink(agent->name);
+
+  if (agent->pid < 0 || atomic_load(&agent->region->state) != SHM_AGENT_READY)
+  {
+    printf("Error: The agent did not open the shared memory\n");
+    stopShmAgent(agent);
+    return false;
+  }
+
+  agent->alive = true;
+  return true;
+}
+
+void stopShmAgent(struct ShmAgent *agent)
+{
+  if (agent->region != NULL)
+  {
+    atomic_store(&agent->region->state, SHM_AGENT_CLOSED);
+    wakeFutex(&agent->region->requestIndex.head);
+  }
+
+  if (agent->pid > 0)
+  {
+    waitAgentProcess(agent->pid);
+  }
+
+  if (agent->region != NULL)
+  {
+    munmap(agent->region, sizeof(struct ShmAgentRegion));
+    agent->region = NULL;
+  }
+
+  agent->alive = false;
+  pthread_mutex_destroy(&agent->lock);
+}
+
+/* Shared memory batch evaluator */
+
+static void writeShmRequest(struct ShmAgentRequest *entry, uint32_t sequenceNo, struct DecisionRequest *request)
+{
+  entry->sequenceNo = sequenceNo;
+  entry->gameIndex = request->gameIndex;
+  entry->playerIndex = request->playerIndex;
+  entry->diceNumber = request->diceNumber;
+  entry->legalMask = request->legalMask;
+  entry->mysteryCellNo = request->mysteryCellNo == EMPTY ? BASE : request->mysteryCellNo;
+
+  for (int color = 0; color < PLAYER_NO; color++)
+  {
+    for (int pieceIndex = 0; pieceIndex < PIECE_NO; pieceIndex++)
+    {
+      struct Piece *piece = &request->players[color].pieces[pieceIndex];
+
+      entry->pieceCells[color][pieceIndex] = piece->cellNo;
+      entry->pieceFlags[color][pieceIndex] = getPieceFlags(piece, request->board);
+    }
+  }
+}
+
+// Read the answers that have arrived, keeping those of the
+// batch starting at firstSequenceNo. Returns how many of
+// the batch were answered
+static int readShmAnswers(struct ShmAgentRegion *region, uint32_t firstSequenceNo, int count, int *actions)
+{
+  struct ShmRingIndex *index = &region->answerIndex;
+  uint32_t tail = atomic_load_explicit(&index->tail, memory_order_relaxed);
+  uint32_t head = atomic_load_explicit(&index->head, memory_order_acquire);
+  int answered = 0;
+
+  for (; tail != head; tail++)
+  {
+    struct ShmAgentAnswer *answer = &region->answers[tail % SHM_AGENT_CAPACITY];
+    uint32_t offset = answer->sequenceNo - firstSequenceNo;
+
+    if (offset < (uint32_t)count)
+    {
+      actions[offset] = answer->action >= 0 && answer->action < PIECE_NO * 2 ? answer->action : EMPTY;
+      answered++;
+    }
+  }
+
+  atomic_store_explicit(&index->tail, tail, memory_order_release);
+
+  return answered;
+}
+
+// BatchEvaluator over a ShmAgent (the context)
+void evaluateShmAgentDecisions(void *context, struct DecisionRequest *requests, int count, int *actions)
+{
+  struct ShmAgent *agent = context;
+  struct ShmAgentRegion *region = agent->region;
+
+  for (int index = 0; index < count; index++)
+  {
+    actions[index] = EMPTY;
+  }
+
+  pthread_mutex_lock(&agent->lock);
+
+  agent->decisionCount += count;
+
+  // late answers of earlier batches are dropped here
+  uint32_t firstSequenceNo = agent->sequenceNo;
+  readShmAnswers(region, firstSequenceNo, 0, actions);
+
+  uint32_t head = atomic_load_explicit(&region->requestIndex.head, memory_order_relaxed);
+  uint32_t requestTail = atomic_load_explicit(&region->requestIndex.tail, memory_order_acquire);
+  uint32_t answerTail = atomic_load_explicit(&region->answerIndex.tail, memory_order_relaxed);
+
+  if (!agent->alive || head + count - requestTail > SHM_AGENT_CAPACITY || head + count - answerTail > SHM_AGENT_CAPACITY)
+  {
+    // the agent is gone or still busy with timed out batches
+    if (agent->alive)
+    {
+      agent->timeoutCount++;
+    }
+    agent->sequenceNo += count;
+    pthread_mutex_unlock(&agent->lock);
+    return;
+  }
+
+  for (int index = 0; index < count; index++)
+  {
+    writeShmRequest(&region->requests[(head + index) % SHM_AGENT_CAPACITY], firstSequenceNo + index, &requests[index]);
+  }
+  agent->sequenceNo += count;
+  publishShmRing(&region->requestIndex, head + count);
+
+  long deadline = getMonotonicMs() + agent->timeoutMs;
+  int answered = 0;
+
+  while (answered < count)
+  {
+    uint32_t tail = atomic_load_explicit(&region->answerIndex.tail, memory_order_relaxed);
+    int remainingMs = getRemainingMs(deadline);
+
+    if (waitShmRing(&region->answerIndex, tail, remainingMs) != tail)
+    {
+      answered += readShmAnswers(region, firstSequenceNo, count, actions);
+    }
+    else if (remainingMs == 0)
+    {
+      break;
+    }
+  }
+
+  if (answered < count)
+  {
+    agent->timeoutCount++;
+    agent->alive = isAgentProcessAlive(agent->pid);
+
+    for (int index = 0; index < count; index++)
+    {
+      actions[index] = EMPTY;
+    }
+  }
+
+  pthread_mutex_unlock(&agent->lock);
+}
+
+/* Shared memory agent side */
+
+// Map the region the engine named and mark the agent ready
+struct ShmAgentRegion *openShmAgentRegion(char *name)
+{
+  int file = name != NULL ? shm_open(name, O_RDWR, 0) : -1;
+  if (file < 0)
+  {
+    return NULL;
+  }
+
+  void *mapping = mmap(NULL, sizeof(struct ShmAgentRegion), PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+  close(file);
+
+  if (mapping == MAP_FAILED)
+  {
+    return NULL;
+  }
+
+  struct ShmAgentRegion *region = mapping;
+  if (region->magic != SHM_AGENT_MAGIC || region->version != AGENT_PROTOCOL_VERSION)
+  {
+    munmap(mapping, sizeof(struct ShmAgentRegion));
+    return NULL;
+  }
+
+  atomic_store(&region->state, SHM_AGENT_READY);
+  wakeFutex(&region->state);
+
+  return region;
+}
+
+void closeShmAgentRegion(struct ShmAgentRegion *region)
+{
+  munmap(region, sizeof(struct ShmAgentRegion));
+}
+
+// Number of requests waiting for an answer, blocking until
+// there is one. 0 once the engine has closed the region
+int waitShmRequests(struct ShmAgentRegion *region)
+{
+  struct ShmRingIndex *index = &region->requestIndex;
+  uint32_t tail = atomic_load_explicit(&index->tail, memory_order_relaxed);
+
+  while (atomic_load(&region->state) == SHM_AGENT_READY)
+  {
+    uint32_t head = waitShmRing(index, tail, AGENT_TIMEOUT_MS);
+    if (head != tail)
+    {
+      return (int)(head - tail);
+    }
+
+    // the engine may have been killed without closing
+    if (kill(region->enginePid, 0) != 0 && errno == ESRCH)
+    {
+      break;
+    }
+  }
+
+  return 0;
+}
+
+// Pending request index, read in place
+struct ShmAgentRequest *getShmRequest(struct ShmAgentRegion *region, int index)
+{
+  uint32_t tail = atomic_load_explicit(&region->requestIndex.tail, memory_order_relaxed);
+
+  return &region->requests[(tail + index) % SHM_AGENT_CAPACITY];
+}
+
+// Answer the first count pending requests in order and
+// release their slots
+void answerShmRequests(struct ShmAgentRegion *region, int count, int *actions)
+{
+  uint32_t head = atomic_load_explicit(&region->answerIndex.head, memory_order_relaxed);
+
+  for (int index = 0; index < count; index++)
+  {
+    region->answers[(head + index) % SHM_AGENT_CAPACITY] = (struct ShmAgentAnswer){
+      getShmRequest(region, index)->sequenceNo,
+      actions[index],
+    };
+  }
+
+  uint32_t tail = atomic_load_explicit(&region->requestIndex.tail, memory_order_relaxed);
+  atomic_store_explicit(&region->requestIndex.tail, tail + count, memory_order_release);
+  publishShmRing(&region->answerIndex, head + count);
+}
+
+// Reference agent of the shared memory transport, it moves
+// the first legal action like the pipe reference agent
+void runShmReferenceAgent()
+{
+  struct ShmAgentRegion *region = openShmAgentRegion(getenv(SHM_AGENT_ENVIRONMENT));
+  int actions[SHM_AGENT_CAPACITY];
+  int count;
+
+  if (region == NULL)
+  {
+    printf("Error: Could not open the shared memory of %s\n", SHM_AGENT_ENVIRONMENT);
+    return;
+  }
+
+  while ((count = waitShmRequests(region)) > 0)
+  {
+    for (int index = 0; index < count; index++)
+    {
+      actions[index] = selectReferenceAction(getShmRequest(region, index)->legalMask);
+    }
+
+    answerShmRequests(region, count, actions);
+  }
+
+  closeShmAgentRegion(region);
+}
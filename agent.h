@@ -0,0 +1,161 @@
+#ifndef AGENT_H
+#define AGENT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include "types.h"
+
+#define AGENT_PROTOCOL_VERSION 1
+#define AGENT_TIMEOUT_MS 100
+#define AGENT_HANDSHAKE_TIMEOUT_MS 5000
+#define AGENT_READ_SIZE 65536
+#define AGENT_REQUEST_LINE_SIZE 256
+#define SHM_AGENT_MAGIC 0x314D485344554CULL // "LUDSHM1"
+#define SHM_AGENT_CAPACITY 4096 // requests in flight, at least SCHEDULER_MAX_BATCH
+#define SHM_AGENT_SPIN_NO 256 // polls of a ring before sleeping on its futex
+#define SHM_AGENT_ENVIRONMENT "LUDO_AGENT_SHM" // name of the region for the agent command
+
+// Line protocol between the engine and an external agent
+// process over its stdin and stdout. Fields are separated
+// by single spaces and every message ends with '\n'.
+//
+// engine: ludo <version>
+// agent:  ready
+//
+// engine: decide <batch> <count>
+//         followed by count request lines:
+//         <game> <player> <dice> <legal> <mystery> <cells 16> <flags 16>
+// agent:  moves <batch> <action 1> ... <action count>
+//
+// engine: quit
+//
+// game identifies the game of the request across batches.
+// player is the color index (yellow, blue, red, green).
+// dice is the value after the mystery effects. legal has bit
+// a set when action a is legal: a < 4 moves piece a alone,
+// a >= 4 moves the block of piece a - 4. mystery is the
+// mystery cell or -1. cells and flags are color major: -1
+// for BASE, 0 to 51 on the track, 52 to 56 in the home
+// straight and 57 for HOME, flags are PIECE_FLAG bits.
+//
+// Actions are answered in request order. -1 or an illegal
+// action leaves the move to the built-in behavior. When the
+// answer is not complete within the timeout (one budget for
+// the whole batch), the behavior moves for every request of
+// the batch and a late answer is discarded by its batch no.
+struct PipeAgent
+{
+  pid_t pid;
+  int requestFile; // agent stdin
+  int answerFile; // agent stdout
+  int timeoutMs;
+  bool alive;
+  uint64_t batchNo;
+  char *message;
+  size_t messageCapacity;
+  char answer[AGENT_READ_SIZE];
+  size_t answerLength;
+  long timeoutCount;
+  long decisionCount;
+  pthread_mutex_t lock;
+};
+
+enum ShmAgentState
+{
+  SHM_AGENT_WAITING,
+  SHM_AGENT_READY,
+  SHM_AGENT_CLOSED
+};
+
+// Binary form of a request line of the pipe protocol
+struct ShmAgentRequest
+{
+  uint32_t sequenceNo;
+  int32_t gameIndex;
+  int8_t playerIndex;
+  int8_t diceNumber;
+  uint8_t legalMask;
+  int8_t mysteryCellNo; // BASE when there is none
+  int8_t pieceCells[PLAYER_NO][PIECE_NO];
+  uint8_t pieceFlags[PLAYER_NO][PIECE_NO];
+};
+
+struct ShmAgentAnswer
+{
+  uint32_t sequenceNo; // of the request
+  int32_t action; // -1 for the built-in behavior
+};
+
+// Indexes of a single producer single consumer ring. head
+// is only written by the producer and tail by the consumer.
+// The consumer sets sleeping before it waits on the head
+// futex, so the producer only wakes it when needed
+struct ShmRingIndex
+{
+  _Atomic uint32_t head __attribute__((aligned(64)));
+  _Atomic uint32_t sleeping;
+  _Atomic uint32_t tail __attribute__((aligned(64)));
+};
+
+// Shared memory transport for agents on the same machine.
+// The engine creates the region, runs the agent command with
+// its name in SHM_AGENT_ENVIRONMENT and waits for the agent
+// to set state to SHM_AGENT_READY.
+//
+// Requests go to the agent through the request ring and
+// answers come back through the answer ring, both read in
+// place. The engine never has more than SHM_AGENT_CAPACITY
+// requests unanswered, so neither ring can overflow. The
+// timeout and fallback rules are those of the pipe protocol,
+// with late answers discarded by sequence no.
+struct ShmAgentRegion
+{
+  uint64_t magic;
+  uint32_t version;
+  _Atomic uint32_t state;
+  int32_t enginePid;
+  struct ShmRingIndex requestIndex;
+  struct ShmRingIndex answerIndex;
+  struct ShmAgentRequest requests[SHM_AGENT_CAPACITY];
+  struct ShmAgentAnswer answers[SHM_AGENT_CAPACITY];
+};
+
+struct ShmAgent
+{
+  pid_t pid;
+  char name[64];
+  struct ShmAgentRegion *region;
+  int timeoutMs;
+  bool alive;
+  uint32_t sequenceNo;
+  long timeoutCount;
+  long decisionCount;
+  pthread_mutex_t lock;
+};
+
+// Function declarations for external agents
+
+bool startPipeAgent(struct PipeAgent *agent, char *command, int timeoutMs);
+void stopPipeAgent(struct PipeAgent *agent);
+void evaluatePipeAgentDecisions(void *context, struct DecisionRequest *requests, int count, int *actions);
+void runReferenceAgent();
+int selectReferenceAction(int legalMask);
+int formatDecisionRequest(char *line, struct DecisionRequest *request);
+
+bool startShmAgent(struct ShmAgent *agent, char *command, int timeoutMs);
+void stopShmAgent(struct ShmAgent *agent);
+void evaluateShmAgentDecisions(void *context, struct DecisionRequest *requests, int count, int *actions);
+
+// Function declarations for the agent side of the region
+
+struct ShmAgentRegion *openShmAgentRegion(char *name);
+void closeShmAgentRegion(struct ShmAgentRegion *region);
+int waitShmRequests(struct ShmAgentRegion *region);
+struct ShmAgentRequest *getShmRequest(struct ShmAgentRegion *region, int index);
+void answerShmRequests(struct ShmAgentRegion *region, int count, int *actions);
+void runShmReferenceAgent();
+
+#endif // !AGENT_H
@@ -1,4 +1,12 @@
 #!/bin/bash
 
 # Build the game file
-gcc game.c main.c -o game.out
+# (add -DLUDO_DEBUG to verify the per cell counters on every query)
+gcc game.c simulation.c tuner.c endgame.c selfplay.c policy.c scheduler.c agent.c server.c render.c spectate.c replay.c query.c export.c steal.c topology.c shard.c compare.c main.c -o game.out -pthread -lm
+
+# Build the offline solver of home_table.h
+# (run ./home_solver.out > home_table.h after changing the movement rules)
+gcc game.c endgame.c home_solver.c -o home_solver.out -lm
+
+# Build the batched training environment as a shared library
+gcc -shared -fPIC game.c simulation.c endgame.c policy.c env.c -o libludo_env.so -pthread
@@ -0,0 +1,68 @@
+#!/bin/bash
+
+# Check that games still play out as before and that the tools
+# built on them agree with each other
+# (run ./check.sh after build.sh, a failing check exits with 1)
+
+# Fingerprint of games 0 to 2999 with the built-in weights,
+# update it only with changes meant to alter how games are played
+FINGERPRINT=42d65ecd0790dfd3
+
+root=$(cd "$(dirname "$0")" && pwd)
+game="$root/game.out"
+failures=0
+
+check()
+{
+  if "$@"
+  then
+    echo "ok   $name"
+  else
+    echo "FAIL $name"
+    failures=$((failures + 1))
+  fi
+}
+
+# run in an empty directory so no weights or endgame table is read
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+cd "$work" || exit 1
+
+name="fingerprint of 3000 games"
+check grep -q "seed 0: $FINGERPRINT," <("$game" --fingerprint 3000 0)
+
+name="fingerprint of 300 games does not depend on threads"
+check cmp -s <("$game" --fingerprint 300 0 1) <("$game" --fingerprint 300 0 4)
+
+name="fingerprint of 300 games with pinned workers"
+check cmp -s <("$game" --fingerprint 300 0) <("$game" --pinned --fingerprint 300 0)
+
+# the counters of every cell and the board totals are recounted
+# after every move when built with -DLUDO_DEBUG
+gcc -DLUDO_DEBUG -I"$root" $(ls "$root"/*.c | grep -vE '/(home_solver|env)\.c$') -o debug.out -pthread -lm
+name="board counters in 300 games"
+check cmp -s <("$game" --fingerprint 300 0) <(./debug.out --fingerprint 300 0)
+
+name="make and unmake of every legal move in 1000 games"
+check grep -q " 0 mismatches" <("$game" --check-undo 1000)
+
+"$game" --shard 0/2 1000 1 first.shard 1 records > /dev/null
+"$game" --shard 1/2 1000 1 second.shard 1 records > /dev/null
+"$game" --shard 0/1 1000 1 whole.shard 1 records > /dev/null
+"$game" --merge merged.shard first.shard second.shard > /dev/null
+name="merged shards match a single shard"
+check cmp -s merged.shard whole.shard
+
+# with more threads the games are written in the order they end
+"$game" --record first.rpl 50 10 1 > /dev/null
+"$game" --record second.rpl 50 10 1 > /dev/null
+name="replay files are repeatable"
+check cmp -s first.rpl second.rpl
+
+name="replay seeks play the games as recorded"
+check bash -c "for index in 0 17 49; do '$game' --replay first.rpl \$index 40 > /dev/null || exit 1; done"
+
+name="work stealing gives the results of static chunks"
+check grep -q "Results by game index identical" <("$game" --steal-bench 500 2)
+
+exit $((failures > 0))
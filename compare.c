@@ -0,0 +1,229 @@
+#include "compare.h"
+#include "game.h"
+#include "simulation.h"
+#include "steal.h"
+#include <math.h>
+#include <string.h>
+
+static char *decisionNames[] = {"undecided", "first better", "second better", "negligible", "failed"};
+
+struct CompareOptions getDefaultCompareOptions()
+{
+  struct CompareOptions options = {
+    RED,
+    COMPARE_DEFAULT_WEIGHTS,
+    WEIGHTS_CONFIG_FILE,
+    0.02,
+    500,
+    100000,
+    0,
+    DEFAULT_FIRST_SEED
+  };
+
+  return options;
+}
+
+static bool loadCompareWeights(char *fileName, enum Color color, int baseWeights[][WEIGHT_NO], int weights[][WEIGHT_NO])
+{
+  int fileWeights[PLAYER_NO][WEIGHT_NO];
+
+  memcpy(weights, baseWeights, PLAYER_NO * sizeof(weights[0]));
+  if (strcmp(fileName, COMPARE_DEFAULT_WEIGHTS) == 0)
+  {
+    setDefaultPieceWeights(color, weights[color]);
+    return true;
+  }
+
+  if (!loadPieceWeights(fileName, fileWeights))
+  {
+    printf("Error: Could not read the weights in %s\n", fileName);
+    return false;
+  }
+
+  memcpy(weights[color], fileWeights[color], sizeof(weights[color]));
+  return true;
+}
+
+// Two SPRTs on the per game difference d (1 when only the
+// first variant won, -1 when only the second did, else 0), one
+// for each variant being better by minDifference against both
+// being equal, with d taken as normal. A variant is better once
+// its test accepts, the difference is negligible once both
+// tests reject. The variance of d is at least
+// minDifference * (1 - minDifference) under either alternative,
+// which keeps variants that play the same games from dividing
+// by zero and lets them be declared negligible.
+// The test is approximate: d is not normal, its variance is
+// estimated from the games so far with that floor, and the
+// drift is taken at the alternative rather than fitted. Over
+// simulated split rates of 0.1 to 0.5 equal variants were
+// called better in 2 to 4% of runs per side, about 7% in all
+// against the nominal 5%, and a difference of minDifference was
+// found in about 98% of runs
+static enum CompareDecision decideComparison
+(
+  long firstWins, long secondWins, long gameCount, double minDifference, double *ratios
+)
+{
+  double upperBound = log((1.0 - COMPARE_BETA) / COMPARE_ALPHA);
+  double lowerBound = log(COMPARE_BETA / (1.0 - COMPARE_ALPHA));
+  double meanDifference = (double)(firstWins - secondWins) / gameCount;
+  double variance = (double)(firstWins + secondWins) / gameCount - meanDifference * meanDifference;
+  double minVariance = minDifference * (1.0 - minDifference);
+
+  variance = variance > minVariance ? variance : minVariance;
+  double drift = gameCount * minDifference * minDifference / 2;
+  ratios[0] = (minDifference * (firstWins - secondWins) - drift) / variance;
+  ratios[1] = (minDifference * (secondWins - firstWins) - drift) / variance;
+
+  if (ratios[0] >= upperBound)
+  {
+    return COMPARE_FIRST_BETTER;
+  }
+
+  if (ratios[1] >= upperBound)
+  {
+    return COMPARE_SECOND_BETTER;
+  }
+
+  if (ratios[0] <= lowerBound && ratios[1] <= lowerBound)
+  {
+    return COMPARE_NEGLIGIBLE;
+  }
+
+  return COMPARE_UNDECIDED;
+}
+
+// Play batches of games on the same seeds with both weights
+// until the test decides or maxGames games have been played
+enum CompareDecision compareWeightFiles(struct CompareOptions *options)
+{
+  int baseWeights[PLAYER_NO][WEIGHT_NO];
+  int firstWeights[PLAYER_NO][WEIGHT_NO];
+  int secondWeights[PLAYER_NO][WEIGHT_NO];
+  long colorWins[2][PLAYER_NO] = {{0}};
+  long splitWins[2] = {0, 0};
+  double ratios[2] = {0, 0};
+  enum CompareDecision decision = COMPARE_UNDECIDED;
+  int playedGames = 0;
+
+  loadPieceWeights(WEIGHTS_CONFIG_FILE, baseWeights);
+  if
+  (
+    !loadCompareWeights(options->firstFile, options->color, baseWeights, firstWeights)
+    || !loadCompareWeights(options->secondFile, options->color, baseWeights, secondWeights)
+  )
+  {
+    return COMPARE_FAILED;
+  }
+
+  if (options->batchSize < 1 || options->maxGames < 1 || options->minDifference <= 0 || options->minDifference >= 1.0)
+  {
+    printf("Error: The batch and game counts must be positive and the difference between 0 and 1\n");
+    return COMPARE_FAILED;
+  }
+
+  if (options->threadCount < 1)
+  {
+    options->threadCount = getDefaultThreadCount();
+  }
+
+  struct GameResult *firstResults = malloc(options->batchSize * sizeof(struct GameResult));
+  struct GameResult *secondResults = malloc(options->batchSize * sizeof(struct GameResult));
+
+  if (firstResults == NULL || secondResults == NULL)
+  {
+    printf("Error: Memory allocation failed\n");
+    exit(1);
+  }
+
+  printf
+  (
+    "Comparing %s weights of %s and %s, win rate difference %.1f points, alpha %.2f, beta %.2f\n",
+    getName(options->color), options->firstFile, options->secondFile,
+    100.0 * options->minDifference, COMPARE_ALPHA, COMPARE_BETA
+  );
+
+  while (decision == COMPARE_UNDECIDED && playedGames < options->maxGames)
+  {
+    int batchSize = options->batchSize < options->maxGames - playedGames ? options->batchSize : options->maxGames - playedGames;
+    uint64_t firstSeed = options->seed + playedGames;
+
+    if
+    (
+      !runStealingGameBatch(firstSeed, batchSize, firstWeights, options->threadCount, firstResults)
+      || !runStealingGameBatch(firstSeed, batchSize, secondWeights, options->threadCount, secondResults)
+    )
+    {
+      printf("Error: The games of a batch were not all played\n");
+      free(firstResults);
+      free(secondResults);
+      return COMPARE_FAILED;
+    }
+
+    for (int gameIndex = 0; gameIndex < batchSize; gameIndex++)
+    {
+      int firstWinner = firstResults[gameIndex].winners[0];
+      int secondWinner = secondResults[gameIndex].winners[0];
+
+      // games cut at MAX_GAME_ROUNDS can end without a winner
+      if (firstWinner != EMPTY)
+      {
+        colorWins[0][firstWinner]++;
+      }
+      if (secondWinner != EMPTY)
+      {
+        colorWins[1][secondWinner]++;
+      }
+
+      bool firstWon = firstWinner == (int)options->color;
+      bool secondWon = secondWinner == (int)options->color;
+      if (firstWon != secondWon)
+      {
+        splitWins[firstWon ? 0 : 1]++;
+      }
+    }
+
+    playedGames += batchSize;
+    decision = decideComparison(splitWins[0], splitWins[1], playedGames, options->minDifference, ratios);
+    printf
+    (
+      "  %7d games  %s wins %5.2f%% vs %5.2f%%  split %ld:%ld  LLR %+.2f %+.2f\n",
+      playedGames, getName(options->color),
+      100.0 * colorWins[0][options->color] / playedGames, 100.0 * colorWins[1][options->color] / playedGames,
+      splitWins[0], splitWins[1], ratios[0], ratios[1]
+    );
+  }
+
+  printf("Decision after %d of at most %d games per variant: %s\n", playedGames, options->maxGames, decisionNames[decision]);
+  printf("  %-6s %8s %8s\n", "wins", "first", "second");
+  for (int color = 0; color < PLAYER_NO; color++)
+  {
+    printf
+    (
+      "  %-6s %7.2f%% %7.2f%%\n", getName(color),
+      100.0 * colorWins[0][color] / playedGames, 100.0 * colorWins[1][color] / playedGames
+    );
+  }
+
+  free(firstResults);
+  free(secondResults);
+  return decision;
+}
+
+int getCompareExitCode(enum CompareDecision decision)
+{
+  switch (decision)
+  {
+    case COMPARE_NEGLIGIBLE:
+      return COMPARE_EXIT_NEGLIGIBLE;
+    case COMPARE_FIRST_BETTER:
+      return COMPARE_EXIT_FIRST_BETTER;
+    case COMPARE_SECOND_BETTER:
+      return COMPARE_EXIT_SECOND_BETTER;
+    case COMPARE_UNDECIDED:
+      return COMPARE_EXIT_UNDECIDED;
+    default:
+      return COMPARE_EXIT_FAILED;
+  }
+}
@@ -0,0 +1,51 @@
+#ifndef COMPARE_H
+#define COMPARE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "types.h"
+
+#define COMPARE_DEFAULT_WEIGHTS "default" // the built-in weights instead of a file
+#define COMPARE_ALPHA 0.05 // nominal, the approximate test calls about 2-4% per side
+#define COMPARE_BETA 0.05 // nominal, about 2% missed at minDifference
+
+// Exit codes of --compare
+#define COMPARE_EXIT_NEGLIGIBLE 0
+#define COMPARE_EXIT_FAILED 1
+#define COMPARE_EXIT_FIRST_BETTER 2
+#define COMPARE_EXIT_SECOND_BETTER 3
+#define COMPARE_EXIT_UNDECIDED 4
+
+// Compare the weights of one color from two files, the other
+// colors keep the weights of WEIGHTS_CONFIG_FILE. Both variants
+// play the same seeds, so only the games won by exactly one of
+// them (split games) move the difference of their win rates
+struct CompareOptions
+{
+  enum Color color;
+  char *firstFile;
+  char *secondFile;
+  double minDifference; // of win rates worth detecting, 0.02 is 2 points
+  int batchSize; // games between two tests
+  int maxGames;
+  int threadCount;
+  uint64_t seed;
+};
+
+// Sequential test after each batch
+enum CompareDecision
+{
+  COMPARE_UNDECIDED,
+  COMPARE_FIRST_BETTER,
+  COMPARE_SECOND_BETTER,
+  COMPARE_NEGLIGIBLE,
+  COMPARE_FAILED // weights, options or games could not be used
+};
+
+// Function declarations for comparing weights with early stopping
+
+struct CompareOptions getDefaultCompareOptions();
+enum CompareDecision compareWeightFiles(struct CompareOptions *options);
+int getCompareExitCode(enum CompareDecision decision);
+
+#endif // !COMPARE_H
@@ -0,0 +1,585 @@
+#include "endgame.h"
+#include "game.h"
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define COUNT_KEY_NO 3125 // 5 cells with 0 to 4 pieces each
+#define CYCLE_TOLERANCE 1e-12
+#define MAX_CYCLE_ITERATIONS 1000
+
+// Piece counts on each home straight cell for every
+// player state and the reverse lookup from the counts
+static uint8_t stateCounts[ENDGAME_PLAYER_STATE_NO][ENDGAME_POSITION_NO];
+static int16_t stateIndexOfKey[COUNT_KEY_NO];
+static bool playerStatesReady = false;
+
+static void *mappedTable = NULL;
+static size_t mappedSize = 0;
+static struct EndgameEntry *endgameTables[ENDGAME_MAX_PLAYERS + 1];
+
+/* Player state functions
+ */
+
+static int getCountKey(uint8_t *counts)
+{
+  int key = 0;
+  for (int position = ENDGAME_POSITION_NO - 1; position >= 0; position--)
+  {
+    key = key * (PIECE_NO + 1) + counts[position];
+  }
+
+  return key;
+}
+
+static void initializePlayerStates()
+{
+  if (playerStatesReady)
+  {
+    return;
+  }
+
+  int stateNo = 0;
+  memset(stateIndexOfKey, 0xFF, sizeof(stateIndexOfKey));
+
+  for (int key = 0; key < COUNT_KEY_NO; key++)
+  {
+    uint8_t counts[ENDGAME_POSITION_NO];
+    int pieceCount = 0;
+
+    for (int position = 0, rest = key; position < ENDGAME_POSITION_NO; position++)
+    {
+      counts[position] = rest % (PIECE_NO + 1);
+      pieceCount += counts[position];
+      rest /= PIECE_NO + 1;
+    }
+
+    if (pieceCount > PIECE_NO)
+    {
+      continue;
+    }
+
+    memcpy(stateCounts[stateNo], counts, sizeof(counts));
+    stateIndexOfKey[key] = stateNo;
+    stateNo++;
+  }
+
+  tryValueAndCatchError(stateNo != ENDGAME_PLAYER_STATE_NO, '=', true);
+  playerStatesReady = true;
+}
+
+// Sum of the distances of the pieces to HOME
+static int getPipCount(int state)
+{
+  int pipCount = 0;
+  for (int position = 0; position < ENDGAME_POSITION_NO; position++)
+  {
+    pipCount += stateCounts[state][position] * (ENDGAME_POSITION_NO - position);
+  }
+
+  return pipCount;
+}
+
+static int getFinishedState()
+{
+  uint8_t counts[ENDGAME_POSITION_NO] = {0};
+
+  return stateIndexOfKey[getCountKey(counts)];
+}
+
+static uint64_t getTableSize(int playerCount)
+{
+  uint64_t size = 1;
+  for (int playerIndex = 0; playerIndex < playerCount; playerIndex++)
+  {
+    size *= ENDGAME_PLAYER_STATE_NO;
+  }
+
+  return size;
+}
+
+static void splitPosition(uint64_t position, int playerCount, int *states)
+{
+  for (int playerIndex = 0; playerIndex < playerCount; playerIndex++)
+  {
+    states[playerIndex] = position % ENDGAME_PLAYER_STATE_NO;
+    position /= ENDGAME_PLAYER_STATE_NO;
+  }
+}
+
+// Position after the turn passes, with the next
+// player first and the mover (in moverState) last
+static uint64_t getNextPosition(int *states, int playerCount, int moverState)
+{
+  uint64_t position = moverState;
+  for (int playerIndex = playerCount - 1; playerIndex > 0; playerIndex--)
+  {
+    position = position * ENDGAME_PLAYER_STATE_NO + states[playerIndex];
+  }
+
+  return position;
+}
+
+/* Generation functions
+ */
+
+// Win chances of the position from the point of view of
+// its mover, one dice value at a time. Moves go to
+// positions with fewer pips, which are already solved,
+// while dice values that cannot move pass the turn
+static void evaluatePosition
+(
+  double (*values)[ENDGAME_MAX_PLAYERS], int playerCount,
+  uint64_t position, double *result, uint16_t *moves
+)
+{
+  int states[ENDGAME_MAX_PLAYERS];
+  splitPosition(position, playerCount, states);
+
+  // a throw of 6 cannot move any piece in the home straight
+  // and the player throws again, up to 3 throws per turn
+  double throwWeight = (1.0 + 1.0 / MAX_DICE_VALUE + 1.0 / (MAX_DICE_VALUE * MAX_DICE_VALUE)) / MAX_DICE_VALUE;
+  double passWeight = 1.0 / (MAX_DICE_VALUE * MAX_DICE_VALUE * MAX_DICE_VALUE);
+
+  double *passed = values[getNextPosition(states, playerCount, states[0])];
+  double passedValue[ENDGAME_MAX_PLAYERS];
+  for (int playerIndex = 0; playerIndex < playerCount; playerIndex++)
+  {
+    passedValue[playerIndex] = passed[(playerIndex + playerCount - 1) % playerCount];
+    result[playerIndex] = passWeight * passedValue[playerIndex];
+  }
+
+  *moves = 0;
+
+  for (int diceNumber = 1; diceNumber < MAX_DICE_VALUE; diceNumber++)
+  {
+    double bestValue[ENDGAME_MAX_PLAYERS];
+    int bestPosition = ENDGAME_NO_MOVE;
+
+    memcpy(bestValue, passedValue, sizeof(bestValue));
+
+    for (int from = 0; from < ENDGAME_POSITION_NO; from++)
+    {
+      if (stateCounts[states[0]][from] == 0 || from + diceNumber > ENDGAME_POSITION_NO)
+      {
+        continue;
+      }
+
+      uint8_t counts[ENDGAME_POSITION_NO];
+      memcpy(counts, stateCounts[states[0]], sizeof(counts));
+      counts[from]--;
+      if (from + diceNumber < ENDGAME_POSITION_NO)
+      {
+        counts[from + diceNumber]++;
+      }
+
+      int moverState = stateIndexOfKey[getCountKey(counts)];
+      double value[ENDGAME_MAX_PLAYERS] = {0};
+
+      if (moverState == getFinishedState())
+      {
+        value[0] = 1.0;
+      }
+      else
+      {
+        double *next = values[getNextPosition(states, playerCount, moverState)];
+        for (int playerIndex = 0; playerIndex < playerCount; playerIndex++)
+        {
+          value[playerIndex] = next[(playerIndex + playerCount - 1) % playerCount];
+        }
+      }
+
+      if (bestPosition == ENDGAME_NO_MOVE || value[0] > bestValue[0])
+      {
+        memcpy(bestValue, value, sizeof(bestValue));
+        bestPosition = from;
+      }
+    }
+
+    *moves |= bestPosition << (ENDGAME_MOVE_BITS * (diceNumber - 1));
+
+    for (int playerIndex = 0; playerIndex < playerCount; playerIndex++)
+    {
+      result[playerIndex] += throwWeight * bestValue[playerIndex];
+    }
+  }
+}
+
+static bool isPositionPlayable(int *states, int playerCount)
+{
+  for (int playerIndex = 0; playerIndex < playerCount; playerIndex++)
+  {
+    if (states[playerIndex] == getFinishedState())
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Solve the positions that only differ by whose turn it
+// is together, since passing the turn cycles through them
+static void solveCycle
+(
+  double (*values)[ENDGAME_MAX_PLAYERS], int playerCount,
+  uint64_t position, uint16_t *moves
+)
+{
+  uint64_t cycle[ENDGAME_MAX_PLAYERS];
+  int states[ENDGAME_MAX_PLAYERS];
+
+  cycle[0] = position;
+  for (int cycleIndex = 1; cycleIndex < playerCount; cycleIndex++)
+  {
+    splitPosition(cycle[cycleIndex - 1], playerCount, states);
+    cycle[cycleIndex] = getNextPosition(states, playerCount, states[0]);
+  }
+
+  for (int iteration = 0; iteration < MAX_CYCLE_ITERATIONS; iteration++)
+  {
+    double change = 0;
+
+    for (int cycleIndex = 0; cycleIndex < playerCount; cycleIndex++)
+    {
+      double result[ENDGAME_MAX_PLAYERS];
+      evaluatePosition(values, playerCount, cycle[cycleIndex], result, &moves[cycle[cycleIndex]]);
+
+      for (int playerIndex = 0; playerIndex < playerCount; playerIndex++)
+      {
+        double difference = result[playerIndex] - values[cycle[cycleIndex]][playerIndex];
+        change = difference > change ? difference : (-difference > change ? -difference : change);
+        values[cycle[cycleIndex]][playerIndex] = result[playerIndex];
+      }
+    }
+
+    if (change < CYCLE_TOLERANCE)
+    {
+      break;
+    }
+  }
+}
+
+static struct EndgameEntry *buildTable(int playerCount)
+{
+  uint64_t size = getTableSize(playerCount);
+  double (*values)[ENDGAME_MAX_PLAYERS] = calloc(size, sizeof(*values));
+  uint16_t *moves = calloc(size, sizeof(uint16_t));
+  bool *solved = calloc(size, sizeof(bool));
+  struct EndgameEntry *table = calloc(size, sizeof(struct EndgameEntry));
+
+  if (values == NULL || moves == NULL || solved == NULL || table == NULL)
+  {
+    printf("Error: Memory allocation failed\n");
+    exit(1);
+  }
+
+  // bucket the positions by total pips so they can be solved
+  // in increasing order, after every position they move to
+  int maxPipCount = playerCount * PIECE_NO * ENDGAME_POSITION_NO;
+  uint64_t *bucketStart = calloc(maxPipCount + 2, sizeof(uint64_t));
+  uint64_t *order = malloc(size * sizeof(uint64_t));
+  uint8_t *pipCounts = malloc(size);
+
+  if (bucketStart == NULL || order == NULL || pipCounts == NULL)
+  {
+    printf("Error: Memory allocation failed\n");
+    exit(1);
+  }
+
+  for (uint64_t position = 0; position < size; position++)
+  {
+    int states[ENDGAME_MAX_PLAYERS];
+    splitPosition(position, playerCount, states);
+
+    pipCounts[position] = 0;
+    for (int playerIndex = 0; playerIndex < playerCount; playerIndex++)
+    {
+      pipCounts[position] += getPipCount(states[playerIndex]);
+    }
+    bucketStart[pipCounts[position] + 1]++;
+  }
+
+  for (int pipCount = 1; pipCount <= maxPipCount + 1; pipCount++)
+  {
+    bucketStart[pipCount] += bucketStart[pipCount - 1];
+  }
+
+  for (uint64_t position = 0; position < size; position++)
+  {
+    order[bucketStart[pipCounts[position]]++] = position;
+  }
+
+  for (uint64_t orderIndex = 0; orderIndex < size; orderIndex++)
+  {
+    uint64_t position = order[orderIndex];
+    int states[ENDGAME_MAX_PLAYERS];
+
+    splitPosition(position, playerCount, states);
+    if (solved[position] || !isPositionPlayable(states, playerCount))
+    {
+      continue;
+    }
+
+    solveCycle(values, playerCount, position, moves);
+
+    for (int cycleIndex = 0; cycleIndex < playerCount; cycleIndex++)
+    {
+      solved[position] = true;
+      splitPosition(position, playerCount, states);
+      position = getNextPosition(states, playerCount, states[0]);
+    }
+  }
+
+  free(bucketStart);
+  free(order);
+  free(pipCounts);
+
+  for (uint64_t position = 0; position < size; position++)
+  {
+    for (int playerIndex = 0; playerIndex < playerCount; playerIndex++)
+    {
+      table[position].winChance[playerIndex] = (uint16_t)(values[position][playerIndex] * ENDGAME_CHANCE_SCALE + 0.5);
+    }
+    table[position].moves = moves[position];
+  }
+
+  free(values);
+  free(moves);
+  free(solved);
+
+  return table;
+}
+
+// Retrograde analysis of every home straight endgame with
+// 2 or 3 remaining players, written as one file that is
+// memory mapped by loadEndgameTable. 4 players would need
+// 126^4 positions and are left to the behaviors
+bool generateEndgameTable(char *fileName)
+{
+  initializePlayerStates();
+
+  FILE *file = fopen(fileName, "wb");
+  if (file == NULL)
+  {
+    printf("Error: Could not open %s for writing\n", fileName);
+    return false;
+  }
+
+  struct EndgameHeader header = {0};
+  header.magic = ENDGAME_MAGIC;
+  header.playerStateNo = ENDGAME_PLAYER_STATE_NO;
+  header.tableNo = ENDGAME_MAX_PLAYERS - ENDGAME_MIN_PLAYERS + 1;
+
+  uint64_t offset = sizeof(header);
+  for (int playerCount = ENDGAME_MIN_PLAYERS; playerCount <= ENDGAME_MAX_PLAYERS; playerCount++)
+  {
+    header.offsets[playerCount] = offset;
+    offset += getTableSize(playerCount) * sizeof(struct EndgameEntry);
+  }
+
+  bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+
+  for (int playerCount = ENDGAME_MIN_PLAYERS; playerCount <= ENDGAME_MAX_PLAYERS && written; playerCount++)
+  {
+    printf("Solving home straight endgames of %d players...\n", playerCount);
+
+    struct EndgameEntry *table = buildTable(playerCount);
+    written = fwrite(table, sizeof(struct EndgameEntry), getTableSize(playerCount), file) == getTableSize(playerCount);
+    free(table);
+  }
+
+  if (fclose(file) != 0 || !written)
+  {
+    printf("Error: Could not write %s\n", fileName);
+    return false;
+  }
+
+  printf("Endgame table written to %s\n", fileName);
+  return true;
+}
+
+/* Probe functions
+ */
+
+bool loadEndgameTable(char *fileName)
+{
+  if (mappedTable != NULL)
+  {
+    return true;
+  }
+
+  initializePlayerStates();
+
+  int descriptor = open(fileName, O_RDONLY);
+  if (descriptor < 0)
+  {
+    return false;
+  }
+
+  struct stat fileStat;
+  if (fstat(descriptor, &fileStat) != 0 || (size_t)fileStat.st_size < sizeof(struct EndgameHeader))
+  {
+    close(descriptor);
+    return false;
+  }
+
+  void *mapped = mmap(NULL, fileStat.st_size, PROT_READ, MAP_SHARED, descriptor, 0);
+  close(descriptor);
+
+  if (mapped == MAP_FAILED)
+  {
+    return false;
+  }
+
+  struct EndgameHeader *header = mapped;
+  bool valid = header->magic == ENDGAME_MAGIC && header->playerStateNo == ENDGAME_PLAYER_STATE_NO;
+
+  for (int playerCount = ENDGAME_MIN_PLAYERS; playerCount <= ENDGAME_MAX_PLAYERS && valid; playerCount++)
+  {
+    uint64_t end = header->offsets[playerCount] + getTableSize(playerCount) * sizeof(struct EndgameEntry);
+    valid = end <= (uint64_t)fileStat.st_size;
+  }
+
+  if (!valid)
+  {
+    printf("Warning: %s is not a valid endgame table and is ignored\n", fileName);
+    munmap(mapped, fileStat.st_size);
+    return false;
+  }
+
+  for (int playerCount = ENDGAME_MIN_PLAYERS; playerCount <= ENDGAME_MAX_PLAYERS; playerCount++)
+  {
+    endgameTables[playerCount] = (struct EndgameEntry *)((char *)mapped + header->offsets[playerCount]);
+  }
+
+  mappedTable = mapped;
+  mappedSize = fileStat.st_size;
+  return true;
+}
+
+void unloadEndgameTable()
+{
+  if (mappedTable == NULL)
+  {
+    return;
+  }
+
+  munmap(mappedTable, mappedSize);
+  memset(endgameTables, 0, sizeof(endgameTables));
+  mappedTable = NULL;
+  mappedSize = 0;
+}
+
+static int getPlayerState(struct Player *player)
+{
+  uint8_t counts[ENDGAME_POSITION_NO] = {0};
+
+  for (int pieceIndex = 0; pieceIndex < PIECE_NO; pieceIndex++)
+  {
+    if (player->pieces[pieceIndex].cellNo < HOME)
+    {
+      counts[player->pieces[pieceIndex].cellNo - MAX_STANDARD_CELL]++;
+    }
+  }
+
+  return stateIndexOfKey[getCountKey(counts)];
+}
+
+// Entry of the current position when the game is in the
+// home straight endgame, otherwise NULL. The table assumes
+// plain dice, so pieces with an active mystery effect
+// keep the game out of the table
+struct EndgameEntry *probeEndgameTable(struct Game *game, struct Player *players, int playerIndex, struct Board *board)
+{
+  int playerCount = __builtin_popcount(game->activePlayers);
+
+  if (mappedTable == NULL || playerCount < ENDGAME_MIN_PLAYERS || playerCount > ENDGAME_MAX_PLAYERS)
+  {
+    return NULL;
+  }
+
+  // no piece on the board cells
+  if (board->emptyCells != ALL_CELLS_EMPTY)
+  {
+    return NULL;
+  }
+
+  int moverOrder = 0;
+  while (game->order[moverOrder] != playerIndex)
+  {
+    moverOrder++;
+  }
+
+  uint64_t position = 0;
+  uint64_t stride = 1;
+
+  for (int orderIndex = 0; orderIndex < PLAYER_NO; orderIndex++)
+  {
+    int orderPlayerIndex = game->order[(moverOrder + orderIndex) % PLAYER_NO];
+    struct Player *player = &players[orderPlayerIndex];
+
+    if (!(game->activePlayers & (1 << orderPlayerIndex)))
+    {
+      continue;
+    }
+
+    if (board->piecesInBase[player->color] != 0)
+    {
+      return NULL;
+    }
+
+    for (int pieceIndex = 0; pieceIndex < PIECE_NO; pieceIndex++)
+    {
+      if (player->pieces[pieceIndex].effect.effectActive)
+      {
+        return NULL;
+      }
+    }
+
+    position += getPlayerState(player) * stride;
+    stride *= ENDGAME_PLAYER_STATE_NO;
+  }
+
+  return &endgameTables[playerCount][position];
+}
+
+// Play the move stored in the endgame table. Returns false
+// when the game is not in a position covered by the table
+bool tryEndgameMove(struct Game *game, struct Player *players, int playerIndex, int diceNumber, struct Board *board)
+{
+  struct EndgameEntry *entry = probeEndgameTable(game, players, playerIndex, board);
+
+  if (entry == NULL)
+  {
+    return false;
+  }
+
+  struct Player *player = &players[playerIndex];
+  char *playerName = getName(player->color);
+  int fromPosition = ENDGAME_NO_MOVE;
+
+  gameLog("%s player has a %.1f%% chance to finish first from this position\n",
+    playerName,
+    100.0 * entry->winChance[0] / ENDGAME_CHANCE_SCALE
+  );
+
+  if (diceNumber < MAX_DICE_VALUE)
+  {
+    fromPosition = (entry->moves >> (ENDGAME_MOVE_BITS * (diceNumber - 1))) & ENDGAME_NO_MOVE;
+  }
+
+  for (int pieceIndex = 0; pieceIndex < PIECE_NO && fromPosition != ENDGAME_NO_MOVE; pieceIndex++)
+  {
+    if (player->pieces[pieceIndex].cellNo == MAX_STANDARD_CELL + fromPosition)
+    {
+      moveInHomeStraight(&player->pieces[pieceIndex], diceNumber, board);
+      return true;
+    }
+  }
+
+  gameLog("No moves can be made by piece %s\n", playerName);
+  return true;
+}
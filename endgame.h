@@ -0,0 +1,46 @@
+#ifndef ENDGAME_H
+#define ENDGAME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "types.h"
+
+#define ENDGAME_TABLE_FILE "endgame.tb"
+#define ENDGAME_MAGIC 0x3142544F44554CULL // "LUDOTB1"
+#define ENDGAME_MIN_PLAYERS 2
+#define ENDGAME_MAX_PLAYERS 3
+#define ENDGAME_POSITION_NO (HOME - MAX_STANDARD_CELL) // home straight cells
+#define ENDGAME_PLAYER_STATE_NO 126 // piece counts over the home straight cells
+#define ENDGAME_MOVE_BITS 3
+#define ENDGAME_NO_MOVE 7
+#define ENDGAME_CHANCE_SCALE 65535
+
+// Positions where every piece left in the game is in the
+// home straight. Players there cannot affect each other, so
+// a position is the piece counts on each home straight cell
+// of every remaining player, starting from the player to
+// move and following the turn order.
+struct EndgameEntry
+{
+  uint16_t winChance[ENDGAME_MAX_PLAYERS]; // of finishing first, per player from the mover
+  uint16_t moves; // cell of the piece to move per dice value 1 to 5, 3 bits each
+} __attribute__((aligned(8)));
+
+struct EndgameHeader
+{
+  uint64_t magic;
+  uint32_t playerStateNo;
+  uint32_t tableNo;
+  uint64_t offsets[ENDGAME_MAX_PLAYERS + 1]; // of the table for each player count
+} __attribute__((aligned(8)));
+
+// Function declarations for building and probing the
+// home straight endgame tablebase
+
+bool generateEndgameTable(char *fileName);
+bool loadEndgameTable(char *fileName);
+void unloadEndgameTable();
+struct EndgameEntry *probeEndgameTable(struct Game *game, struct Player *players, int playerIndex, struct Board *board);
+bool tryEndgameMove(struct Game *game, struct Player *players, int playerIndex, int diceNumber, struct Board *board);
+
+#endif // !ENDGAME_H
@@ -0,0 +1,330 @@
+#include "env.h"
+#include "game.h"
+#include "endgame.h"
+#include "simulation.h"
+#include <pthread.h>
+#include <string.h>
+
+enum EnvTask
+{
+  ENV_TASK_RESET,
+  ENV_TASK_STEP
+};
+
+struct EnvWorker
+{
+  pthread_t thread;
+  struct Env *env;
+  int firstGame;
+  int lastGame;
+};
+
+struct Env
+{
+  int envCount;
+  int agentColor;
+  int threadCount;
+  bool hasWeights;
+  int weights[PLAYER_NO][WEIGHT_NO];
+  struct EnvBuffers buffers;
+  struct EnvGame *games;
+  struct EnvWorker *workers;
+
+  // current task handed to the worker pool
+  enum EnvTask task;
+  const uint64_t *seeds;
+  const int32_t *actions;
+
+  pthread_mutex_t lock;
+  pthread_cond_t taskReady;
+  pthread_cond_t taskDone;
+  uint64_t generation;
+  int pendingWorkers;
+  bool stopping;
+};
+
+int getEnvObservationSize()
+{
+  return ENV_OBSERVATION_SIZE;
+}
+
+int getEnvActionCount()
+{
+  return ENV_ACTION_NO;
+}
+
+/* Observation */
+
+// The observation is the policy feature vector of the
+// agent. The dice and legal actions are only set while the
+// agent has a decision to make
+static void writeOutputs(struct Env *env, int gameIndex)
+{
+  struct EnvGame *envGame = &env->games[gameIndex];
+  struct GameSession *session = &envGame->session;
+  bool isDecision = !envGame->done;
+  uint8_t legalMask = isDecision ? session->turn.legalMask : 0;
+
+  writePolicyFeatures
+  (
+    session->players, env->agentColor, isDecision ? session->turn.diceNumber : 0,
+    &session->board, session->game.mysteryCellNo,
+    &env->buffers.observations[gameIndex * ENV_OBSERVATION_SIZE]
+  );
+
+  for (int action = 0; action < ENV_ACTION_NO; action++)
+  {
+    env->buffers.legalMasks[gameIndex * ENV_ACTION_NO + action] = (legalMask >> action) & 1;
+  }
+
+  env->buffers.rewards[gameIndex] = envGame->reward;
+  env->buffers.dones[gameIndex] = envGame->done;
+}
+
+/* Game runner */
+
+// Reward from the final rank of the agent, 1 for first
+// to -1 for last, and 0 for a game cut at the round limit
+static void finishEnvGame(struct Env *env, struct EnvGame *envGame)
+{
+  struct Game *game = &envGame->session.game;
+
+  envGame->done = true;
+  envGame->reward = 0.0f;
+
+  for (int winIndex = 0; winIndex < PLAYER_NO; winIndex++)
+  {
+    bool ranked = winIndex < game->winIndex || (winIndex == PLAYER_NO - 1 && game->winIndex == PLAYER_NO - 1);
+    if (ranked && game->winners[winIndex] == env->agentColor)
+    {
+      envGame->reward = 1.0f - 2.0f * winIndex / (PLAYER_NO - 1);
+      return;
+    }
+  }
+}
+
+// Play until the agent has to choose a move. The game is
+// done for the agent once it finishes or the game is over
+static void advanceEnvGame(struct Env *env, struct EnvGame *envGame)
+{
+  if (advanceGameSession(&envGame->session) != TURN_EVENT_DECISION)
+  {
+    finishEnvGame(env, envGame);
+  }
+}
+
+static void resetEnvGame(struct Env *env, struct EnvGame *envGame, uint64_t seed)
+{
+  startGameSession(&envGame->session, seed, env->hasWeights ? env->weights : NULL, 1 << env->agentColor, MAX_GAME_ROUNDS);
+  envGame->seed = seed;
+  envGame->done = false;
+  envGame->reward = 0.0f;
+
+  advanceEnvGame(env, envGame);
+}
+
+// Apply the agent action and play on to its next decision.
+// An illegal action is replaced by the move of the agent
+// color behavior. Done games start over with the seed
+// advanced by the env count
+static void stepEnvGame(struct Env *env, struct EnvGame *envGame, int32_t action)
+{
+  if (envGame->done)
+  {
+    resetEnvGame(env, envGame, envGame->seed + env->envCount);
+    return;
+  }
+
+  resumeGameSession(&envGame->session, action);
+  advanceEnvGame(env, envGame);
+}
+
+/* Worker pool */
+
+static void runEnvTask(struct EnvWorker *worker)
+{
+  struct Env *env = worker->env;
+
+  for (int gameIndex = worker->firstGame; gameIndex < worker->lastGame; gameIndex++)
+  {
+    struct EnvGame *envGame = &env->games[gameIndex];
+
+    if (env->task == ENV_TASK_RESET)
+    {
+      resetEnvGame(env, envGame, env->seeds[gameIndex]);
+    }
+    else
+    {
+      stepEnvGame(env, envGame, env->actions[gameIndex]);
+    }
+
+    writeOutputs(env, gameIndex);
+  }
+}
+
+static void *runEnvWorker(void *argument)
+{
+  struct EnvWorker *worker = argument;
+  struct Env *env = worker->env;
+  uint64_t generation = 0;
+
+  setGameOutput(false);
+
+  pthread_mutex_lock(&env->lock);
+  while (true)
+  {
+    while (env->generation == generation && !env->stopping)
+    {
+      pthread_cond_wait(&env->taskReady, &env->lock);
+    }
+
+    if (env->stopping)
+    {
+      break;
+    }
+
+    generation = env->generation;
+    pthread_mutex_unlock(&env->lock);
+
+    runEnvTask(worker);
+
+    pthread_mutex_lock(&env->lock);
+    env->pendingWorkers--;
+    if (env->pendingWorkers == 0)
+    {
+      pthread_cond_signal(&env->taskDone);
+    }
+  }
+  pthread_mutex_unlock(&env->lock);
+
+  return NULL;
+}
+
+// Hand a task to every worker and wait until all of them
+// have written their games to the buffers
+static void dispatchEnvTask(struct Env *env, enum EnvTask task)
+{
+  pthread_mutex_lock(&env->lock);
+
+  env->task = task;
+  env->pendingWorkers = env->threadCount;
+  env->generation++;
+  pthread_cond_broadcast(&env->taskReady);
+
+  while (env->pendingWorkers > 0)
+  {
+    pthread_cond_wait(&env->taskDone, &env->lock);
+  }
+
+  pthread_mutex_unlock(&env->lock);
+}
+
+/* Exported API */
+
+// Games and workers are allocated once here, so reset and
+// step do not allocate. A thread count below 1 uses every
+// online core
+struct Env *createEnv(int envCount, int agentColor, int threadCount, struct EnvBuffers *buffers)
+{
+  if (envCount < 1 || agentColor < 0 || agentColor >= PLAYER_NO || buffers == NULL)
+  {
+    return NULL;
+  }
+
+  if (threadCount < 1)
+  {
+    threadCount = getDefaultThreadCount();
+  }
+
+  if (threadCount > envCount)
+  {
+    threadCount = envCount;
+  }
+
+  struct Env *env = calloc(1, sizeof(struct Env));
+  if (env == NULL)
+  {
+    return NULL;
+  }
+
+  env->games = calloc(envCount, sizeof(struct EnvGame));
+  env->workers = calloc(threadCount, sizeof(struct EnvWorker));
+  if (env->games == NULL || env->workers == NULL)
+  {
+    free(env->games);
+    free(env->workers);
+    free(env);
+    return NULL;
+  }
+
+  env->envCount = envCount;
+  env->agentColor = agentColor;
+  env->threadCount = threadCount;
+  env->buffers = *buffers;
+  env->hasWeights = loadPieceWeights(WEIGHTS_CONFIG_FILE, env->weights);
+
+  loadEndgameTable(ENDGAME_TABLE_FILE);
+
+  pthread_mutex_init(&env->lock, NULL);
+  pthread_cond_init(&env->taskReady, NULL);
+  pthread_cond_init(&env->taskDone, NULL);
+
+  for (int threadIndex = 0; threadIndex < threadCount; threadIndex++)
+  {
+    struct EnvWorker *worker = &env->workers[threadIndex];
+    worker->env = env;
+    worker->firstGame = (int)((long)envCount * threadIndex / threadCount);
+    worker->lastGame = (int)((long)envCount * (threadIndex + 1) / threadCount);
+
+    // stop and join the workers already started
+    if (pthread_create(&worker->thread, NULL, runEnvWorker, worker) != 0)
+    {
+      env->threadCount = threadIndex;
+      destroyEnv(env);
+      return NULL;
+    }
+  }
+
+  return env;
+}
+
+void destroyEnv(struct Env *env)
+{
+  if (env == NULL)
+  {
+    return;
+  }
+
+  pthread_mutex_lock(&env->lock);
+  env->stopping = true;
+  pthread_cond_broadcast(&env->taskReady);
+  pthread_mutex_unlock(&env->lock);
+
+  for (int threadIndex = 0; threadIndex < env->threadCount; threadIndex++)
+  {
+    pthread_join(env->workers[threadIndex].thread, NULL);
+  }
+
+  pthread_mutex_destroy(&env->lock);
+  pthread_cond_destroy(&env->taskReady);
+  pthread_cond_destroy(&env->taskDone);
+
+  free(env->games);
+  free(env->workers);
+  free(env);
+}
+
+// Start game i from seeds[i] and write the first observations
+void resetEnv(struct Env *env, const uint64_t *seeds)
+{
+  env->seeds = seeds;
+  dispatchEnvTask(env, ENV_TASK_RESET);
+}
+
+// Play actions[i] in game i. Games marked done by the last
+// call are reset instead and their action is ignored
+void stepEnv(struct Env *env, const int32_t *actions)
+{
+  env->actions = actions;
+  dispatchEnvTask(env, ENV_TASK_STEP);
+}
@@ -0,0 +1,48 @@
+#ifndef ENV_H
+#define ENV_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "types.h"
+#include "policy.h"
+
+// Batched environment for training policies on the rule
+// set. Built as libludo_env.so with a plain C ABI, so it
+// can be driven from Python (ctypes, cffi) or any other
+// language. One agent color is controlled by the caller
+// and the other colors play their behaviors.
+
+#define ENV_OBSERVATION_SIZE POLICY_FEATURE_NO // same features as the MLP policy
+#define ENV_ACTION_NO POLICY_ACTION_NO
+
+// Compact state of one game, resumed at each step
+struct EnvGame
+{
+  struct GameSession session;
+  uint64_t seed;
+  bool done;
+  float reward;
+};
+
+// Caller owned output buffers, written in place on every
+// reset and step. Row i belongs to game i
+struct EnvBuffers
+{
+  float *observations; // envCount * ENV_OBSERVATION_SIZE
+  uint8_t *legalMasks; // envCount * ENV_ACTION_NO
+  float *rewards; // envCount
+  uint8_t *dones; // envCount
+};
+
+struct Env;
+
+// Function declarations of the exported environment API
+
+struct Env *createEnv(int envCount, int agentColor, int threadCount, struct EnvBuffers *buffers);
+void destroyEnv(struct Env *env);
+void resetEnv(struct Env *env, const uint64_t *seeds);
+void stepEnv(struct Env *env, const int32_t *actions);
+int getEnvObservationSize();
+int getEnvActionCount();
+
+#endif // !ENV_H
@@ -0,0 +1,341 @@
+#include "export.h"
+#include "game.h"
+#include "simulation.h"
+#include "endgame.h"
+#include <pthread.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+struct ExportWorker
+{
+  pthread_t thread;
+  struct TurnColumnFiles *columnFiles;
+  uint64_t firstSeed;
+  int firstGame;
+  int lastGame;
+  int (*weights)[WEIGHT_NO];
+};
+
+static char *columnNames[COLUMN_NO] = {
+  "game.u32", "round.u16", "player.u8", "dice.u8", "piece.i8",
+  "from_cell.i8", "to_cell.i8", "capture.u8", "block.u8", "mystery.u8"
+};
+
+static long getExportTimeNs()
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000000L + now.tv_nsec;
+}
+
+static bool writeColumn(int file, void *data, size_t size, uint64_t offset)
+{
+  for (size_t written = 0; written < size; )
+  {
+    ssize_t count = pwrite(file, (char *)data + written, size - written, offset + written);
+
+    if (count < 0 && errno != EINTR)
+    {
+      return false;
+    }
+    written += count > 0 ? count : 0;
+  }
+
+  return true;
+}
+
+// Write the buffered rows at the end of the files
+void flushTurnExporter(struct TurnExporter *exporter)
+{
+  struct TurnColumnFiles *columnFiles = exporter->columnFiles;
+  uint64_t firstRow = atomic_fetch_add(&columnFiles->nextRow, exporter->rowCount);
+  size_t count = exporter->rowCount;
+  void *columns[COLUMN_NO] = {
+    exporter->games, exporter->rounds, exporter->players, exporter->dice, exporter->pieces,
+    exporter->fromCells, exporter->toCells, exporter->captures, exporter->blocks, exporter->mysteries
+  };
+  size_t sizes[COLUMN_NO] = {
+    sizeof(exporter->games[0]), sizeof(exporter->rounds[0]), 1, 1, 1, 1, 1, 1, 1, 1
+  };
+
+  for (int column = 0; column < COLUMN_NO; column++)
+  {
+    if (!writeColumn(columnFiles->files[column], columns[column], count * sizes[column], firstRow * sizes[column]))
+    {
+      atomic_store(&columnFiles->failed, true);
+    }
+  }
+
+  exporter->rowCount = 0;
+}
+
+// Pieces of the player of the row that changed their cell
+// since the last call, as a mask. Captures are counted by
+// the capturing pieces, so other colors need not be followed
+static int updateExportPieces(struct TurnExporter *exporter, struct Player *player, bool *captured)
+{
+  int changedPieces = 0;
+  int captureCount = 0;
+
+  for (int pieceIndex = 0; pieceIndex < PIECE_NO; pieceIndex++)
+  {
+    struct Piece *piece = &player->pieces[pieceIndex];
+
+    if (piece->cellNo != exporter->pieceCells[pieceIndex])
+    {
+      changedPieces |= 1 << pieceIndex;
+      exporter->pieceCells[pieceIndex] = piece->cellNo;
+    }
+    captureCount += piece->captured;
+  }
+
+  *captured = captureCount > exporter->captureCount;
+  exporter->captureCount = captureCount;
+
+  return changedPieces;
+}
+
+// The mystery effect and the captures of a teleport are
+// only known after AFTER_MOVE. The effect is the one drawn
+// on landing, the cell reached can be that of a re-teleport
+static void finishExportRow(struct TurnExporter *exporter, struct Player *players)
+{
+  if (!exporter->rowPending)
+  {
+    return;
+  }
+
+  int row = exporter->rowCount;
+  bool captured;
+  updateExportPieces(exporter, &players[exporter->players[row]], &captured);
+  if (exporter->rowLanded)
+  {
+    exporter->mysteries[row] = getLandedMysteryEffect();
+  }
+  exporter->captures[row] |= captured;
+
+  exporter->rowPending = false;
+  if (++exporter->rowCount == EXPORT_BUFFER_ROWS)
+  {
+    flushTurnExporter(exporter);
+  }
+}
+
+// Turn observer: a row at each throw, filled in by the move
+// and the mystery cell that follow it
+void onExportPhase(void *context, struct Game *game, struct Player *players, struct TurnState *turn)
+{
+  struct TurnExporter *exporter = context;
+  int row = exporter->rowCount;
+  bool captured;
+
+  switch (turn->phase)
+  {
+    case TURN_THROW:
+      finishExportRow(exporter, players);
+      row = exporter->rowCount;
+
+      exporter->games[row] = exporter->gameId;
+      exporter->rounds[row] = game->rounds;
+      exporter->players[row] = turn->playerIndex;
+      exporter->dice[row] = turn->diceNumber;
+      exporter->pieces[row] = -1;
+      exporter->fromCells[row] = -1;
+      exporter->toCells[row] = -1;
+      exporter->captures[row] = false;
+      exporter->blocks[row] = false;
+      exporter->mysteries[row] = 0;
+      exporter->rowPending = true;
+      exporter->rowLanded = false;
+      updateExportPieces(exporter, &players[turn->playerIndex], &captured);
+      break;
+
+    case TURN_AFTER_MOVE:
+      if (exporter->rowPending)
+      {
+        struct Player *player = &players[turn->playerIndex];
+        int8_t fromCells[PIECE_NO];
+
+        memcpy(fromCells, exporter->pieceCells, sizeof(fromCells));
+        int movedPieces = updateExportPieces(exporter, player, &captured);
+
+        // the lowest piece of a block stands for the block
+        if (movedPieces != 0)
+        {
+          int pieceIndex = __builtin_ctz(movedPieces);
+
+          exporter->pieces[row] = pieceIndex;
+          exporter->fromCells[row] = fromCells[pieceIndex];
+          exporter->toCells[row] = player->pieces[pieceIndex].cellNo;
+          exporter->blocks[row] = __builtin_popcount(movedPieces) > 1;
+          exporter->rowLanded = exporter->toCells[row] == game->mysteryCellNo;
+        }
+        exporter->captures[row] = captured;
+      }
+      break;
+
+    case TURN_PLAYER_END:
+    case TURN_GAME_OVER:
+      finishExportRow(exporter, players);
+      break;
+
+    default:
+      break;
+  }
+}
+
+static void *runExportWorker(void *argument)
+{
+  struct ExportWorker *worker = argument;
+  struct TurnExporter *exporter = malloc(sizeof(struct TurnExporter));
+  struct TurnObserver observer = {onExportPhase, exporter};
+  struct GameResult result;
+
+  if (exporter == NULL)
+  {
+    printf("Error: Memory allocation failed\n");
+    exit(1);
+  }
+
+  exporter->columnFiles = worker->columnFiles;
+  exporter->rowCount = 0;
+  setTurnObserver(&observer);
+
+  for (int gameIndex = worker->firstGame; gameIndex < worker->lastGame; gameIndex++)
+  {
+    exporter->gameId = gameIndex;
+    exporter->rowPending = false;
+    simulateGame(worker->firstSeed + gameIndex, worker->weights, &result);
+
+    // write between games so their rows stay together
+    if (exporter->rowCount >= EXPORT_FLUSH_ROWS)
+    {
+      flushTurnExporter(exporter);
+    }
+  }
+
+  flushTurnExporter(exporter);
+  setTurnObserver(NULL);
+  free(exporter);
+  return NULL;
+}
+
+static bool writeExportManifest(char *directory, uint64_t firstSeed, int gameCount, uint64_t rowCount)
+{
+  char path[4096];
+
+  snprintf(path, sizeof(path), "%s/%s", directory, EXPORT_MANIFEST_FILE);
+  FILE *file = fopen(path, "w");
+  if (file == NULL)
+  {
+    return false;
+  }
+
+  fprintf(file, "rows %llu\ngames %d\nfirst_seed %llu\n", (unsigned long long)rowCount, gameCount, (unsigned long long)firstSeed);
+  for (int column = 0; column < COLUMN_NO; column++)
+  {
+    fprintf(file, "column %s\n", columnNames[column]);
+  }
+
+  return fclose(file) == 0;
+}
+
+// Play games like runGameBatch and write a row per throw
+// to the column files of the directory
+bool exportTurnColumns(char *directory, uint64_t firstSeed, int gameCount, int threadCount)
+{
+  struct TurnColumnFiles columnFiles;
+  int weights[PLAYER_NO][WEIGHT_NO];
+  char path[4096];
+
+  if (gameCount < 1)
+  {
+    printf("Error: No games to export\n");
+    return false;
+  }
+
+  if (mkdir(directory, 0755) != 0 && errno != EEXIST)
+  {
+    printf("Error: Could not create the directory %s\n", directory);
+    return false;
+  }
+
+  for (int column = 0; column < COLUMN_NO; column++)
+  {
+    snprintf(path, sizeof(path), "%s/%s", directory, columnNames[column]);
+    columnFiles.files[column] = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (columnFiles.files[column] < 0)
+    {
+      printf("Error: Could not create %s\n", path);
+      for (int opened = 0; opened < column; opened++)
+      {
+        close(columnFiles.files[opened]);
+      }
+      return false;
+    }
+  }
+  atomic_store(&columnFiles.nextRow, 0);
+  atomic_store(&columnFiles.failed, false);
+
+  if (threadCount < 1)
+  {
+    threadCount = getDefaultThreadCount();
+  }
+
+  if (threadCount > gameCount)
+  {
+    threadCount = gameCount;
+  }
+
+  loadPieceWeights(WEIGHTS_CONFIG_FILE, weights);
+  loadEndgameTable(ENDGAME_TABLE_FILE);
+
+  struct ExportWorker workers[threadCount];
+  long startNs = getExportTimeNs();
+
+  for (int workerIndex = 0; workerIndex < threadCount; workerIndex++)
+  {
+    workers[workerIndex] = (struct ExportWorker){
+      .columnFiles = &columnFiles,
+      .firstSeed = firstSeed,
+      .firstGame = (int)((long)gameCount * workerIndex / threadCount),
+      .lastGame = (int)((long)gameCount * (workerIndex + 1) / threadCount),
+      .weights = weights,
+    };
+
+    pthread_create(&workers[workerIndex].thread, NULL, runExportWorker, &workers[workerIndex]);
+  }
+
+  for (int workerIndex = 0; workerIndex < threadCount; workerIndex++)
+  {
+    pthread_join(workers[workerIndex].thread, NULL);
+  }
+
+  bool failed = atomic_load(&columnFiles.failed);
+  for (int column = 0; column < COLUMN_NO; column++)
+  {
+    failed |= close(columnFiles.files[column]) != 0;
+  }
+
+  uint64_t rowCount = atomic_load(&columnFiles.nextRow);
+  failed |= !writeExportManifest(directory, firstSeed, gameCount, rowCount);
+
+  if (failed)
+  {
+    printf("Error: Could not write the columns to %s\n", directory);
+    return false;
+  }
+
+  double seconds = (getExportTimeNs() - startNs) / 1e9;
+  printf
+  (
+    "Exported %llu throws of %d games to %s in %.2f s, %.0f throws per second\n",
+    (unsigned long long)rowCount, gameCount, directory, seconds, rowCount / (seconds > 0 ? seconds : 1e-9)
+  );
+  return true;
+}
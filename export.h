@@ -0,0 +1,83 @@
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "types.h"
+
+#define EXPORT_DIRECTORY "turns"
+#define EXPORT_MANIFEST_FILE "turns.txt"
+#define EXPORT_BUFFER_ROWS (1 << 16) // rows a worker keeps before writing
+#define EXPORT_FLUSH_ROWS (EXPORT_BUFFER_ROWS / 2) // written at the end of a game past this
+
+// Columns of the turn export. Every column is a file of
+// one little endian array, row i of all files is throw i:
+//
+// game.u32       game index, the seed is the first seed plus it
+// round.u16
+// player.u8      color index
+// dice.u8        as thrown, before the mystery effects
+// piece.i8       piece moved, -1 when no piece could move
+// from_cell.i8   BASE (-1), 0 to 51, home straight or HOME,
+// to_cell.i8     -1 for both when no piece moved
+// capture.u8     the throw sent pieces of other colors to base
+// block.u8       the piece moved as part of a block
+// mystery.u8     effect of the mystery cell the piece landed on,
+//                1 to 6 as in getMysteryEffectNumber, or 0
+//
+// The rows of a game are contiguous unless the game has more
+// throws than a worker buffer. Games are in no order
+enum TurnColumn
+{
+  COLUMN_GAME,
+  COLUMN_ROUND,
+  COLUMN_PLAYER,
+  COLUMN_DICE,
+  COLUMN_PIECE,
+  COLUMN_FROM_CELL,
+  COLUMN_TO_CELL,
+  COLUMN_CAPTURE,
+  COLUMN_BLOCK,
+  COLUMN_MYSTERY,
+  COLUMN_NO
+};
+
+// Open column files. Workers reserve the rows they write
+// with nextRow and write them with pwrite, without a lock
+struct TurnColumnFiles
+{
+  int files[COLUMN_NO];
+  _Atomic uint64_t nextRow;
+  _Atomic bool failed;
+};
+
+// Turn observer of one worker, with its rows by column
+struct TurnExporter
+{
+  struct TurnColumnFiles *columnFiles;
+  uint32_t gameId;
+  bool rowPending;
+  bool rowLanded; // the move of the pending row ended on the mystery cell
+  int rowCount;
+  int8_t pieceCells[PIECE_NO]; // of the player of the pending row
+  int captureCount; // made by its pieces
+  uint32_t games[EXPORT_BUFFER_ROWS];
+  uint16_t rounds[EXPORT_BUFFER_ROWS];
+  uint8_t players[EXPORT_BUFFER_ROWS];
+  uint8_t dice[EXPORT_BUFFER_ROWS];
+  int8_t pieces[EXPORT_BUFFER_ROWS];
+  int8_t fromCells[EXPORT_BUFFER_ROWS];
+  int8_t toCells[EXPORT_BUFFER_ROWS];
+  uint8_t captures[EXPORT_BUFFER_ROWS];
+  uint8_t blocks[EXPORT_BUFFER_ROWS];
+  uint8_t mysteries[EXPORT_BUFFER_ROWS];
+};
+
+// Function declarations for the columnar turn export
+
+void onExportPhase(void *context, struct Game *game, struct Player *players, struct TurnState *turn);
+void flushTurnExporter(struct TurnExporter *exporter);
+bool exportTurnColumns(char *directory, uint64_t firstSeed, int gameCount, int threadCount);
+
+#endif // !EXPORT_H
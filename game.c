@@ -1,9 +1,38 @@
 #include "game.h"
 #include "types.h"
+#include "home_table.h"
+#include "endgame.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdarg.h>
+#include <strings.h>
+
+// Per thread state so that several games can be
+// simulated in parallel without sharing rand()
+static _Thread_local uint64_t randomState = 0x9E3779B97F4A7C15ULL;
+static _Thread_local bool outputEnabled = true;
+
+// Undo stack of the move being made by makeMove, NULL when
+// the changes of the engine are not being recorded
+static _Thread_local struct UndoStack *undoJournal = NULL;
+
+// Observer of the moves chosen by moveParse, NULL when the
+// behavior moves are not being recorded
+static _Thread_local struct MoveObserver *moveObserver = NULL;
+
+// Observer of the phases of the turn engine, NULL when the
+// games of the thread are not being followed
+static _Thread_local struct TurnObserver *turnObserver = NULL;
+
+// Effect drawn by the last landing on the mystery cell of
+// the thread, before any re-teleport, 0 before the first
+static _Thread_local int landedMysteryEffect = 0;
+
+// Policies replacing the behavior of a color, shared by all
+// threads and set before games are started
+static struct MovePolicy *movePolicies[PLAYER_NO] = {NULL};
 
 /* Initialization functions
  */
@@ -14,7 +43,11 @@ struct Piece createPiece(char namePrefix, char nameSuffix)
 
   struct Piece piece;
 
+  // zero the reserved bits and padding too, keyframes of
+  // replay files store pieces as they are in memory
+  memset(&piece, 0, sizeof(piece));
   piece.cellNo = BASE;
+  piece.cellIndex = EMPTY;
   piece.captured = 0;
   strncpy(piece.name, name, sizeof(piece.name) - 1);
   piece.name[sizeof(piece.name) - 1] = '\0'; //explicit null termination
@@ -42,9 +75,13 @@ struct Player createPlayer(int start, char namePrefix, enum Color color)
       createPiece(namePrefix, '3'),
       createPiece(namePrefix, '4')
     },
-    color
+    color,
+    -1,
+    {0}
   };
 
+  setDefaultPieceWeights(color, player.weights);
+
   return player;
 }
 
@@ -58,6 +95,14 @@ struct Player* initializePlayers()
     exit(0);
   }
 
+  resetPlayers(players);
+
+  return players;
+}
+
+// Fill caller owned storage with the players of a new game
+void resetPlayers(struct Player *players)
+{
   players[0] = createPlayer(YELLOW_START, 'Y', YELLOW);
 
   players[1] = createPlayer(BLUE_START, 'B', BLUE);
@@ -65,8 +110,23 @@ struct Player* initializePlayers()
   players[2] = createPlayer(RED_START, 'R', RED);
 
   players[3] = createPlayer(GREEN_START, 'G', GREEN);
+}
 
-  return players;
+struct Game createGame()
+{
+  struct Game game = {
+    0,
+    EMPTY,
+    0,
+    0,
+    0,
+    {[0 ... PLAYER_NO - 1] = EMPTY},
+    {[0 ... PLAYER_NO - 1] = EMPTY},
+    EMPTY,
+    ALL_PLAYERS_ACTIVE,
+  };
+
+  return game;
 }
 
 void initializePlayerOrder(struct Game *game, int maxPlayerIndex)
@@ -98,6 +158,361 @@ void initializePlayerOrder(struct Game *game, int maxPlayerIndex)
   }
 }
 
+/* Board methods
+ */
+
+void initializeBoard(struct Board *board)
+{
+  memset(board, 0, sizeof(struct Board));
+
+  for (int cellNo = 0; cellNo < MAX_STANDARD_CELL; cellNo++)
+  {
+    board->cells[cellNo].freeSlots = ALL_SLOTS_FREE;
+  }
+  board->emptyCells = ALL_CELLS_EMPTY;
+
+  for (int color = 0; color < PLAYER_NO; color++)
+  {
+    board->piecesInBase[color] = PIECE_NO;
+  }
+}
+
+// All writes to a cell slot go through here so that the
+// per cell counters, the free slot mask, the empty cell
+// mask and the slot index of the piece always match the
+// slot array
+void setCellPiece(struct Board *board, int cellNo, int cellIndex, struct Piece *piece)
+{
+  struct Cell *cell = &board->cells[cellNo];
+  struct Piece *prevPiece = cell->pieces[cellIndex];
+
+  recordSlotChange(cellNo, cellIndex, prevPiece);
+
+  if (prevPiece != NULL)
+  {
+    cell->colorCount[getPieceColor(prevPiece->name[0])]--;
+    cell->pieceCount--;
+    cell->freeSlots |= 1 << cellIndex;
+    prevPiece->cellIndex = EMPTY;
+  }
+
+  if (piece != NULL)
+  {
+    cell->colorCount[getPieceColor(piece->name[0])]++;
+    cell->pieceCount++;
+    cell->freeSlots &= ~(1 << cellIndex);
+    piece->cellIndex = cellIndex;
+  }
+
+  cell->pieces[cellIndex] = piece;
+
+  if (cell->pieceCount == 0)
+  {
+    board->emptyCells |= 1ULL << cellNo;
+  }
+  else
+  {
+    board->emptyCells &= ~(1ULL << cellNo);
+  }
+}
+
+// Place the piece in the first free slot of the cell
+void placePieceInCell(struct Board *board, int cellNo, struct Piece *piece)
+{
+  tryValueAndCatchError(board->cells[cellNo].freeSlots, '=', 0);
+
+  setCellPiece(board, cellNo, __builtin_ctz(board->cells[cellNo].freeSlots), piece);
+}
+
+void removePieceFromCell(struct Board *board, int cellNo, struct Piece *piece)
+{
+  tryValueAndCatchError(piece->cellIndex, '=', EMPTY);
+
+  setCellPiece(board, cellNo, piece->cellIndex, NULL);
+}
+
+// Set up the board of pieces restored from elsewhere, with
+// each piece back in its own slot and the running totals
+// counted again
+void rebuildBoard(struct Board *board, struct Player *players)
+{
+  initializeBoard(board);
+
+  for (int color = 0; color < PLAYER_NO; color++)
+  {
+    for (int pieceIndex = 0; pieceIndex < PIECE_NO; pieceIndex++)
+    {
+      struct Piece *piece = &players[color].pieces[pieceIndex];
+
+      board->captureCount[color] += piece->captured;
+
+      if (piece->cellNo == BASE)
+      {
+        continue;
+      }
+
+      board->piecesInBase[color]--;
+
+      if (piece->cellNo == HOME)
+      {
+        board->piecesAtHome[color]++;
+        continue;
+      }
+
+      board->piecesInPlay++;
+
+      if (piece->cellNo < MAX_STANDARD_CELL)
+      {
+        setCellPiece(board, piece->cellNo, piece->cellIndex, piece);
+      }
+    }
+  }
+}
+
+/* Make/unmake functions
+ */
+
+void initializeUndoStack(struct UndoStack *stack)
+{
+  stack->frameCount = 0;
+  stack->entryCount = 0;
+}
+
+static struct UndoEntry *pushUndoEntry(enum UndoKind kind)
+{
+  tryValueAndCatchError(undoJournal->entryCount, '>', UNDO_MAX_ENTRIES - 1);
+
+  struct UndoEntry *entry = &undoJournal->entries[undoJournal->entryCount++];
+  entry->kind = kind;
+
+  return entry;
+}
+
+void recordSlotChange(int cellNo, int cellIndex, struct Piece *prevPiece)
+{
+  if (undoJournal == NULL)
+  {
+    return;
+  }
+
+  struct UndoEntry *entry = pushUndoEntry(UNDO_SLOT);
+  entry->cellNo = cellNo;
+  entry->cellIndex = cellIndex;
+  entry->piece = prevPiece;
+}
+
+void recordPieceChange(struct Piece *piece)
+{
+  if (undoJournal == NULL)
+  {
+    return;
+  }
+
+  struct UndoEntry *entry = pushUndoEntry(UNDO_PIECE);
+  entry->piece = piece;
+  entry->cellNo = piece->cellNo;
+  entry->captured = piece->captured;
+  entry->noOfApproachPasses = piece->noOfApproachPasses;
+  entry->effectActiveRounds = piece->effect.effectActiveRounds;
+  entry->diceMultiplier = piece->effect.diceMultiplier;
+  entry->diceDivider = piece->effect.diceDivider;
+  entry->flags = 0;
+  entry->flags |= piece->clockWise ? UNDO_FLAG_CLOCKWISE : 0;
+  entry->flags |= piece->blockClockWise ? UNDO_FLAG_BLOCK_CLOCKWISE : 0;
+  entry->flags |= piece->effect.effectActive ? UNDO_FLAG_EFFECT_ACTIVE : 0;
+  entry->flags |= piece->effect.pieceActive ? UNDO_FLAG_PIECE_ACTIVE : 0;
+}
+
+static void restorePieceChange(struct UndoEntry *entry)
+{
+  struct Piece *piece = entry->piece;
+
+  piece->cellNo = entry->cellNo;
+  piece->captured = entry->captured;
+  piece->noOfApproachPasses = entry->noOfApproachPasses;
+  piece->effect.effectActiveRounds = entry->effectActiveRounds;
+  piece->effect.diceMultiplier = entry->diceMultiplier;
+  piece->effect.diceDivider = entry->diceDivider;
+  piece->clockWise = entry->flags & UNDO_FLAG_CLOCKWISE;
+  piece->blockClockWise = entry->flags & UNDO_FLAG_BLOCK_CLOCKWISE;
+  piece->effect.effectActive = entry->flags & UNDO_FLAG_EFFECT_ACTIVE;
+  piece->effect.pieceActive = entry->flags & UNDO_FLAG_PIECE_ACTIVE;
+}
+
+// Apply the move of one piece like finalizeMovement and
+// the mystery cell check of the game loop do, recording
+// what changes so that unmakeMove can revert it.
+// Only the pieces of the player can change apart from
+// captured pieces, which are recorded by resetPiece
+void makeMove
+(
+  struct UndoStack *stack, struct Game *game, struct Player *players,
+  int playerIndex, int pieceIndex, int diceNumber,
+  bool blockMoveCondition, struct Board *board
+)
+{
+  tryValueAndCatchError(stack->frameCount, '>', UNDO_MAX_DEPTH - 1);
+
+  struct UndoFrame *frame = &stack->frames[stack->frameCount++];
+  struct Player *player = &players[playerIndex];
+
+  frame->firstEntry = stack->entryCount;
+  frame->randomState = getGameRandomState();
+  memcpy(frame->piecesInBase, board->piecesInBase, sizeof(frame->piecesInBase));
+  memcpy(frame->piecesAtHome, board->piecesAtHome, sizeof(frame->piecesAtHome));
+  memcpy(frame->captureCount, board->captureCount, sizeof(frame->captureCount));
+  frame->piecesInPlay = board->piecesInPlay;
+
+  undoJournal = stack;
+
+  for (int index = 0; index < PIECE_NO; index++)
+  {
+    recordPieceChange(&player->pieces[index]);
+  }
+
+  finalizeMovement(player, pieceIndex, diceNumber, board, blockMoveCondition);
+  handlePieceLandOnMysteryCell(game, player, board);
+
+  undoJournal = NULL;
+}
+
+// Revert the last move made with makeMove, replaying
+// the recorded changes from the newest to the oldest
+void unmakeMove(struct UndoStack *stack, struct Board *board)
+{
+  tryValueAndCatchError(stack->frameCount, '=', 0);
+
+  struct UndoFrame *frame = &stack->frames[--stack->frameCount];
+
+  while (stack->entryCount > frame->firstEntry)
+  {
+    struct UndoEntry *entry = &stack->entries[--stack->entryCount];
+
+    if (entry->kind == UNDO_SLOT)
+    {
+      setCellPiece(board, entry->cellNo, entry->cellIndex, entry->piece);
+    }
+    else
+    {
+      restorePieceChange(entry);
+    }
+  }
+
+  memcpy(board->piecesInBase, frame->piecesInBase, sizeof(frame->piecesInBase));
+  memcpy(board->piecesAtHome, frame->piecesAtHome, sizeof(frame->piecesAtHome));
+  memcpy(board->captureCount, frame->captureCount, sizeof(frame->captureCount));
+  board->piecesInPlay = frame->piecesInPlay;
+  setGameRandomState(frame->randomState);
+}
+
+uint64_t getEmptyCells(struct Board *board)
+{
+  return board->emptyCells;
+}
+
+// Cell no of the nth (from 0) set bit of the mask.
+// Skips whole bytes by popcount so the cost does not
+// depend on n
+int selectCellFromMask(uint64_t cells, int n)
+{
+  int offset = 0;
+  int byteCount = __builtin_popcountll(cells & 0xFF);
+
+  while (n >= byteCount)
+  {
+    n -= byteCount;
+    cells >>= 8;
+    offset += 8;
+    byteCount = __builtin_popcountll(cells & 0xFF);
+  }
+
+  for (int bit = 0; bit < n; bit++)
+  {
+    cells &= cells - 1;
+  }
+
+  return offset + __builtin_ctzll(cells);
+}
+
+// Recount the slot array and compare with the counters,
+// the free slot mask and the slot index of each piece.
+// Only active when compiled with -DLUDO_DEBUG
+void checkCellCounts(struct Cell *cell)
+{
+#ifndef LUDO_DEBUG
+  (void)cell;
+#else
+  int colorCount[PLAYER_NO] = {0};
+  int pieceCount = 0;
+  int freeSlots = 0;
+
+  for (int cellIndex = 0; cellIndex < PIECE_NO; cellIndex++)
+  {
+    if (cell->pieces[cellIndex] != NULL)
+    {
+      colorCount[getPieceColor(cell->pieces[cellIndex]->name[0])]++;
+      pieceCount++;
+      tryValueAndCatchError(cell->pieces[cellIndex]->cellIndex != cellIndex, '=', true);
+    }
+    else
+    {
+      freeSlots |= 1 << cellIndex;
+    }
+  }
+
+  tryValueAndCatchError(pieceCount != cell->pieceCount, '=', true);
+  tryValueAndCatchError(freeSlots != cell->freeSlots, '=', true);
+  for (int colorIndex = 0; colorIndex < PLAYER_NO; colorIndex++)
+  {
+    tryValueAndCatchError(colorCount[colorIndex] != cell->colorCount[colorIndex], '=', true);
+  }
+#endif
+}
+
+// Recount base, home and capture totals from the pieces
+// and compare with the running totals of the board.
+// Also compares the empty cell mask with the cells.
+// Only active when compiled with -DLUDO_DEBUG
+void checkBoardProgress(struct Board *board, struct Player *players)
+{
+#ifndef LUDO_DEBUG
+  (void)board;
+  (void)players;
+#else
+  int piecesInPlay = 0;
+
+  for (int playerIndex = 0; playerIndex < PLAYER_NO; playerIndex++)
+  {
+    int piecesInBase = 0;
+    int piecesAtHome = 0;
+    int captureCount = 0;
+
+    for (int pieceIndex = 0; pieceIndex < PIECE_NO; pieceIndex++)
+    {
+      int cellNo = players[playerIndex].pieces[pieceIndex].cellNo;
+
+      piecesInBase += cellNo == BASE;
+      piecesAtHome += cellNo == HOME;
+      captureCount += players[playerIndex].pieces[pieceIndex].captured;
+    }
+
+    piecesInPlay += PIECE_NO - piecesInBase - piecesAtHome;
+
+    tryValueAndCatchError(piecesInBase != board->piecesInBase[playerIndex], '=', true);
+    tryValueAndCatchError(piecesAtHome != board->piecesAtHome[playerIndex], '=', true);
+    tryValueAndCatchError(captureCount != board->captureCount[playerIndex], '=', true);
+  }
+
+  tryValueAndCatchError(piecesInPlay != board->piecesInPlay, '=', true);
+
+  for (int cellNo = 0; cellNo < MAX_STANDARD_CELL; cellNo++)
+  {
+    bool isEmpty = (board->emptyCells >> cellNo) & 1;
+    tryValueAndCatchError(isEmpty != (board->cells[cellNo].pieceCount == 0), '=', true);
+  }
+#endif
+}
+
 /* Error methods
  */
 
@@ -140,6 +555,54 @@ void displayErrors()
   printf("!!!!!====================================================!!!!!");
 }
 
+/* Random number and output methods
+ */
+
+void seedGameRandom(uint64_t seed)
+{
+  randomState = seed;
+}
+
+uint64_t getGameRandomState()
+{
+  return randomState;
+}
+
+void setGameRandomState(uint64_t state)
+{
+  randomState = state;
+}
+
+// splitmix64 generator, returns a non negative value like rand()
+int gameRandom()
+{
+  uint64_t value = (randomState += 0x9E3779B97F4A7C15ULL);
+  value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+  value ^= value >> 31;
+
+  return (int)(value >> 33);
+}
+
+void setGameOutput(bool enabled)
+{
+  outputEnabled = enabled;
+}
+
+// printf wrapper which can be silenced for simulated games
+void gameLog(const char *format, ...)
+{
+  if (!outputEnabled)
+  {
+    return;
+  }
+
+  va_list args;
+  va_start(args, format);
+  vprintf(format, args);
+  va_end(args);
+}
+
 /* Helper methods
  */
 bool cellNoIndexable(int cellNo)
@@ -257,16 +720,9 @@ int getApproachIndex(enum Color color)
   return approachIndex;
 }
 
-int getNoOfPiecesInBase(struct Player *player)
+int getNoOfPiecesInBase(struct Board *board, enum Color color)
 {
-  int count = 0;
-  for (int pieceIndex = 0; pieceIndex < PLAYER_NO; pieceIndex++)
-  {
-    if (player->pieces[pieceIndex].cellNo == BASE)
-    {
-      count++;
-    }
-  }
+  int count = board->piecesInBase[color];
 
   tryValueAndCatchError(count, '>', PIECE_NO);
 
@@ -283,76 +739,32 @@ bool canMoveToBoard(int diceNumber)
   return false;
 }
 
-int getPlayerCountOfCell(struct Piece *cells[PLAYER_NO], enum Color playerColor)
+int getPlayerCountOfCell(struct Cell *cell, enum Color playerColor)
 {
-  int count = 0;
-  for (int cellIndex = 0; cellIndex < PLAYER_NO; cellIndex++)
-  {
-    if (
-      cells[cellIndex] != NULL 
-      &&
-      getPieceColor(cells[cellIndex]->name[0]) == playerColor
-    )
-    {
-      count++;
-    }
-  }
+  checkCellCounts(cell);
 
-  tryValueAndCatchError(count, '>', PIECE_NO);
-  
-  return count;
+  return cell->colorCount[playerColor];
 }
 
-int getEnemyCountOfCell(struct Piece *cell[PLAYER_NO], enum Color playerColor)
+int getEnemyCountOfCell(struct Cell *cell, enum Color playerColor)
 {
-  int count = 0;
-  for (int cellIndex = 0; cellIndex < PLAYER_NO; cellIndex++)
-  {
-    if (
-      cell[cellIndex] != NULL 
-      &&
-      getPieceColor(cell[cellIndex]->name[0]) != playerColor
-    )
-    {
-      count++;
-    }
-  }
-
-  tryValueAndCatchError(count, '>', PIECE_NO);
+  checkCellCounts(cell);
 
-  return count;
+  return cell->pieceCount - cell->colorCount[playerColor];
 }
 
-bool isPlayerCell(struct Piece *cells[PLAYER_NO], enum Color playerColor)
+bool isPlayerCell(struct Cell *cell, enum Color playerColor)
 {
-  for (int cellIndex = 0; cellIndex < PLAYER_NO; cellIndex++)
-  {
-    if (cells[cellIndex] != NULL && getPieceColor(cells[cellIndex]->name[0]) == playerColor)
-    {
-      return true;
-    }
-  }
-  return false;
+  checkCellCounts(cell);
+
+  return cell->colorCount[playerColor] != 0;
 }
 
-bool isBlockade(struct Piece *cell[PIECE_NO])
+bool isBlockade(struct Cell *cell)
 {
-  int count = 0;
-
-  for (int cellIndex = 0; cellIndex < PIECE_NO; cellIndex++)
-  {
-    if (cell[cellIndex] != NULL)
-    {
-      count++;
-    }
-  }
-
-  if (count > 1)
-  {
-    return true;
-  }
+  checkCellCounts(cell);
 
-  return false;
+  return cell->pieceCount > 1;
 }
 
 bool isBlocked(int playerPieceCount, int enemyPieceCount)
@@ -371,17 +783,11 @@ bool isBlocked(int playerPieceCount, int enemyPieceCount)
 }
 
 // Check if piece is occupied in the current cell
-bool isCellEmpty(struct Piece *cells[PLAYER_NO])
+bool isCellEmpty(struct Cell *cell)
 {
-  for (int cellIndex = 0; cellIndex < PLAYER_NO; cellIndex++)
-  {
-    if (cells[cellIndex] != NULL)
-    {
-      return false;
-    }
-  }
+  checkCellCounts(cell);
 
-  return true;
+  return cell->pieceCount == 0;
 }
 
 int getMysteryEffectNumber(int location)
@@ -472,21 +878,35 @@ char *getMysteryLocationName(int mysteryEffect)
   return name;
 }
 
-bool boardHasPiece(struct Player *players)
+// Short name of a piece location for logs of moves. text
+// needs room for 16 characters
+char *formatCellName(int cellNo, char *text)
 {
-  for (int playerIndex = 0; playerIndex < PLAYER_NO; playerIndex++)
+  if (cellNo == BASE)
   {
-    for (int pieceIndex = 0; pieceIndex < PIECE_NO; pieceIndex++)
-    {
-      int cellNo = players[playerIndex].pieces[pieceIndex].cellNo;
-      if (cellNo != HOME && cellNo != BASE)
-      {
-        return true;
-      }
-    }
+    return "base";
   }
 
-  return false;
+  if (cellNo == HOME)
+  {
+    return "home";
+  }
+
+  if (cellNo >= MAX_STANDARD_CELL)
+  {
+    sprintf(text, "homepath %d", cellNo - MAX_STANDARD_CELL);
+  }
+  else
+  {
+    sprintf(text, "L%d", cellNo);
+  }
+
+  return text;
+}
+
+bool boardHasPiece(struct Board *board)
+{
+  return board->piecesInPlay != 0;
 }
 
 int getCorrectCellCount(int cellCount)
@@ -512,30 +932,24 @@ int getMovableCellCount
   int diceNumber,
   bool clockWise,
   int playerCount,
-  struct Piece *cells[][PIECE_NO],
+  struct Board *board,
   enum Color color
 )
 {
   int movableCellCount = 0;
+  int directionConstant = clockWise ? 1 : -1;
 
-  if (clockWise)
-  {
-    int maxCellNo = cellNo + diceNumber;
-    for (int cellIndex = cellNo + 1; cellIndex <= maxCellNo; cellIndex++)
-    {
-      int correctCellIndex = getCorrectCellCount(cellIndex);
-      
-      movableCellCount += checkIfCellIsPassable(cells[correctCellIndex], color, playerCount);
-    } 
-  }
-  else
+  // the piece moves over the passable cells of its throw and
+  // skips the blocked ones, so it ends on the last passable cell
+  // in reach. The count is that distance, which is more than the
+  // number of passable cells when a block was skipped on the way
+  for (int step = 1; step <= diceNumber; step++)
   {
-    int maxCellNo = cellNo - diceNumber;
-    for (int cellIndex = cellNo - 1; cellIndex >= maxCellNo; cellIndex--)
-    {
-      int correctCellIndex = getCorrectCellCount(cellIndex);
+    int correctCellIndex = getCorrectCellCount(cellNo + (step * directionConstant));
 
-      movableCellCount += checkIfCellIsPassable(cells[correctCellIndex], color, playerCount);
+    if (checkIfCellIsPassable(&board->cells[correctCellIndex], color, playerCount))
+    {
+      movableCellCount = step;
     }
   }
 
@@ -543,7 +957,7 @@ int getMovableCellCount
   
 }
 
-int checkIfCellIsPassable(struct Piece *cell[PIECE_NO], enum Color color, int playerCount)
+int checkIfCellIsPassable(struct Cell *cell, enum Color color, int playerCount)
 {
   int enemyCountOfCell = getEnemyCountOfCell(cell, color);
 
@@ -559,15 +973,17 @@ int checkIfCellIsPassable(struct Piece *cell[PIECE_NO], enum Color color, int pl
   return 0;
 }
 
-enum Color getPlayerColorInCell(struct Piece *cell[PIECE_NO])
+enum Color getPlayerColorInCell(struct Cell *cell)
 {
-  enum Color color;
+  enum Color color = EMPTY;
 
-  for (int cellIndex = 0; cellIndex < PIECE_NO; cellIndex++)
+  checkCellCounts(cell);
+
+  for (int colorIndex = 0; colorIndex < PLAYER_NO; colorIndex++)
   {
-    if (cell[cellIndex] != NULL)
+    if (cell->colorCount[colorIndex] != 0)
     {
-      color = getPieceColor(cell[cellIndex]->name[0]);
+      color = colorIndex;
       break;
     }
   }
@@ -575,15 +991,15 @@ enum Color getPlayerColorInCell(struct Piece *cell[PIECE_NO])
   return color;
 }
 
-int getCaptureCountOfPlayer(struct Player *player)
+int getCaptureCountOfPlayer(struct Board *board, enum Color color)
 {
-  int captured = 0;
-  for (int pieceIndex = 0; pieceIndex < PIECE_NO; pieceIndex++)
-  {
-    captured += player->pieces[pieceIndex].captured;
-  }
+  return board->captureCount[color];
+}
 
-  return captured;
+void addPieceCapture(struct Piece *piece, struct Board *board)
+{
+  piece->captured++;
+  board->captureCount[getPieceColor(piece->name[0])]++;
 }
 
 // change this
@@ -619,6 +1035,35 @@ int getDistanceFromHome(struct Piece *piece)
   return distanceFromHome;
 }
 
+// Expected number of throws for the piece to reach HOME
+// when it is alone on the board, looked up from the table
+// generated by home_solver.c. The table assumes the piece
+// has captured, which the rules require to enter the home
+// straight. A piece in base first needs a 6 and then takes
+// either direction at the start.
+float getExpectedThrowsToHome(struct Piece *piece)
+{
+  enum Color color = getPieceColor(piece->name[0]);
+  int passState = piece->noOfApproachPasses > 0;
+
+  if (piece->cellNo == HOME)
+  {
+    return 0;
+  }
+
+  if (piece->cellNo == BASE)
+  {
+    int startIndex = getStartIndex(color);
+
+    return THROWS_TO_LEAVE_BASE + (
+      HOME_EXPECTED_THROWS[color][true][0][startIndex] +
+      HOME_EXPECTED_THROWS[color][false][0][startIndex]
+    ) / 2;
+  }
+
+  return HOME_EXPECTED_THROWS[color][piece->clockWise][passState][piece->cellNo];
+}
+
 bool playerHasBlock(struct Player *player)
 {
   int cellNo = EMPTY;
@@ -638,7 +1083,7 @@ bool playerHasBlock(struct Player *player)
   return false;
 }
 
-int getCellNoOfRandomBlock(struct Player *player, struct Piece *cells[][PIECE_NO])
+int getCellNoOfRandomBlock(struct Player *player, struct Board *board)
 {
   int cellNo = EMPTY;
   for (int pieceIndex = 0; pieceIndex < PIECE_NO; pieceIndex++)
@@ -648,7 +1093,7 @@ int getCellNoOfRandomBlock(struct Player *player, struct Piece *cells[][PIECE_NO
       continue;
     }
 
-    if (isBlockade(cells[player->pieces[pieceIndex].cellNo]))
+    if (isBlockade(&board->cells[player->pieces[pieceIndex].cellNo]))
     {
       cellNo = player->pieces[pieceIndex].cellNo;
       break;
@@ -657,15 +1102,15 @@ int getCellNoOfRandomBlock(struct Player *player, struct Piece *cells[][PIECE_NO
   return cellNo;
 }
 
-int getEnemyDistanceFromHome(struct Piece *cell[PIECE_NO])
+int getEnemyDistanceFromHome(struct Cell *cell)
 {
   int enemyDistanceFromHome = 0;
 
   for (int cellIndex = 0; cellIndex < PIECE_NO; cellIndex++)
   {
-    if (cell[cellIndex] != NULL)
+    if (cell->pieces[cellIndex] != NULL)
     {
-      enemyDistanceFromHome = getDistanceFromHome(cell[cellIndex]);
+      enemyDistanceFromHome = getDistanceFromHome(cell->pieces[cellIndex]);
       break;
     }
   }
@@ -673,7 +1118,7 @@ int getEnemyDistanceFromHome(struct Piece *cell[PIECE_NO])
   return enemyDistanceFromHome;
 }
 
-bool pieceInApproachRange(struct Piece *piece, struct Piece *cells[][PIECE_NO], int finalCellNo)
+bool pieceInApproachRange(struct Piece *piece, int finalCellNo)
 {
   enum Color color = getPieceColor(piece->name[0]);
   int approachIndex = getApproachIndex(color);
@@ -742,38 +1187,38 @@ bool canMoveInHomeStraight(int cellNo, int diceNumber)
 
 int rollDice()
 {
-  int diceNumber = (rand() % 6) + 1;
+  int diceNumber = (gameRandom() % 6) + 1;
   return diceNumber;
 }
 
 // Coin toss
 bool getDirectionFromToss()
 {
-  bool clockWise = rand() % 2;
+  bool clockWise = gameRandom() % 2;
 
   return clockWise;
 }
 
 int getMysteryEffect()
 {
-  int mysteryEffect = (rand() % MYSTERY_LOCATIONS) + 1;
+  int mysteryEffect = (gameRandom() % MYSTERY_LOCATIONS) + 1;
   return mysteryEffect;
 }
 
-void formBlock(struct Piece *cell[PIECE_NO])
+void formBlock(struct Cell *cell)
 {
   int maxDistanceFromHome = 0;
   bool selectedClockWise = true;
 
   for (int cellIndex = 0; cellIndex < PIECE_NO; cellIndex++)
   {
-    if (cell[cellIndex] != NULL)
+    if (cell->pieces[cellIndex] != NULL)
     {
-      int distanceFromHome = getDistanceFromHome(cell[cellIndex]);
+      int distanceFromHome = getDistanceFromHome(cell->pieces[cellIndex]);
       if (distanceFromHome > maxDistanceFromHome)
       {
         maxDistanceFromHome = distanceFromHome;
-        selectedClockWise = cell[cellIndex]->clockWise;
+        selectedClockWise = cell->pieces[cellIndex]->clockWise;
       }
     }
   }
@@ -781,15 +1226,17 @@ void formBlock(struct Piece *cell[PIECE_NO])
   // set direction for block piece
   for (int cellIndex = 0; cellIndex < PIECE_NO; cellIndex++)
   {
-    if (cell[cellIndex] != NULL)
+    if (cell->pieces[cellIndex] != NULL)
     {
-      cell[cellIndex]->blockClockWise = selectedClockWise;
+      cell->pieces[cellIndex]->blockClockWise = selectedClockWise;
     }
   }
 }
 
-void moveFromBase(struct Player *player, struct Piece *piece, struct Piece *cell[PLAYER_NO])
+void moveFromBase(struct Player *player, struct Piece *piece, struct Board *board)
 {
+  int startCellNo = getStartIndex(player->color);
+  struct Cell *cell = &board->cells[startCellNo];
   enum Color color = getPieceColor(piece->name[0]);
   char *pieceColor = getName(color);
   int enemyCount = getEnemyCountOfCell(cell, color);
@@ -799,25 +1246,21 @@ void moveFromBase(struct Player *player, struct Piece *piece, struct Piece *cell
   {
     for (int cellIndex = 0; cellIndex < PLAYER_NO; cellIndex++)
     {
-      if (cell[cellIndex] != NULL && cell[cellIndex]->name[0] != piece->name[0])
+      if (cell->pieces[cellIndex] != NULL && cell->pieces[cellIndex]->name[0] != piece->name[0])
       {
-        cell[cellIndex]->cellNo = BASE;
-        resetPiece(cell[cellIndex]);
-        cell[cellIndex] = NULL;
-        piece->captured += 1;
-        break;
-      }
-    }
+        struct Piece *enemyPiece = cell->pieces[cellIndex];
 
-    for (int cellIndex = 0; cellIndex < PIECE_NO; cellIndex++)
-    {
-      if (cell[cellIndex] == NULL)
-      {
-        cell[cellIndex] = piece;
+        removePieceFromCell(board, startCellNo, enemyPiece);
+        resetPiece(enemyPiece, board);
+        addPieceCapture(piece, board);
         break;
       }
     }
+
+    placePieceInCell(board, startCellNo, piece);
     piece->cellNo = player->startIndex;
+    board->piecesInBase[color]--;
+    board->piecesInPlay++;
     piece->clockWise = getDirectionFromToss();
 
     if (playerCount != 0)
@@ -825,10 +1268,10 @@ void moveFromBase(struct Player *player, struct Piece *piece, struct Piece *cell
       formBlock(cell); 
     }
 
-    int noOfPiecesInBase = getNoOfPiecesInBase(player);
+    int noOfPiecesInBase = getNoOfPiecesInBase(board, color);
 
-    printf("%s moves piece %s to the starting point\n", pieceColor, piece->name);
-    printf("%s player now has %d/4 of pieces on the board and %d/4 pieces on the base\n\n",
+    gameLog("%s moves piece %s to the starting point\n", pieceColor, piece->name);
+    gameLog("%s player now has %d/4 of pieces on the board and %d/4 pieces on the base\n\n",
       pieceColor,
       PLAYER_NO - noOfPiecesInBase,
       noOfPiecesInBase
@@ -836,22 +1279,34 @@ void moveFromBase(struct Player *player, struct Piece *piece, struct Piece *cell
   }
 }
 
-void allocateMysteryCell(struct Game *game, struct Piece *pieces[][PIECE_NO])
+// Cells where the next mystery cell can spawn, which are
+// the empty cells other than the current mystery cell.
+// Every cell in the mask is equally likely
+uint64_t getMysteryCandidateCells(struct Game *game, struct Board *board)
 {
-  bool repeat = true;
+  uint64_t cells = getEmptyCells(board);
 
-  do
+  if (game->mysteryCellNo != EMPTY)
   {
-    int mysteryCell = (rand() % MAX_STANDARD_CELL - 1) + 1;
+    cells &= ~(1ULL << game->mysteryCellNo);
+  }
 
-    if (mysteryCell != game->prevMysteryCell && isCellEmpty(pieces[mysteryCell]))
-    {
-      repeat = false;
-      game->prevMysteryCell = game->mysteryCellNo;
-      game->mysteryCellNo = mysteryCell;
-    }
+  return cells;
+}
+
+void allocateMysteryCell(struct Game *game, struct Board *board)
+{
+  uint64_t cells = getMysteryCandidateCells(game, board);
+  int cellCount = __builtin_popcountll(cells);
+
+  // keep the current mystery cell if no other cell is empty
+  if (cellCount == 0)
+  {
+    return;
   }
-  while (repeat);
+
+  game->prevMysteryCell = game->mysteryCellNo;
+  game->mysteryCellNo = selectCellFromMask(cells, gameRandom() % cellCount);
 }
 
 void applyMysteryEffect
@@ -863,18 +1318,18 @@ void applyMysteryEffect
   switch (mysteryEffect)
   {
     case 1: // bhawana
-      int energy = rand() % 2;
+      int energy = gameRandom() % 2;
       piece->effect.effectActive = true;
       piece->effect.effectActiveRounds = 4;
 
       if (energy)
       {
-        printf("%s piece %s feels energized and movement speed doubles\n", playerName, pieceName);
+        gameLog("%s piece %s feels energized and movement speed doubles\n", playerName, pieceName);
         piece->effect.diceMultiplier = 2;  
       }
       else
       {
-        printf("%s piece %s feels sick and movement speed halves\n", playerName, pieceName);
+        gameLog("%s piece %s feels sick and movement speed halves\n", playerName, pieceName);
         piece->effect.diceDivider = 2;
       }
 
@@ -883,7 +1338,7 @@ void applyMysteryEffect
       piece->effect.effectActive = true;
       piece->effect.pieceActive = false;
       piece->effect.effectActiveRounds = 4;
-      printf("%s piece %s attends meeting and cannot move for the next four rounds\n", playerName, pieceName);
+      gameLog("%s piece %s attends meeting and cannot move for the next four rounds\n", playerName, pieceName);
       break;
     case 3: // pita kotuwa
       bool isClockWise = piece->clockWise;
@@ -895,12 +1350,12 @@ void applyMysteryEffect
 
       if (isClockWise)
       {
-        printf("%s piece %s which was moving clockwise, has changed to moving counter-clockwise\n", playerName, pieceName);
+        gameLog("%s piece %s which was moving clockwise, has changed to moving counter-clockwise\n", playerName, pieceName);
         piece->clockWise = false;
       }
       else
       {
-        printf("%s piece %s is moving in counter clockwise direction. Teleporting to Kotuwa from pitakotuwa\n", playerName, pieceName);
+        gameLog("%s piece %s is moving in counter clockwise direction. Teleporting to Kotuwa from pitakotuwa\n", playerName, pieceName);
 
         piece->effect.effectActive = true;
         piece->effect.pieceActive = false;
@@ -917,7 +1372,7 @@ void applyMysteryEffect
   piece->cellNo = mysteryLocation;
 }
 
-void applyTeleportation(struct Piece **pieces, int mysteryEffect, int count, struct Piece *cells[][PLAYER_NO])
+void applyTeleportation(struct Piece **pieces, int mysteryEffect, int count, struct Board *board)
 {
   int mysteryLocation = getMysteryLocation(mysteryEffect, pieces[0]);
   char *mysteryLocationName = getMysteryLocationName(mysteryEffect);
@@ -927,45 +1382,38 @@ void applyTeleportation(struct Piece **pieces, int mysteryEffect, int count, str
 
   if (mysteryLocation == BASE)
   {
-    handleBaseTeleportation(pieces, cells, count, playerName, mysteryLocationName);
+    handleBaseTeleportation(pieces, board, count, playerName, mysteryLocationName);
     return;
   }
 
-  int enemyCount = getEnemyCountOfCell(cells[mysteryLocation], color);
-  int playerCount = getPlayerCountOfCell(cells[mysteryLocation], color);
+  int enemyCount = getEnemyCountOfCell(&board->cells[mysteryLocation], color);
+  int playerCount = getPlayerCountOfCell(&board->cells[mysteryLocation], color);
 
   if (!canTeleport(isBlocked(count, enemyCount), playerCount, playerName, mysteryLocation))
   {
     return;
   }
 
-  bool captured = false;
-
   // find if teleportation triggers a piece capture action
-  for (int cellIndex = 0; cellIndex < PLAYER_NO; cellIndex++)
-  {
-    if (cells[mysteryLocation][cellIndex] != NULL && getPieceColor(cells[mysteryLocation][cellIndex]->name[0]) != color)
-    {
-      captured = true;
-    }
-  }
+  bool captured = enemyCount != 0;
 
-  // Reset previous position cells
-  for (int cellIndex = 0; cellIndex < PIECE_NO; cellIndex++)
+  // Reset previous position cells of the teleported pieces
+  for (int pieceIndex = 0; pieceIndex < count; pieceIndex++)
   {
-    cells[pieces[0]->cellNo][cellIndex] = NULL;
+    removePieceFromCell(board, pieces[0]->cellNo, pieces[pieceIndex]);
   }
 
-  // capture the pieces
+  // capture the pieces, the source cell is already cleared
+  // so the count tells whether a block teleported
   if (captured)
   {
-    if (isBlockade(cells[pieces[0]->cellNo]))
+    if (count > 1)
     {
-      captureByBlock(pieces, count, cells, mysteryLocation, playerName);
+      captureByBlock(pieces, count, board, mysteryLocation, playerName);
     }
     else
     {
-      captureByPiece(pieces[0], cells, mysteryLocation, playerName);
+      captureByPiece(pieces[0], board, mysteryLocation, playerName);
     }
   }
 
@@ -973,55 +1421,47 @@ void applyTeleportation(struct Piece **pieces, int mysteryEffect, int count, str
 
   for (int pieceIndex = 0; pieceIndex < count; pieceIndex++)
   {
-    for (int cellIndex = 0; cellIndex < PLAYER_NO; cellIndex++)
-    {
-      if (cells[mysteryLocation][cellIndex] == NULL)
-      {
-        // get direction of piece before applying mystery effect
-        bool prevClockWise = pieces[pieceIndex]->clockWise;
-        bool isPartOfBlockade = false;
+    // get direction of piece before applying mystery effect
+    bool prevClockWise = pieces[pieceIndex]->clockWise;
+    bool isPartOfBlockade = false;
 
-        if (count > 1)
-        {
-          isPartOfBlockade = true;
-          prevClockWise = pieces[pieceIndex]->blockClockWise;
-        }
+    if (count > 1)
+    {
+      isPartOfBlockade = true;
+      prevClockWise = pieces[pieceIndex]->blockClockWise;
+    }
 
-        cells[mysteryLocation][cellIndex] = pieces[pieceIndex]; // place the piece in new location
-        applyMysteryEffect(mysteryEffect, mysteryLocation, pieces[pieceIndex], playerName, pieces[pieceIndex]->name, isPartOfBlockade);
+    placePieceInCell(board, mysteryLocation, pieces[pieceIndex]); // place the piece in new location
+    applyMysteryEffect(mysteryEffect, mysteryLocation, pieces[pieceIndex], playerName, pieces[pieceIndex]->name, isPartOfBlockade);
 
-        if (mysteryEffect == getMysteryEffectNumber(PITA_KOTUWA) && !prevClockWise)
-        {
-          reTeleport = true;
-        }
-        break;
-      }
+    if (mysteryEffect == getMysteryEffectNumber(PITA_KOTUWA) && !prevClockWise)
+    {
+      reTeleport = true;
     }
   }
 
   if (reTeleport)
   {
     int newMysteryEffect = getMysteryEffectNumber(KOTUWA);
-    applyTeleportation(pieces, newMysteryEffect, count, cells);
+    applyTeleportation(pieces, newMysteryEffect, count, board);
   }
 }
 
 void handleBaseTeleportation
 (
-  struct Piece **pieces, struct Piece *cells[][PIECE_NO], 
+  struct Piece **pieces, struct Board *board, 
   int count, char *playerName, char *mysteryLocationName
 )
 {
-  // Reset previous position cells
-  for (int cellIndex = 0; cellIndex < PIECE_NO; cellIndex++)
+  // Reset previous position cells of the teleported pieces
+  for (int pieceIndex = 0; pieceIndex < count; pieceIndex++)
   {
-    cells[pieces[0]->cellNo][cellIndex] = NULL;
+    removePieceFromCell(board, pieces[0]->cellNo, pieces[pieceIndex]);
   }
   
   for (int pieceIndex = 0; pieceIndex < count; pieceIndex++)
   {
-    pieces[pieceIndex]->cellNo = BASE;
-    resetPiece(pieces[pieceIndex]);
+    resetPiece(pieces[pieceIndex], board);
   }
   displayTeleportationMessage(playerName, count, pieces, mysteryLocationName);
 }
@@ -1030,7 +1470,7 @@ bool canTeleport(bool isTeleportBlocked, int playerCount, char *playerName, int
 {
   if (isTeleportBlocked)
   {
-    printf("There is a block in L%d preventing %s from teleporting therefore aborting mystery cell teleportation\n",
+    gameLog("There is a block in L%d preventing %s from teleporting therefore aborting mystery cell teleportation\n",
       mysteryLocation,
       playerName
     );
@@ -1039,7 +1479,7 @@ bool canTeleport(bool isTeleportBlocked, int playerCount, char *playerName, int
 
   if (playerCount != 0)
   {
-    printf("Mystery effect cancelled since there is already a %s pieces on L%d\n",
+    gameLog("Mystery effect cancelled since there is already a %s pieces on L%d\n",
       playerName,
       mysteryLocation
     );
@@ -1067,8 +1507,20 @@ int getDiceValueAfterMysteryEffect(int diceNumber, struct Player *player, int pi
   return diceNumber;
 }
 
-void resetPiece(struct Piece *piece)
+void resetPiece(struct Piece *piece, struct Board *board)
 {
+  enum Color color = getPieceColor(piece->name[0]);
+
+  recordPieceChange(piece);
+
+  // return the piece and its captures to the totals of the base
+  if (piece->cellNo != BASE)
+  {
+    board->piecesInBase[color]++;
+    board->piecesInPlay--;
+  }
+  board->captureCount[color] -= piece->captured;
+
   // reset piece stats
   piece->cellNo = BASE;
   piece->captured = 0;
@@ -1110,29 +1562,28 @@ void resetMysteryEffect(struct Piece *pieces)
   }
 }
 
-void captureByPiece(struct Piece *piece, struct Piece *cells[][PIECE_NO], int finalCellNo, char *playerName)
+void captureByPiece(struct Piece *piece, struct Board *board, int finalCellNo, char *playerName)
 {
-  piece->captured+=1;
+  addPieceCapture(piece, board);
   for (int cellIndex = 0; cellIndex < PIECE_NO; cellIndex++)
   {
-    if (cells[finalCellNo][cellIndex] != NULL)
+    if (board->cells[finalCellNo].pieces[cellIndex] != NULL)
     {
-      enum Color enemyColor = getPieceColor(cells[finalCellNo][cellIndex]->name[0]);
+      enum Color enemyColor = getPieceColor(board->cells[finalCellNo].pieces[cellIndex]->name[0]);
       char *enemyName = getName(enemyColor);
 
-      printf("%s piece %s lands on square L%d, captures %s piece %s, and returns it to the base\n",
+      gameLog("%s piece %s lands on square L%d, captures %s piece %s, and returns it to the base\n",
         playerName,
         piece->name,
         finalCellNo,
         enemyName,
-        cells[finalCellNo][cellIndex]->name
+        board->cells[finalCellNo].pieces[cellIndex]->name
       );
           
-      cells[finalCellNo][cellIndex]->cellNo = BASE;
-      resetPiece(cells[finalCellNo][cellIndex]);
+      resetPiece(board->cells[finalCellNo].pieces[cellIndex], board);
 
       // clear the pointer
-      cells[finalCellNo][cellIndex] = NULL;
+      setCellPiece(board, finalCellNo, cellIndex, NULL);
 
       break;
     }
@@ -1143,61 +1594,60 @@ void captureByBlock
 (
   struct Piece **blockPieces,
   int playerCount,
-  struct Piece *cells[][PIECE_NO],
+  struct Board *board,
   int finalCellNo,
   char *playerName
 )
 {
   for (int cellIndex = 0, blockIndex = 0; cellIndex < PIECE_NO; cellIndex++)
   {
-    if (cells[finalCellNo][cellIndex] != NULL)
+    if (board->cells[finalCellNo].pieces[cellIndex] != NULL)
     {
-      enum Color enemyColor = getPieceColor(cells[finalCellNo][cellIndex]->name[0]);
+      enum Color enemyColor = getPieceColor(board->cells[finalCellNo].pieces[cellIndex]->name[0]);
       char *enemyName = getName(enemyColor);
 
-      printf("%s piece %s is captured by block of %s and is returned to the base\n",
+      gameLog("%s piece %s is captured by block of %s and is returned to the base\n",
         enemyName,
-        cells[finalCellNo][cellIndex]->name,
+        board->cells[finalCellNo].pieces[cellIndex]->name,
         playerName
       );
           
-      cells[finalCellNo][cellIndex]->cellNo = BASE;
-      resetPiece(cells[finalCellNo][cellIndex]);
+      resetPiece(board->cells[finalCellNo].pieces[cellIndex], board);
 
       // clear the pointer
-      cells[finalCellNo][cellIndex] = NULL;
+      setCellPiece(board, finalCellNo, cellIndex, NULL);
     }
   }
 
   // increment for all pieces of the block
   for (int blockIndex = 0; blockIndex < playerCount; blockIndex++)
   {
-    blockPieces[blockIndex]->captured++;
+    addPieceCapture(blockPieces[blockIndex], board);
   }
 }
 
-void separateBlockade(struct Piece *cells[][PIECE_NO], int blockCellNo)
+void separateBlockade(struct Board *board, int blockCellNo)
 {
   int cummulativeDistance = MAX_DICE_VALUE;
-  enum Color color = getPlayerColorInCell(cells[blockCellNo]);
-  int playerCount = getPlayerCountOfCell(cells[blockCellNo], color);
+  enum Color color = getPlayerColorInCell(&board->cells[blockCellNo]);
+  int playerCount = getPlayerCountOfCell(&board->cells[blockCellNo], color);
   int distanceForOneCell = cummulativeDistance/playerCount;
 
   for (int cellIndex = 0; cellIndex < PIECE_NO; cellIndex++)
   {
-    if (cells[blockCellNo][cellIndex] != NULL)
+    if (board->cells[blockCellNo].pieces[cellIndex] != NULL)
     {
-      move(cells[blockCellNo][cellIndex], cellIndex, distanceForOneCell, cells);
+      move(board->cells[blockCellNo].pieces[cellIndex], distanceForOneCell, board);
     }
   }
 }
 
-void move(struct Piece *piece, int prevIndex, int diceNumber, struct Piece *cells[][PIECE_NO])
+void move(struct Piece *piece, int diceNumber, struct Board *board)
 {
   enum Color color = getPieceColor(piece->name[0]);
   char *playerName = getName(color);
 
-  int movableCellCount = getMovableCellCount(piece->cellNo, diceNumber, piece->clockWise, 1, cells, color);
+  int movableCellCount = getMovableCellCount(piece->cellNo, diceNumber, piece->clockWise, 1, board, color);
 
   bool formBlockStatus = false; 
   int directionConstant = piece->clockWise ? 1 : -1;
@@ -1208,7 +1658,7 @@ void move(struct Piece *piece, int prevIndex, int diceNumber, struct Piece *cell
   if (movableCellCount == 0)
   {
     targetFinalCellNo = getCorrectCellCount(piece->cellNo + (1 * directionConstant));
-    displayMovablePieceStatus(movableCellCount, diceNumber, playerName, piece, finalCellNo, cells[targetFinalCellNo]);
+    displayMovablePieceStatus(movableCellCount, diceNumber, playerName, piece, finalCellNo, &board->cells[targetFinalCellNo]);
     return;
   }
   else if (movableCellCount < diceNumber)
@@ -1218,25 +1668,25 @@ void move(struct Piece *piece, int prevIndex, int diceNumber, struct Piece *cell
   }
 
   // Must NULL this index to avoid cell duplication
-  cells[piece->cellNo][prevIndex] = NULL;
+  removePieceFromCell(board, piece->cellNo, piece);
 
-  if (handleCellToHomeStraight(piece, diceNumber, movableCellCount, finalCellNo, cells))
+  if (handleCellToHomeStraight(piece, diceNumber, movableCellCount, finalCellNo, board))
   {
     return;
   }
 
-  displayMovablePieceStatus(movableCellCount, diceNumber, playerName, piece, finalCellNo, cells[targetFinalCellNo]);
+  displayMovablePieceStatus(movableCellCount, diceNumber, playerName, piece, finalCellNo, &board->cells[targetFinalCellNo]);
 
-  incrementHomeApproachPasses(piece, cells, finalCellNo);
+  incrementHomeApproachPasses(piece, finalCellNo);
 
   piece->cellNo = finalCellNo;
   
   // trigger capture or form block actions
-  if (!isCellEmpty(cells[finalCellNo]))
+  if (!isCellEmpty(&board->cells[finalCellNo]))
   {
-    if (getEnemyCountOfCell(cells[finalCellNo], color) != 0)
+    if (getEnemyCountOfCell(&board->cells[finalCellNo], color) != 0)
     {
-      captureByPiece(piece, cells, finalCellNo, playerName);
+      captureByPiece(piece, board, finalCellNo, playerName);
     }
     else
     {
@@ -1245,30 +1695,23 @@ void move(struct Piece *piece, int prevIndex, int diceNumber, struct Piece *cell
   }
 
   // place piece in the new position
-  for (int cellIndex = 0; cellIndex < PIECE_NO; cellIndex++)
-  {
-    if (cells[finalCellNo][cellIndex] == NULL)
-    {
-      cells[finalCellNo][cellIndex] = piece;
-      break;
-    }
-  }
+  placePieceInCell(board, finalCellNo, piece);
 
   if (formBlockStatus)
   {
-    formBlock(cells[finalCellNo]);
-    printf("%s piece has formed a block on L%d\n",
+    formBlock(&board->cells[finalCellNo]);
+    gameLog("%s piece has formed a block on L%d\n",
       playerName,
       finalCellNo
     );
   }
 }
 
-void moveBlock(struct Piece *piece, int diceNumber, struct Piece *cells[][PIECE_NO])
+void moveBlock(struct Piece *piece, int diceNumber, struct Board *board)
 {
   enum Color color = getPieceColor(piece->name[0]);
   char *playerName = getName(color);
-  int playerCount = getPlayerCountOfCell(cells[piece->cellNo], color);
+  int playerCount = getPlayerCountOfCell(&board->cells[piece->cellNo], color);
   int blockDiceNumber = diceNumber/playerCount;
   struct Piece *blockPieces[playerCount];
 
@@ -1280,14 +1723,15 @@ void moveBlock(struct Piece *piece, int diceNumber, struct Piece *cells[][PIECE_
       break;
     }
 
-    if (cells[piece->cellNo][cellIndex] != NULL)
+    if (board->cells[piece->cellNo].pieces[cellIndex] != NULL && getPieceColor(board->cells[piece->cellNo].pieces[cellIndex]->name[0]) == color)
     {
-      blockPieces[blockIndex] = cells[piece->cellNo][cellIndex];
+      blockPieces[blockIndex] = board->cells[piece->cellNo].pieces[cellIndex];
       blockIndex++;
     }
   }
   
-  int movableCellCount = getMovableCellCount(piece->cellNo, blockDiceNumber, piece->blockClockWise, playerCount, cells, color);
+  int blockCellNo = piece->cellNo;
+  int movableCellCount = getMovableCellCount(piece->cellNo, blockDiceNumber, piece->blockClockWise, playerCount, board, color);
 
   bool formBlockStatus = false;
   int directionConstant = piece->blockClockWise ? 1 : -1;
@@ -1298,7 +1742,7 @@ void moveBlock(struct Piece *piece, int diceNumber, struct Piece *cells[][PIECE_
   if (movableCellCount == 0)
   {
     targetFinalCellNo = getCorrectCellCount(piece->cellNo + (1 * directionConstant));
-    displayMovableBlockStatus(movableCellCount, blockDiceNumber, playerName, piece, finalCellNo, cells[targetFinalCellNo]);
+    displayMovableBlockStatus(movableCellCount, blockDiceNumber, playerName, piece, finalCellNo, &board->cells[targetFinalCellNo]);
     return;
   }
   else if (movableCellCount < 0)
@@ -1309,42 +1753,32 @@ void moveBlock(struct Piece *piece, int diceNumber, struct Piece *cells[][PIECE_
 
   for (int blockIndex = 0; blockIndex < playerCount; blockIndex++)
   {
-    int pieceMovableCellCount = getMovableCellCount(piece->cellNo, diceNumber, blockPieces[blockIndex]->clockWise, 1, cells, color);
+    int pieceMovableCellCount = getMovableCellCount(piece->cellNo, diceNumber, blockPieces[blockIndex]->clockWise, 1, board, color);
     int pieceDirectionConstant = blockPieces[blockIndex]->clockWise ? 1 : -1;
     int pieceFinalCellNo = getCorrectCellCount(diceNumber + (pieceDirectionConstant * diceNumber));
-    if (handleCellToHomeStraight(blockPieces[blockIndex], diceNumber, pieceMovableCellCount, pieceFinalCellNo, cells))
+    if (handleCellToHomeStraight(blockPieces[blockIndex], diceNumber, pieceMovableCellCount, pieceFinalCellNo, board))
     {
       // NULL only the piece moved to homestraight
-      for (int cellIndex = 0; cellIndex < PIECE_NO; cellIndex++)
-      {
-        if (cells[piece->cellNo][cellIndex] != NULL)
-        {
-          // potential to cause errors in future
-          if (cells[piece->cellNo][cellIndex]->name == blockPieces[blockIndex]->name)
-          {
-            cells[piece->cellNo][cellIndex] = NULL;
-          }
-        }
-      }
+      removePieceFromCell(board, blockCellNo, blockPieces[blockIndex]);
       return;
     }
-    incrementHomeApproachPasses(blockPieces[blockIndex], cells, finalCellNo);
+    incrementHomeApproachPasses(blockPieces[blockIndex], finalCellNo);
   }
 
-  // reset the cell pointers in the array
-  for (int cellIndex = 0; cellIndex < playerCount; cellIndex++)
+  // reset the cell pointers of the block pieces in the array
+  for (int blockIndex = 0; blockIndex < playerCount; blockIndex++)
   {
-    cells[piece->cellNo][cellIndex] = NULL;
+    removePieceFromCell(board, blockCellNo, blockPieces[blockIndex]);
   }
 
-  displayMovableBlockStatus(movableCellCount, blockDiceNumber, playerName, piece, finalCellNo, cells[targetFinalCellNo]);
+  displayMovableBlockStatus(movableCellCount, blockDiceNumber, playerName, piece, finalCellNo, &board->cells[targetFinalCellNo]);
 
   // triiger capture or form block actions
-  if (!isCellEmpty(cells[finalCellNo]))
+  if (!isCellEmpty(&board->cells[finalCellNo]))
   {
-    if (getEnemyCountOfCell(cells[finalCellNo], color) != 0)
+    if (getEnemyCountOfCell(&board->cells[finalCellNo], color) != 0)
     {
-      captureByBlock(blockPieces, playerCount, cells, finalCellNo, playerName);
+      captureByBlock(blockPieces, playerCount, board, finalCellNo, playerName);
     }
     else
     {
@@ -1352,55 +1786,49 @@ void moveBlock(struct Piece *piece, int diceNumber, struct Piece *cells[][PIECE_
     }
   }
 
-  for (int cellIndex = 0, blockIndex = 0; cellIndex < PIECE_NO; cellIndex++)
+  for (int blockIndex = 0; blockIndex < playerCount; blockIndex++)
   {
-    // exit loop if block index exceeds the maximum
-    // no of player counts in array
-    if (blockIndex >= playerCount)
-    {
-      break;
-    }
-
-    if (cells[finalCellNo][cellIndex] == NULL)
-    {
-      cells[finalCellNo][blockIndex] = blockPieces[blockIndex];
-      blockPieces[blockIndex]->cellNo = finalCellNo;
-
-      blockIndex++;
-    }
+    placePieceInCell(board, finalCellNo, blockPieces[blockIndex]);
+    blockPieces[blockIndex]->cellNo = finalCellNo;
   }
 
   if (formBlockStatus)
   {
-    formBlock(cells[finalCellNo]);
-    printf("Block of %s has formed another block\n",
+    formBlock(&board->cells[finalCellNo]);
+    gameLog("Block of %s has formed another block\n",
       playerName
     );
   }
 }
 
-void moveInHomeStraight(struct Piece *piece, int diceNumber)
+void moveInHomeStraight(struct Piece *piece, int diceNumber, struct Board *board)
 {
   enum Color color = getPieceColor(piece->name[0]);
   char *playerName = getName(color);
 
   if (canMoveToHome(piece->cellNo, diceNumber))
   {
-    printf("%s piece %s has successfully reached Home!\n", playerName, piece->name);
+    gameLog("%s piece %s has successfully reached Home!\n", playerName, piece->name);
+    // a piece already at home can be picked with a zero dice value
+    if (piece->cellNo != HOME)
+    {
+      board->piecesAtHome[color]++;
+      board->piecesInPlay--;
+    }
     piece->cellNo = HOME;
   }
   else if (piece->cellNo + diceNumber < HOME)
   {
-    printf("%s piece %s has moved forward in home straight by %d units\n", playerName, piece->name, diceNumber);
+    gameLog("%s piece %s has moved forward in home straight by %d units\n", playerName, piece->name, diceNumber);
     piece->cellNo += diceNumber;
   }
   else
   {
-    printf("%s piece %s cannot move in homestraight since it has rolled greater value than home\n", playerName, piece->name);
+    gameLog("%s piece %s cannot move in homestraight since it has rolled greater value than home\n", playerName, piece->name);
   }
 }
 
-void handlePieceLandOnMysteryCell(struct Game *game, struct Player *player, struct Piece *cells[][PIECE_NO])
+void handlePieceLandOnMysteryCell(struct Game *game, struct Player *player, struct Board *board)
 {
   int count = 0;
   for (int pieceIndex = 0; pieceIndex < PIECE_NO; pieceIndex++)
@@ -1428,10 +1856,19 @@ void handlePieceLandOnMysteryCell(struct Game *game, struct Player *player, stru
   }
 
   int mysteryEffect = getMysteryEffect();
-  applyTeleportation(pieces, mysteryEffect, count, cells);
+  landedMysteryEffect = mysteryEffect;
+  applyTeleportation(pieces, mysteryEffect, count, board);
+}
+
+// Effect of the mystery cell the last teleported pieces of
+// this thread landed on. A Pita-Kotuwa landing stays 3 when
+// the pieces are sent on to Kotuwa
+int getLandedMysteryEffect()
+{
+  return landedMysteryEffect;
 }
 
-bool handleCellToHomeStraight(struct Piece *piece, int diceNumber, int movableCellCount, int finalCellNo, struct Piece *cells[][PIECE_NO])
+bool handleCellToHomeStraight(struct Piece *piece, int diceNumber, int movableCellCount, int finalCellNo, struct Board *board)
 {
   enum Color color = getPieceColor(piece->name[0]);
   char *playerName = getName(color);
@@ -1454,11 +1891,11 @@ bool handleCellToHomeStraight(struct Piece *piece, int diceNumber, int movableCe
     if
     (
       movedDiceNumbers <= movableCellCount &&
-      pieceInApproachRange(piece, cells, finalCellNo) && 
+      pieceInApproachRange(piece, finalCellNo) && 
       canMoveInHomeStraight(MAX_STANDARD_CELL, remainingDiceNumbers
     ))
     {
-      printf("%s piece %s has moved L%d to L%d by %d units in %s direction\n",
+      gameLog("%s piece %s has moved L%d to L%d by %d units in %s direction\n",
         playerName,
         piece->name,
         piece->cellNo,
@@ -1466,7 +1903,7 @@ bool handleCellToHomeStraight(struct Piece *piece, int diceNumber, int movableCe
         movedDiceNumbers,
         piece->clockWise ? "clockwise" : "counter clockwise"
       );
-      printf("%s piece %s has entered home straight at %s homepath %d\n",
+      gameLog("%s piece %s has entered home straight at %s homepath %d\n",
         playerName,
         piece->name,
         playerName,
@@ -1478,7 +1915,7 @@ bool handleCellToHomeStraight(struct Piece *piece, int diceNumber, int movableCe
       // for the extra step of moving into homestraight
       if (remainingDiceNumbers - 1 > 0)
       {
-        moveInHomeStraight(piece, remainingDiceNumbers - 1);
+        moveInHomeStraight(piece, remainingDiceNumbers - 1, board);
       }
       return true;
     }
@@ -1487,108 +1924,264 @@ bool handleCellToHomeStraight(struct Piece *piece, int diceNumber, int movableCe
   return false;
 }
 
-void incrementHomeApproachPasses(struct Piece *piece, struct Piece *cells[][PIECE_NO], int finalCellNo)
+void incrementHomeApproachPasses(struct Piece *piece, int finalCellNo)
 {
-  if (pieceInApproachRange(piece, cells, finalCellNo))
+  if (pieceInApproachRange(piece, finalCellNo))
   {
     piece->noOfApproachPasses++;
   }
 }
 
-/* Behavior functions
+/* Behavior weight functions
  */
 
-union PiecePriority getPriorities(enum Color color)
+char *getWeightName(enum PieceWeight weight)
 {
-  union PiecePriority piecePriorities;
+  char *name = NULL;
+  switch (weight)
+  {
+    case ATTACK_WEIGHT:
+      name = "attack";
+      break;
+    case MOVE_FROM_BASE_WEIGHT:
+      name = "moveFromBase";
+      break;
+    case FORM_BLOCK_WEIGHT:
+      name = "formBlock";
+      break;
+    case SKIP_BLOCK_WEIGHT:
+      name = "skipBlock";
+      break;
+    case STAY_IN_BLOCK_WEIGHT:
+      name = "stayInBlock";
+      break;
+    case FULL_MOVE_WEIGHT:
+      name = "fullMove";
+      break;
+    case PARTIAL_MOVE_WEIGHT:
+      name = "partialMove";
+      break;
+    case SINGLE_PIECE_WEIGHT:
+      name = "singlePiece";
+      break;
+    case BLOCK_MOVABLE_WEIGHT:
+      name = "blockMovable";
+      break;
+    case PREFER_TO_MOVE_WEIGHT:
+      name = "preferToMove";
+      break;
+    case ROTATION_WEIGHT:
+      name = "rotation";
+      break;
+    case IMMOBILE_WEIGHT:
+      name = "immobile";
+      break;
+    case REMAINING_THROWS_WEIGHT:
+      name = "remainingThrows";
+      break;
+    case WEIGHT_NO:
+      break;
+  }
+
+  if (name == NULL)
+  {
+    displayErrors();
+    exit(0);
+  }
+
+  return name;
+}
+
+// Default weights reproduce the original hard coded
+// importance values of each behavior
+void setDefaultPieceWeights(enum Color color, int *weights)
+{
+  for (int weightIndex = 0; weightIndex < WEIGHT_NO; weightIndex++)
+  {
+    weights[weightIndex] = 0;
+  }
+
+  weights[FULL_MOVE_WEIGHT] = 2;
+  weights[PARTIAL_MOVE_WEIGHT] = 1;
 
   switch (color)
   {
     case RED:
-      struct RedPriority *redPriorities = malloc(PIECE_NO * sizeof(struct RedPriority));
+      weights[ATTACK_WEIGHT] = MAX_PRIORITY;
+      weights[MOVE_FROM_BASE_WEIGHT] = MAX_PRIORITY/2;
+      weights[SKIP_BLOCK_WEIGHT] = 1;
+      weights[STAY_IN_BLOCK_WEIGHT] = -1;
+      weights[SINGLE_PIECE_WEIGHT] = 1;
+      break;
+    case GREEN:
+      weights[FORM_BLOCK_WEIGHT] = MAX_PRIORITY;
+      weights[MOVE_FROM_BASE_WEIGHT] = MAX_PRIORITY-1;
+      weights[BLOCK_MOVABLE_WEIGHT] = 1;
+      break;
+    case YELLOW:
+      weights[MOVE_FROM_BASE_WEIGHT] = MAX_PRIORITY;
+      weights[ATTACK_WEIGHT] = MAX_PRIORITY/2;
+      break;
+    case BLUE:
+      weights[ROTATION_WEIGHT] = MAX_PRIORITY/2;
+      weights[PREFER_TO_MOVE_WEIGHT] = MAX_PRIORITY/2;
+      weights[IMMOBILE_WEIGHT] = -MAX_PRIORITY/2;
+      break;
+  }
+}
 
-      if (redPriorities == NULL)
-      {
-        printf("Failed to allocate memory\n");
-        exit(0);
-      }
+// check if a weight is read by the behavior of the color
+bool isWeightUsed(enum Color color, enum PieceWeight weight)
+{
+  if (weight == FULL_MOVE_WEIGHT || weight == PARTIAL_MOVE_WEIGHT || weight == REMAINING_THROWS_WEIGHT)
+  {
+    return true;
+  }
 
-      for (int pieceIndex = 0; pieceIndex < PIECE_NO; pieceIndex++)
+  switch (color)
+  {
+    case RED:
+      return weight == ATTACK_WEIGHT || weight == MOVE_FROM_BASE_WEIGHT ||
+        weight == SKIP_BLOCK_WEIGHT || weight == STAY_IN_BLOCK_WEIGHT ||
+        weight == SINGLE_PIECE_WEIGHT;
+    case GREEN:
+      return weight == FORM_BLOCK_WEIGHT || weight == MOVE_FROM_BASE_WEIGHT ||
+        weight == BLOCK_MOVABLE_WEIGHT;
+    case YELLOW:
+      return weight == MOVE_FROM_BASE_WEIGHT || weight == ATTACK_WEIGHT;
+    case BLUE:
+      return weight == ROTATION_WEIGHT || weight == PREFER_TO_MOVE_WEIGHT ||
+        weight == IMMOBILE_WEIGHT;
+  }
+
+  return false;
+}
+
+// Weights file format is one "<color> <weight name> <value>"
+// entry per line, lines starting with '#' are ignored.
+// Weights missing from the file keep their default value
+bool loadPieceWeights(char *fileName, int weights[][WEIGHT_NO])
+{
+  for (int color = 0; color < PLAYER_NO; color++)
+  {
+    setDefaultPieceWeights(color, weights[color]);
+  }
+
+  FILE *file = fopen(fileName, "r");
+
+  if (file == NULL)
+  {
+    return false;
+  }
+
+  char line[128];
+  while (fgets(line, sizeof(line), file) != NULL)
+  {
+    char colorName[16];
+    char weightName[32];
+    int value;
+
+    if (line[0] == '#' || sscanf(line, "%15s %31s %d", colorName, weightName, &value) != 3)
+    {
+      continue;
+    }
+
+    for (int color = 0; color < PLAYER_NO; color++)
+    {
+      if (strcasecmp(colorName, getName(color)) != 0)
       {
-        redPriorities[pieceIndex].canAttack = false;
-        redPriorities[pieceIndex].canExitBlock = false;
-        redPriorities[pieceIndex].canFormBlock = false;
-        redPriorities[pieceIndex].canFullMove = false;
-        redPriorities[pieceIndex].canMoveFromBase = false;
-        redPriorities[pieceIndex].canPartialMove = false;
+        continue;
       }
-      piecePriorities.redPriority = redPriorities;
-      break;
-    
-    case GREEN:
-      struct GreenPriority *greenPriorities = malloc(PIECE_NO * sizeof(struct GreenPriority));
 
-      if (greenPriorities == NULL)
+      for (int weightIndex = 0; weightIndex < WEIGHT_NO; weightIndex++)
       {
-        printf("Failed to allocate memory\n");
-        exit(0);
+        if (strcmp(weightName, getWeightName(weightIndex)) == 0)
+        {
+          weights[color][weightIndex] = value;
+        }
       }
-      for (int pieceIndex = 0; pieceIndex < PIECE_NO; pieceIndex++)
+    }
+  }
+
+  fclose(file);
+  return true;
+}
+
+bool savePieceWeights(char *fileName, int weights[][WEIGHT_NO])
+{
+  FILE *file = fopen(fileName, "w");
+
+  if (file == NULL)
+  {
+    return false;
+  }
+
+  fprintf(file, "# piece importance weights: <color> <weight> <value>\n");
+  for (int color = 0; color < PLAYER_NO; color++)
+  {
+    for (int weightIndex = 0; weightIndex < WEIGHT_NO; weightIndex++)
+    {
+      if (isWeightUsed(color, weightIndex))
       {
-        greenPriorities[pieceIndex].canFormBlock = false;
-        greenPriorities[pieceIndex].canFullMove = false;
-        greenPriorities[pieceIndex].canMoveFromBase = false;
-        greenPriorities[pieceIndex].canPartialMove = false;
-        greenPriorities[pieceIndex].isBlockMovable = false;
+        fprintf(file, "%s %s %d\n", getName(color), getWeightName(weightIndex), weights[color][weightIndex]);
       }
-      piecePriorities.greenPriority = greenPriorities;
+    }
+  }
+
+  fclose(file);
+  return true;
+}
+
+void applyPieceWeights(struct Player *players, int weights[][WEIGHT_NO])
+{
+  for (int playerIndex = 0; playerIndex < PLAYER_NO; playerIndex++)
+  {
+    memcpy(players[playerIndex].weights, weights[players[playerIndex].color], sizeof(players[playerIndex].weights));
+  }
+}
+
+/* Behavior functions
+ */
+
+// Point the priorities of the color into the storage and
+// clear them. The storage is owned by the caller so that
+// no decision needs a heap allocation
+union PiecePriority getPriorities(enum Color color, union PriorityStorage *storage)
+{
+  union PiecePriority piecePriorities;
+
+  memset(storage, 0, sizeof(union PriorityStorage));
+
+  switch (color)
+  {
+    case RED:
+      piecePriorities.redPriority = storage->redPriorities;
+      break;
+    case GREEN:
+      piecePriorities.greenPriority = storage->greenPriorities;
       break;
-
     case YELLOW:
-      struct YellowPriority *yellowPriorities = malloc(PIECE_NO * sizeof(struct YellowPriority));
-
-      if (yellowPriorities == NULL)
-      {
-        printf("Failed to allocate memory\n");
-        exit(0);
-      }
-      for (int pieceIndex = 0; pieceIndex < PIECE_NO; pieceIndex++)
-      {
-        yellowPriorities[pieceIndex].canAttack = false;
-        yellowPriorities[pieceIndex].canExitBlock = false;
-        yellowPriorities[pieceIndex].canFullMove = false;
-        yellowPriorities[pieceIndex].canMoveFromBase = false;
-        yellowPriorities[pieceIndex].canPartialMove = false;
-      }
-      piecePriorities.yellowPriority = yellowPriorities;
+      piecePriorities.yellowPriority = storage->yellowPriorities;
       break;
-    
     case BLUE:
-      struct BluePriority *bluePriorities = malloc(PIECE_NO * sizeof(struct BluePriority));
-      if (bluePriorities == NULL)
-      {
-        printf("Failed to allocate memory\n");
-        exit(0);
-      }
-      for (int pieceIndex = 0; pieceIndex < PIECE_NO; pieceIndex++)
-      {
-        bluePriorities[pieceIndex].canExitBlock = false;
-        bluePriorities[pieceIndex].canFullMove = false;
-        bluePriorities[pieceIndex].canPartialMove = false;
-        bluePriorities[pieceIndex].preferToMove = false;
-      }
-      piecePriorities.bluePriority = bluePriorities;
+      piecePriorities.bluePriority = storage->bluePriorities;
       break;
   }
 
   return piecePriorities;
 }
 
-void moveParse(struct Player *players, int playerIndex, int diceNumber, struct Piece *cells[][PIECE_NO], int curMyseryCell)
+// Validate the movement of every piece and score it with
+// the behavior of the color
+void evaluatePieceMoves
+(
+  struct Player *players, int playerIndex, int diceNumber,
+  struct Board *board, int curMyseryCell, struct MoveDecision *decision
+)
 {
   struct Player *player = &players[playerIndex];
-  static int previousPieceIndex = -1; //for blue player
-  union PiecePriority piecePriorities = getPriorities(player->color);
+  decision->piecePriorities = getPriorities(player->color, &decision->storage);
+  union PiecePriority *piecePriorities = &decision->piecePriorities;
 
   // do complete movement validation for each pieces
   for (int pieceIndex = 0; pieceIndex < PIECE_NO; pieceIndex++)
@@ -1596,25 +2189,26 @@ void moveParse(struct Player *players, int playerIndex, int diceNumber, struct P
     // check mystery effects
     diceNumber = getDiceValueAfterMysteryEffect(diceNumber, player, pieceIndex);
 
-    if (!initialMovementCheck(player, &piecePriorities, cells, pieceIndex, diceNumber))
+    if (!initialMovementCheck(player, piecePriorities, board, pieceIndex, diceNumber))
     {
       continue;
     }
 
-    validateSingleMovement(player, &piecePriorities, cells, pieceIndex, diceNumber, curMyseryCell);
+    validateSingleMovement(player, piecePriorities, board, pieceIndex, diceNumber, curMyseryCell);
 
-    bool isPartOfBlockade = isBlockade(cells[player->pieces[pieceIndex].cellNo]);
+    bool isPartOfBlockade = isBlockade(&board->cells[player->pieces[pieceIndex].cellNo]);
 
     // perform block movement check if possible
     if (isPartOfBlockade)
     {
-      validateBlockMovement(player, &piecePriorities, cells, pieceIndex, diceNumber, curMyseryCell);
+      validateBlockMovement(player, piecePriorities, board, pieceIndex, diceNumber, curMyseryCell);
     }
   }
 
   // variables to track piece importance
-  int pieceImportance[] = { 0, 0, 0, 0 };
-  int canAttackCount = 0; // for red piece
+  memset(decision->pieceImportance, 0, sizeof(decision->pieceImportance));
+  memset(decision->canAttack, 0, sizeof(decision->canAttack)); // for red piece
+  decision->diceNumber = diceNumber;
 
   // assign piece validation importance
   for (int pieceIndex = 0; pieceIndex < PIECE_NO; pieceIndex++)
@@ -1622,59 +2216,144 @@ void moveParse(struct Player *players, int playerIndex, int diceNumber, struct P
     switch (player->color)
     {
     case RED:
-      bool isPartOfBlockade = isBlockade(cells[player->pieces[pieceIndex].cellNo]);
-      validateRedPieceImportance(piecePriorities.redPriority, pieceImportance, pieceIndex, &canAttackCount, isPartOfBlockade);
+      bool isPartOfBlockade = cellNoIndexable(player->pieces[pieceIndex].cellNo) && isBlockade(&board->cells[player->pieces[pieceIndex].cellNo]);
+      validateRedPieceImportance(piecePriorities->redPriority, player->weights, decision->pieceImportance, pieceIndex, decision->canAttack, isPartOfBlockade);
       break;
     case GREEN:
-      validateGreenPieceImportance(piecePriorities.greenPriority, pieceImportance, pieceIndex);
+      validateGreenPieceImportance(piecePriorities->greenPriority, player->weights, decision->pieceImportance, pieceIndex);
       break;
     case YELLOW:
-      validateYellowPieceImportance(piecePriorities.yellowPriority, pieceImportance, pieceIndex);
+      validateYellowPieceImportance(piecePriorities->yellowPriority, player->weights, decision->pieceImportance, pieceIndex);
       break;
     case BLUE:
-      validateBluePieceImportance(piecePriorities.bluePriority, pieceImportance, pieceIndex, previousPieceIndex);
+      validateBluePieceImportance(piecePriorities->bluePriority, player->weights, decision->pieceImportance, pieceIndex, player->previousPieceIndex);
       break;
     }
   }
+}
 
-  int selectedPieceIndex = getIndexOfSelectedPiece(player->pieces, cells, pieceImportance, canAttackCount, diceNumber);
+int selectPieceMove(struct Player *player, struct Board *board, struct MoveDecision *decision)
+{
+  int selectedPieceIndex = getIndexOfSelectedPiece(
+    player, board, decision->pieceImportance, decision->canAttack, decision->diceNumber
+  );
 
   // set selected index to previous for blue
   if (player->color == BLUE)
   {
-    previousPieceIndex = selectedPieceIndex;
+    player->previousPieceIndex = selectedPieceIndex;
   }
 
+  return selectedPieceIndex;
+}
+
+// Whether the behavior moves the whole block of the piece
+bool getBlockMoveCondition(struct Player *player, struct MoveDecision *decision, int selectedPieceIndex)
+{
   bool blockMoveCondition = false;
 
-  // set block move condition and free the dynamically allocated memory
   switch (player->color)
   {
     case RED:
-      blockMoveCondition = !piecePriorities.redPriority[selectedPieceIndex].canExitBlock;
-      free(piecePriorities.redPriority);
+      blockMoveCondition = !decision->piecePriorities.redPriority[selectedPieceIndex].canExitBlock;
       break;
     case GREEN:
-      blockMoveCondition = piecePriorities.greenPriority[selectedPieceIndex].isBlockMovable;
-      free(piecePriorities.greenPriority);
+      blockMoveCondition = decision->piecePriorities.greenPriority[selectedPieceIndex].isBlockMovable;
       break;
     case YELLOW:
-      blockMoveCondition = !piecePriorities.yellowPriority[selectedPieceIndex].canExitBlock;
-      free(piecePriorities.yellowPriority);
+      blockMoveCondition = !decision->piecePriorities.yellowPriority[selectedPieceIndex].canExitBlock;
       break;
     case BLUE:
-      blockMoveCondition = !piecePriorities.bluePriority[selectedPieceIndex].canExitBlock;
-      free(piecePriorities.bluePriority);
+      blockMoveCondition = !decision->piecePriorities.bluePriority[selectedPieceIndex].canExitBlock;
       break;
   }
 
-  finalizeMovement(player, selectedPieceIndex, diceNumber, cells, blockMoveCondition);
+  return blockMoveCondition;
+}
+
+// Record the moves chosen by moveParse on this thread,
+// NULL stops recording
+void setMoveObserver(struct MoveObserver *observer)
+{
+  moveObserver = observer;
+}
+
+// Choose the moves of a color with a policy, NULL gives
+// the color its behavior back
+void setMovePolicy(enum Color color, struct MovePolicy *policy)
+{
+  movePolicies[color] = policy;
+}
+
+// Ask the policy of the color for a move. Returns false
+// when the color has no policy or no move is legal
+static bool selectPolicyMove
+(
+  struct Player *players, int playerIndex, int diceNumber, struct Board *board,
+  int curMyseryCell, int *selectedPieceIndex, bool *blockMoveCondition, int *moveDiceNumber
+)
+{
+  struct Player *player = &players[playerIndex];
+  struct MovePolicy *policy = movePolicies[player->color];
+
+  if (policy == NULL)
+  {
+    return false;
+  }
+
+  *moveDiceNumber = getDiceValueOfPlayer(player, diceNumber);
+  uint8_t legalMask = getLegalMoveMask(player, *moveDiceNumber, board);
+
+  if (legalMask == 0)
+  {
+    return false;
+  }
+
+  int action = policy->selectMove(policy->context, players, playerIndex, diceNumber, board, curMyseryCell, legalMask);
+  tryValueAndCatchError(action, '<', 0);
+  tryValueAndCatchError(action, '>', PIECE_NO * 2 - 1);
+  tryValueAndCatchError(legalMask & (1 << action), '=', 0);
+
+  *selectedPieceIndex = action % PIECE_NO;
+  *blockMoveCondition = action >= PIECE_NO;
+
+  return true;
+}
+
+void moveParse(struct Player *players, int playerIndex, int diceNumber, struct Board *board, int curMyseryCell)
+{
+  struct Player *player = &players[playerIndex];
+  int selectedPieceIndex;
+  bool blockMoveCondition;
+  int moveDiceNumber;
+
+  if (!selectPolicyMove(players, playerIndex, diceNumber, board, curMyseryCell, &selectedPieceIndex, &blockMoveCondition, &moveDiceNumber))
+  {
+    struct MoveDecision decision;
+
+    evaluatePieceMoves(players, playerIndex, diceNumber, board, curMyseryCell, &decision);
+
+    selectedPieceIndex = selectPieceMove(player, board, &decision);
+    blockMoveCondition = getBlockMoveCondition(player, &decision, selectedPieceIndex);
+    moveDiceNumber = decision.diceNumber;
+  }
+
+  if (moveObserver != NULL)
+  {
+    moveObserver->onMove
+    (
+      moveObserver->context, players, playerIndex, moveDiceNumber,
+      board, curMyseryCell, selectedPieceIndex, blockMoveCondition
+    );
+  }
+
+  finalizeMovement(player, selectedPieceIndex, moveDiceNumber, board, blockMoveCondition);
 }
 
 bool initialMovementCheck
 (
   struct Player *player, union PiecePriority *piecePriorities,
-  struct Piece *cells[][PIECE_NO], int pieceIndex, int diceNumber 
+  struct Board *board, int pieceIndex, int diceNumber 
 )
 {
   int cellNo = player->pieces[pieceIndex].cellNo;
@@ -1694,7 +2373,7 @@ bool initialMovementCheck
 
   if (cellNo == BASE)
   {
-    initialBaseCheck(piecePriorities, cells[getStartIndex(player->color)], pieceIndex, cellNo, diceNumber, player->color);
+    initialBaseCheck(piecePriorities, &board->cells[getStartIndex(player->color)], pieceIndex, cellNo, diceNumber, player->color);
     return false;
   }
 
@@ -1730,7 +2409,7 @@ void initialHomeStraightCheck
 
 void initialBaseCheck
 (
-  union PiecePriority *piecePriorities, struct Piece *startCell[PIECE_NO], int pieceIndex,
+  union PiecePriority *piecePriorities, struct Cell *startCell, int pieceIndex,
   int cellNo, int diceNumber, enum Color color 
 )
 {
@@ -1775,7 +2454,7 @@ void initialBaseCheck
 
 void validateSingleMovement
 (
-  struct Player *player, union PiecePriority *piecePriorities, struct Piece *cells[][PIECE_NO],
+  struct Player *player, union PiecePriority *piecePriorities, struct Board *board,
   int pieceIndex, int diceNumber, int curMysteryCell
 )
 {
@@ -1790,7 +2469,7 @@ void validateSingleMovement
       diceNumber, 
       player->pieces[pieceIndex].clockWise,
       playerCount,
-      cells,
+      board,
       player->color
     );
 
@@ -1813,14 +2492,14 @@ void validateSingleMovement
   }
 
   // only for red and green behaviors
-  validateFormBlockMovement(piecePriorities, cells[finalCellNo], pieceIndex, player->color);
+  validateFormBlockMovement(piecePriorities, &board->cells[finalCellNo], pieceIndex, player->color);
 
   if (player->color == GREEN)
   {
     return; // green validation ends here
   }
 
-  int enemyCount = getEnemyCountOfCell(cells[finalCellNo], player->color);
+  int enemyCount = getEnemyCountOfCell(&board->cells[finalCellNo], player->color);
 
   // only for red and yellow behaviors
   validateCanAttackMovement(piecePriorities, pieceIndex, player->color, enemyCount, playerCount);
@@ -1828,7 +2507,7 @@ void validateSingleMovement
 
 void validateFormBlockMovement
 (
-  union PiecePriority *piecePriorities, struct Piece *finalCell[PIECE_NO],
+  union PiecePriority *piecePriorities, struct Cell *finalCell,
   int pieceIndex, enum Color color
 )
 {
@@ -1877,12 +2556,12 @@ void validateCanAttackMovement
 
 void validateBlockMovement
 (
-  struct Player *player, union PiecePriority *piecePriorities, struct Piece *cells[][PIECE_NO],
+  struct Player *player, union PiecePriority *piecePriorities, struct Board *board,
   int pieceIndex, int diceNumber, int curMysteryCell
 )
 {
   int cellNo = player->pieces[pieceIndex].cellNo;
-  int playerCount = getPlayerCountOfCell(cells[cellNo], player->color);
+  int playerCount = getPlayerCountOfCell(&board->cells[cellNo], player->color);
   bool blockClockWise = player->pieces[pieceIndex].blockClockWise;
   diceNumber /= playerCount;
 
@@ -1897,7 +2576,7 @@ void validateBlockMovement
       diceNumber,
       player->pieces[pieceIndex].clockWise,
       playerCount,
-      cells,
+      board,
       player->color
     );
   
@@ -1908,7 +2587,7 @@ void validateBlockMovement
 
   validateMovableCell(piecePriorities, pieceIndex, movableCellCount, diceNumber, player->color, playerCount);
 
-  validateExitBlockMovement(piecePriorities, cells, pieceIndex, player, movableCellCount, curMysteryCell);
+  validateExitBlockMovement(piecePriorities, board, pieceIndex, player, movableCellCount, curMysteryCell);
 }
 
 // check if the cells can be moved through
@@ -1966,12 +2645,12 @@ void validateMovableCell
 
 void validateExitBlockMovement
 (
-  union PiecePriority *piecePriorities, struct Piece *cells[][PIECE_NO], int pieceIndex,
+  union PiecePriority *piecePriorities, struct Board *board, int pieceIndex,
   struct Player *player, int movableCellCount, int curMysteryCell
 )
 {
   int cellNo = player->pieces[pieceIndex].cellNo;
-  int playerCount = getPlayerCountOfCell(cells[cellNo], player->color);
+  int playerCount = getPlayerCountOfCell(&board->cells[cellNo], player->color);
   bool blockClockWise = player->pieces[pieceIndex].blockClockWise;
 
   switch (player->color)
@@ -1986,7 +2665,7 @@ void validateExitBlockMovement
       {
         int directionConstant = (blockClockWise) ? 1 : -1;
         int finalCellNo = getCorrectCellCount(cellNo + (directionConstant * movableCellCount));
-        int enemyCount = getEnemyCountOfCell(cells[finalCellNo], player->color);
+        int enemyCount = getEnemyCountOfCell(&board->cells[finalCellNo], player->color);
         
         // check if red block can attack
         if (enemyCount != 0 && !isBlocked(playerCount, enemyCount))
@@ -2005,7 +2684,7 @@ void validateExitBlockMovement
       {
         int directionConstant = (blockClockWise) ? 1 : -1;
         int finalCellNo = getCorrectCellCount(cellNo + (directionConstant * movableCellCount));
-        int enemyCount = getEnemyCountOfCell(cells[finalCellNo], player->color);
+        int enemyCount = getEnemyCountOfCell(&board->cells[finalCellNo], player->color);
         
         // check if yellow block can attack
         if (enemyCount != 0 && !isBlocked(playerCount, enemyCount))
@@ -2052,235 +2731,330 @@ void validateBlueMovement
 
 int getIndexOfSelectedPiece
 (
-  struct Piece *pieces, struct Piece *cells[][PIECE_NO],
-  int *pieceImportance, int canAttackCount, int diceNumber
+  struct Player *player, struct Board *board,
+  int *pieceImportance, bool *canAttack, int diceNumber
 )
 {
+  struct Piece *pieces = player->pieces;
+  int remainingThrowsWeight = player->weights[REMAINING_THROWS_WEIGHT];
   int selectedPieceIndex = 0;
   int maxPriority = EMPTY;
+  int score[PIECE_NO];
+
+  for (int pieceIndex = 0; pieceIndex < PIECE_NO; pieceIndex++)
+  {
+    score[pieceIndex] = pieceImportance[pieceIndex];
+
+    // a positive weight prefers the pieces furthest from HOME
+    // in expected throws, a negative one the closest ones.
+    // The weight is in tenths of a point per throw, rounded
+    // to the nearest point
+    if (remainingThrowsWeight != 0 && canPieceMove(player, pieceIndex, diceNumber, board))
+    {
+      float throwsScore = remainingThrowsWeight * getExpectedThrowsToHome(&pieces[pieceIndex]) / MAX_PRIORITY;
+
+      score[pieceIndex] += (int)(throwsScore + (throwsScore < 0 ? -0.5f : 0.5f));
+    }
+
+    if (score[pieceIndex] > maxPriority)
+    {
+      maxPriority = score[pieceIndex];
+      selectedPieceIndex = pieceIndex;
+    }
+  }
 
   // for red piece
   int prevEnemyDistanceFromHome = MAX_STANDARD_CELL;
 
+  // Selects the opponent player close to their home if several
+  // attacks share the highest importance. The attack flag is kept
+  // per piece since tuned weights can give other moves the same
+  // importance as an attack
   for (int pieceIndex = 0; pieceIndex < PIECE_NO; pieceIndex++)
   {
-    if (pieceImportance[pieceIndex] > maxPriority)
+    struct Piece *piece = &pieces[pieceIndex];
+
+    if (!canAttack[pieceIndex] || score[pieceIndex] != maxPriority)
     {
-      maxPriority = pieceImportance[pieceIndex];
-      selectedPieceIndex = pieceIndex;
+      continue;
     }
 
-    // skip to next part of loop if piece is not red
-    if (getPieceColor(pieces[pieceIndex].name[0]) != RED)
+    int directionConstant = piece->clockWise ? 1 : -1;
+    int movableCellCount = getMovableCellCount(piece->cellNo, diceNumber, piece->clockWise, 1, board, RED);
+    int destinationIndex = getCorrectCellCount(piece->cellNo + (directionConstant * movableCellCount));
+    struct Cell *destinationCell = &board->cells[destinationIndex];
+
+    // attacks of a whole block land elsewhere
+    if (getEnemyCountOfCell(destinationCell, RED) == 0)
     {
       continue;
     }
 
-    // Selects the opponent player close to their home if there are multiple
-    // attack options
-    if (pieceImportance[pieceIndex] == MAX_PRIORITY && canAttackCount != 0)
-    {
-      int destinationIndex = pieces[pieceIndex].cellNo + diceNumber;
-      int enemyDistanceFromHome = getEnemyDistanceFromHome(cells[destinationIndex]);
+    int enemyDistanceFromHome = getEnemyDistanceFromHome(destinationCell);
 
-      if (enemyDistanceFromHome < prevEnemyDistanceFromHome)
-      {
-        selectedPieceIndex = pieceIndex;
-      }
+    if (enemyDistanceFromHome < prevEnemyDistanceFromHome)
+    {
+      prevEnemyDistanceFromHome = enemyDistanceFromHome;
+      selectedPieceIndex = pieceIndex;
     }
   }
 
   return selectedPieceIndex;
 }
 
+// Dice value after the mystery effects of all pieces,
+// as evaluatePieceMoves hands it to finalizeMovement
+int getDiceValueOfPlayer(struct Player *player, int diceNumber)
+{
+  for (int pieceIndex = 0; pieceIndex < PIECE_NO; pieceIndex++)
+  {
+    diceNumber = getDiceValueAfterMysteryEffect(diceNumber, player, pieceIndex);
+  }
+
+  return diceNumber;
+}
+
+// Whether finalizeMovement would move the piece on its own,
+// used to mask the choices of agents that replace the
+// behaviors
+bool canPieceMove(struct Player *player, int pieceIndex, int diceNumber, struct Board *board)
+{
+  struct Piece *piece = &player->pieces[pieceIndex];
+
+  if (diceNumber == 0 || piece->cellNo == HOME)
+  {
+    return false;
+  }
+
+  if (piece->cellNo == BASE)
+  {
+    struct Cell *startCell = &board->cells[getStartIndex(player->color)];
+    return diceNumber == MAX_DICE_VALUE && !isBlocked(1, getEnemyCountOfCell(startCell, player->color));
+  }
+
+  if (piece->cellNo >= MAX_STANDARD_CELL)
+  {
+    return canMoveInHomeStraight(piece->cellNo, diceNumber);
+  }
+
+  return getMovableCellCount(piece->cellNo, diceNumber, piece->clockWise, 1, board, player->color) > 0;
+}
+
+// Whether finalizeMovement would move the block of the piece
+bool canBlockMove(struct Player *player, int pieceIndex, int diceNumber, struct Board *board)
+{
+  struct Piece *piece = &player->pieces[pieceIndex];
+
+  if (diceNumber == 0 || !cellNoIndexable(piece->cellNo) || !isBlockade(&board->cells[piece->cellNo]))
+  {
+    return false;
+  }
+
+  int playerCount = getPlayerCountOfCell(&board->cells[piece->cellNo], player->color);
+
+  return getMovableCellCount(piece->cellNo, diceNumber / playerCount, piece->blockClockWise, playerCount, board, player->color) > 0;
+}
+
+uint8_t getPieceFlags(struct Piece *piece, struct Board *board)
+{
+  uint8_t flags = 0;
+
+  flags |= piece->clockWise ? PIECE_FLAG_CLOCKWISE : 0;
+  flags |= piece->captured > 0 ? PIECE_FLAG_CAPTURED : 0;
+  flags |= cellNoIndexable(piece->cellNo) && isBlockade(&board->cells[piece->cellNo]) ? PIECE_FLAG_IN_BLOCK : 0;
+  flags |= piece->effect.effectActive ? PIECE_FLAG_EFFECT_ACTIVE : 0;
+  flags |= piece->effect.effectActive && !piece->effect.pieceActive ? PIECE_FLAG_FROZEN : 0;
+
+  return flags;
+}
+
+// Bit i for moving piece i alone and bit PIECE_NO + i for
+// moving its block, with the dice value after the effects
+uint8_t getLegalMoveMask(struct Player *player, int diceNumber, struct Board *board)
+{
+  uint8_t legalMask = 0;
+
+  for (int pieceIndex = 0; pieceIndex < PIECE_NO; pieceIndex++)
+  {
+    legalMask |= canPieceMove(player, pieceIndex, diceNumber, board) << pieceIndex;
+    legalMask |= canBlockMove(player, pieceIndex, diceNumber, board) << (PIECE_NO + pieceIndex);
+  }
+
+  return legalMask;
+}
+
 void finalizeMovement
 (
   struct Player *player, int selectedPieceIndex, 
-  int diceNumber, struct Piece *cells[][PIECE_NO], 
+  int diceNumber, struct Board *board, 
   bool blockMoveCondition
 )
 {
   // when piece is in base
   if (player->pieces[selectedPieceIndex].cellNo == BASE && diceNumber == MAX_DICE_VALUE)
   {
-    moveFromBase(player, &player->pieces[selectedPieceIndex], cells[getStartIndex(player->color)]);
+    moveFromBase(player, &player->pieces[selectedPieceIndex], board);
   }
   // when piece is in board
   else if (player->pieces[selectedPieceIndex].cellNo != BASE && player->pieces[selectedPieceIndex].cellNo < MAX_STANDARD_CELL)
   {
-    if (isBlockade(cells[player->pieces[selectedPieceIndex].cellNo]) && blockMoveCondition)
+    if (isBlockade(&board->cells[player->pieces[selectedPieceIndex].cellNo]) && blockMoveCondition)
     {
-      moveBlock(&player->pieces[selectedPieceIndex], diceNumber, cells);
+      moveBlock(&player->pieces[selectedPieceIndex], diceNumber, board);
     }
     else
     {
-      int cellIndexOfPiece = EMPTY;
-      for (int cellIndex = 0; cellIndex < PIECE_NO; cellIndex++)
-      { 
-        if (cells[player->pieces[selectedPieceIndex].cellNo][cellIndex] == &player->pieces[selectedPieceIndex])
-        {
-          cellIndexOfPiece = cellIndex;
-          break;
-        }
-      }
-      move(&player->pieces[selectedPieceIndex], cellIndexOfPiece, diceNumber, cells);
+      move(&player->pieces[selectedPieceIndex], diceNumber, board);
     }
   }
   // when piece is in home straight
   else if (player->pieces[selectedPieceIndex].cellNo >= MAX_STANDARD_CELL)
   {
-    moveInHomeStraight(&player->pieces[selectedPieceIndex], diceNumber);
+    moveInHomeStraight(&player->pieces[selectedPieceIndex], diceNumber, board);
   }
   // when there are no possible moves
   else
   {
-    printf("No moves can be made by piece %s\n", getName(player->color));
+    gameLog("No moves can be made by piece %s\n", getName(player->color));
   }
 }
 
 
 void validateRedPieceImportance(
-  struct RedPriority *piecePriorities, 
+  struct RedPriority *piecePriorities, int *weights,
   int *pieceImportance, int pieceIndex,
-  int *canAttackCount, bool isPartOfBlockade
+  bool *canAttack, bool isPartOfBlockade
 )
 {
-  int maxPriority = MAX_PRIORITY;
-
   if (piecePriorities[pieceIndex].canAttack)
   {
-    pieceImportance[pieceIndex] = maxPriority;
-    *canAttackCount++;
+    pieceImportance[pieceIndex] = weights[ATTACK_WEIGHT];
+    canAttack[pieceIndex] = true;
     return;
   }
 
   if (piecePriorities[pieceIndex].canMoveFromBase)
   {
-    pieceImportance[pieceIndex] = maxPriority/2;
+    pieceImportance[pieceIndex] = weights[MOVE_FROM_BASE_WEIGHT];
     return;
   }
 
   if (!piecePriorities[pieceIndex].canFormBlock)
   {
-    pieceImportance[pieceIndex] += 1;
+    pieceImportance[pieceIndex] += weights[SKIP_BLOCK_WEIGHT];
   }
 
   if (!piecePriorities[pieceIndex].canExitBlock)
   {
-    pieceImportance[pieceIndex] -= 1;
+    pieceImportance[pieceIndex] += weights[STAY_IN_BLOCK_WEIGHT];
   }
 
   if (piecePriorities[pieceIndex].canFullMove)
   {
-    pieceImportance[pieceIndex] += 2;
+    pieceImportance[pieceIndex] += weights[FULL_MOVE_WEIGHT];
   }
   else if (piecePriorities[pieceIndex].canPartialMove)
   {
-    pieceImportance[pieceIndex] += 1;
+    pieceImportance[pieceIndex] += weights[PARTIAL_MOVE_WEIGHT];
   }
 
   if (!isPartOfBlockade)
   {
-    pieceImportance[pieceIndex] += 1;
+    pieceImportance[pieceIndex] += weights[SINGLE_PIECE_WEIGHT];
   }
 }
 
 
 void validateGreenPieceImportance
 (
-  struct GreenPriority *piecePriorities, int *pieceImportance, int pieceIndex
+  struct GreenPriority *piecePriorities, int *weights, int *pieceImportance, int pieceIndex
 )
 {
-  int maxPriority = MAX_PRIORITY;
-
   if (piecePriorities[pieceIndex].canFormBlock)
   {
-    pieceImportance[pieceIndex] = maxPriority;
+    pieceImportance[pieceIndex] = weights[FORM_BLOCK_WEIGHT];
     return;
   }
 
   if (piecePriorities[pieceIndex].canMoveFromBase)
   {
-    pieceImportance[pieceIndex] = maxPriority-1;
+    pieceImportance[pieceIndex] = weights[MOVE_FROM_BASE_WEIGHT];
     return;
   }
 
   if (piecePriorities[pieceIndex].isBlockMovable)
   {
-    pieceImportance[pieceIndex] += 1;
+    pieceImportance[pieceIndex] += weights[BLOCK_MOVABLE_WEIGHT];
   }
 
   if (piecePriorities[pieceIndex].canFullMove)
   {
-    pieceImportance[pieceIndex] += 2;
+    pieceImportance[pieceIndex] += weights[FULL_MOVE_WEIGHT];
   }
   else if (piecePriorities[pieceIndex].canPartialMove)
   {
-    pieceImportance[pieceIndex] += 1;
+    pieceImportance[pieceIndex] += weights[PARTIAL_MOVE_WEIGHT];
   }
 }
 
 
 void validateYellowPieceImportance
 (
-  struct YellowPriority *piecePriorities, int *pieceImportance, int pieceIndex
+  struct YellowPriority *piecePriorities, int *weights, int *pieceImportance, int pieceIndex
 )
 {
-  int maxPriority = MAX_PRIORITY;
-
   if (piecePriorities[pieceIndex].canMoveFromBase)
   {
-    pieceImportance[pieceIndex] = maxPriority;
+    pieceImportance[pieceIndex] = weights[MOVE_FROM_BASE_WEIGHT];
     return;
   }
 
   if (piecePriorities[pieceIndex].canAttack)
   {
-    pieceImportance[pieceIndex] = maxPriority/2;
+    pieceImportance[pieceIndex] = weights[ATTACK_WEIGHT];
     return;
   }
 
   if (piecePriorities[pieceIndex].canFullMove)
   {
-    pieceImportance[pieceIndex] += 2;
+    pieceImportance[pieceIndex] += weights[FULL_MOVE_WEIGHT];
   }
   else if (piecePriorities[pieceIndex].canPartialMove)
   {
-    pieceImportance[pieceIndex] += 1;
+    pieceImportance[pieceIndex] += weights[PARTIAL_MOVE_WEIGHT];
   }
 }
 
 
 void validateBluePieceImportance
 (
-  struct BluePriority *piecePriorities,int *pieceImportance,int pieceIndex,int previousPieceIndex
+  struct BluePriority *piecePriorities, int *weights, int *pieceImportance, int pieceIndex, int previousPieceIndex
 )
 {
-  int maxPriority = MAX_PRIORITY;
   int targetIndex = (previousPieceIndex + 1) >= PIECE_NO ? 0 : previousPieceIndex + 1;
 
   if (targetIndex == pieceIndex)
   {
-    pieceImportance[pieceIndex] = maxPriority/2;
+    pieceImportance[pieceIndex] = weights[ROTATION_WEIGHT];
   }
 
   if (piecePriorities[pieceIndex].preferToMove)
   {
-    pieceImportance[pieceIndex] = maxPriority/2;
+    pieceImportance[pieceIndex] = weights[PREFER_TO_MOVE_WEIGHT];
     return;
   }
 
   if (piecePriorities[pieceIndex].canFullMove)
   {
-    pieceImportance[pieceIndex] += 2;
+    pieceImportance[pieceIndex] += weights[FULL_MOVE_WEIGHT];
   }
   else if (piecePriorities[pieceIndex].canPartialMove)
   {
-    pieceImportance[pieceIndex] += 1;
+    pieceImportance[pieceIndex] += weights[PARTIAL_MOVE_WEIGHT];
   }
   else
   {
-    pieceImportance[pieceIndex] -= maxPriority/2;
+    pieceImportance[pieceIndex] += weights[IMMOBILE_WEIGHT];
   }
 }
 
@@ -2288,23 +3062,23 @@ void validateBluePieceImportance
 /* Output Display functions
  */
 
-void displayPlayerStatusAfterRound(struct Player *players, struct Game *game)
+void displayPlayerStatusAfterRound(struct Player *players, struct Game *game, struct Board *board)
 {
-  printf("Round %d is over. Status of each player is displayed below:\n\n", game->rounds);
+  gameLog("Round %d is over. Status of each player is displayed below:\n\n", game->rounds);
   for (int orderIndex = 0; orderIndex < PIECE_NO; orderIndex++)
   {
     int playerIndex = game->order[orderIndex];
     char *playerName = getName(players[playerIndex].color);
-    int noOfPiecesInBase = getNoOfPiecesInBase(&players[playerIndex]);
+    int noOfPiecesInBase = getNoOfPiecesInBase(board, players[playerIndex].color);
 
-    printf("%s player has %d/4 of pieces on the board and %d/4 pieces on the base\n",
+    gameLog("%s player has %d/4 of pieces on the board and %d/4 pieces on the base\n",
       playerName,
       PLAYER_NO - noOfPiecesInBase,
       noOfPiecesInBase
     );
-    printf("=======================================================================\n");
-    printf("Location of pieces of %s\n", playerName);
-    printf("=======================================================================\n");
+    gameLog("=======================================================================\n");
+    gameLog("Location of pieces of %s\n", playerName);
+    gameLog("=======================================================================\n");
 
     for (int pieceIndex = 0; pieceIndex < PIECE_NO; pieceIndex++)
     {
@@ -2313,18 +3087,18 @@ void displayPlayerStatusAfterRound(struct Player *players, struct Game *game)
       switch (piece.cellNo)
       {
         case BASE:
-          printf("Piece %s -> Base\n", piece.name);
+          gameLog("Piece %s -> Base\n", piece.name);
           break;
         case MAX_STANDARD_CELL...HOME-1:
-          printf("Piece %s -> %s homepath %d\n", piece.name, playerName, piece.cellNo - MAX_STANDARD_CELL);
+          gameLog("Piece %s -> %s homepath %d\n", piece.name, playerName, piece.cellNo - MAX_STANDARD_CELL);
           break;
         case HOME:
-          printf("Piece %s -> Home\n", piece.name);
+          gameLog("Piece %s -> Home\n", piece.name);
           break;
         default:
-          printf("Piece %s -> L%d\n", piece.name, piece.cellNo);
+          gameLog("Piece %s -> L%d\n", piece.name, piece.cellNo);
       }
-      printf("\n");
+      gameLog("\n");
     }
   }
 }
@@ -2333,11 +3107,11 @@ void displayMysteryCellStatusAfterRound(int mysteryCellNo, int mysteryRounds)
 {
   if (mysteryCellNo == EMPTY)
   {
-    printf("The required conditions for generating mystery cells have not been met\n");
+    gameLog("The required conditions for generating mystery cells have not been met\n");
   }
   else
   {
-    printf("The mystery cell is at L%d and will be at that location for the next %d rounds\n",
+    gameLog("The mystery cell is at L%d and will be at that location for the next %d rounds\n",
       mysteryCellNo,
       mysteryRounds
     );
@@ -2346,19 +3120,19 @@ void displayMysteryCellStatusAfterRound(int mysteryCellNo, int mysteryRounds)
 
 void displayTeleportationMessage(char* playerName, int count, struct Piece **pieces, char *location)
 {
-  printf("%s piece ", playerName);
+  gameLog("%s piece ", playerName);
   for (int pieceIndex = 0; pieceIndex < count; pieceIndex++)
   {
-    printf("%s ", pieces[pieceIndex]->name);
+    gameLog("%s ", pieces[pieceIndex]->name);
   }
-  printf("teleported to %s\n", location);
+  gameLog("teleported to %s\n", location);
 }
 
 
 void displayMovablePieceStatus
 (
   int movableCellCount, int diceNumber, char *playerName,struct Piece *piece,
-  int finalCellNo, struct Piece *cell[PIECE_NO]
+  int finalCellNo, struct Cell *cell
 )
 {
   if (movableCellCount < diceNumber)
@@ -2367,7 +3141,7 @@ void displayMovablePieceStatus
 
     if (enemyCount != 0)
     {
-      printf("%s piece %s is blocked from L%d to L%d by %s piece\n",
+      gameLog("%s piece %s is blocked from L%d to L%d by %s piece\n",
         playerName,
         piece->name,
         piece->cellNo,
@@ -2376,18 +3150,18 @@ void displayMovablePieceStatus
       );
     }
 
-    printf("%s does not have other pieces to move instead of %s piece.\n",
+    gameLog("%s does not have other pieces to move instead of %s piece.\n",
       playerName,
       enemyCount != 0 ? "blocked" : "immobile"
     );
 
     if (movableCellCount == 0)
     {
-      printf("Ignoring the throw and moving to the next player\n");
+      gameLog("Ignoring the throw and moving to the next player\n");
     }
     else
     {
-      printf("Moved the piece %s to square L%d which is a cell before the block\n",
+      gameLog("Moved the piece %s to square L%d which is a cell before the block\n",
         piece->name,
         finalCellNo
       );
@@ -2395,7 +3169,7 @@ void displayMovablePieceStatus
   }
   else
   {
-    printf("%s moves piece %s from location L%d to L%d by %d units in %s direction\n",
+    gameLog("%s moves piece %s from location L%d to L%d by %d units in %s direction\n",
       playerName,
       piece->name,
       piece->cellNo,
@@ -2410,7 +3184,7 @@ void displayMovablePieceStatus
 void displayMovableBlockStatus(
   int movableCellCount, int diceNumber,
   char *playerName, struct Piece *piece,
-  int finalCellNo, struct Piece *cell[PIECE_NO]
+  int finalCellNo, struct Cell *cell
 )
 {
   if (movableCellCount < diceNumber)
@@ -2419,13 +3193,13 @@ void displayMovableBlockStatus(
 
     if (enemyCount != 0)
     {
-      printf("Block of %s has been blocked by %s block from moving from L%d to L%d\n",
+      gameLog("Block of %s has been blocked by %s block from moving from L%d to L%d\n",
         playerName,
         getName(getPlayerColorInCell(cell)),
         piece->cellNo,
         finalCellNo
       );
-      printf("%s does not have other pieces to move instead of %s piece.\n", 
+      gameLog("%s does not have other pieces to move instead of %s piece.\n", 
         enemyCount != 0 ? "blocked" : "immobile",
         playerName
       );
@@ -2433,18 +3207,18 @@ void displayMovableBlockStatus(
 
     if (movableCellCount == 0)
     { 
-      printf("Ignoring the throw and moving to the next player\n");
+      gameLog("Ignoring the throw and moving to the next player\n");
     }
     else
     {
-      printf("Moved the block pieces to square L%d which is a cell before the block\n",
+      gameLog("Moved the block pieces to square L%d which is a cell before the block\n",
         finalCellNo
       );
     }
   }
   else
   {
-    printf("Block of %s moves from location L%d to L%d by %d units in %s direction\n",
+    gameLog("Block of %s moves from location L%d to L%d by %d units in %s direction\n",
       playerName,
       piece->cellNo,
       finalCellNo,
@@ -2456,24 +3230,24 @@ void displayMovableBlockStatus(
 
 void displayWinners(struct Game *game, struct Player *players)
 {
-  printf("=============================================\n\n");
-  printf("Rounds completed => %d\n\n", game->rounds);
+  gameLog("=============================================\n\n");
+  gameLog("Rounds completed => %d\n\n", game->rounds);
 
   if (game->winners[0] != EMPTY)
   {
-    printf("%s player wins!!!\n\n", getName(players[game->winners[0]].color));
+    gameLog("%s player wins!!!\n\n", getName(players[game->winners[0]].color));
   }
   else
   {
-    printf("No players have won the game. Game stopped due to unavoidable reasons\n");
+    gameLog("No players have won the game. Game stopped due to unavoidable reasons\n");
     return;
   }
 
-  printf("============= Rank of players ===============\n");
-  printf("1st place => %s\n", game->winners[0] != EMPTY ? getName(players[game->winners[0]].color) : "Error");
-  printf("2nd place => %s\n", game->winners[1] != EMPTY ? getName(players[game->winners[1]].color) : "Error");
-  printf("3rd place => %s\n", game->winners[2] != EMPTY ? getName(players[game->winners[2]].color) : "Error");
-  printf("4th place => %s\n", game->winners[3] != EMPTY ? getName(players[game->winners[3]].color) : "Error");
+  gameLog("============= Rank of players ===============\n");
+  gameLog("1st place => %s\n", game->winners[0] != EMPTY ? getName(players[game->winners[0]].color) : "Error");
+  gameLog("2nd place => %s\n", game->winners[1] != EMPTY ? getName(players[game->winners[1]].color) : "Error");
+  gameLog("3rd place => %s\n", game->winners[2] != EMPTY ? getName(players[game->winners[2]].color) : "Error");
+  gameLog("4th place => %s\n", game->winners[3] != EMPTY ? getName(players[game->winners[3]].color) : "Error");
 
 }
 
@@ -2489,7 +3263,7 @@ void initialGameLoop(struct Player *players, struct Game *game)
   for (int playerIndex = 0; playerIndex < PLAYER_NO; playerIndex++)
   { 
     int diceNumber = rollDice();
-    printf("%s rolls %d\n", getName(players[playerIndex].color), diceNumber);
+    gameLog("%s rolls %d\n", getName(players[playerIndex].color), diceNumber);
     if (diceNumber > max)
     {
       max = diceNumber;
@@ -2497,9 +3271,9 @@ void initialGameLoop(struct Player *players, struct Game *game)
     }
   }
 
-  printf("\n%s player has the highest roll and will begin the game\n", getName(players[maxPlayerIndex].color));
+  gameLog("\n%s player has the highest roll and will begin the game\n", getName(players[maxPlayerIndex].color));
   initializePlayerOrder(game, maxPlayerIndex);
-  printf("The order of single round is %s, %s, %s, and %s\n\n", 
+  gameLog("The order of single round is %s, %s, %s, and %s\n\n", 
     getName(players[game->order[0]].color),
     getName(players[game->order[1]].color),
     getName(players[game->order[2]].color),
@@ -2507,11 +3281,11 @@ void initialGameLoop(struct Player *players, struct Game *game)
   );
 }
 
-void handleMysteryCellLoop(struct Game *game, struct Player *players, struct Piece *cells[][PIECE_NO])
+void handleMysteryCellLoop(struct Game *game, struct Board *board)
 {
   if (game->roundsTillMysteryCell < 2)
   {
-    if (boardHasPiece(players))
+    if (boardHasPiece(board))
     {
       game->roundsTillMysteryCell += 1;
     }
@@ -2520,9 +3294,9 @@ void handleMysteryCellLoop(struct Game *game, struct Player *players, struct Pie
   {
     if (game->mysteryRounds == 0)
     {
-      allocateMysteryCell(game, cells);
+      allocateMysteryCell(game, board);
       game->mysteryRounds = 4;
-      printf("A mystery cell has spawned in location L%d and will be at this location for the next %d rounds\n",
+      gameLog("A mystery cell has spawned in location L%d and will be at this location for the next %d rounds\n",
         game->mysteryCellNo,
         game->mysteryRounds
       );
@@ -2534,175 +3308,277 @@ void handleMysteryCellLoop(struct Game *game, struct Player *players, struct Pie
   }
 }
 
-void mainGameLoop(struct Player *players, struct Game *game, struct Piece *standardCells[][PLAYER_NO])
+void initializeTurnState(struct TurnState *turn, uint8_t suspendedColors, int maxRounds)
+{
+  turn->phase = TURN_ROUND_START;
+  turn->orderIndex = 0;
+  turn->playerIndex = EMPTY;
+  turn->diceNumber = 0;
+  turn->minConsecutive = 0;
+  turn->captureCount = 0;
+  turn->maxRounds = maxRounds;
+  turn->suspendedColors = suspendedColors;
+  turn->legalMask = 0;
+}
+
+// Follow the turn engine on this thread, NULL stops
+void setTurnObserver(struct TurnObserver *observer)
 {
-  // limit counter
-  // Define the max limit of the game loop
-  // if loop exceeds stop the game
-  // NOTE: prevents infinite loop in worst cases
-  int limit = 0;
-  int maxLimit = 10000;
+  turnObserver = observer;
+}
 
+// Play the game phase by phase until a suspended color has
+// to choose a move or finishes, or the game is over. Other
+// colors move with the endgame table or their behavior
+enum TurnEvent advanceGame(struct Game *game, struct Player *players, struct Board *board, struct TurnState *turn)
+{
   while (true)
   {
-    // stop game loop after 3 players have reached HOME
-    if (isGameOver(game, players))
+    int playerIndex = turn->playerIndex;
+
+    if (turnObserver != NULL)
     {
-      break;
+      turnObserver->onPhase(turnObserver->context, game, players, turn);
     }
 
-    game->rounds += 1;
-    printf("=============== Round %d ==============\n\n", game->rounds);
+    switch (turn->phase)
+    {
+      case TURN_ROUND_START:
+        // stop after 3 players have reached HOME
+        // or when the round limit is exceeded
+        if (isGameOver(game) || game->rounds >= turn->maxRounds)
+        {
+          turn->phase = TURN_GAME_OVER;
+          break;
+        }
 
-    handleMysteryCellLoop(game, players, standardCells);
+        game->rounds += 1;
+        gameLog("=============== Round %d ==============\n\n", game->rounds);
 
-    for (int orderIndex = 0; orderIndex < PLAYER_NO; orderIndex++)
-    {
-      int playerIndex = game->order[orderIndex];
+        handleMysteryCellLoop(game, board);
+        turn->orderIndex = 0;
+        turn->phase = TURN_PLAYER_START;
+        break;
 
-      // skip player if all pieces of players are at home
-      if (skipPlayerIfWon(game->winners, game->winIndex, playerIndex))
-      {
-        continue;
-      }
+      case TURN_PLAYER_START:
+        if (turn->orderIndex == PLAYER_NO)
+        {
+          displayPlayerStatusAfterRound(players, game, board);
+          displayMysteryCellStatusAfterRound(game->mysteryCellNo, game->mysteryRounds);
+          gameLog("\n");
+
+          turn->phase = TURN_ROUND_START;
+          break;
+        }
 
-      int diceNumber = rollDice();
-      int noOfPiecesInBase = getNoOfPiecesInBase(&players[playerIndex]);
+        turn->playerIndex = game->order[turn->orderIndex];
+
+        // skip player if all pieces of players are at home
+        if (skipPlayerIfWon(game, turn->playerIndex))
+        {
+          turn->orderIndex++;
+          break;
+        }
 
-      printf("%s player rolled %d\n\n", getName(players[playerIndex].color), diceNumber);
+        turn->diceNumber = rollDice();
+        gameLog("%s player rolled %d\n\n", getName(players[turn->playerIndex].color), turn->diceNumber);
 
-      int minConsecutive = 0;
+        turn->minConsecutive = 0;
+        turn->phase = TURN_THROW;
+        break;
 
-      do
-      {
+      case TURN_THROW:
         // capture count should be calculated after each move
         // to prevent infinite loops
-        int captureCount = getCaptureCountOfPlayer(&players[playerIndex]);
+        turn->captureCount = getCaptureCountOfPlayer(board, playerIndex);
+
+        if (turn->suspendedColors & (1 << players[playerIndex].color))
+        {
+          struct Player *player = &players[playerIndex];
+          turn->legalMask = getLegalMoveMask(player, getDiceValueOfPlayer(player, turn->diceNumber), board);
+
+          if (turn->legalMask != 0)
+          {
+            turn->phase = TURN_DECISION;
+            return TURN_EVENT_DECISION;
+          }
+        }
+
+        // home straight endgames are played from the tablebase
+        if (!tryEndgameMove(game, players, playerIndex, turn->diceNumber, board))
+        {
+          moveParse(players, playerIndex, turn->diceNumber, board, game->mysteryCellNo);
+        }
+        turn->phase = TURN_AFTER_MOVE;
+        break;
 
-        moveParse(players, playerIndex, diceNumber, standardCells, game->mysteryCellNo);
-        minConsecutive++;
+      case TURN_DECISION:
+        // waiting for resumeGame
+        return TURN_EVENT_DECISION;
+
+      case TURN_AFTER_MOVE:
+      {
+        turn->minConsecutive++;
 
         // handle piece landing on mystery cell
-        handlePieceLandOnMysteryCell(game, &players[playerIndex], standardCells);
+        handlePieceLandOnMysteryCell(game, &players[playerIndex], board);
+        checkBoardProgress(board, players);
 
-        if (hasPlayerWon(players[playerIndex].pieces))
+        if (hasPlayerWon(board, playerIndex))
         {
           char *playerName = getName(players[playerIndex].color);
           game->winners[game->winIndex] = playerIndex;
           game->winIndex++;
+          game->activePlayers &= ~(1 << playerIndex);
 
-          if (game->winIndex == 0)
+          gameLog("All pieces of %s has reached home\n", playerName);
+          gameLog("Rank of %s player is %d\n\n", playerName, game->winIndex);
+          gameLog("Continuing the game for other players...\n");
+
+          turn->phase = TURN_PLAYER_END;
+          if (turn->suspendedColors & (1 << players[playerIndex].color))
           {
-            printf("%s has won!!\n", playerName);
+            return TURN_EVENT_FINISHED;
           }
-
-          printf("All pieces of %s has reached home\n", playerName);
-          printf("Rank of %s player is %d\n\n", playerName, game->winIndex);
-
-          printf("Continuing the game for other players...\n");
           break;
         }
 
-        int newCaptureCount = getCaptureCountOfPlayer(&players[playerIndex]);
+        int newCaptureCount = getCaptureCountOfPlayer(board, playerIndex);
+        int diceNumber = turn->diceNumber;
 
-        if ((diceNumber != MAX_DICE_VALUE || minConsecutive == 3 && diceNumber == MAX_DICE_VALUE) && newCaptureCount <= captureCount)
+        if ((diceNumber != MAX_DICE_VALUE || turn->minConsecutive == 3 && diceNumber == MAX_DICE_VALUE) && newCaptureCount <= turn->captureCount)
         {
+          turn->phase = TURN_PLAYER_END;
           break;
         }
-        else
-        {
-          diceNumber = rollDice();
-          printf("%s player rolled %d\n\n", getName(players[playerIndex].color), diceNumber);
-
-          if (newCaptureCount > captureCount)
-          {
-            minConsecutive = 0;
-          }
-        }
 
-      } while (minConsecutive < 3);
+        turn->diceNumber = rollDice();
+        gameLog("%s player rolled %d\n\n", getName(players[playerIndex].color), turn->diceNumber);
 
-      decrementMysteryEffectRounds(players[playerIndex].pieces);
-      resetMysteryEffect(players[playerIndex].pieces);
-
-      // separate block when 6 is consecutively thrown
-      // fix and improve later
-      if (minConsecutive >= 3 && diceNumber == MAX_DICE_VALUE && playerHasBlock(&players[playerIndex]))
-      {
-        int blockCellNo = getCellNoOfRandomBlock(&players[playerIndex], standardCells);
-        if (blockCellNo != EMPTY)
+        if (newCaptureCount > turn->captureCount)
         {
-          separateBlockade(standardCells, blockCellNo);
+          turn->minConsecutive = 0;
         }
+        turn->phase = turn->minConsecutive < 3 ? TURN_THROW : TURN_PLAYER_END;
+        break;
       }
-    } 
 
-    displayPlayerStatusAfterRound(players, game);
-    displayMysteryCellStatusAfterRound(game->mysteryCellNo, game->mysteryRounds);
-    
-    printf("\n");
+      case TURN_PLAYER_END:
+        decrementMysteryEffectRounds(players[playerIndex].pieces);
+        resetMysteryEffect(players[playerIndex].pieces);
+
+        // separate block when 6 is consecutively thrown
+        // fix and improve later
+        if (turn->minConsecutive >= 3 && turn->diceNumber == MAX_DICE_VALUE && playerHasBlock(&players[playerIndex]))
+        {
+          int blockCellNo = getCellNoOfRandomBlock(&players[playerIndex], board);
+          if (blockCellNo != EMPTY)
+          {
+            separateBlockade(board, blockCellNo);
+          }
+        }
 
-    limit++;
+        turn->orderIndex++;
+        turn->phase = TURN_PLAYER_START;
+        break;
 
-    //limit loop stop
-    if (limit >= maxLimit)
-    {
-      displayWinners(game, players);
-      break;
+      case TURN_GAME_OVER:
+        return TURN_EVENT_GAME_OVER;
     }
   }
-
-  displayWinners(game, players);
 }
 
-/* Win/game end condition methods
-  */
-bool hasPlayerWon(struct Piece *pieces)
+// Apply the move chosen for a pending decision. An action
+// that is not legal is replaced by the move of the behavior
+void resumeGame(struct Game *game, struct Player *players, struct Board *board, struct TurnState *turn, int action)
 {
-  int piecesInHome = 0;
+  struct Player *player = &players[turn->playerIndex];
 
-  for (int pieceIndex = 0; pieceIndex < PIECE_NO; pieceIndex++)
+  tryValueAndCatchError(turn->phase != TURN_DECISION, '=', true);
+
+  if (action >= 0 && action < PIECE_NO * 2 && (turn->legalMask & (1 << action)))
   {
-    if (pieces[pieceIndex].cellNo == HOME)
-    {
-      piecesInHome++;
-    }
+    int diceNumber = getDiceValueOfPlayer(player, turn->diceNumber);
+    finalizeMovement(player, action % PIECE_NO, diceNumber, board, action >= PIECE_NO);
   }
-
-  if (piecesInHome == 4)
+  else
   {
-    return true;
+    moveParse(players, turn->playerIndex, turn->diceNumber, board, game->mysteryCellNo);
   }
-  return false;
+
+  turn->phase = TURN_AFTER_MOVE;
 }
 
-bool skipPlayerIfWon(int *winners, int curWinIndex, int playerIndex)
+// Set up a new game up to its first round. NULL weights
+// keep the default behavior weights
+void startGameSession
+(
+  struct GameSession *session, uint64_t seed, int weights[][WEIGHT_NO],
+  uint8_t suspendedColors, int maxRounds
+)
 {
-  for (int winnerIndex = 0; winnerIndex < curWinIndex; winnerIndex++)
+  session->game = createGame();
+  initializeBoard(&session->board);
+  resetPlayers(session->players);
+  if (weights != NULL)
   {
-    if (winners[winnerIndex] == playerIndex)
-    {
-      return true;
-    }
+    applyPieceWeights(session->players, weights);
   }
+  initializeTurnState(&session->turn, suspendedColors, maxRounds);
 
-  return false;
+  seedGameRandom(seed);
+  initialGameLoop(session->players, &session->game);
+  session->randomState = getGameRandomState();
+}
+
+enum TurnEvent advanceGameSession(struct GameSession *session)
+{
+  setGameRandomState(session->randomState);
+  enum TurnEvent event = advanceGame(&session->game, session->players, &session->board, &session->turn);
+  session->randomState = getGameRandomState();
+
+  return event;
+}
+
+void resumeGameSession(struct GameSession *session, int action)
+{
+  setGameRandomState(session->randomState);
+  resumeGame(&session->game, session->players, &session->board, &session->turn, action);
+  session->randomState = getGameRandomState();
+}
+
+// Play the whole game with every color on its behavior.
+// The turn engine stops after MAX_GAME_ROUNDS rounds
+// to prevent infinite loops in worst cases
+void mainGameLoop(struct Player *players, struct Game *game, struct Board *board)
+{
+  struct TurnState turn;
+  initializeTurnState(&turn, 0, MAX_GAME_ROUNDS);
+
+  advanceGame(game, players, board, &turn);
+
+  displayWinners(game, players);
+}
+
+/* Win/game end condition methods
+  */
+bool hasPlayerWon(struct Board *board, enum Color color)
+{
+  return board->piecesAtHome[color] == PIECE_NO;
+}
+
+bool skipPlayerIfWon(struct Game *game, int playerIndex)
+{
+  return !(game->activePlayers & (1 << playerIndex));
 }
 
-bool isGameOver(struct Game *game, struct Player *players)
+bool isGameOver(struct Game *game)
 {
   if (game->winIndex == PLAYER_NO - 1)
   {
-    // find the 4th place player
-    for (int playerIndex = 0; playerIndex < PLAYER_NO; playerIndex++)
-    {
-      if (!hasPlayerWon(players[playerIndex].pieces))
-      {
-        game->winners[game->winIndex] = playerIndex;
-        break;
-      }
-    }
-    printf("Game has ended successfully!\n");
+    // the 4th place player is the only one still active
+    game->winners[game->winIndex] = __builtin_ctz(game->activePlayers);
+    gameLog("Game has ended successfully!\n");
     return true;
   }
 
@@ -2714,25 +3590,26 @@ bool isGameOver(struct Game *game, struct Player *players)
 
 void playGame()
 {
-  struct Game game = {
-    0,
-    EMPTY,
-    0,
-    0,
-    0,
-    {[0 ... PLAYER_NO - 1] = EMPTY},
-    {[0 ... PLAYER_NO - 1] = EMPTY},
-    EMPTY,
-
-  };
+  struct Game game = createGame();
 
-  struct Piece *standardCells[MAX_STANDARD_CELL][PIECE_NO] = {NULL};
+  struct Board board;
+  initializeBoard(&board);
 
   struct Player *players = initializePlayers();
 
+  // override default behavior weights if a tuned config exists
+  int weights[PLAYER_NO][WEIGHT_NO];
+  if (loadPieceWeights(WEIGHTS_CONFIG_FILE, weights))
+  {
+    applyPieceWeights(players, weights);
+  }
+
+  // endgames are only solved exactly if the table was generated
+  loadEndgameTable(ENDGAME_TABLE_FILE);
+
   for (int playerIndex = 0; playerIndex < PLAYER_NO; playerIndex++)
   {
-    printf
+    gameLog
     (
       "The %s player has %d pieces %s, %s, %s, and %s\n",
       getName(players[playerIndex].color),
@@ -2744,14 +3621,14 @@ void playGame()
     );
   }
   
-  printf("\n");
+  gameLog("\n");
 
   // Seed the random number generator
-  srand(time(NULL));
+  seedGameRandom(time(NULL));
 
   initialGameLoop(players, &game);
   
-  mainGameLoop(players, &game, standardCells);
+  mainGameLoop(players, &game, &board);
 
   free(players);
 }
\ No newline at end of file
@@ -13,30 +13,64 @@
 struct Piece createPiece(char namePrefix, char nameSuffix);
 struct Player createPlayer(int start, char namePrefix, enum Color color);
 struct Player* initializePlayers();
+void resetPlayers(struct Player *players);
+struct Game createGame();
 void initializePlayerOrder(struct Game *game, int maxPlayerIndex);
 
+// board functions
+void initializeBoard(struct Board *board);
+void setCellPiece(struct Board *board, int cellNo, int cellIndex, struct Piece *piece);
+void placePieceInCell(struct Board *board, int cellNo, struct Piece *piece);
+void removePieceFromCell(struct Board *board, int cellNo, struct Piece *piece);
+void rebuildBoard(struct Board *board, struct Player *players);
+uint64_t getEmptyCells(struct Board *board);
+
+// make/unmake functions
+void initializeUndoStack(struct UndoStack *stack);
+void recordSlotChange(int cellNo, int cellIndex, struct Piece *prevPiece);
+void recordPieceChange(struct Piece *piece);
+void makeMove
+(
+  struct UndoStack *stack, struct Game *game, struct Player *players,
+  int playerIndex, int pieceIndex, int diceNumber,
+  bool blockMoveCondition, struct Board *board
+);
+void unmakeMove(struct UndoStack *stack, struct Board *board);
+int selectCellFromMask(uint64_t cells, int n);
+void checkCellCounts(struct Cell *cell);
+void checkBoardProgress(struct Board *board, struct Player *players);
+
 // error functions
 void tryValueAndCatchError(int targetValue, char comparison, int compareValue);
 void displayErrors();
 
+// random number and output functions
+void seedGameRandom(uint64_t seed);
+uint64_t getGameRandomState();
+void setGameRandomState(uint64_t state);
+int gameRandom();
+void setGameOutput(bool enabled);
+void gameLog(const char *format, ...);
+
 // helper methods
 bool cellNoIndexable(int cellNo);
 enum Color getPieceColor(char colorLetter);
 char* getName(enum Color color);
 int getStartIndex(enum Color color);
 int getApproachIndex(enum Color color);
-int getNoOfPiecesInBase(struct Player *player);
+int getNoOfPiecesInBase(struct Board *board, enum Color color);
 bool canMoveToBoard(int diceNumber);
-int getPlayerCountOfCell(struct Piece *cells[PLAYER_NO], enum Color playerColor);
-int getEnemyCountOfCell(struct Piece *cell[PLAYER_NO], enum Color playerColor);
-bool isPlayerCell(struct Piece *cells[PLAYER_NO], enum Color playerColor);
-bool isBlockade(struct Piece *cell[PIECE_NO]);
+int getPlayerCountOfCell(struct Cell *cell, enum Color playerColor);
+int getEnemyCountOfCell(struct Cell *cell, enum Color playerColor);
+bool isPlayerCell(struct Cell *cell, enum Color playerColor);
+bool isBlockade(struct Cell *cell);
 bool isBlocked(int playerPieceCount, int enemyPieceCount);
-bool isCellEmpty(struct Piece *cells[PLAYER_NO]);
+bool isCellEmpty(struct Cell *cell);
 int getMysteryEffectNumber(int location);
 int getMysteryLocation(int mysteryEffect, struct Piece *piece);
 char *getMysteryLocationName(int mysteryEffect);
-bool boardHasPiece(struct Player *players);
+char *formatCellName(int cellNo, char *text);
+bool boardHasPiece(struct Board *board);
 int getCorrectCellCount(int cellCount);
 int getMovableCellCount
 (
@@ -44,17 +78,19 @@ int getMovableCellCount
   int diceNumber,
   bool clockWise,
   int playerCount,
-  struct Piece *cells[][PIECE_NO],
+  struct Board *board,
   enum Color color
 );
-int checkIfCellIsPassable(struct Piece *cell[PIECE_NO], enum Color color, int playerCount);
-enum Color getPlayerColorInCell(struct Piece *cell[PIECE_NO]);
-int getCaptureCountOfPlayer(struct Player *player);
+int checkIfCellIsPassable(struct Cell *cell, enum Color color, int playerCount);
+enum Color getPlayerColorInCell(struct Cell *cell);
+int getCaptureCountOfPlayer(struct Board *board, enum Color color);
+void addPieceCapture(struct Piece *piece, struct Board *board);
 int getDistanceFromHome(struct Piece *piece);
-int getEnemyDistanceFromHome(struct Piece *cell[PIECE_NO]);
+float getExpectedThrowsToHome(struct Piece *piece);
+int getEnemyDistanceFromHome(struct Cell *cell);
 bool playerHasBlock(struct Player *player);
-int getCellNoOfRandomBlock(struct Player *player, struct Piece *cells[][PIECE_NO]);
-bool pieceInApproachRange(struct Piece *piece, struct Piece *cells[][PIECE_NO], int finalCellNo);
+int getCellNoOfRandomBlock(struct Player *player, struct Board *board);
+bool pieceInApproachRange(struct Piece *piece, int finalCellNo);
 bool canEnterHomeStraight(struct Piece *piece);
 bool canMoveToHome(int cellNo, int diceNumber);
 bool canMoveInHomeStraight(int cellNo, int diceNumber);
@@ -63,46 +99,65 @@ bool canMoveInHomeStraight(int cellNo, int diceNumber);
 int rollDice();
 bool getDirectionFromToss();
 int getMysteryEffect();
-void formBlock(struct Piece *cell[PIECE_NO]);
-void moveFromBase(struct Player *player, struct Piece *piece, struct Piece *cell[PLAYER_NO]);
-void allocateMysteryCell(struct Game *game, struct Piece *pieces[][PIECE_NO]);
+void formBlock(struct Cell *cell);
+void moveFromBase(struct Player *player, struct Piece *piece, struct Board *board);
+uint64_t getMysteryCandidateCells(struct Game *game, struct Board *board);
+void allocateMysteryCell(struct Game *game, struct Board *board);
 void applyMysteryEffect(int mysteryEffect, int mysteryLocation, struct Piece *piece, char *playerName, char *pieceName, bool isPartOfBlockade);
-void applyTeleportation(struct Piece **pieces, int mysteryEffect, int count, struct Piece *cells[][PLAYER_NO]);
+void applyTeleportation(struct Piece **pieces, int mysteryEffect, int count, struct Board *board);
 void handleBaseTeleportation
 (
-  struct Piece **pieces, struct Piece *cells[][PIECE_NO], 
+  struct Piece **pieces, struct Board *board, 
   int count, char *playerName, char *mysteryLocationName
 );
 bool canTeleport(bool isTeleportBlocked, int playerCount, char *playerName, int mysteryLocation);
 int getDiceValueAfterMysteryEffect(int diceNumber, struct Player *player, int pieceIndex);
-void resetPiece(struct Piece *piece);
+void resetPiece(struct Piece *piece, struct Board *board);
 void decrementMysteryEffectRounds(struct Piece *pieces);
 void resetMysteryEffect(struct Piece *pieces);
-void captureByPiece(struct Piece *piece, struct Piece *cells[][PIECE_NO], int finalCellNo, char *playerName);
+void captureByPiece(struct Piece *piece, struct Board *board, int finalCellNo, char *playerName);
 void captureByBlock
 (
   struct Piece **blockPieces,
   int playerCount,
-  struct Piece *cells[][PIECE_NO],
+  struct Board *board,
   int finalCellNo,
   char *playerName
 );
-void separateBlockade(struct Piece *cells[][PIECE_NO], int blockCellNo);
-void move(struct Piece *piece, int prevIndex, int diceNumber, struct Piece *cells[][PIECE_NO]);
-void moveBlock(struct Piece *piece, int diceNumber, struct Piece *cells[][PIECE_NO]);
-void moveInHomeStraight(struct Piece *piece, int diceNumber);
-void handlePieceLandOnMysteryCell(struct Game *game, struct Player *player, struct Piece *cells[][PIECE_NO]);
-bool handleCellToHomeStraight(struct Piece *piece, int diceNumber, int movableCellCount, int finalCellNo, struct Piece *cells[][PIECE_NO]);
-void incrementHomeApproachPasses(struct Piece *piece, struct Piece *cells[][PIECE_NO], int finalCellNo);
+void separateBlockade(struct Board *board, int blockCellNo);
+void move(struct Piece *piece, int diceNumber, struct Board *board);
+void moveBlock(struct Piece *piece, int diceNumber, struct Board *board);
+void moveInHomeStraight(struct Piece *piece, int diceNumber, struct Board *board);
+void handlePieceLandOnMysteryCell(struct Game *game, struct Player *player, struct Board *board);
+int getLandedMysteryEffect();
+bool handleCellToHomeStraight(struct Piece *piece, int diceNumber, int movableCellCount, int finalCellNo, struct Board *board);
+void incrementHomeApproachPasses(struct Piece *piece, int finalCellNo);
+
+// Behavior weight functions
+char *getWeightName(enum PieceWeight weight);
+void setDefaultPieceWeights(enum Color color, int *weights);
+bool isWeightUsed(enum Color color, enum PieceWeight weight);
+bool loadPieceWeights(char *fileName, int weights[][WEIGHT_NO]);
+bool savePieceWeights(char *fileName, int weights[][WEIGHT_NO]);
+void applyPieceWeights(struct Player *players, int weights[][WEIGHT_NO]);
 
 // Behavior functions
-union PiecePriority getPriorities(enum Color color);
-void moveParse(struct Player *players, int playerIndex, int diceNumber, struct Piece *cells[][PIECE_NO], int curMyseryCell);
+union PiecePriority getPriorities(enum Color color, union PriorityStorage *storage);
+void evaluatePieceMoves
+(
+  struct Player *players, int playerIndex, int diceNumber,
+  struct Board *board, int curMyseryCell, struct MoveDecision *decision
+);
+int selectPieceMove(struct Player *player, struct Board *board, struct MoveDecision *decision);
+bool getBlockMoveCondition(struct Player *player, struct MoveDecision *decision, int selectedPieceIndex);
+void setMoveObserver(struct MoveObserver *observer);
+void setMovePolicy(enum Color color, struct MovePolicy *policy);
+void moveParse(struct Player *players, int playerIndex, int diceNumber, struct Board *board, int curMyseryCell);
 bool initialMovementCheck
 (
   struct Player *player,
   union PiecePriority *piecePriorities,
-  struct Piece *cells[][PIECE_NO],
+  struct Board *board,
   int pieceIndex,
   int diceNumber 
 );
@@ -117,7 +172,7 @@ void initialHomeStraightCheck
 void initialBaseCheck
 (
   union PiecePriority *piecePriorities,
-  struct Piece *startCell[PIECE_NO],
+  struct Cell *startCell,
   int pieceIndex,
   int cellNo,
   int diceNumber,
@@ -127,7 +182,7 @@ void validateSingleMovement
 (
   struct Player *player,
   union PiecePriority *piecePriorities,
-  struct Piece *cells[][PIECE_NO],
+  struct Board *board,
   int pieceIndex,
   int diceNumber,
   int curMysteryCell
@@ -136,7 +191,7 @@ void validateBlockMovement
 (
   struct Player *player,
   union PiecePriority *piecePriorities,
-  struct Piece *cells[][PIECE_NO],
+  struct Board *board,
   int pieceIndex,
   int diceNumber,
   int curMysteryCell
@@ -153,7 +208,7 @@ void validateMovableCell
 void validateFormBlockMovement
 (
   union PiecePriority *piecePriorities,
-  struct Piece *finalCell[PIECE_NO],
+  struct Cell *finalCell,
   int pieceIndex,
   enum Color color
 );
@@ -168,7 +223,7 @@ void validateCanAttackMovement
 void validateExitBlockMovement
 (
   union PiecePriority *piecePriorities,
-  struct Piece *cells[][PIECE_NO],
+  struct Board *board,
   int pieceIndex,
   struct Player *player, 
   int movableCellCount,
@@ -184,32 +239,39 @@ void validateBlueMovement
 );
 int getIndexOfSelectedPiece
 (
-  struct Piece *pieces,
-  struct Piece *cells[][PIECE_NO],
+  struct Player *player,
+  struct Board *board,
   int *pieceImportance,
-  int canAttackCount,
+  bool *canAttack,
   int diceNumber
 );
+int getDiceValueOfPlayer(struct Player *player, int diceNumber);
+bool canPieceMove(struct Player *player, int pieceIndex, int diceNumber, struct Board *board);
+bool canBlockMove(struct Player *player, int pieceIndex, int diceNumber, struct Board *board);
+uint8_t getPieceFlags(struct Piece *piece, struct Board *board);
+uint8_t getLegalMoveMask(struct Player *player, int diceNumber, struct Board *board);
 void finalizeMovement
 (
   struct Player *player,
   int selectedPieceIndex, 
   int diceNumber, 
-  struct Piece *cells[][PIECE_NO], 
+  struct Board *board, 
   bool blockMoveCondition
 );
 
 void validateRedPieceImportance(
   struct RedPriority *piecePriorities,
+  int *weights,
   int *pieceImportance,
   int pieceIndex,
-  int *canAttackCount,
+  bool *canAttack,
   bool isPartofBlockade
 );
 
 void validateGreenPieceImportance
 (
   struct GreenPriority *piecePriorities,
+  int *weights,
   int *pieceImportance,
   int pieceIndex
 );
@@ -217,6 +279,7 @@ void validateGreenPieceImportance
 void validateYellowPieceImportance
 (
   struct YellowPriority *piecePriorities,
+  int *weights,
   int *pieceImportance,
   int pieceIndex
 );
@@ -224,13 +287,14 @@ void validateYellowPieceImportance
 void validateBluePieceImportance
 (
   struct BluePriority *piecePriorities,
+  int *weights,
   int *pieceImportance,
   int pieceIndex,
   int previousPieceIndex
 );
 
 // Output functions
-void displayPlayerStatusAfterRound(struct Player *players, struct Game *game);
+void displayPlayerStatusAfterRound(struct Player *players, struct Game *game, struct Board *board);
 void displayMysteryCellStatusAfterRound(int mysteryCellNo, int mysteryRounds);
 void displayTeleportationMessage(char* playerName, int count, struct Piece **pieces, char *location);
 void displayMovablePieceStatus
@@ -240,7 +304,7 @@ void displayMovablePieceStatus
   char *playerName,
   struct Piece *piece,
   int finalCellNo,
-  struct Piece *cell[PIECE_NO]
+  struct Cell *cell
 );
 void displayMovableBlockStatus(
   int movableCellCount,
@@ -248,19 +312,30 @@ void displayMovableBlockStatus(
   char *playerName,
   struct Piece *piece,
   int finalCellNo,
-  struct Piece *cell[PIECE_NO]
+  struct Cell *cell
 );
 void displayWinners(struct Game *game, struct Player *players);
 
 // game loops
 void initialGameLoop(struct Player *players, struct Game *game);
-void handleMysteryCellLoop(struct Game *game, struct Player *players, struct Piece *cells[][PIECE_NO]);
-void mainGameLoop(struct Player *players, struct Game *game, struct Piece *standardCells[][PLAYER_NO]);
+void handleMysteryCellLoop(struct Game *game, struct Board *board);
+void setTurnObserver(struct TurnObserver *observer);
+void initializeTurnState(struct TurnState *turn, uint8_t suspendedColors, int maxRounds);
+enum TurnEvent advanceGame(struct Game *game, struct Player *players, struct Board *board, struct TurnState *turn);
+void resumeGame(struct Game *game, struct Player *players, struct Board *board, struct TurnState *turn, int action);
+void startGameSession
+(
+  struct GameSession *session, uint64_t seed, int weights[][WEIGHT_NO],
+  uint8_t suspendedColors, int maxRounds
+);
+enum TurnEvent advanceGameSession(struct GameSession *session);
+void resumeGameSession(struct GameSession *session, int action);
+void mainGameLoop(struct Player *players, struct Game *game, struct Board *board);
 
 // check win/end functions
-bool hasPlayerWon(struct Piece *pieces);
-bool skipPlayerIfWon(int *winners, int curWinIndex, int playerIndex);
-bool isGameOver(struct Game *game, struct Player *players);
+bool hasPlayerWon(struct Board *board, enum Color color);
+bool skipPlayerIfWon(struct Game *game, int playerIndex);
+bool isGameOver(struct Game *game);
 
 // Main game execution function
 void playGame();
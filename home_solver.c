@@ -0,0 +1,233 @@
+#include "game.h"
+#include "types.h"
+#include <math.h>
+#include <string.h>
+
+// Offline solver for the expected number of throws a single
+// piece needs to reach HOME when it is alone on the board.
+// Each throw is a transition of a Markov chain whose
+// successors are found by running the engine movement
+// functions, so the table follows the rules in move,
+// handleCellToHomeStraight and moveInHomeStraight.
+// Opponents, blocks and mystery cells are ignored.
+//
+// Usage: ./home_solver.out > home_table.h
+
+#define DIRECTION_NO 2
+#define PASS_STATE_NO 2
+#define STATE_NO (DIRECTION_NO * PASS_STATE_NO * HOME)
+#define UNREACHABLE -1.0
+
+static int getStateIndex(bool clockWise, int passState, int cellNo)
+{
+  return ((clockWise ? 1 : 0) * PASS_STATE_NO + passState) * HOME + cellNo;
+}
+
+// Throw the dice once for a piece in the given state and
+// return the state index it ends in (HOME gives EMPTY)
+static int getNextState(enum Color color, bool clockWise, int passState, int cellNo, int diceNumber)
+{
+  struct Board board;
+  struct Piece piece = createPiece(getName(color)[0], '1');
+
+  initializeBoard(&board);
+  board.piecesInBase[color] = PIECE_NO - 1;
+  board.piecesInPlay = 1;
+
+  // a piece must have captured once to enter the home straight
+  piece.captured = 1;
+  piece.clockWise = clockWise;
+  piece.blockClockWise = clockWise;
+  piece.noOfApproachPasses = passState;
+  piece.cellNo = cellNo;
+
+  if (cellNo < MAX_STANDARD_CELL)
+  {
+    placePieceInCell(&board, cellNo, &piece);
+    move(&piece, diceNumber, &board);
+  }
+  else
+  {
+    moveInHomeStraight(&piece, diceNumber, &board);
+  }
+
+  if (piece.cellNo == HOME)
+  {
+    return EMPTY;
+  }
+
+  return getStateIndex(piece.clockWise, piece.noOfApproachPasses > 0, piece.cellNo);
+}
+
+// Solve (I - P) x = 1 over the states that can reach HOME
+// with gaussian elimination and partial pivoting
+static void solveExpectedThrows(int next[STATE_NO][MAX_DICE_VALUE], bool *canReachHome, double *expectedThrows)
+{
+  int index[STATE_NO];
+  int count = 0;
+
+  for (int state = 0; state < STATE_NO; state++)
+  {
+    index[state] = canReachHome[state] ? count++ : EMPTY;
+  }
+
+  double (*matrix)[count + 1] = calloc(count, sizeof(*matrix));
+  if (matrix == NULL)
+  {
+    printf("Error: Memory allocation failed\n");
+    exit(1);
+  }
+
+  for (int state = 0; state < STATE_NO; state++)
+  {
+    if (index[state] == EMPTY)
+    {
+      continue;
+    }
+
+    double *row = matrix[index[state]];
+    row[index[state]] += 1.0;
+    row[count] = 1.0;
+
+    for (int dice = 0; dice < MAX_DICE_VALUE; dice++)
+    {
+      if (next[state][dice] != EMPTY)
+      {
+        row[index[next[state][dice]]] -= 1.0 / MAX_DICE_VALUE;
+      }
+    }
+  }
+
+  for (int column = 0; column < count; column++)
+  {
+    int pivot = column;
+    for (int row = column + 1; row < count; row++)
+    {
+      if (fabs(matrix[row][column]) > fabs(matrix[pivot][column]))
+      {
+        pivot = row;
+      }
+    }
+
+    for (int k = 0; k <= count; k++)
+    {
+      double swap = matrix[column][k];
+      matrix[column][k] = matrix[pivot][k];
+      matrix[pivot][k] = swap;
+    }
+
+    for (int row = 0; row < count; row++)
+    {
+      if (row == column || matrix[row][column] == 0.0)
+      {
+        continue;
+      }
+
+      double factor = matrix[row][column] / matrix[column][column];
+      for (int k = column; k <= count; k++)
+      {
+        matrix[row][k] -= factor * matrix[column][k];
+      }
+    }
+  }
+
+  for (int state = 0; state < STATE_NO; state++)
+  {
+    expectedThrows[state] = index[state] == EMPTY
+      ? UNREACHABLE
+      : matrix[index[state]][count] / matrix[index[state]][index[state]];
+  }
+
+  free(matrix);
+}
+
+static void solveColor(enum Color color, double *expectedThrows)
+{
+  static int next[STATE_NO][MAX_DICE_VALUE];
+  bool canReachHome[STATE_NO] = {false};
+
+  for (int direction = 0; direction < DIRECTION_NO; direction++)
+  {
+    for (int passState = 0; passState < PASS_STATE_NO; passState++)
+    {
+      for (int cellNo = 0; cellNo < HOME; cellNo++)
+      {
+        int state = getStateIndex(direction, passState, cellNo);
+        for (int dice = 0; dice < MAX_DICE_VALUE; dice++)
+        {
+          next[state][dice] = getNextState(color, direction, passState, cellNo, dice + 1);
+        }
+      }
+    }
+  }
+
+  // backward reachability so that the system stays regular
+  bool changed = true;
+  while (changed)
+  {
+    changed = false;
+    for (int state = 0; state < STATE_NO; state++)
+    {
+      for (int dice = 0; dice < MAX_DICE_VALUE && !canReachHome[state]; dice++)
+      {
+        if (next[state][dice] == EMPTY || canReachHome[next[state][dice]])
+        {
+          canReachHome[state] = true;
+          changed = true;
+        }
+      }
+    }
+  }
+
+  solveExpectedThrows(next, canReachHome, expectedThrows);
+}
+
+int main()
+{
+  static double expectedThrows[PLAYER_NO][STATE_NO];
+
+  setGameOutput(false);
+
+  for (int color = 0; color < PLAYER_NO; color++)
+  {
+    solveColor(color, expectedThrows[color]);
+  }
+
+  printf("#ifndef HOME_TABLE_H\n");
+  printf("#define HOME_TABLE_H\n\n");
+  printf("// Generated by home_solver.c, do not edit.\n");
+  printf("// Expected number of throws for a lone piece that has\n");
+  printf("// captured once to reach HOME, indexed by color,\n");
+  printf("// clockwise, approach passed and cell no (home straight\n");
+  printf("// positions are %d to %d). %.1f marks a state that\n", MAX_STANDARD_CELL, HOME - 1, UNREACHABLE);
+  printf("// cannot reach HOME.\n\n");
+  printf("static const float HOME_EXPECTED_THROWS[PLAYER_NO][%d][%d][HOME] =\n{\n", DIRECTION_NO, PASS_STATE_NO);
+
+  for (int color = 0; color < PLAYER_NO; color++)
+  {
+    printf("  { // %s\n", getName(color));
+    for (int direction = 0; direction < DIRECTION_NO; direction++)
+    {
+      printf("    {\n");
+      for (int passState = 0; passState < PASS_STATE_NO; passState++)
+      {
+        printf("      {");
+        for (int cellNo = 0; cellNo < HOME; cellNo++)
+        {
+          if (cellNo % 8 == 0)
+          {
+            printf("\n        ");
+          }
+          printf("%.4ff, ", expectedThrows[color][getStateIndex(direction, passState, cellNo)]);
+        }
+        printf("\n      },\n");
+      }
+      printf("    },\n");
+    }
+    printf("  },\n");
+  }
+
+  printf("};\n\n#endif\n");
+
+  return 0;
+}
@@ -0,0 +1,199 @@
+#ifndef HOME_TABLE_H
+#define HOME_TABLE_H
+
+// Generated by home_solver.c, do not edit.
+// Expected number of throws for a lone piece that has
+// captured once to reach HOME, indexed by color,
+// clockwise, approach passed and cell no (home straight
+// positions are 52 to 56). -1.0 marks a state that
+// cannot reach HOME.
+
+static const float HOME_EXPECTED_THROWS[PLAYER_NO][2][2][HOME] =
+{
+  { // Yellow
+    {
+      {
+        22.3143f, 22.6000f, 22.8857f, 23.1714f, 23.4571f, 23.7429f, 24.0286f, 24.3143f, 
+        24.6000f, 24.8857f, 25.1714f, 25.4571f, 25.7429f, 26.0286f, 26.3143f, 26.6000f, 
+        26.8857f, 27.1714f, 27.4571f, 27.7429f, 28.0286f, 28.3143f, 28.6000f, 28.8857f, 
+        29.1714f, 29.4571f, 29.7429f, 30.0286f, 30.3143f, 30.6000f, 30.8857f, 31.1714f, 
+        31.4571f, 31.7429f, 32.0286f, 32.3143f, 32.6000f, 32.8857f, 33.1714f, 33.4571f, 
+        33.7429f, 34.0286f, 34.3143f, 34.6000f, 34.8857f, 35.1714f, 35.4571f, 35.7429f, 
+        36.0286f, 36.3143f, 36.6000f, 36.8857f, 6.0000f, 6.0000f, 6.0000f, 6.0000f, 
+        6.0000f, 
+      },
+      {
+        9.4333f, 7.5722f, 7.8343f, 8.1400f, 8.4966f, 8.9127f, 9.3982f, 9.3923f, 
+        9.6957f, 10.0059f, 10.3169f, 10.6203f, 10.9049f, 11.1560f, 11.4500f, 11.7423f, 
+        12.0317f, 12.3175f, 12.6004f, 12.8830f, 13.1708f, 13.4576f, 13.7435f, 14.0288f, 
+        14.3140f, 14.5996f, 14.8857f, 15.1716f, 15.4572f, 15.7428f, 16.0285f, 16.3143f, 
+        16.6000f, 16.8857f, 17.1714f, 17.4571f, 17.7428f, 18.0286f, 18.3143f, 18.6000f, 
+        18.8857f, 19.1714f, 19.4571f, 19.7429f, 20.0286f, 20.3143f, 20.6000f, 20.8857f, 
+        21.1714f, 21.4571f, 21.7429f, 22.0286f, 6.0000f, 6.0000f, 6.0000f, 6.0000f, 
+        6.0000f, 
+      },
+    },
+    {
+      {
+        27.4667f, 27.1810f, 26.8952f, 26.6095f, 26.3238f, 26.0381f, 25.7524f, 25.4667f, 
+        25.1810f, 24.8952f, 24.6095f, 24.3238f, 24.0381f, 23.7524f, 23.4667f, 23.1810f, 
+        22.8952f, 22.6094f, 22.3238f, 22.0383f, 21.7526f, 21.4665f, 21.1805f, 20.8950f, 
+        20.6100f, 20.3249f, 20.0387f, 19.7500f, 19.4643f, 19.1820f, 18.9000f, 18.6146f, 
+        18.3215f, 18.0173f, 17.7505f, 17.4877f, 17.2086f, 16.9019f, 16.5631f, 16.1921f, 
+        16.1495f, 15.9112f, 15.5338f, 15.0619f, 14.5303f, 13.9657f, 15.8944f, 14.4809f, 
+        13.2693f, 12.2309f, 11.3407f, 10.5778f, 6.0000f, 6.0000f, 6.0000f, 6.0000f, 
+        6.0000f, 
+      },
+      {
+        27.4667f, 27.1810f, 26.8952f, 26.6095f, 26.3238f, 26.0381f, 25.7524f, 25.4667f, 
+        25.1810f, 24.8952f, 24.6095f, 24.3238f, 24.0381f, 23.7524f, 23.4667f, 23.1810f, 
+        22.8952f, 22.6094f, 22.3238f, 22.0383f, 21.7526f, 21.4665f, 21.1805f, 20.8950f, 
+        20.6100f, 20.3249f, 20.0387f, 19.7500f, 19.4643f, 19.1820f, 18.9000f, 18.6146f, 
+        18.3215f, 18.0173f, 17.7505f, 17.4877f, 17.2086f, 16.9019f, 16.5631f, 16.1921f, 
+        16.1495f, 15.9112f, 15.5338f, 15.0619f, 14.5303f, 13.9657f, 15.8944f, 14.4809f, 
+        13.2693f, 12.2309f, 11.3407f, 10.5778f, 6.0000f, 6.0000f, 6.0000f, 6.0000f, 
+        6.0000f, 
+      },
+    },
+  },
+  { // Blue
+    {
+      {
+        23.7524f, 24.0381f, 24.3238f, 24.6095f, 24.8952f, 25.1810f, 25.4667f, 25.7524f, 
+        26.0381f, 26.3238f, 26.6095f, 26.8952f, 27.1810f, 27.4667f, 27.7524f, 28.0381f, 
+        28.3238f, 28.6095f, 28.8952f, 29.1810f, 29.4667f, 29.7524f, 30.0381f, 30.3238f, 
+        30.6095f, 30.8952f, 31.1810f, 31.4667f, 31.7524f, 32.0381f, 32.3238f, 32.6095f, 
+        32.8952f, 33.1810f, 33.4667f, 33.7524f, 34.0381f, 34.3238f, 34.6095f, 34.8952f, 
+        35.1810f, 35.4667f, 35.7524f, 36.0381f, 36.3238f, 36.6095f, 36.8952f, 37.1810f, 
+        37.4667f, 37.7524f, 38.0381f, 38.3238f, 6.0000f, 6.0000f, 6.0000f, 6.0000f, 
+        6.0000f, 
+      },
+      {
+        23.7524f, 24.0381f, 24.3238f, 24.6095f, 24.8952f, 25.1810f, 25.4667f, 25.7524f, 
+        26.0381f, 26.3238f, 26.6095f, 26.8952f, 27.1810f, 27.4667f, 10.5778f, 11.3407f, 
+        12.2309f, 13.2693f, 14.4809f, 15.8944f, 13.9657f, 14.5303f, 15.0619f, 15.5338f, 
+        15.9112f, 16.1495f, 16.1921f, 16.5631f, 16.9019f, 17.2086f, 17.4877f, 17.7505f, 
+        18.0173f, 18.3215f, 18.6146f, 18.9000f, 19.1820f, 19.4643f, 19.7500f, 20.0387f, 
+        20.3249f, 20.6100f, 20.8950f, 21.1805f, 21.4665f, 21.7526f, 22.0383f, 22.3238f, 
+        22.6094f, 22.8952f, 23.1810f, 23.4667f, 6.0000f, 6.0000f, 6.0000f, 6.0000f, 
+        6.0000f, 
+      },
+    },
+    {
+      {
+        16.1921f, 16.1495f, 15.9112f, 15.5338f, 15.0619f, 14.5303f, 13.9657f, 15.8944f, 
+        14.4809f, 13.2693f, 12.2309f, 11.3407f, 10.5778f, 27.4667f, 27.1810f, 26.8952f, 
+        26.6095f, 26.3238f, 26.0381f, 25.7524f, 25.4667f, 25.1810f, 24.8952f, 24.6095f, 
+        24.3238f, 24.0381f, 23.7524f, 23.4667f, 23.1810f, 22.8952f, 22.6094f, 22.3238f, 
+        22.0383f, 21.7526f, 21.4665f, 21.1805f, 20.8950f, 20.6100f, 20.3249f, 20.0387f, 
+        19.7500f, 19.4643f, 19.1820f, 18.9000f, 18.6146f, 18.3215f, 18.0173f, 17.7505f, 
+        17.4877f, 17.2086f, 16.9019f, 16.5631f, 6.0000f, 6.0000f, 6.0000f, 6.0000f, 
+        6.0000f, 
+      },
+      {
+        16.1921f, 16.1495f, 15.9112f, 15.5338f, 15.0619f, 14.5303f, 13.9657f, 15.8944f, 
+        14.4809f, 13.2693f, 12.2309f, 11.3407f, 10.5778f, 27.4667f, 27.1810f, 26.8952f, 
+        26.6095f, 26.3238f, 26.0381f, 25.7524f, 25.4667f, 25.1810f, 24.8952f, 24.6095f, 
+        24.3238f, 24.0381f, 23.7524f, 23.4667f, 23.1810f, 22.8952f, 22.6094f, 22.3238f, 
+        22.0383f, 21.7526f, 21.4665f, 21.1805f, 20.8950f, 20.6100f, 20.3249f, 20.0387f, 
+        19.7500f, 19.4643f, 19.1820f, 18.9000f, 18.6146f, 18.3215f, 18.0173f, 17.7505f, 
+        17.4877f, 17.2086f, 16.9019f, 16.5631f, 6.0000f, 6.0000f, 6.0000f, 6.0000f, 
+        6.0000f, 
+      },
+    },
+  },
+  { // Red
+    {
+      {
+        20.0387f, 20.3249f, 20.6100f, 20.8950f, 21.1805f, 21.4665f, 21.7526f, 22.0383f, 
+        22.3238f, 22.6094f, 22.8952f, 23.1810f, 23.4667f, 23.7524f, 24.0381f, 24.3238f, 
+        24.6095f, 24.8952f, 25.1810f, 25.4667f, 25.7524f, 26.0381f, 26.3238f, 26.6095f, 
+        26.8952f, 27.1810f, 27.4667f, 27.7524f, 28.0381f, 28.3238f, 28.6095f, 28.8952f, 
+        29.1810f, 29.4667f, 29.7524f, 30.0381f, 30.3238f, 30.6095f, 30.8952f, 31.1810f, 
+        31.4667f, 31.7524f, 32.0381f, 32.3238f, 32.6095f, 32.8952f, 33.1810f, 33.4667f, 
+        33.7524f, 34.0381f, 34.3238f, 34.6095f, 6.0000f, 6.0000f, 6.0000f, 6.0000f, 
+        6.0000f, 
+      },
+      {
+        20.0387f, 20.3249f, 20.6100f, 20.8950f, 21.1805f, 21.4665f, 21.7526f, 22.0383f, 
+        22.3238f, 22.6094f, 22.8952f, 23.1810f, 23.4667f, 23.7524f, 24.0381f, 24.3238f, 
+        24.6095f, 24.8952f, 25.1810f, 25.4667f, 25.7524f, 26.0381f, 26.3238f, 26.6095f, 
+        26.8952f, 27.1810f, 27.4667f, 10.5778f, 11.3407f, 12.2309f, 13.2693f, 14.4809f, 
+        15.8944f, 13.9657f, 14.5303f, 15.0619f, 15.5338f, 15.9112f, 16.1495f, 16.1921f, 
+        16.5631f, 16.9019f, 17.2086f, 17.4877f, 17.7505f, 18.0173f, 18.3215f, 18.6146f, 
+        18.9000f, 19.1820f, 19.4643f, 19.7500f, 6.0000f, 6.0000f, 6.0000f, 6.0000f, 
+        6.0000f, 
+      },
+    },
+    {
+      {
+        20.0387f, 19.7500f, 19.4643f, 19.1820f, 18.9000f, 18.6146f, 18.3215f, 18.0173f, 
+        17.7505f, 17.4877f, 17.2086f, 16.9019f, 16.5631f, 16.1921f, 16.1495f, 15.9112f, 
+        15.5338f, 15.0619f, 14.5303f, 13.9657f, 15.8944f, 14.4809f, 13.2693f, 12.2309f, 
+        11.3407f, 10.5778f, 27.4667f, 27.1810f, 26.8952f, 26.6095f, 26.3238f, 26.0381f, 
+        25.7524f, 25.4667f, 25.1810f, 24.8952f, 24.6095f, 24.3238f, 24.0381f, 23.7524f, 
+        23.4667f, 23.1810f, 22.8952f, 22.6094f, 22.3238f, 22.0383f, 21.7526f, 21.4665f, 
+        21.1805f, 20.8950f, 20.6100f, 20.3249f, 6.0000f, 6.0000f, 6.0000f, 6.0000f, 
+        6.0000f, 
+      },
+      {
+        20.0387f, 19.7500f, 19.4643f, 19.1820f, 18.9000f, 18.6146f, 18.3215f, 18.0173f, 
+        17.7505f, 17.4877f, 17.2086f, 16.9019f, 16.5631f, 16.1921f, 16.1495f, 15.9112f, 
+        15.5338f, 15.0619f, 14.5303f, 13.9657f, 15.8944f, 14.4809f, 13.2693f, 12.2309f, 
+        11.3407f, 10.5778f, 27.4667f, 27.1810f, 26.8952f, 26.6095f, 26.3238f, 26.0381f, 
+        25.7524f, 25.4667f, 25.1810f, 24.8952f, 24.6095f, 24.3238f, 24.0381f, 23.7524f, 
+        23.4667f, 23.1810f, 22.8952f, 22.6094f, 22.3238f, 22.0383f, 21.7526f, 21.4665f, 
+        21.1805f, 20.8950f, 20.6100f, 20.3249f, 6.0000f, 6.0000f, 6.0000f, 6.0000f, 
+        6.0000f, 
+      },
+    },
+  },
+  { // Green
+    {
+      {
+        16.1921f, 16.5631f, 16.9019f, 17.2086f, 17.4877f, 17.7505f, 18.0173f, 18.3215f, 
+        18.6146f, 18.9000f, 19.1820f, 19.4643f, 19.7500f, 20.0387f, 20.3249f, 20.6100f, 
+        20.8950f, 21.1805f, 21.4665f, 21.7526f, 22.0383f, 22.3238f, 22.6094f, 22.8952f, 
+        23.1810f, 23.4667f, 23.7524f, 24.0381f, 24.3238f, 24.6095f, 24.8952f, 25.1810f, 
+        25.4667f, 25.7524f, 26.0381f, 26.3238f, 26.6095f, 26.8952f, 27.1810f, 27.4667f, 
+        27.7524f, 28.0381f, 28.3238f, 28.6095f, 28.8952f, 29.1810f, 29.4667f, 29.7524f, 
+        30.0381f, 30.3238f, 30.6095f, 30.8952f, 6.0000f, 6.0000f, 6.0000f, 6.0000f, 
+        6.0000f, 
+      },
+      {
+        16.1921f, 16.5631f, 16.9019f, 17.2086f, 17.4877f, 17.7505f, 18.0173f, 18.3215f, 
+        18.6146f, 18.9000f, 19.1820f, 19.4643f, 19.7500f, 20.0387f, 20.3249f, 20.6100f, 
+        20.8950f, 21.1805f, 21.4665f, 21.7526f, 22.0383f, 22.3238f, 22.6094f, 22.8952f, 
+        23.1810f, 23.4667f, 23.7524f, 24.0381f, 24.3238f, 24.6095f, 24.8952f, 25.1810f, 
+        25.4667f, 25.7524f, 26.0381f, 26.3238f, 26.6095f, 26.8952f, 27.1810f, 27.4667f, 
+        10.5778f, 11.3407f, 12.2309f, 13.2693f, 14.4809f, 15.8944f, 13.9657f, 14.5303f, 
+        15.0619f, 15.5338f, 15.9112f, 16.1495f, 6.0000f, 6.0000f, 6.0000f, 6.0000f, 
+        6.0000f, 
+      },
+    },
+    {
+      {
+        23.7524f, 23.4667f, 23.1810f, 22.8952f, 22.6094f, 22.3238f, 22.0383f, 21.7526f, 
+        21.4665f, 21.1805f, 20.8950f, 20.6100f, 20.3249f, 20.0387f, 19.7500f, 19.4643f, 
+        19.1820f, 18.9000f, 18.6146f, 18.3215f, 18.0173f, 17.7505f, 17.4877f, 17.2086f, 
+        16.9019f, 16.5631f, 16.1921f, 16.1495f, 15.9112f, 15.5338f, 15.0619f, 14.5303f, 
+        13.9657f, 15.8944f, 14.4809f, 13.2693f, 12.2309f, 11.3407f, 10.5778f, 27.4667f, 
+        27.1810f, 26.8952f, 26.6095f, 26.3238f, 26.0381f, 25.7524f, 25.4667f, 25.1810f, 
+        24.8952f, 24.6095f, 24.3238f, 24.0381f, 6.0000f, 6.0000f, 6.0000f, 6.0000f, 
+        6.0000f, 
+      },
+      {
+        23.7524f, 23.4667f, 23.1810f, 22.8952f, 22.6094f, 22.3238f, 22.0383f, 21.7526f, 
+        21.4665f, 21.1805f, 20.8950f, 20.6100f, 20.3249f, 20.0387f, 19.7500f, 19.4643f, 
+        19.1820f, 18.9000f, 18.6146f, 18.3215f, 18.0173f, 17.7505f, 17.4877f, 17.2086f, 
+        16.9019f, 16.5631f, 16.1921f, 16.1495f, 15.9112f, 15.5338f, 15.0619f, 14.5303f, 
+        13.9657f, 15.8944f, 14.4809f, 13.2693f, 12.2309f, 11.3407f, 10.5778f, 27.4667f, 
+        27.1810f, 26.8952f, 26.6095f, 26.3238f, 26.0381f, 25.7524f, 25.4667f, 25.1810f, 
+        24.8952f, 24.6095f, 24.3238f, 24.0381f, 6.0000f, 6.0000f, 6.0000f, 6.0000f, 
+        6.0000f, 
+      },
+    },
+  },
+};
+
+#endif
@@ -1,7 +1,554 @@
 #include "game.h"
+#include "tuner.h"
+#include "endgame.h"
+#include "selfplay.h"
+#include "policy.h"
+#include "scheduler.h"
+#include "agent.h"
+#include "server.h"
+#include "render.h"
+#include "spectate.h"
+#include "replay.h"
+#include "query.h"
+#include "export.h"
+#include "steal.h"
+#include "shard.h"
+#include "compare.h"
+#include <string.h>
+#include <strings.h>
 
-int main()
+static bool parseColor(char *colorName, enum Color *color)
 {
+  for (int colorIndex = 0; colorIndex < PLAYER_NO; colorIndex++)
+  {
+    if (strcasecmp(colorName, getName(colorIndex)) == 0)
+    {
+      *color = colorIndex;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Play games with the moves of the color chosen by an
+// external agent and show the ranks. One worker, so the
+// agent answers the batches in order
+static void playAgentGames(enum Color color, uint64_t firstSeed, int gameCount, int batchSize, struct BatchEvaluator *evaluator)
+{
+  int weights[PLAYER_NO][WEIGHT_NO];
+  struct GameResult *results = calloc(gameCount > 0 ? gameCount : 1, sizeof(struct GameResult));
+
+  if (results == NULL)
+  {
+    printf("Error: Memory allocation failed\n");
+    exit(1);
+  }
+
+  loadPieceWeights(WEIGHTS_CONFIG_FILE, weights);
+  runScheduledGames(firstSeed, gameCount, weights, 1 << color, evaluator, batchSize, 1, results);
+  displayColorRanks(results, gameCount);
+
+  free(results);
+}
+
+static void displayUsage(char *program)
+{
+  printf("Usage:\n");
+  printf("  %s                         play a single game\n", program);
+  printf("  %s --tune <color> [generations] [population] [games] [threads]\n", program);
+  printf("      tune the piece importance weights of a color and write them to %s\n", WEIGHTS_CONFIG_FILE);
+  printf("  %s --endgame [file]\n", program);
+  printf("      solve the home straight endgames and write the table to %s\n", ENDGAME_TABLE_FILE);
+  printf("  %s --policy <color> [file]\n", program);
+  printf("      play a single game with the moves of a color chosen by the MLP policy in %s\n", POLICY_FILE);
+  printf("  %s --evaluate <color> [file] [games] [batch] [threads] [first seed]\n", program);
+  printf("      play games with the moves of a color chosen by the MLP policy in batches and show the ranks\n");
+  printf("  %s --policy-init [file] [hidden1] [hidden2] [seed]\n", program);
+  printf("      write an untrained MLP policy with the given hidden layer widths to %s\n", POLICY_FILE);
+  printf("  %s --selfplay [file] [games] [capacity] [threads] [first seed]\n", program);
+  printf("      play games with the color behaviors and stream their moves to the ring file %s\n", SAMPLE_RING_FILE);
+  printf("  %s --pipe <color> <command> [games] [batch] [timeout ms] [first seed]\n", program);
+  printf("      play games with the moves of a color chosen by an agent process speaking the line protocol\n");
+  printf("  %s --shm <color> <command> [games] [batch] [timeout ms] [first seed]\n", program);
+  printf("      same as --pipe with the requests and answers in shared memory rings\n");
+  printf("  %s --agent\n", program);
+  printf("      run the reference agent on stdin and stdout\n");
+  printf("  %s --shm-agent\n", program);
+  printf("      run the reference agent on the shared memory named in %s\n", SHM_AGENT_ENVIRONMENT);
+  printf("  %s --watch [seed] [delay ms]\n", program);
+  printf("      draw a game on the terminal, updating only the cells that change\n");
+  printf("  %s --broadcast [games] [threads] [ring] [first seed]\n", program);
+  printf("      play games while publishing their changes to the shared memory ring %s\n", SPECTATOR_RING_NAME);
+  printf("  %s --spectate [game] [ring] [delay us]\n", program);
+  printf("      print the changes published to a spectator ring, of one game or all (-1)\n");
+  printf("  %s --record [file] [games] [keyframe rounds] [threads] [first seed]\n", program);
+  printf("      play games and record them to the replay file %s with a keyframe every %d rounds\n", REPLAY_FILE, REPLAY_KEYFRAME_INTERVAL);
+  printf("  %s --replay [file] [game] [round]\n", program);
+  printf("      show the games of a replay file, or seek to a round of a game and show its position\n");
+  printf("  %s --query <file or directory> <event> [filters] [then <event> [filters]] [threads=n] [limit=n]\n", program);
+  printf("      find throws of recorded games, events are move, capture, teleport and split,\n");
+  printf("      filters color=<color> (of the player of the throw), cell=<cell or name> and block\n");
+  printf("  %s --export [directory] [games] [threads] [first seed]\n", program);
+  printf("      play games and write a row per throw to column files in %s\n", EXPORT_DIRECTORY);
+  printf("  %s --steal-bench [games] [threads] [first seed]\n", program);
+  printf("      play the same games with static chunks and with work stealing and compare their tails\n");
+  printf("  %s --pin-bench [games] [threads] [first seed]\n", program);
+  printf("      play the same games with workers unpinned and pinned to the NUMA nodes of %s\n", TOPOLOGY_NODE_DIRECTORY);
+  printf("  %s --shard <i/N> [games] [first seed] [file] [threads] [records]\n", program);
+  printf("      play shard i of N of the games and write their ranks, and a record per game with records, to %s\n", SHARD_FILE_FORMAT);
+  printf("  %s --merge <output> <shard files...>\n", program);
+  printf("      combine the shard files of a run into the file of a single process run (shard 0/1)\n");
+  printf("  %s --compare <color> <weights file> <weights file> [difference] [batch] [max games] [threads] [first seed]\n", program);
+  printf("      play both weights of a color on the same seeds in batches until a sequential test decides,\n");
+  printf("      a file can be %s for the built-in weights; exits %d when negligible, %d when the first\n", COMPARE_DEFAULT_WEIGHTS, COMPARE_EXIT_NEGLIGIBLE, COMPARE_EXIT_FIRST_BETTER);
+  printf("      is better, %d when the second is, %d when undecided and %d on errors\n", COMPARE_EXIT_SECOND_BETTER, COMPARE_EXIT_UNDECIDED, COMPARE_EXIT_FAILED);
+  printf("  %s --serve [socket] [sessions]\n", program);
+  printf("      serve games to clients on the Unix socket %s until interrupted\n", SERVER_SOCKET_FILE);
+  printf("  %s --client [socket] [sessions] [games]\n", program);
+  printf("      play games on a server with stand-in clients and show the turn latency\n");
+  printf("  %s --check-undo [games] [first seed]\n", program);
+  printf("      make and unmake every legal move of every decision of games and check the positions come back\n");
+  printf("  %s --fingerprint [games] [first seed] [threads]\n", program);
+  printf("      play games with the built-in weights and print a hash of their rounds and ranks\n");
+  printf("  %s --pinned <--tune, --compare, --shard or --fingerprint and its arguments>\n", program);
+  printf("      run the game batches of the command with workers pinned to the NUMA nodes of %s\n", TOPOLOGY_NODE_DIRECTORY);
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc == 1)
+  {
     playGame();
     return 0;
-}
\ No newline at end of file
+  }
+
+  // the game batches of the command run on pinned workers
+  if (strcmp(argv[1], "--pinned") == 0 && argc >= 3)
+  {
+    usePinnedGameBatches(true);
+    argv[1] = argv[0];
+    argv++;
+    argc--;
+  }
+
+  if (strcmp(argv[1], "--tune") == 0 && argc >= 3)
+  {
+    struct TunerOptions options = getDefaultTunerOptions();
+
+    if (!parseColor(argv[2], &options.color))
+    {
+      displayUsage(argv[0]);
+      return 1;
+    }
+
+    if (argc > 3) options.generations = atoi(argv[3]);
+    if (argc > 4) options.populationSize = atoi(argv[4]);
+    if (argc > 5) options.gamesPerCandidate = atoi(argv[5]);
+    if (argc > 6) options.threadCount = atoi(argv[6]);
+
+    // the sizes of the population and result arrays
+    if (options.generations < 1 || options.populationSize < 1 || options.gamesPerCandidate < 1)
+    {
+      printf("Error: The generations, population and games must be at least 1\n");
+      return 1;
+    }
+
+    tunePieceWeights(&options);
+    return 0;
+  }
+
+  if (strcmp(argv[1], "--endgame") == 0)
+  {
+    return generateEndgameTable(argc > 2 ? argv[2] : ENDGAME_TABLE_FILE) ? 0 : 1;
+  }
+
+  if (strcmp(argv[1], "--policy") == 0 && argc >= 3)
+  {
+    enum Color color;
+    if (!parseColor(argv[2], &color))
+    {
+      displayUsage(argv[0]);
+      return 1;
+    }
+
+    struct MlpPolicy *policy = loadMlpPolicy(argc > 3 ? argv[3] : POLICY_FILE);
+    if (policy == NULL)
+    {
+      printf("Error: Could not load the policy\n");
+      return 1;
+    }
+
+    useMlpPolicy(color, policy);
+    playGame();
+    useMlpPolicy(color, NULL);
+    freeMlpPolicy(policy);
+    return 0;
+  }
+
+  if (strcmp(argv[1], "--evaluate") == 0 && argc >= 3)
+  {
+    enum Color color;
+    if (!parseColor(argv[2], &color))
+    {
+      displayUsage(argv[0]);
+      return 1;
+    }
+
+    struct MlpPolicy *policy = loadMlpPolicy(argc > 3 ? argv[3] : POLICY_FILE);
+    if (policy == NULL)
+    {
+      printf("Error: Could not load the policy\n");
+      return 1;
+    }
+
+    int gameCount = argc > 4 ? atoi(argv[4]) : 1000;
+    int batchSize = argc > 5 ? atoi(argv[5]) : 256;
+    int threadCount = argc > 6 ? atoi(argv[6]) : getDefaultThreadCount();
+    uint64_t firstSeed = argc > 7 ? strtoull(argv[7], NULL, 10) : DEFAULT_FIRST_SEED;
+    int weights[PLAYER_NO][WEIGHT_NO];
+    struct BatchEvaluator evaluator = {evaluateMlpDecisions, policy};
+    struct GameResult *results = calloc(gameCount > 0 ? gameCount : 1, sizeof(struct GameResult));
+
+    if (results == NULL)
+    {
+      printf("Error: Memory allocation failed\n");
+      return 1;
+    }
+
+    loadPieceWeights(WEIGHTS_CONFIG_FILE, weights);
+    runScheduledGames(firstSeed, gameCount, weights, 1 << color, &evaluator, batchSize, threadCount, results);
+    displayColorRanks(results, gameCount);
+
+    free(results);
+    freeMlpPolicy(policy);
+    return 0;
+  }
+
+  if (strcmp(argv[1], "--policy-init") == 0)
+  {
+    char *fileName = argc > 2 ? argv[2] : POLICY_FILE;
+    int hidden1No = argc > 3 ? atoi(argv[3]) : 64;
+    int hidden2No = argc > 4 ? atoi(argv[4]) : 32;
+    uint64_t seed = argc > 5 ? strtoull(argv[5], NULL, 10) : 1;
+
+    if (hidden1No < 1 || hidden1No > POLICY_MAX_HIDDEN || hidden2No < 1 || hidden2No > POLICY_MAX_HIDDEN)
+    {
+      printf("Error: The hidden layer widths must be between 1 and %d\n", POLICY_MAX_HIDDEN);
+      return 1;
+    }
+
+    struct MlpPolicy *policy = createMlpPolicy(hidden1No, hidden2No, seed);
+    bool saved = saveMlpPolicy(policy, fileName);
+
+    if (!saved)
+    {
+      printf("Error: Could not write %s\n", fileName);
+    }
+
+    freeMlpPolicy(policy);
+    return saved ? 0 : 1;
+  }
+
+  if (strcmp(argv[1], "--selfplay") == 0)
+  {
+    char *fileName = argc > 2 ? argv[2] : SAMPLE_RING_FILE;
+    int gameCount = argc > 3 ? atoi(argv[3]) : 1000;
+    uint64_t capacity = argc > 4 ? strtoull(argv[4], NULL, 10) : SAMPLE_RING_CAPACITY;
+    int threadCount = argc > 5 ? atoi(argv[5]) : 0;
+    uint64_t firstSeed = argc > 6 ? strtoull(argv[6], NULL, 10) : DEFAULT_FIRST_SEED;
+
+    generateSelfPlaySamples(fileName, firstSeed, gameCount, capacity, threadCount);
+    return 0;
+  }
+
+  if ((strcmp(argv[1], "--pipe") == 0 || strcmp(argv[1], "--shm") == 0) && argc >= 4)
+  {
+    enum Color color;
+    if (!parseColor(argv[2], &color))
+    {
+      displayUsage(argv[0]);
+      return 1;
+    }
+
+    int gameCount = argc > 4 ? atoi(argv[4]) : 1000;
+    int batchSize = argc > 5 ? atoi(argv[5]) : 256;
+    int timeoutMs = argc > 6 ? atoi(argv[6]) : AGENT_TIMEOUT_MS;
+    uint64_t firstSeed = argc > 7 ? strtoull(argv[7], NULL, 10) : DEFAULT_FIRST_SEED;
+
+    if (strcmp(argv[1], "--pipe") == 0)
+    {
+      struct PipeAgent *agent = malloc(sizeof(struct PipeAgent));
+      if (agent == NULL || !startPipeAgent(agent, argv[3], timeoutMs))
+      {
+        return 1;
+      }
+
+      struct BatchEvaluator evaluator = {evaluatePipeAgentDecisions, agent};
+      playAgentGames(color, firstSeed, gameCount, batchSize, &evaluator);
+      printf("Agent decisions: %ld, timed out batches: %ld\n", agent->decisionCount, agent->timeoutCount);
+
+      stopPipeAgent(agent);
+      free(agent);
+    }
+    else
+    {
+      struct ShmAgent agent;
+      if (!startShmAgent(&agent, argv[3], timeoutMs))
+      {
+        return 1;
+      }
+
+      struct BatchEvaluator evaluator = {evaluateShmAgentDecisions, &agent};
+      playAgentGames(color, firstSeed, gameCount, batchSize, &evaluator);
+      printf("Agent decisions: %ld, timed out batches: %ld\n", agent.decisionCount, agent.timeoutCount);
+
+      stopShmAgent(&agent);
+    }
+
+    return 0;
+  }
+
+  if (strcmp(argv[1], "--agent") == 0)
+  {
+    runReferenceAgent();
+    return 0;
+  }
+
+  if (strcmp(argv[1], "--shm-agent") == 0)
+  {
+    runShmReferenceAgent();
+    return 0;
+  }
+
+  if (strcmp(argv[1], "--watch") == 0)
+  {
+    uint64_t seed = argc > 2 ? strtoull(argv[2], NULL, 10) : (uint64_t)time(NULL);
+    int delayMs = argc > 3 ? atoi(argv[3]) : 50;
+
+    watchGame(seed, delayMs);
+    return 0;
+  }
+
+  if (strcmp(argv[1], "--broadcast") == 0)
+  {
+    int gameCount = argc > 2 ? atoi(argv[2]) : 1000;
+    int threadCount = argc > 3 ? atoi(argv[3]) : 0;
+    char *name = argc > 4 ? argv[4] : SPECTATOR_RING_NAME;
+    uint64_t firstSeed = argc > 5 ? strtoull(argv[5], NULL, 10) : DEFAULT_FIRST_SEED;
+
+    runBroadcastGames(name, firstSeed, gameCount, threadCount);
+    return 0;
+  }
+
+  if (strcmp(argv[1], "--spectate") == 0)
+  {
+    long gameId = argc > 2 ? atol(argv[2]) : -1;
+    char *name = argc > 3 ? argv[3] : SPECTATOR_RING_NAME;
+    int delayUs = argc > 4 ? atoi(argv[4]) : 0;
+
+    runSpectator(name, gameId, delayUs);
+    return 0;
+  }
+
+  if (strcmp(argv[1], "--record") == 0)
+  {
+    char *fileName = argc > 2 ? argv[2] : REPLAY_FILE;
+    int gameCount = argc > 3 ? atoi(argv[3]) : 1000;
+    int keyframeInterval = argc > 4 ? atoi(argv[4]) : REPLAY_KEYFRAME_INTERVAL;
+    int threadCount = argc > 5 ? atoi(argv[5]) : 0;
+    uint64_t firstSeed = argc > 6 ? strtoull(argv[6], NULL, 10) : DEFAULT_FIRST_SEED;
+
+    return recordReplayGames(fileName, firstSeed, gameCount, keyframeInterval, threadCount) ? 0 : 1;
+  }
+
+  if (strcmp(argv[1], "--replay") == 0)
+  {
+    char *fileName = argc > 2 ? argv[2] : REPLAY_FILE;
+    int gameIndex = argc > 3 ? atoi(argv[3]) : -1;
+    int round = argc > 4 ? atoi(argv[4]) : 1;
+
+    return showReplay(fileName, gameIndex, round) ? 0 : 1;
+  }
+
+  if (strcmp(argv[1], "--query") == 0 && argc >= 4)
+  {
+    struct Query query;
+
+    if (!parseQuery(argc - 3, argv + 3, &query))
+    {
+      return 1;
+    }
+
+    return runReplayQuery(argv[2], &query) ? 0 : 1;
+  }
+
+  if (strcmp(argv[1], "--export") == 0)
+  {
+    char *directory = argc > 2 ? argv[2] : EXPORT_DIRECTORY;
+    int gameCount = argc > 3 ? atoi(argv[3]) : 1000;
+    int threadCount = argc > 4 ? atoi(argv[4]) : 0;
+    uint64_t firstSeed = argc > 5 ? strtoull(argv[5], NULL, 10) : DEFAULT_FIRST_SEED;
+
+    return exportTurnColumns(directory, firstSeed, gameCount, threadCount) ? 0 : 1;
+  }
+
+  if (strcmp(argv[1], "--steal-bench") == 0)
+  {
+    int gameCount = argc > 2 ? atoi(argv[2]) : 2000;
+    int threadCount = argc > 3 ? atoi(argv[3]) : 0;
+    uint64_t firstSeed = argc > 4 ? strtoull(argv[4], NULL, 10) : DEFAULT_FIRST_SEED;
+
+    benchmarkGameScheduling(firstSeed, gameCount, threadCount);
+    return 0;
+  }
+
+  if (strcmp(argv[1], "--pin-bench") == 0)
+  {
+    int gameCount = argc > 2 ? atoi(argv[2]) : 2000;
+    int threadCount = argc > 3 ? atoi(argv[3]) : 0;
+    uint64_t firstSeed = argc > 4 ? strtoull(argv[4], NULL, 10) : DEFAULT_FIRST_SEED;
+
+    benchmarkWorkerPinning(firstSeed, gameCount, threadCount);
+    return 0;
+  }
+
+  if (strcmp(argv[1], "--shard") == 0 && argc >= 3)
+  {
+    int shardIndex;
+    int shardCount;
+    char defaultName[64];
+
+    if (!parseShardSpec(argv[2], &shardIndex, &shardCount))
+    {
+      printf("Error: The shard must be i/N with 0 <= i < N\n");
+      return 1;
+    }
+
+    // records may come anywhere after the shard
+    bool withRecords = false;
+    int positionalCount = 0;
+    char *positionals[4] = {NULL};
+    for (int argIndex = 3; argIndex < argc; argIndex++)
+    {
+      if (strcmp(argv[argIndex], "records") == 0)
+      {
+        withRecords = true;
+      }
+      else if (positionalCount < 4)
+      {
+        positionals[positionalCount++] = argv[argIndex];
+      }
+    }
+
+    snprintf(defaultName, sizeof(defaultName), SHARD_FILE_FORMAT, shardIndex, shardCount);
+    int gameCount = positionals[0] != NULL ? atoi(positionals[0]) : 1000;
+    uint64_t firstSeed = positionals[1] != NULL ? strtoull(positionals[1], NULL, 10) : DEFAULT_FIRST_SEED;
+    char *fileName = positionals[2] != NULL ? positionals[2] : defaultName;
+    int threadCount = positionals[3] != NULL ? atoi(positionals[3]) : 0;
+
+    return runShard(fileName, shardIndex, shardCount, gameCount, firstSeed, withRecords, threadCount) ? 0 : 1;
+  }
+
+  if (strcmp(argv[1], "--merge") == 0 && argc >= 4)
+  {
+    return mergeShardFiles(argv[2], argc - 3, argv + 3) ? 0 : 1;
+  }
+
+  if (strcmp(argv[1], "--compare") == 0 && argc >= 5)
+  {
+    struct CompareOptions options = getDefaultCompareOptions();
+
+    if (!parseColor(argv[2], &options.color))
+    {
+      displayUsage(argv[0]);
+      return 1;
+    }
+
+    options.firstFile = argv[3];
+    options.secondFile = argv[4];
+    if (argc > 5) options.minDifference = atof(argv[5]);
+    if (argc > 6) options.batchSize = atoi(argv[6]);
+    if (argc > 7) options.maxGames = atoi(argv[7]);
+    if (argc > 8) options.threadCount = atoi(argv[8]);
+    if (argc > 9) options.seed = strtoull(argv[9], NULL, 10);
+
+    return getCompareExitCode(compareWeightFiles(&options));
+  }
+
+  if (strcmp(argv[1], "--serve") == 0)
+  {
+    char *socketPath = argc > 2 ? argv[2] : SERVER_SOCKET_FILE;
+    int maxSessions = argc > 3 ? atoi(argv[3]) : SERVER_MAX_SESSIONS;
+
+    return runGameServer(socketPath, maxSessions) ? 0 : 1;
+  }
+
+  if (strcmp(argv[1], "--client") == 0)
+  {
+    char *socketPath = argc > 2 ? argv[2] : SERVER_SOCKET_FILE;
+    int sessionCount = argc > 3 ? atoi(argv[3]) : 1;
+    int gameCount = argc > 4 ? atoi(argv[4]) : 1;
+
+    return runStandInClients(socketPath, sessionCount, gameCount) ? 0 : 1;
+  }
+
+  if (strcmp(argv[1], "--check-undo") == 0)
+  {
+    int gameCount = argc > 2 ? atoi(argv[2]) : 100;
+    uint64_t firstSeed = argc > 3 ? strtoull(argv[3], NULL, 10) : 0;
+
+    return checkUndoGames(firstSeed, gameCount) == 0 ? 0 : 1;
+  }
+
+  if (strcmp(argv[1], "--fingerprint") == 0)
+  {
+    int gameCount = argc > 2 ? atoi(argv[2]) : 1000;
+    uint64_t firstSeed = argc > 3 ? strtoull(argv[3], NULL, 10) : 0;
+    int threadCount = argc > 4 ? atoi(argv[4]) : getDefaultThreadCount();
+    int weights[PLAYER_NO][WEIGHT_NO];
+    long roundCount = 0;
+
+    if (gameCount < 1)
+    {
+      printf("Error: No games to play\n");
+      return 1;
+    }
+
+    struct GameResult *results = malloc(gameCount * sizeof(struct GameResult));
+    if (results == NULL)
+    {
+      printf("Error: Memory allocation failed\n");
+      exit(1);
+    }
+
+    for (int color = 0; color < PLAYER_NO; color++)
+    {
+      setDefaultPieceWeights(color, weights[color]);
+    }
+
+    if (!runStealingGameBatch(firstSeed, gameCount, weights, threadCount, results))
+    {
+      printf("Error: The games were not all played\n");
+      free(results);
+      return 1;
+    }
+
+    for (int gameIndex = 0; gameIndex < gameCount; gameIndex++)
+    {
+      roundCount += results[gameIndex].rounds;
+    }
+
+    printf("Fingerprint of %d games from seed %llu: %016llx, %.1f rounds per game\n",
+      gameCount,
+      (unsigned long long)firstSeed,
+      (unsigned long long)getResultsFingerprint(results, gameCount),
+      (double)roundCount / gameCount
+    );
+    free(results);
+    return 0;
+  }
+
+  displayUsage(argv[0]);
+  return 1;
+}
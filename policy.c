@@ -0,0 +1,487 @@
+#include "policy.h"
+#include "game.h"
+#include <string.h>
+#include <math.h>
+#include <immintrin.h>
+
+#define POLICY_ROUNDS_SCALE 4.0f
+
+static struct MovePolicy mlpMovePolicies[PLAYER_NO];
+
+/* Features */
+
+static float getRelativeCell(int cellNo, enum Color color)
+{
+  return (float)((cellNo - getStartIndex(color) + MAX_STANDARD_CELL) % MAX_STANDARD_CELL) / (MAX_STANDARD_CELL - 1);
+}
+
+static void writePieceFeatures(struct Piece *piece, struct Board *board, enum Color color, float *features)
+{
+  bool onTrack = cellNoIndexable(piece->cellNo);
+  bool inHomeStraight = piece->cellNo >= MAX_STANDARD_CELL && piece->cellNo < HOME;
+  struct MysteryEffects *effect = &piece->effect;
+
+  features[0] = piece->cellNo == BASE;
+  features[1] = piece->cellNo == HOME;
+  features[2] = onTrack;
+  features[3] = onTrack ? getRelativeCell(piece->cellNo, color) : 0.0f;
+  features[4] = inHomeStraight ? (float)(piece->cellNo - MAX_STANDARD_CELL + 1) / HOME_STRAIGHT_DISTANCE : 0.0f;
+  features[5] = piece->clockWise;
+  features[6] = onTrack && isBlockade(&board->cells[piece->cellNo]);
+  features[7] = piece->captured > 0;
+  features[8] = effect->effectActive;
+  features[9] = effect->effectActive && !effect->pieceActive;
+  features[10] = effect->effectActive ? (float)effect->diceMultiplier / effect->diceDivider : 0.0f;
+  features[11] = effect->effectActive ? effect->effectActiveRounds / POLICY_ROUNDS_SCALE : 0.0f;
+}
+
+// Board features from the view of the player to move.
+// Pieces are written for each player in turn order from the
+// mover, cells are relative to the start of the mover, and
+// the dice one-hot is left empty for a dice number of 0
+void writePolicyFeatures
+(
+  struct Player *players, int playerIndex, int diceNumber,
+  struct Board *board, int mysteryCellNo, float *features
+)
+{
+  enum Color color = players[playerIndex].color;
+
+  for (int offset = 0; offset < PLAYER_NO; offset++)
+  {
+    struct Player *player = &players[(playerIndex + offset) % PLAYER_NO];
+    for (int pieceIndex = 0; pieceIndex < PIECE_NO; pieceIndex++)
+    {
+      writePieceFeatures(&player->pieces[pieceIndex], board, color, features);
+      features += POLICY_PIECE_FEATURE_NO;
+    }
+  }
+
+  features[0] = mysteryCellNo != EMPTY;
+  features[1] = mysteryCellNo != EMPTY ? getRelativeCell(mysteryCellNo, color) : 0.0f;
+
+  memset(&features[2], 0, MAX_DICE_VALUE * sizeof(float));
+  if (diceNumber > 0)
+  {
+    features[2 + diceNumber - 1] = 1.0f;
+  }
+}
+
+/* Weight file */
+
+static void allocatePolicyLayer(struct PolicyLayer *layer, int inputNo, int outputNo)
+{
+  layer->inputNo = inputNo;
+  layer->outputNo = outputNo;
+  layer->paddedOutputNo = (outputNo + POLICY_LANE_NO - 1) / POLICY_LANE_NO * POLICY_LANE_NO;
+
+  size_t rowSize = layer->paddedOutputNo * sizeof(float);
+  layer->weights = aligned_alloc(32, inputNo * rowSize);
+  layer->biases = aligned_alloc(32, rowSize);
+  if (layer->weights == NULL || layer->biases == NULL)
+  {
+    printf("Error: Memory allocation failed\n");
+    exit(1);
+  }
+
+  // padding lanes stay zero so they never change a score
+  memset(layer->weights, 0, inputNo * rowSize);
+  memset(layer->biases, 0, rowSize);
+}
+
+static bool loadPolicyLayer(FILE *file, struct PolicyLayer *layer, int inputNo, int outputNo)
+{
+  allocatePolicyLayer(layer, inputNo, outputNo);
+
+  for (int input = 0; input < inputNo; input++)
+  {
+    if (fread(&layer->weights[input * layer->paddedOutputNo], sizeof(float), outputNo, file) != (size_t)outputNo)
+    {
+      return false;
+    }
+  }
+
+  return fread(layer->biases, sizeof(float), outputNo, file) == (size_t)outputNo;
+}
+
+static bool savePolicyLayer(FILE *file, struct PolicyLayer *layer)
+{
+  for (int input = 0; input < layer->inputNo; input++)
+  {
+    if (fwrite(&layer->weights[input * layer->paddedOutputNo], sizeof(float), layer->outputNo, file) != (size_t)layer->outputNo)
+    {
+      return false;
+    }
+  }
+
+  return fwrite(layer->biases, sizeof(float), layer->outputNo, file) == (size_t)layer->outputNo;
+}
+
+// Reads the format described above struct PolicyFileHeader,
+// as written by saveMlpPolicy. Returns NULL if the file is
+// missing or does not match the feature and action counts of
+// this build
+struct MlpPolicy *loadMlpPolicy(char *fileName)
+{
+  FILE *file = fopen(fileName, "rb");
+  if (file == NULL)
+  {
+    return NULL;
+  }
+
+  struct PolicyFileHeader header;
+  bool valid = fread(&header, sizeof(header), 1, file) == 1
+    && header.magic == POLICY_MAGIC
+    && header.inputNo == POLICY_FEATURE_NO
+    && header.outputNo == POLICY_ACTION_NO
+    && header.hidden1No > 0 && header.hidden1No <= POLICY_MAX_HIDDEN
+    && header.hidden2No > 0 && header.hidden2No <= POLICY_MAX_HIDDEN;
+
+  if (!valid)
+  {
+    printf("Error: %s is not a policy for %d features and %d actions\n", fileName, POLICY_FEATURE_NO, POLICY_ACTION_NO);
+    fclose(file);
+    return NULL;
+  }
+
+  struct MlpPolicy *policy = calloc(1, sizeof(struct MlpPolicy));
+  if (policy == NULL)
+  {
+    printf("Error: Memory allocation failed\n");
+    exit(1);
+  }
+
+  valid = loadPolicyLayer(file, &policy->layers[0], header.inputNo, header.hidden1No)
+    && loadPolicyLayer(file, &policy->layers[1], header.hidden1No, header.hidden2No)
+    && loadPolicyLayer(file, &policy->layers[2], header.hidden2No, header.outputNo);
+  fclose(file);
+
+  if (!valid)
+  {
+    printf("Error: %s is truncated\n", fileName);
+    freeMlpPolicy(policy);
+    return NULL;
+  }
+
+  __builtin_cpu_init();
+  policy->useAvx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+
+  return policy;
+}
+
+// Untrained policy with uniform He initialized weights and
+// zero biases, the starting point of a trainer that reads
+// and writes the policy file
+struct MlpPolicy *createMlpPolicy(int hidden1No, int hidden2No, uint64_t seed)
+{
+  int sizes[4] = {POLICY_FEATURE_NO, hidden1No, hidden2No, POLICY_ACTION_NO};
+  struct MlpPolicy *policy = calloc(1, sizeof(struct MlpPolicy));
+
+  if (policy == NULL)
+  {
+    printf("Error: Memory allocation failed\n");
+    exit(1);
+  }
+
+  seedGameRandom(seed);
+
+  for (int layerIndex = 0; layerIndex < 3; layerIndex++)
+  {
+    struct PolicyLayer *layer = &policy->layers[layerIndex];
+    float limit = sqrtf(6.0f / sizes[layerIndex]);
+
+    allocatePolicyLayer(layer, sizes[layerIndex], sizes[layerIndex + 1]);
+
+    for (int input = 0; input < layer->inputNo; input++)
+    {
+      for (int output = 0; output < layer->outputNo; output++)
+      {
+        float unit = (float)gameRandom() / (1U << 31);
+        layer->weights[input * layer->paddedOutputNo + output] = (2.0f * unit - 1.0f) * limit;
+      }
+    }
+  }
+
+  __builtin_cpu_init();
+  policy->useAvx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+
+  return policy;
+}
+
+bool saveMlpPolicy(struct MlpPolicy *policy, char *fileName)
+{
+  FILE *file = fopen(fileName, "wb");
+  if (file == NULL)
+  {
+    return false;
+  }
+
+  struct PolicyFileHeader header = {
+    POLICY_MAGIC,
+    policy->layers[0].inputNo,
+    policy->layers[0].outputNo,
+    policy->layers[1].outputNo,
+    policy->layers[2].outputNo
+  };
+
+  bool written = fwrite(&header, sizeof(header), 1, file) == 1
+    && savePolicyLayer(file, &policy->layers[0])
+    && savePolicyLayer(file, &policy->layers[1])
+    && savePolicyLayer(file, &policy->layers[2]);
+
+  return fclose(file) == 0 && written;
+}
+
+void freeMlpPolicy(struct MlpPolicy *policy)
+{
+  if (policy == NULL)
+  {
+    return;
+  }
+
+  for (int layerIndex = 0; layerIndex < 3; layerIndex++)
+  {
+    free(policy->layers[layerIndex].weights);
+    free(policy->layers[layerIndex].biases);
+  }
+
+  free(policy);
+}
+
+/* Inference */
+
+// Most features are zero (pieces in base, no effects), so
+// only the weight rows of nonzero inputs are accumulated
+static int getNonzeroInputs(const float *input, int inputNo, int *indexes, float *values)
+{
+  int count = 0;
+
+  for (int index = 0; index < inputNo; index++)
+  {
+    // branchless, the zero pattern is not predictable
+    indexes[count] = index;
+    values[count] = input[index];
+    count += input[index] != 0.0f;
+  }
+
+  return count;
+}
+
+static void forwardLayerScalar(struct PolicyLayer *layer, const float *input, float *output, bool relu)
+{
+  int indexes[POLICY_FEATURE_NO > POLICY_MAX_HIDDEN ? POLICY_FEATURE_NO : POLICY_MAX_HIDDEN];
+  float values[POLICY_FEATURE_NO > POLICY_MAX_HIDDEN ? POLICY_FEATURE_NO : POLICY_MAX_HIDDEN];
+  int count = getNonzeroInputs(input, layer->inputNo, indexes, values);
+  int width = layer->paddedOutputNo;
+
+  memcpy(output, layer->biases, width * sizeof(float));
+
+  for (int nonzero = 0; nonzero < count; nonzero++)
+  {
+    const float *row = &layer->weights[indexes[nonzero] * width];
+    for (int outputIndex = 0; outputIndex < width; outputIndex++)
+    {
+      output[outputIndex] += values[nonzero] * row[outputIndex];
+    }
+  }
+
+  for (int outputIndex = 0; relu && outputIndex < width; outputIndex++)
+  {
+    output[outputIndex] = output[outputIndex] > 0.0f ? output[outputIndex] : 0.0f;
+  }
+}
+
+// Same as getNonzeroInputs, eight inputs per compare
+__attribute__((target("avx2,fma")))
+static int getNonzeroInputsAvx2(const float *input, int inputNo, int *indexes, float *values)
+{
+  int count = 0;
+  int index = 0;
+
+  for (; index + POLICY_LANE_NO <= inputNo; index += POLICY_LANE_NO)
+  {
+    __m256 lanes = _mm256_loadu_ps(&input[index]);
+    unsigned mask = _mm256_movemask_ps(_mm256_cmp_ps(lanes, _mm256_setzero_ps(), _CMP_NEQ_UQ));
+
+    while (mask != 0)
+    {
+      int lane = __builtin_ctz(mask);
+      indexes[count] = index + lane;
+      values[count] = input[index + lane];
+      count++;
+      mask &= mask - 1;
+    }
+  }
+
+  for (; index < inputNo; index++)
+  {
+    indexes[count] = index;
+    values[count] = input[index];
+    count += input[index] != 0.0f;
+  }
+
+  return count;
+}
+
+// Outputs are processed 32 at a time in four registers, so
+// each nonzero input is broadcast once per block
+__attribute__((target("avx2,fma")))
+static void forwardLayerAvx2(struct PolicyLayer *layer, const float *input, float *output, bool relu)
+{
+  int indexes[POLICY_FEATURE_NO > POLICY_MAX_HIDDEN ? POLICY_FEATURE_NO : POLICY_MAX_HIDDEN];
+  float values[POLICY_FEATURE_NO > POLICY_MAX_HIDDEN ? POLICY_FEATURE_NO : POLICY_MAX_HIDDEN];
+  int count = getNonzeroInputsAvx2(input, layer->inputNo, indexes, values);
+  int width = layer->paddedOutputNo;
+  __m256 zero = _mm256_setzero_ps();
+
+  for (int block = 0; block < width; block += 4 * POLICY_LANE_NO)
+  {
+    int laneCount = (width - block) / POLICY_LANE_NO;
+    const float *biases = &layer->biases[block];
+
+    if (laneCount >= 4)
+    {
+      __m256 sum0 = _mm256_load_ps(biases);
+      __m256 sum1 = _mm256_load_ps(biases + 8);
+      __m256 sum2 = _mm256_load_ps(biases + 16);
+      __m256 sum3 = _mm256_load_ps(biases + 24);
+
+      for (int nonzero = 0; nonzero < count; nonzero++)
+      {
+        const float *row = &layer->weights[indexes[nonzero] * width + block];
+        __m256 value = _mm256_set1_ps(values[nonzero]);
+        sum0 = _mm256_fmadd_ps(value, _mm256_load_ps(row), sum0);
+        sum1 = _mm256_fmadd_ps(value, _mm256_load_ps(row + 8), sum1);
+        sum2 = _mm256_fmadd_ps(value, _mm256_load_ps(row + 16), sum2);
+        sum3 = _mm256_fmadd_ps(value, _mm256_load_ps(row + 24), sum3);
+      }
+
+      if (relu)
+      {
+        sum0 = _mm256_max_ps(sum0, zero);
+        sum1 = _mm256_max_ps(sum1, zero);
+        sum2 = _mm256_max_ps(sum2, zero);
+        sum3 = _mm256_max_ps(sum3, zero);
+      }
+
+      _mm256_storeu_ps(&output[block], sum0);
+      _mm256_storeu_ps(&output[block + 8], sum1);
+      _mm256_storeu_ps(&output[block + 16], sum2);
+      _mm256_storeu_ps(&output[block + 24], sum3);
+      continue;
+    }
+
+    for (int lane = 0; lane < laneCount; lane++)
+    {
+      int offset = block + lane * POLICY_LANE_NO;
+      __m256 sum = _mm256_load_ps(&layer->biases[offset]);
+
+      for (int nonzero = 0; nonzero < count; nonzero++)
+      {
+        __m256 value = _mm256_set1_ps(values[nonzero]);
+        sum = _mm256_fmadd_ps(value, _mm256_load_ps(&layer->weights[indexes[nonzero] * width + offset]), sum);
+      }
+
+      _mm256_storeu_ps(&output[offset], relu ? _mm256_max_ps(sum, zero) : sum);
+    }
+  }
+}
+
+// Score count feature rows. scores receives POLICY_ACTION_NO
+// values per row. Rows go through the layers one at a time:
+// a row only accumulates the weight rows of its own nonzero
+// inputs and the weights (60KB for 64 and 32 hidden units)
+// stay in cache. A product over groups of 4 rows has to
+// accumulate every input that is nonzero in any row of the
+// group and measured about 30% slower, so scoring a batch
+// costs the same per row as scoring rows one by one
+void evaluatePolicyBatch(struct MlpPolicy *policy, float *features, int count, float *scores)
+{
+  void (*forwardLayer)(struct PolicyLayer *, const float *, float *, bool) =
+    policy->useAvx2 ? forwardLayerAvx2 : forwardLayerScalar;
+  float hidden1[POLICY_MAX_HIDDEN];
+  float hidden2[POLICY_MAX_HIDDEN];
+  float output[POLICY_LANE_NO];
+
+  for (int row = 0; row < count; row++)
+  {
+    forwardLayer(&policy->layers[0], &features[row * POLICY_FEATURE_NO], hidden1, true);
+    forwardLayer(&policy->layers[1], hidden1, hidden2, true);
+    forwardLayer(&policy->layers[2], hidden2, output, false);
+
+    memcpy(&scores[row * POLICY_ACTION_NO], output, POLICY_ACTION_NO * sizeof(float));
+  }
+}
+
+// Legal action with the highest score, EMPTY if none
+int selectPolicyAction(float *scores, uint8_t legalMask)
+{
+  int selectedAction = EMPTY;
+
+  for (int action = 0; action < POLICY_ACTION_NO; action++)
+  {
+    if ((legalMask & (1 << action)) && (selectedAction == EMPTY || scores[action] > scores[selectedAction]))
+    {
+      selectedAction = action;
+    }
+  }
+
+  return selectedAction;
+}
+
+/* Engine hook */
+
+static int selectMlpMove
+(
+  void *context, struct Player *players, int playerIndex, int diceNumber,
+  struct Board *board, int mysteryCellNo, uint8_t legalMask
+)
+{
+  float features[POLICY_FEATURE_NO];
+  float scores[POLICY_ACTION_NO];
+
+  writePolicyFeatures(players, playerIndex, diceNumber, board, mysteryCellNo, features);
+  evaluatePolicyBatch(context, features, 1, scores);
+
+  return selectPolicyAction(scores, legalMask);
+}
+
+// Let the policy choose the moves of a color in place of
+// its behavior, NULL gives the color its behavior back
+void useMlpPolicy(enum Color color, struct MlpPolicy *policy)
+{
+  mlpMovePolicies[color].selectMove = selectMlpMove;
+  mlpMovePolicies[color].context = policy;
+
+  setMovePolicy(color, policy != NULL ? &mlpMovePolicies[color] : NULL);
+}
+
+// Batch evaluator for runScheduledGames, the context is
+// the MlpPolicy
+void evaluateMlpDecisions(void *context, struct DecisionRequest *requests, int count, int *actions)
+{
+  float features[POLICY_DECISION_TILE][POLICY_FEATURE_NO];
+  float scores[POLICY_DECISION_TILE][POLICY_ACTION_NO];
+
+  for (int first = 0; first < count; first += POLICY_DECISION_TILE)
+  {
+    int tileCount = count - first < POLICY_DECISION_TILE ? count - first : POLICY_DECISION_TILE;
+
+    for (int index = 0; index < tileCount; index++)
+    {
+      struct DecisionRequest *request = &requests[first + index];
+      writePolicyFeatures
+      (
+        request->players, request->playerIndex, request->diceNumber,
+        request->board, request->mysteryCellNo, features[index]
+      );
+    }
+
+    evaluatePolicyBatch(context, features[0], tileCount, scores[0]);
+
+    for (int index = 0; index < tileCount; index++)
+    {
+      actions[first + index] = selectPolicyAction(scores[index], requests[first + index].legalMask);
+    }
+  }
+}
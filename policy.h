@@ -0,0 +1,68 @@
+#ifndef POLICY_H
+#define POLICY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "types.h"
+
+#define POLICY_FILE "policy.bin"
+#define POLICY_MAGIC 0x31504C4DU // "MLP1"
+#define POLICY_PIECE_FEATURE_NO 12
+#define POLICY_GLOBAL_FEATURE_NO 8 // mystery cell (2) and dice one-hot (6)
+#define POLICY_FEATURE_NO (PLAYER_NO * PIECE_NO * POLICY_PIECE_FEATURE_NO + POLICY_GLOBAL_FEATURE_NO)
+#define POLICY_ACTION_NO (PIECE_NO * 2) // move piece i alone, or move the block of piece i
+#define POLICY_MAX_HIDDEN 256
+#define POLICY_LANE_NO 8 // floats per AVX register, layer widths are padded to it
+#define POLICY_DECISION_TILE 32 // decisions scored per evaluatePolicyBatch call
+
+// Flat binary weight file, little endian:
+//   struct PolicyFileHeader
+//   float w1[inputNo][hidden1No], b1[hidden1No]
+//   float w2[hidden1No][hidden2No], b2[hidden2No]
+//   float w3[hidden2No][outputNo], b3[outputNo]
+// inputNo must be POLICY_FEATURE_NO and outputNo must be
+// POLICY_ACTION_NO. Weights are stored input major so one
+// input updates a whole row of outputs.
+struct PolicyFileHeader
+{
+  uint32_t magic;
+  uint32_t inputNo;
+  uint32_t hidden1No;
+  uint32_t hidden2No;
+  uint32_t outputNo;
+} __attribute__((aligned(4)));
+
+struct PolicyLayer
+{
+  int inputNo;
+  int outputNo;
+  int paddedOutputNo;
+  float *weights; // inputNo rows of paddedOutputNo
+  float *biases; // paddedOutputNo
+};
+
+// Two hidden layer perceptron with ReLU scoring the
+// actions of the player to move
+struct MlpPolicy
+{
+  struct PolicyLayer layers[3];
+  bool useAvx2;
+};
+
+// Function declarations for the neural piece selection
+
+void writePolicyFeatures
+(
+  struct Player *players, int playerIndex, int diceNumber,
+  struct Board *board, int mysteryCellNo, float *features
+);
+struct MlpPolicy *loadMlpPolicy(char *fileName);
+struct MlpPolicy *createMlpPolicy(int hidden1No, int hidden2No, uint64_t seed);
+bool saveMlpPolicy(struct MlpPolicy *policy, char *fileName);
+void freeMlpPolicy(struct MlpPolicy *policy);
+void evaluatePolicyBatch(struct MlpPolicy *policy, float *features, int count, float *scores);
+int selectPolicyAction(float *scores, uint8_t legalMask);
+void useMlpPolicy(enum Color color, struct MlpPolicy *policy);
+void evaluateMlpDecisions(void *context, struct DecisionRequest *requests, int count, int *actions);
+
+#endif // !POLICY_H
@@ -0,0 +1,556 @@
+#include "query.h"
+#include "game.h"
+#include "simulation.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <strings.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Files of the scan with the games numbered across files
+struct QueryScan
+{
+  struct Query *query;
+  struct ReplayFile *files;
+  char **fileNames;
+  int fileCount;
+  long *firstGames; // of each file, fileCount + 1 entries
+  _Atomic long nextGame;
+};
+
+struct QueryWorker
+{
+  pthread_t thread;
+  struct QueryScan *scan;
+  long gameCount;
+  long matchingGames;
+  long matchCount;
+  long colorMatches[PLAYER_NO];
+  long roundSum;
+  long readBytes;
+  bool failed;
+  int matchesLength; // up to the limit, in scan order
+  int matchesCapacity;
+  struct QueryMatch *matches;
+};
+
+static long getQueryTimeNs()
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000000L + now.tv_nsec;
+}
+
+/* Parsing */
+
+static bool parseQueryCell(char *text, int *cellNo)
+{
+  char *end;
+
+  if (strcasecmp(text, "bhawana") == 0)
+  {
+    *cellNo = BHAWANA;
+  }
+  else if (strcasecmp(text, "kotuwa") == 0)
+  {
+    *cellNo = KOTUWA;
+  }
+  else if (strcasecmp(text, "pita-kotuwa") == 0)
+  {
+    *cellNo = PITA_KOTUWA;
+  }
+  else if (strcasecmp(text, "base") == 0)
+  {
+    *cellNo = BASE;
+  }
+  else if (strcasecmp(text, "home") == 0)
+  {
+    *cellNo = HOME;
+  }
+  else
+  {
+    *cellNo = strtol(text + (text[0] == 'L'), &end, 10);
+    return end != text + (text[0] == 'L') && *end == '\0' && *cellNo >= 0 && *cellNo < HOME;
+  }
+
+  return true;
+}
+
+static bool parseQueryColor(char *text, int *color)
+{
+  for (int colorIndex = 0; colorIndex < PLAYER_NO; colorIndex++)
+  {
+    if (strcasecmp(text, getName(colorIndex)) == 0)
+    {
+      *color = colorIndex;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Terms are an event (move, capture, teleport or split)
+// followed by its filters (color=, cell=, block), joined by
+// "then". threads= and limit= may go anywhere
+bool parseQuery(int termCount, char **terms, struct Query *query)
+{
+  struct QueryTerm *term = NULL;
+
+  memset(query, 0, sizeof(struct Query));
+  query->limit = QUERY_DEFAULT_LIMIT;
+
+  for (int termIndex = 0; termIndex < termCount; termIndex++)
+  {
+    char *text = terms[termIndex];
+    bool valid = true;
+
+    if (strncmp(text, "threads=", 8) == 0)
+    {
+      query->threadCount = atoi(text + 8);
+    }
+    else if (strncmp(text, "limit=", 6) == 0)
+    {
+      query->limit = atoi(text + 6);
+    }
+    else if (strcmp(text, "then") == 0)
+    {
+      valid = term != NULL;
+      term = NULL;
+    }
+    else if (term == NULL)
+    {
+      int cause;
+
+      for (cause = REPLAY_CAUSE_MOVE; cause <= REPLAY_CAUSE_SPLIT; cause++)
+      {
+        if (strcmp(text, getReplayCauseName(cause)) == 0)
+        {
+          break;
+        }
+      }
+
+      valid = cause <= REPLAY_CAUSE_SPLIT && query->termCount < QUERY_MAX_TERMS;
+      if (valid)
+      {
+        term = &query->terms[query->termCount++];
+        *term = (struct QueryTerm){.cause = cause, .color = EMPTY, .cellNo = EMPTY, .block = false};
+      }
+    }
+    else if (strncmp(text, "color=", 6) == 0)
+    {
+      valid = parseQueryColor(text + 6, &term->color);
+    }
+    else if (strncmp(text, "cell=", 5) == 0)
+    {
+      valid = parseQueryCell(text + 5, &term->cellNo);
+    }
+    else if (strcmp(text, "block") == 0)
+    {
+      term->block = true;
+    }
+    else
+    {
+      valid = false;
+    }
+
+    if (!valid)
+    {
+      printf("Error: Unexpected query term %s\n", text);
+      return false;
+    }
+  }
+
+  if (query->termCount == 0 || term == NULL)
+  {
+    printf("Error: The query has no event\n");
+    return false;
+  }
+
+  return true;
+}
+
+/* Scan */
+
+static bool matchesQueryTerm(struct QueryTerm *term, enum ReplayChangeCause cause, int color, int cellNo, bool block)
+{
+  return term->cause == cause
+    && (term->color == EMPTY || term->color == color)
+    && (term->cellNo == EMPTY || term->cellNo == cellNo)
+    && (!term->block || block);
+}
+
+static void addQueryMatch(struct QueryWorker *worker, struct QueryMatch *match)
+{
+  int limit = worker->scan->query->limit;
+
+  worker->matchCount++;
+  worker->colorMatches[match->color]++;
+  worker->roundSum += match->round;
+
+  if (limit <= 0 || worker->matchesLength < limit)
+  {
+    if (worker->matchesLength == worker->matchesCapacity)
+    {
+      worker->matchesCapacity = worker->matchesCapacity > 0 ? 2 * worker->matchesCapacity : 64;
+      worker->matches = realloc(worker->matches, worker->matchesCapacity * sizeof(struct QueryMatch));
+      if (worker->matches == NULL)
+      {
+        printf("Error: Memory allocation failed\n");
+        exit(1);
+      }
+    }
+
+    worker->matches[worker->matchesLength++] = *match;
+  }
+}
+
+// Walk the records of one game. Every piece has the index of
+// the next term it has to match, and its cells are followed
+// from the start to know where captures happened
+static void evaluateQueryGame(struct QueryWorker *worker, uint8_t *data, size_t length, int fileIndex, int gameIndex)
+{
+  struct Query *query = worker->scan->query;
+  int8_t pieceCells[PLAYER_NO * PIECE_NO];
+  uint8_t nextTerms[PLAYER_NO * PIECE_NO] = {0};
+  struct QueryMatch match = {.fileIndex = fileIndex, .gameIndex = gameIndex};
+  long matchCount = worker->matchCount;
+
+  memset(pieceCells, BASE, sizeof(pieceCells));
+
+  for (size_t position = 0; position < length; )
+  {
+    uint8_t record = data[position];
+
+    if ((record & 3) == REPLAY_RECORD_KEYFRAME)
+    {
+      position += 1 + sizeof(struct ReplayKeyframe);
+      continue;
+    }
+
+    if ((record & 3) == REPLAY_RECORD_END)
+    {
+      break;
+    }
+
+    uint8_t *changes = data + position + 2;
+    int changeCount = data[position + 1];
+    int color = record >> 2 & 3;
+    int moveCount = 0;
+
+    position += 2 + 2 * changeCount;
+
+    if ((record & 3) == REPLAY_RECORD_ROUND)
+    {
+      match.round++;
+      color = EMPTY;
+    }
+    else
+    {
+      match.throwNo++;
+      match.color = color;
+
+      for (int changeIndex = 0; changeIndex < changeCount; changeIndex++)
+      {
+        uint8_t id = changes[2 * changeIndex];
+
+        moveCount += id != REPLAY_MYSTERY_CHANGE && REPLAY_CHANGE_CAUSE(id) == REPLAY_CAUSE_MOVE;
+      }
+    }
+
+    for (int changeIndex = 0; changeIndex < changeCount; changeIndex++)
+    {
+      uint8_t id = changes[2 * changeIndex];
+      int8_t cellNo = changes[2 * changeIndex + 1];
+
+      if (id == REPLAY_MYSTERY_CHANGE)
+      {
+        continue;
+      }
+
+      int pieceId = REPLAY_CHANGE_PIECE(id);
+      enum ReplayChangeCause cause = REPLAY_CHANGE_CAUSE(id);
+      int eventCellNo = cause == REPLAY_CAUSE_CAPTURE ? pieceCells[pieceId] : cellNo;
+
+      pieceCells[pieceId] = cellNo;
+
+      if (color == EMPTY || !matchesQueryTerm(&query->terms[nextTerms[pieceId]], cause, color, eventCellNo, moveCount > 1))
+      {
+        continue;
+      }
+
+      if (++nextTerms[pieceId] == query->termCount)
+      {
+        nextTerms[pieceId] = 0;
+        match.pieceId = pieceId;
+        addQueryMatch(worker, &match);
+      }
+    }
+  }
+
+  worker->matchingGames += worker->matchCount > matchCount;
+}
+
+static void *runQueryWorker(void *argument)
+{
+  struct QueryWorker *worker = argument;
+  struct QueryScan *scan = worker->scan;
+  long totalGames = scan->firstGames[scan->fileCount];
+  size_t capacity = 0;
+  uint8_t *data = NULL;
+  int fileIndex = 0;
+
+  while (true)
+  {
+    long firstGame = atomic_fetch_add(&scan->nextGame, QUERY_CHUNK_GAMES);
+
+    if (firstGame >= totalGames)
+    {
+      break;
+    }
+
+    long lastGame = firstGame + QUERY_CHUNK_GAMES < totalGames ? firstGame + QUERY_CHUNK_GAMES : totalGames;
+
+    for (long game = firstGame; game < lastGame; game++)
+    {
+      // chunks are claimed in order, so the file only moves forward
+      while (game >= scan->firstGames[fileIndex + 1])
+      {
+        fileIndex++;
+      }
+
+      struct ReplayFile *replay = &scan->files[fileIndex];
+      int gameIndex = game - scan->firstGames[fileIndex];
+      struct ReplayGameEntry *entry = &replay->games[gameIndex];
+
+      if (entry->size > capacity)
+      {
+        capacity = entry->size;
+        free(data);
+        data = malloc(capacity);
+        if (data == NULL)
+        {
+          printf("Error: Memory allocation failed\n");
+          exit(1);
+        }
+      }
+
+      // pread so that the workers share the open files
+      if (pread(fileno(replay->file), data, entry->size, entry->offset) != (ssize_t)entry->size)
+      {
+        worker->failed = true;
+        continue;
+      }
+
+      worker->gameCount++;
+      worker->readBytes += entry->size;
+      evaluateQueryGame(worker, data, entry->size, fileIndex, gameIndex);
+    }
+  }
+
+  free(data);
+  return NULL;
+}
+
+static int compareQueryFileNames(const void *first, const void *second)
+{
+  return strcmp(*(char **)first, *(char **)second);
+}
+
+static int compareQueryMatches(const void *first, const void *second)
+{
+  const struct QueryMatch *a = first, *b = second;
+
+  if (a->fileIndex != b->fileIndex)
+  {
+    return a->fileIndex - b->fileIndex;
+  }
+
+  if (a->gameIndex != b->gameIndex)
+  {
+    return a->gameIndex - b->gameIndex;
+  }
+
+  return a->throwNo - b->throwNo;
+}
+
+// The replay file, or the .replay files of the directory
+// in name order
+static int findQueryFiles(char *path, char **fileNames)
+{
+  struct stat status;
+
+  if (stat(path, &status) != 0)
+  {
+    printf("Error: Could not find %s\n", path);
+    return 0;
+  }
+
+  if (!S_ISDIR(status.st_mode))
+  {
+    fileNames[0] = strdup(path);
+    return 1;
+  }
+
+  DIR *directory = opendir(path);
+  struct dirent *item;
+  int fileCount = 0;
+
+  if (directory == NULL)
+  {
+    printf("Error: Could not open the directory %s\n", path);
+    return 0;
+  }
+
+  while ((item = readdir(directory)) != NULL && fileCount < QUERY_MAX_FILES)
+  {
+    size_t length = strlen(item->d_name);
+
+    if (length > 7 && strcmp(item->d_name + length - 7, ".replay") == 0)
+    {
+      fileNames[fileCount] = malloc(strlen(path) + length + 2);
+      sprintf(fileNames[fileCount], "%s/%s", path, item->d_name);
+      fileCount++;
+    }
+  }
+  closedir(directory);
+
+  qsort(fileNames, fileCount, sizeof(char *), compareQueryFileNames);
+  if (fileCount == 0)
+  {
+    printf("Error: No .replay files in %s\n", path);
+  }
+
+  return fileCount;
+}
+
+static void displayQueryMatch(struct QueryScan *scan, struct QueryMatch *match)
+{
+  printf
+  (
+    "%s game %d round %d throw %d: %s, piece %c%d\n",
+    scan->fileNames[match->fileIndex], match->gameIndex, match->round, match->throwNo,
+    getName(match->color), getName(match->pieceId / PIECE_NO)[0], match->pieceId % PIECE_NO + 1
+  );
+}
+
+// Scan every game of the files with a worker per thread and
+// print the first matches and the totals
+bool runReplayQuery(char *path, struct Query *query)
+{
+  static char *fileNames[QUERY_MAX_FILES];
+  struct QueryScan scan = {.query = query, .fileNames = fileNames};
+
+  scan.fileCount = findQueryFiles(path, fileNames);
+  if (scan.fileCount == 0)
+  {
+    return false;
+  }
+
+  scan.files = calloc(scan.fileCount, sizeof(struct ReplayFile));
+  scan.firstGames = calloc(scan.fileCount + 1, sizeof(long));
+  if (scan.files == NULL || scan.firstGames == NULL)
+  {
+    printf("Error: Memory allocation failed\n");
+    exit(1);
+  }
+
+  bool opened = true;
+  for (int fileIndex = 0; fileIndex < scan.fileCount && opened; fileIndex++)
+  {
+    opened = openReplayFile(fileNames[fileIndex], &scan.files[fileIndex]);
+    scan.firstGames[fileIndex + 1] = scan.firstGames[fileIndex] + (opened ? scan.files[fileIndex].footer.gameCount : 0);
+  }
+
+  int threadCount = query->threadCount > 0 ? query->threadCount : getDefaultThreadCount();
+  struct QueryWorker workers[threadCount];
+  struct QueryWorker total = {0};
+  long startNs = getQueryTimeNs();
+
+  atomic_store(&scan.nextGame, 0);
+
+  for (int workerIndex = 0; workerIndex < threadCount && opened; workerIndex++)
+  {
+    workers[workerIndex] = (struct QueryWorker){.scan = &scan};
+    pthread_create(&workers[workerIndex].thread, NULL, runQueryWorker, &workers[workerIndex]);
+  }
+
+  for (int workerIndex = 0; workerIndex < threadCount && opened; workerIndex++)
+  {
+    struct QueryWorker *worker = &workers[workerIndex];
+
+    pthread_join(worker->thread, NULL);
+
+    total.gameCount += worker->gameCount;
+    total.matchingGames += worker->matchingGames;
+    total.matchCount += worker->matchCount;
+    total.roundSum += worker->roundSum;
+    total.readBytes += worker->readBytes;
+    total.failed |= worker->failed;
+    for (int color = 0; color < PLAYER_NO; color++)
+    {
+      total.colorMatches[color] += worker->colorMatches[color];
+    }
+
+    total.matches = realloc(total.matches, (total.matchesLength + worker->matchesLength + 1) * sizeof(struct QueryMatch));
+    if (total.matches == NULL)
+    {
+      printf("Error: Memory allocation failed\n");
+      exit(1);
+    }
+    memcpy(total.matches + total.matchesLength, worker->matches, worker->matchesLength * sizeof(struct QueryMatch));
+    total.matchesLength += worker->matchesLength;
+    free(worker->matches);
+  }
+
+  double seconds = (getQueryTimeNs() - startNs) / 1e9;
+
+  if (opened)
+  {
+    // each worker kept its first matches, so the first of
+    // all of them are the first of the scan
+    qsort(total.matches, total.matchesLength, sizeof(struct QueryMatch), compareQueryMatches);
+    for (int matchIndex = 0; matchIndex < total.matchesLength && (query->limit <= 0 || matchIndex < query->limit); matchIndex++)
+    {
+      displayQueryMatch(&scan, &total.matches[matchIndex]);
+    }
+
+    printf("\n%ld matches in %ld of %ld games", total.matchCount, total.matchingGames, total.gameCount);
+    if (total.matchCount > 0)
+    {
+      printf(", at round %.1f on average", (double)total.roundSum / total.matchCount);
+    }
+    printf("\nMatches by player:");
+    for (int color = 0; color < PLAYER_NO; color++)
+    {
+      printf(" %s %ld", getName(color), total.colorMatches[color]);
+    }
+    printf
+    (
+      "\nScanned %d files, %.1f MB in %.2f s with %d threads, %.0f games per minute\n",
+      scan.fileCount, total.readBytes / 1e6, seconds, threadCount, total.gameCount * 60 / (seconds > 0 ? seconds : 1e-9)
+    );
+
+    if (total.failed)
+    {
+      printf("Error: Some games could not be read\n");
+    }
+  }
+
+  for (int fileIndex = 0; fileIndex < scan.fileCount; fileIndex++)
+  {
+    if (scan.files[fileIndex].file != NULL)
+    {
+      closeReplayFile(&scan.files[fileIndex]);
+    }
+    free(fileNames[fileIndex]);
+  }
+  free(total.matches);
+  free(scan.files);
+  free(scan.firstGames);
+
+  return opened && !total.failed;
+}
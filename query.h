@@ -0,0 +1,55 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "types.h"
+#include "replay.h"
+
+#define QUERY_MAX_TERMS 4
+#define QUERY_MAX_FILES 4096
+#define QUERY_DEFAULT_LIMIT 20 // matches printed
+#define QUERY_CHUNK_GAMES 64 // games a worker takes at a time
+
+// One event of a query. color, cellNo and block are left
+// out with EMPTY and false. cellNo is where the piece ended,
+// or where it was captured for a capture. color is the player
+// of the throw, so "capture color=red" is a capture by red
+struct QueryTerm
+{
+  enum ReplayChangeCause cause;
+  int color;
+  int cellNo;
+  bool block; // the player of the throw moved a block
+};
+
+// The terms are matched in order on the same piece, so
+//   teleport cell=pita-kotuwa then teleport
+// finds pieces sent to Pita Kotuwa that were teleported again
+// later in the game. A match is reported at its last term
+struct Query
+{
+  struct QueryTerm terms[QUERY_MAX_TERMS];
+  int termCount;
+  int limit; // 0 prints every match
+  int threadCount;
+};
+
+// Throw of a game where a query matched. throwNo counts the
+// throws of the game from 1
+struct QueryMatch
+{
+  int fileIndex;
+  int gameIndex;
+  int round;
+  int throwNo;
+  uint8_t color; // player of the throw
+  uint8_t pieceId; // color * PIECE_NO + piece index
+};
+
+// Function declarations for querying recorded games
+
+bool parseQuery(int termCount, char **terms, struct Query *query);
+bool runReplayQuery(char *path, struct Query *query);
+
+#endif // !QUERY_H
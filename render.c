@@ -0,0 +1,466 @@
+#include "render.h"
+#include "game.h"
+#include "endgame.h"
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define STYLE(foreground, background) ((uint8_t)((foreground) | (background) << 4))
+#define ANSI(color) ((color) + 1)
+
+enum AnsiColor
+{
+  ANSI_BLACK,
+  ANSI_RED,
+  ANSI_GREEN,
+  ANSI_YELLOW,
+  ANSI_BLUE,
+  ANSI_MAGENTA,
+  ANSI_CYAN,
+  ANSI_WHITE
+};
+
+// Track cells in order from the start cell of yellow, the
+// player on the left arm. Cell c of the game is entry
+// (c - YELLOW_START) % MAX_STANDARD_CELL
+static const int8_t trackCoordinates[MAX_STANDARD_CELL][2] = {
+  {6, 1}, {6, 2}, {6, 3}, {6, 4}, {6, 5},
+  {5, 6}, {4, 6}, {3, 6}, {2, 6}, {1, 6}, {0, 6}, {0, 7},
+  {0, 8}, {1, 8}, {2, 8}, {3, 8}, {4, 8}, {5, 8},
+  {6, 9}, {6, 10}, {6, 11}, {6, 12}, {6, 13}, {6, 14}, {7, 14},
+  {8, 14}, {8, 13}, {8, 12}, {8, 11}, {8, 10}, {8, 9},
+  {9, 8}, {10, 8}, {11, 8}, {12, 8}, {13, 8}, {14, 8}, {14, 7},
+  {14, 6}, {13, 6}, {12, 6}, {11, 6}, {10, 6}, {9, 6},
+  {8, 5}, {8, 4}, {8, 3}, {8, 2}, {8, 1}, {8, 0}, {7, 0}, {6, 0},
+};
+
+// First home straight cell, home straight direction, HOME
+// cell and top left corner of the base, by color
+static const int8_t homeStraightCoordinates[PLAYER_NO][2] = {{7, 1}, {1, 7}, {7, 13}, {13, 7}};
+static const int8_t homeStraightSteps[PLAYER_NO][2] = {{0, 1}, {1, 0}, {0, -1}, {-1, 0}};
+static const int8_t homeCoordinates[PLAYER_NO][2] = {{7, 6}, {6, 7}, {7, 8}, {8, 7}};
+static const int8_t baseCoordinates[PLAYER_NO][2] = {{0, 0}, {0, 9}, {9, 9}, {9, 0}};
+static const int8_t baseSlotOffsets[PIECE_NO][2] = {{2, 2}, {2, 3}, {3, 2}, {3, 3}};
+static const uint8_t colorAnsi[PLAYER_NO] = {ANSI_YELLOW, ANSI_BLUE, ANSI_RED, ANSI_GREEN};
+
+static long getRenderTimeNs()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return now.tv_sec * 1000000000L + now.tv_nsec;
+}
+
+/* Frame building */
+
+static void setRenderCell(struct RenderCell cells[][RENDER_GRID_SIZE], int row, int column, char *text, uint8_t style)
+{
+  struct RenderCell *cell = &cells[row][column];
+  int length = 0;
+
+  // pad to the cell width so cells are compared as a whole
+  for (; length < RENDER_CELL_WIDTH && text[length] != '\0'; length++)
+  {
+    cell->text[length] = text[length];
+  }
+  for (; length < RENDER_CELL_WIDTH; length++)
+  {
+    cell->text[length] = ' ';
+  }
+  cell->text[RENDER_CELL_WIDTH] = '\0';
+  cell->style = style;
+}
+
+static void getTrackCoordinates(int cellNo, int *row, int *column)
+{
+  int pathIndex = (cellNo - YELLOW_START + MAX_STANDARD_CELL) % MAX_STANDARD_CELL;
+
+  *row = trackCoordinates[pathIndex][0];
+  *column = trackCoordinates[pathIndex][1];
+}
+
+static void getPieceCoordinates(enum Color color, int pieceIndex, int cellNo, int *row, int *column)
+{
+  if (cellNo == BASE)
+  {
+    *row = baseCoordinates[color][0] + baseSlotOffsets[pieceIndex][0];
+    *column = baseCoordinates[color][1] + baseSlotOffsets[pieceIndex][1];
+  }
+  else if (cellNo >= MAX_STANDARD_CELL)
+  {
+    int step = cellNo - MAX_STANDARD_CELL;
+
+    *row = homeStraightCoordinates[color][0] + homeStraightSteps[color][0] * step;
+    *column = homeStraightCoordinates[color][1] + homeStraightSteps[color][1] * step;
+  }
+  else
+  {
+    getTrackCoordinates(cellNo, row, column);
+  }
+}
+
+// Empty board: bases, track, start cells and home straights
+static void drawEmptyBoard(struct RenderCell cells[][RENDER_GRID_SIZE])
+{
+  for (int row = 0; row < RENDER_GRID_SIZE; row++)
+  {
+    for (int column = 0; column < RENDER_GRID_SIZE; column++)
+    {
+      setRenderCell(cells, row, column, "", STYLE(0, 0));
+    }
+  }
+
+  for (int cellNo = 0; cellNo < MAX_STANDARD_CELL; cellNo++)
+  {
+    int row, column;
+
+    getTrackCoordinates(cellNo, &row, &column);
+    setRenderCell(cells, row, column, " .", STYLE(0, 0));
+  }
+
+  for (int color = 0; color < PLAYER_NO; color++)
+  {
+    uint8_t style = STYLE(ANSI(colorAnsi[color]), 0);
+    int row, column;
+
+    getTrackCoordinates(YELLOW_START + color * (MAX_STANDARD_CELL / PLAYER_NO), &row, &column);
+    setRenderCell(cells, row, column, " o", style);
+
+    for (int cellNo = MAX_STANDARD_CELL; cellNo < HOME; cellNo++)
+    {
+      getPieceCoordinates(color, 0, cellNo, &row, &column);
+      setRenderCell(cells, row, column, " -", style);
+    }
+
+    for (int pieceIndex = 0; pieceIndex < PIECE_NO; pieceIndex++)
+    {
+      getPieceCoordinates(color, pieceIndex, BASE, &row, &column);
+      setRenderCell(cells, row, column, " .", style);
+    }
+  }
+}
+
+// Draw the pieces of the players over the empty board. A
+// block shows its color and size, HOME the pieces home
+static void drawPieces(struct RenderCell cells[][RENDER_GRID_SIZE], struct Player *players, struct Game *game)
+{
+  uint8_t pieceCounts[RENDER_GRID_SIZE][RENDER_GRID_SIZE] = {0};
+  int mysteryRow = EMPTY;
+  int mysteryColumn = EMPTY;
+
+  if (game->mysteryCellNo != EMPTY)
+  {
+    getTrackCoordinates(game->mysteryCellNo, &mysteryRow, &mysteryColumn);
+    setRenderCell(cells, mysteryRow, mysteryColumn, " ?", STYLE(ANSI(ANSI_WHITE), ANSI(ANSI_MAGENTA)));
+  }
+
+  for (int color = 0; color < PLAYER_NO; color++)
+  {
+    uint8_t style = STYLE(ANSI(colorAnsi[color]), 0);
+    int homeCount = 0;
+
+    for (int pieceIndex = 0; pieceIndex < PIECE_NO; pieceIndex++)
+    {
+      struct Piece *piece = &players[color].pieces[pieceIndex];
+      char text[RENDER_CELL_WIDTH + 1];
+      int row, column;
+
+      if (piece->cellNo == HOME)
+      {
+        homeCount++;
+        continue;
+      }
+
+      getPieceCoordinates(color, pieceIndex, piece->cellNo, &row, &column);
+      uint8_t cellStyle = row == mysteryRow && column == mysteryColumn ? STYLE(ANSI(colorAnsi[color]), ANSI(ANSI_MAGENTA)) : style;
+
+      if (++pieceCounts[row][column] == 1)
+      {
+        snprintf(text, sizeof(text), " %s", piece->name);
+      }
+      else
+      {
+        // a cell holds at most PIECE_NO pieces, one digit
+        snprintf(text, sizeof(text), " %c%c", piece->name[0], '0' + pieceCounts[row][column]);
+      }
+      setRenderCell(cells, row, column, text, cellStyle);
+    }
+
+    if (homeCount > 0)
+    {
+      char text[RENDER_CELL_WIDTH + 1];
+
+      snprintf(text, sizeof(text), " %c", '0' + homeCount);
+      setRenderCell(cells, homeCoordinates[color][0], homeCoordinates[color][1], text, style);
+    }
+  }
+}
+
+/* Terminal output */
+
+static void appendRenderOutput(struct BoardRenderer *renderer, char *format, ...)
+{
+  va_list arguments;
+  va_start(arguments, format);
+  int written = vsnprintf
+  (
+    renderer->output + renderer->outputLength,
+    RENDER_OUTPUT_SIZE - renderer->outputLength, format, arguments
+  );
+  va_end(arguments);
+
+  if (written > 0)
+  {
+    renderer->outputLength += written;
+  }
+}
+
+static void moveRenderCursor(struct BoardRenderer *renderer, int row, int column)
+{
+  if (renderer->cursorRow != row || renderer->cursorColumn != column)
+  {
+    appendRenderOutput(renderer, "\x1b[%d;%dH", row + 1, column + 1);
+    renderer->cursorRow = row;
+    renderer->cursorColumn = column;
+  }
+}
+
+static void setRenderStyle(struct BoardRenderer *renderer, uint8_t style)
+{
+  if (renderer->style == style)
+  {
+    return;
+  }
+
+  appendRenderOutput(renderer, "\x1b[0");
+  if (style & 0x0F)
+  {
+    appendRenderOutput(renderer, ";1;%d", 30 + (style & 0x0F) - 1);
+  }
+  if (style >> 4)
+  {
+    appendRenderOutput(renderer, ";%d", 40 + (style >> 4) - 1);
+  }
+  appendRenderOutput(renderer, "m");
+  renderer->style = style;
+}
+
+static void flushRenderOutput(struct BoardRenderer *renderer)
+{
+  size_t offset = 0;
+
+  while (offset < renderer->outputLength)
+  {
+    ssize_t written = write(renderer->outputFile, renderer->output + offset, renderer->outputLength - offset);
+    if (written <= 0)
+    {
+      break;
+    }
+    offset += written;
+  }
+
+  renderer->byteCount += renderer->outputLength;
+  renderer->outputLength = 0;
+}
+
+// Send the cells and status lines that differ from the
+// shadow, and make the shadow the frame
+static void emitFrameChanges(struct BoardRenderer *renderer)
+{
+  for (int row = 0; row < RENDER_GRID_SIZE; row++)
+  {
+    for (int column = 0; column < RENDER_GRID_SIZE; column++)
+    {
+      struct RenderCell *cell = &renderer->frame.cells[row][column];
+      struct RenderCell *shown = &renderer->shadow.cells[row][column];
+
+      if (renderer->drawn && cell->style == shown->style && memcmp(cell->text, shown->text, RENDER_CELL_WIDTH) == 0)
+      {
+        continue;
+      }
+
+      moveRenderCursor(renderer, row, column * RENDER_CELL_WIDTH);
+      setRenderStyle(renderer, cell->style);
+      appendRenderOutput(renderer, "%s", cell->text);
+      renderer->cursorColumn += RENDER_CELL_WIDTH;
+      *shown = *cell;
+    }
+  }
+
+  for (int lineIndex = 0; lineIndex < RENDER_STATUS_NO; lineIndex++)
+  {
+    char *status = renderer->frame.status[lineIndex];
+
+    if (renderer->drawn && strcmp(status, renderer->shadow.status[lineIndex]) == 0)
+    {
+      continue;
+    }
+
+    // the rest of an older, longer line is erased
+    moveRenderCursor(renderer, RENDER_GRID_SIZE + 1 + lineIndex, 0);
+    setRenderStyle(renderer, STYLE(0, 0));
+    appendRenderOutput(renderer, "%s\x1b[K", status);
+    renderer->cursorColumn = EMPTY;
+    strcpy(renderer->shadow.status[lineIndex], status);
+  }
+}
+
+/* Renderer */
+
+void initializeBoardRenderer(struct BoardRenderer *renderer, int outputFile)
+{
+  memset(renderer, 0, sizeof(struct BoardRenderer));
+  renderer->outputFile = outputFile;
+  renderer->cursorRow = EMPTY;
+  renderer->cursorColumn = EMPTY;
+  drawEmptyBoard(renderer->emptyCells);
+}
+
+void setRenderStatus(struct BoardRenderer *renderer, int lineIndex, char *format, ...)
+{
+  va_list arguments;
+  va_start(arguments, format);
+  vsnprintf(renderer->frame.status[lineIndex], RENDER_STATUS_SIZE, format, arguments);
+  va_end(arguments);
+}
+
+// Draw the pieces and status lines. The first frame clears
+// the screen, later frames only send what changed
+void renderBoard(struct BoardRenderer *renderer, struct Player *players, struct Game *game)
+{
+  long startNs = getRenderTimeNs();
+
+  if (!renderer->drawn)
+  {
+    // clear the screen, home the cursor and hide it
+    appendRenderOutput(renderer, "\x1b[0m\x1b[2J\x1b[H\x1b[?25l");
+    renderer->cursorRow = 0;
+    renderer->cursorColumn = 0;
+    renderer->style = STYLE(0, 0);
+  }
+
+  memcpy(renderer->frame.cells, renderer->emptyCells, sizeof(renderer->emptyCells));
+  drawPieces(renderer->frame.cells, players, game);
+  emitFrameChanges(renderer);
+  renderer->drawn = true;
+  renderer->frameCount++;
+  renderer->renderNs += getRenderTimeNs() - startNs;
+
+  flushRenderOutput(renderer);
+}
+
+// Leave the cursor below the drawing with the default style
+void closeBoardRenderer(struct BoardRenderer *renderer)
+{
+  if (renderer->drawn)
+  {
+    moveRenderCursor(renderer, RENDER_GRID_SIZE + 1 + RENDER_STATUS_NO, 0);
+    appendRenderOutput(renderer, "\x1b[0m\x1b[?25h");
+    flushRenderOutput(renderer);
+  }
+}
+
+/* Watching a game */
+
+struct GameWatch
+{
+  struct BoardRenderer renderer;
+  struct GameSession *session;
+  int delayMs;
+};
+
+static void setWatchStatus(struct GameWatch *watch)
+{
+  struct Game *game = &watch->session->game;
+
+  if (game->mysteryCellNo != EMPTY)
+  {
+    setRenderStatus(&watch->renderer, 0, "Round %d, mystery cell L%d for %d rounds", game->rounds, game->mysteryCellNo, game->mysteryRounds);
+  }
+  else
+  {
+    setRenderStatus(&watch->renderer, 0, "Round %d", game->rounds);
+  }
+
+  setRenderStatus
+  (
+    &watch->renderer, 2, "Ranks: %s %s %s %s",
+    game->winIndex > 0 ? getName(game->winners[0]) : "",
+    game->winIndex > 1 ? getName(game->winners[1]) : "",
+    game->winIndex > 2 ? getName(game->winners[2]) : "",
+    game->winIndex > 3 ? getName(game->winners[3]) : ""
+  );
+}
+
+// Frame before each behavior move, naming the piece to move
+static void onWatchedMove
+(
+  void *context, struct Player *players, int playerIndex, int diceNumber,
+  struct Board *board, int mysteryCellNo, int pieceIndex, bool blockMove
+)
+{
+  struct GameWatch *watch = context;
+  char *playerName = getName(players[playerIndex].color);
+
+  // renderBoard draws the mystery cell from the game
+  (void)mysteryCellNo;
+  struct Piece *piece = pieceIndex != EMPTY ? &players[playerIndex].pieces[pieceIndex] : NULL;
+
+  setWatchStatus(watch);
+  if (pieceIndex == EMPTY)
+  {
+    setRenderStatus(&watch->renderer, 1, "%s rolled %d and cannot move", playerName, diceNumber);
+  }
+  else
+  {
+    setRenderStatus
+    (
+      &watch->renderer, 1, "%s rolled %d and moves %s%s", playerName, diceNumber,
+      blockMove && (getPieceFlags(piece, board) & PIECE_FLAG_IN_BLOCK) ? "the block of " : "", piece->name
+    );
+  }
+
+  renderBoard(&watch->renderer, players, &watch->session->game);
+
+  if (watch->delayMs > 0)
+  {
+    usleep(watch->delayMs * 1000);
+  }
+}
+
+// Play a game with every color on its behavior, drawing
+// the board before each move. With no delay this measures
+// the cost of a frame, which is shown at the end on stderr
+void watchGame(uint64_t seed, int delayMs)
+{
+  static struct GameWatch watch;
+  static struct GameSession session;
+  int weights[PLAYER_NO][WEIGHT_NO];
+  bool hasWeights = loadPieceWeights(WEIGHTS_CONFIG_FILE, weights);
+
+  loadEndgameTable(ENDGAME_TABLE_FILE);
+  setGameOutput(false);
+
+  initializeBoardRenderer(&watch.renderer, STDOUT_FILENO);
+  watch.session = &session;
+  watch.delayMs = delayMs;
+
+  struct MoveObserver observer = {onWatchedMove, &watch};
+  startGameSession(&session, seed, hasWeights ? weights : NULL, 0, MAX_GAME_ROUNDS);
+  setMoveObserver(&observer);
+  advanceGameSession(&session);
+  setMoveObserver(NULL);
+
+  setWatchStatus(&watch);
+  setRenderStatus(&watch.renderer, 1, "Game over after %d rounds", session.game.rounds);
+  renderBoard(&watch.renderer, session.players, &session.game);
+  closeBoardRenderer(&watch.renderer);
+
+  fprintf
+  (
+    stderr, "Rendered %ld frames, %.2f us and %.0f bytes per frame\n",
+    watch.renderer.frameCount, watch.renderer.renderNs / 1000.0 / watch.renderer.frameCount,
+    (double)watch.renderer.byteCount / watch.renderer.frameCount
+  );
+}
@@ -0,0 +1,59 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "types.h"
+
+#define RENDER_GRID_SIZE 15 // cells per side of the board drawing
+#define RENDER_CELL_WIDTH 3 // terminal columns per cell
+#define RENDER_STATUS_NO 3 // status lines below the board
+#define RENDER_STATUS_SIZE 96
+#define RENDER_OUTPUT_SIZE 16384 // a full frame with every cell addressed fits
+
+// Text and ANSI colors of one cell of the drawing. style has
+// the foreground in the low nibble and the background in the
+// high nibble, 0 for the terminal default and 1 + n for
+// ANSI color n
+struct RenderCell
+{
+  char text[RENDER_CELL_WIDTH + 1];
+  uint8_t style;
+} __attribute__((aligned(1)));
+
+struct RenderFrame
+{
+  struct RenderCell cells[RENDER_GRID_SIZE][RENDER_GRID_SIZE];
+  char status[RENDER_STATUS_NO][RENDER_STATUS_SIZE];
+};
+
+// Draws the board at the top left of a terminal. shadow is
+// what the terminal shows, so a frame only sends the cells
+// and status lines that differ from it
+struct BoardRenderer
+{
+  int outputFile;
+  bool drawn;
+  int cursorRow; // 0 based terminal position after the last write
+  int cursorColumn;
+  uint8_t style; // current terminal style
+  struct RenderCell emptyCells[RENDER_GRID_SIZE][RENDER_GRID_SIZE];
+  struct RenderFrame frame;
+  struct RenderFrame shadow;
+  size_t outputLength;
+  char output[RENDER_OUTPUT_SIZE];
+  long frameCount;
+  long byteCount;
+  long renderNs; // building and diffing frames, without the writes
+};
+
+// Function declarations for the terminal board renderer
+
+void initializeBoardRenderer(struct BoardRenderer *renderer, int outputFile);
+void setRenderStatus(struct BoardRenderer *renderer, int lineIndex, char *format, ...);
+void renderBoard(struct BoardRenderer *renderer, struct Player *players, struct Game *game);
+void closeBoardRenderer(struct BoardRenderer *renderer);
+void watchGame(uint64_t seed, int delayMs);
+
+#endif // !RENDER_H
@@ -0,0 +1,917 @@
+#include "replay.h"
+#include "game.h"
+#include "simulation.h"
+#include "endgame.h"
+#include <pthread.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+
+// Games of all workers are appended to the file in the
+// order they finish. The index is kept by game number
+struct ReplayWriter
+{
+  FILE *file;
+  pthread_mutex_t lock;
+  uint64_t nextOffset;
+  bool failed;
+  struct ReplayGameEntry *games;
+  struct ReplayKeyframeEntry **keyframes; // of each game, absolute offsets
+};
+
+struct ReplayWorker
+{
+  pthread_t thread;
+  struct ReplayWriter *writer;
+  uint64_t firstSeed;
+  int firstGame;
+  int lastGame;
+  int keyframeInterval;
+  int (*weights)[WEIGHT_NO];
+};
+
+static long getReplayTimeNs()
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000000L + now.tv_nsec;
+}
+
+/* Encoder */
+
+void initializeReplayEncoder(struct ReplayEncoder *encoder, int keyframeInterval)
+{
+  memset(encoder, 0, sizeof(struct ReplayEncoder));
+  encoder->keyframeInterval = keyframeInterval > 0 ? keyframeInterval : REPLAY_KEYFRAME_INTERVAL;
+  resetReplayEncoder(encoder);
+}
+
+// Forget the last game but keep the buffers
+void resetReplayEncoder(struct ReplayEncoder *encoder)
+{
+  encoder->length = 0;
+  encoder->keyframeCount = 0;
+  encoder->lastKeyframeRounds = EMPTY;
+  encoder->stopRounds = INT_MAX;
+  encoder->started = false;
+  encoder->stopped = false;
+  encoder->throwPending = false;
+  encoder->changeCount = 0;
+  encoder->previousPhase = TURN_ROUND_START;
+}
+
+void freeReplayEncoder(struct ReplayEncoder *encoder)
+{
+  free(encoder->data);
+  free(encoder->keyframes);
+  encoder->data = NULL;
+  encoder->keyframes = NULL;
+}
+
+static uint8_t *reserveReplayBytes(struct ReplayEncoder *encoder, size_t count)
+{
+  if (encoder->length + count > encoder->capacity)
+  {
+    size_t capacity = encoder->capacity > 0 ? encoder->capacity * 2 : 4096;
+
+    while (capacity < encoder->length + count)
+    {
+      capacity *= 2;
+    }
+
+    encoder->data = realloc(encoder->data, capacity);
+    if (encoder->data == NULL)
+    {
+      printf("Error: Memory allocation failed\n");
+      exit(1);
+    }
+    encoder->capacity = capacity;
+  }
+
+  return encoder->data + encoder->length;
+}
+
+static int8_t getReplayMysteryCell(struct Game *game)
+{
+  return game->mysteryCellNo == EMPTY ? BASE : game->mysteryCellNo;
+}
+
+static void addReplayChange(struct ReplayEncoder *encoder, uint8_t id, int8_t cellNo)
+{
+  if (encoder->changeCount == REPLAY_MAX_CHANGES)
+  {
+    printf("Error: More than %d changes in one replay record\n", REPLAY_MAX_CHANGES);
+    exit(1);
+  }
+
+  encoder->changes[2 * encoder->changeCount] = id;
+  encoder->changes[2 * encoder->changeCount + 1] = (uint8_t)cellNo;
+  encoder->changeCount++;
+}
+
+// Collect the pieces and the mystery cell that changed
+// since the last call. Pieces of playerIndex changed by
+// cause, the others were captured
+static void collectReplayChanges
+(
+  struct ReplayEncoder *encoder, struct Game *game, struct Player *players,
+  int playerIndex, enum ReplayChangeCause cause
+)
+{
+  for (int color = 0; color < PLAYER_NO; color++)
+  {
+    enum ReplayChangeCause pieceCause = color == playerIndex ? cause : REPLAY_CAUSE_CAPTURE;
+
+    for (int pieceIndex = 0; pieceIndex < PIECE_NO; pieceIndex++)
+    {
+      int8_t cellNo = players[color].pieces[pieceIndex].cellNo;
+
+      if (cellNo != encoder->pieceCells[color][pieceIndex])
+      {
+        addReplayChange(encoder, pieceCause << 4 | (color * PIECE_NO + pieceIndex), cellNo);
+        encoder->pieceCells[color][pieceIndex] = cellNo;
+      }
+    }
+  }
+
+  if (getReplayMysteryCell(game) != encoder->mysteryCellNo)
+  {
+    encoder->mysteryCellNo = getReplayMysteryCell(game);
+    addReplayChange(encoder, REPLAY_MYSTERY_CHANGE, encoder->mysteryCellNo);
+  }
+}
+
+// Write the record with the collected changes
+static void writeReplayRecord(struct ReplayEncoder *encoder, uint8_t record)
+{
+  uint8_t *data = reserveReplayBytes(encoder, 2 + 2 * encoder->changeCount);
+
+  data[0] = record;
+  data[1] = encoder->changeCount;
+  memcpy(data + 2, encoder->changes, 2 * encoder->changeCount);
+  encoder->length += 2 + 2 * encoder->changeCount;
+  encoder->changeCount = 0;
+}
+
+// Changes after the move are only complete at the next
+// throw or round, after the mystery cells and block splits
+// of the turn
+static void flushReplayThrow(struct ReplayEncoder *encoder, struct Game *game, struct Player *players)
+{
+  if (encoder->throwPending)
+  {
+    collectReplayChanges(encoder, game, players, encoder->throwPlayerIndex, encoder->laterCause);
+    writeReplayRecord(encoder, encoder->throwRecord);
+    encoder->throwPending = false;
+  }
+}
+
+static void writeReplayKeyframe(struct ReplayEncoder *encoder, struct Game *game, struct Player *players)
+{
+  struct ReplayKeyframe keyframe;
+
+  memset(&keyframe, 0, sizeof(keyframe));
+  keyframe.randomState = getGameRandomState();
+  keyframe.game = *game;
+  for (int color = 0; color < PLAYER_NO; color++)
+  {
+    memcpy(keyframe.pieces[color], players[color].pieces, sizeof(keyframe.pieces[color]));
+    keyframe.previousPieceIndex[color] = players[color].previousPieceIndex;
+  }
+
+  if (encoder->keyframeCount == encoder->keyframeCapacity)
+  {
+    encoder->keyframeCapacity = encoder->keyframeCapacity > 0 ? encoder->keyframeCapacity * 2 : 64;
+    encoder->keyframes = realloc(encoder->keyframes, encoder->keyframeCapacity * sizeof(struct ReplayKeyframeEntry));
+    if (encoder->keyframes == NULL)
+    {
+      printf("Error: Memory allocation failed\n");
+      exit(1);
+    }
+  }
+
+  encoder->keyframes[encoder->keyframeCount++] = (struct ReplayKeyframeEntry){
+    .rounds = game->rounds,
+    .offset = encoder->length,
+  };
+  encoder->lastKeyframeRounds = game->rounds;
+
+  uint8_t *data = reserveReplayBytes(encoder, 1 + sizeof(keyframe));
+  data[0] = REPLAY_RECORD_KEYFRAME;
+  memcpy(data + 1, &keyframe, sizeof(keyframe));
+  encoder->length += 1 + sizeof(keyframe);
+}
+
+char *getReplayCauseName(enum ReplayChangeCause cause)
+{
+  switch (cause)
+  {
+    case REPLAY_CAUSE_MOVE:
+      return "move";
+    case REPLAY_CAUSE_CAPTURE:
+      return "capture";
+    case REPLAY_CAUSE_TELEPORT:
+      return "teleport";
+    case REPLAY_CAUSE_SPLIT:
+      return "split";
+  }
+
+  return "change";
+}
+
+// Turn observer: a keyframe at every keyframeInterval-th
+// round start, then the round and throw records
+void onReplayPhase(void *context, struct Game *game, struct Player *players, struct TurnState *turn)
+{
+  struct ReplayEncoder *encoder = context;
+  enum TurnPhase previousPhase = encoder->previousPhase;
+
+  encoder->previousPhase = turn->phase;
+
+  if (encoder->stopped)
+  {
+    return;
+  }
+
+  if (!encoder->started)
+  {
+    for (int color = 0; color < PLAYER_NO; color++)
+    {
+      for (int pieceIndex = 0; pieceIndex < PIECE_NO; pieceIndex++)
+      {
+        encoder->pieceCells[color][pieceIndex] = players[color].pieces[pieceIndex].cellNo;
+      }
+    }
+    encoder->mysteryCellNo = getReplayMysteryCell(game);
+    encoder->started = true;
+  }
+
+  switch (turn->phase)
+  {
+    case TURN_ROUND_START:
+      flushReplayThrow(encoder, game, players);
+
+      if (game->rounds >= encoder->stopRounds)
+      {
+        encoder->stopped = true;
+        break;
+      }
+
+      // not at the round start that ends the game
+      if
+      (
+        game->rounds % encoder->keyframeInterval == 0 && game->rounds != encoder->lastKeyframeRounds
+        && game->winIndex < PLAYER_NO - 1 && game->rounds < turn->maxRounds
+      )
+      {
+        writeReplayKeyframe(encoder, game, players);
+      }
+      break;
+
+    case TURN_PLAYER_START:
+      if (previousPhase == TURN_ROUND_START)
+      {
+        collectReplayChanges(encoder, game, players, EMPTY, REPLAY_CAUSE_CAPTURE);
+        writeReplayRecord(encoder, REPLAY_RECORD_ROUND);
+      }
+      break;
+
+    case TURN_THROW:
+      flushReplayThrow(encoder, game, players);
+      encoder->throwRecord = REPLAY_RECORD_THROW | turn->playerIndex << 2 | turn->diceNumber << 4;
+      encoder->throwPlayerIndex = turn->playerIndex;
+      encoder->throwPending = true;
+      break;
+
+    case TURN_AFTER_MOVE:
+      collectReplayChanges(encoder, game, players, turn->playerIndex, REPLAY_CAUSE_MOVE);
+      encoder->laterCause = REPLAY_CAUSE_TELEPORT;
+      break;
+
+    case TURN_PLAYER_END:
+      // the block of three sixes is split after this
+      if (encoder->throwPending)
+      {
+        collectReplayChanges(encoder, game, players, turn->playerIndex, REPLAY_CAUSE_TELEPORT);
+        encoder->laterCause = REPLAY_CAUSE_SPLIT;
+      }
+      break;
+
+    case TURN_GAME_OVER:
+      flushReplayThrow(encoder, game, players);
+      *reserveReplayBytes(encoder, 1) = REPLAY_RECORD_END;
+      encoder->length++;
+      encoder->stopped = true;
+      break;
+
+    default:
+      break;
+  }
+}
+
+/* Recording */
+
+static bool writeReplayBytes(FILE *file, void *data, size_t size)
+{
+  return fwrite(data, 1, size, file) == size;
+}
+
+// Append the game to the file and index its keyframes
+static void writeReplayGame
+(
+  struct ReplayWriter *writer, struct ReplayEncoder *encoder,
+  int gameIndex, struct GameResult *result
+)
+{
+  struct ReplayKeyframeEntry *keyframes = malloc((encoder->keyframeCount > 0 ? encoder->keyframeCount : 1) * sizeof(struct ReplayKeyframeEntry));
+
+  if (keyframes == NULL)
+  {
+    printf("Error: Memory allocation failed\n");
+    exit(1);
+  }
+
+  pthread_mutex_lock(&writer->lock);
+
+  uint64_t offset = writer->nextOffset;
+
+  if (!writeReplayBytes(writer->file, encoder->data, encoder->length))
+  {
+    writer->failed = true;
+  }
+  writer->nextOffset += encoder->length;
+
+  pthread_mutex_unlock(&writer->lock);
+
+  for (int keyframeIndex = 0; keyframeIndex < encoder->keyframeCount; keyframeIndex++)
+  {
+    keyframes[keyframeIndex] = encoder->keyframes[keyframeIndex];
+    keyframes[keyframeIndex].offset += offset;
+  }
+
+  struct ReplayGameEntry *entry = &writer->games[gameIndex];
+  entry->seed = result->seed;
+  entry->offset = offset;
+  entry->size = encoder->length;
+  entry->rounds = result->rounds;
+  for (int winIndex = 0; winIndex < PLAYER_NO; winIndex++)
+  {
+    entry->winners[winIndex] = result->winners[winIndex];
+  }
+  entry->keyframeCount = encoder->keyframeCount;
+  writer->keyframes[gameIndex] = keyframes;
+}
+
+static void *runReplayWorker(void *argument)
+{
+  struct ReplayWorker *worker = argument;
+  struct ReplayEncoder encoder;
+  struct TurnObserver observer = {onReplayPhase, &encoder};
+  struct GameResult result;
+
+  initializeReplayEncoder(&encoder, worker->keyframeInterval);
+  setTurnObserver(&observer);
+
+  for (int gameIndex = worker->firstGame; gameIndex < worker->lastGame; gameIndex++)
+  {
+    resetReplayEncoder(&encoder);
+    simulateGame(worker->firstSeed + gameIndex, worker->weights, &result);
+    writeReplayGame(worker->writer, &encoder, gameIndex, &result);
+  }
+
+  setTurnObserver(NULL);
+  freeReplayEncoder(&encoder);
+  return NULL;
+}
+
+// Play games like runGameBatch and record them with a
+// keyframe every keyframeInterval rounds
+bool recordReplayGames(char *fileName, uint64_t firstSeed, int gameCount, int keyframeInterval, int threadCount)
+{
+  struct ReplayWriter writer = {0};
+  struct ReplayFileHeader header = {0};
+  int weights[PLAYER_NO][WEIGHT_NO];
+
+  if (gameCount < 1)
+  {
+    printf("Error: No games to record\n");
+    return false;
+  }
+
+  if (keyframeInterval < 1)
+  {
+    keyframeInterval = REPLAY_KEYFRAME_INTERVAL;
+  }
+
+  if (threadCount < 1)
+  {
+    threadCount = getDefaultThreadCount();
+  }
+
+  if (threadCount > gameCount)
+  {
+    threadCount = gameCount;
+  }
+
+  writer.file = fopen(fileName, "wb");
+  if (writer.file == NULL)
+  {
+    printf("Error: Could not create %s\n", fileName);
+    return false;
+  }
+
+  writer.games = calloc(gameCount, sizeof(struct ReplayGameEntry));
+  writer.keyframes = calloc(gameCount, sizeof(struct ReplayKeyframeEntry *));
+  if (writer.games == NULL || writer.keyframes == NULL)
+  {
+    printf("Error: Memory allocation failed\n");
+    exit(1);
+  }
+
+  loadPieceWeights(WEIGHTS_CONFIG_FILE, weights);
+  loadEndgameTable(ENDGAME_TABLE_FILE);
+
+  header.magic = REPLAY_MAGIC;
+  header.keyframeInterval = keyframeInterval;
+  header.pieceSize = sizeof(struct Piece);
+  header.gameSize = sizeof(struct Game);
+  memcpy(header.weights, weights, sizeof(header.weights));
+
+  writer.failed = !writeReplayBytes(writer.file, &header, sizeof(header));
+  writer.nextOffset = sizeof(header);
+  pthread_mutex_init(&writer.lock, NULL);
+
+  struct ReplayWorker workers[threadCount];
+  long startNs = getReplayTimeNs();
+
+  for (int workerIndex = 0; workerIndex < threadCount; workerIndex++)
+  {
+    workers[workerIndex] = (struct ReplayWorker){
+      .writer = &writer,
+      .firstSeed = firstSeed,
+      .firstGame = (int)((long)gameCount * workerIndex / threadCount),
+      .lastGame = (int)((long)gameCount * (workerIndex + 1) / threadCount),
+      .keyframeInterval = keyframeInterval,
+      .weights = weights,
+    };
+
+    pthread_create(&workers[workerIndex].thread, NULL, runReplayWorker, &workers[workerIndex]);
+  }
+
+  for (int workerIndex = 0; workerIndex < threadCount; workerIndex++)
+  {
+    pthread_join(workers[workerIndex].thread, NULL);
+  }
+
+  pthread_mutex_destroy(&writer.lock);
+
+  // index in game order, whatever order the games were written in
+  struct ReplayFooter footer = {.magic = REPLAY_MAGIC, .gameCount = gameCount};
+  footer.keyframeTableOffset = writer.nextOffset;
+
+  for (int gameIndex = 0; gameIndex < gameCount; gameIndex++)
+  {
+    struct ReplayGameEntry *entry = &writer.games[gameIndex];
+
+    entry->firstKeyframe = footer.keyframeCount;
+    footer.keyframeCount += entry->keyframeCount;
+    writer.failed |= !writeReplayBytes(writer.file, writer.keyframes[gameIndex], entry->keyframeCount * sizeof(struct ReplayKeyframeEntry));
+    free(writer.keyframes[gameIndex]);
+  }
+
+  footer.gameTableOffset = footer.keyframeTableOffset + (uint64_t)footer.keyframeCount * sizeof(struct ReplayKeyframeEntry);
+  writer.failed |= !writeReplayBytes(writer.file, writer.games, gameCount * sizeof(struct ReplayGameEntry));
+  writer.failed |= !writeReplayBytes(writer.file, &footer, sizeof(footer));
+  writer.failed |= fclose(writer.file) != 0;
+
+  uint64_t fileSize = footer.gameTableOffset + gameCount * sizeof(struct ReplayGameEntry) + sizeof(footer);
+  long totalRounds = 0;
+  for (int gameIndex = 0; gameIndex < gameCount; gameIndex++)
+  {
+    totalRounds += writer.games[gameIndex].rounds;
+  }
+
+  free(writer.games);
+  free(writer.keyframes);
+
+  if (writer.failed)
+  {
+    printf("Error: Could not write %s\n", fileName);
+    return false;
+  }
+
+  printf
+  (
+    "Recorded %d games, %ld rounds and %u keyframes to %s in %.2f s, %.1f bytes per round\n",
+    gameCount, totalRounds, footer.keyframeCount, fileName,
+    (getReplayTimeNs() - startNs) / 1e9, (double)fileSize / (totalRounds > 0 ? totalRounds : 1)
+  );
+  return true;
+}
+
+/* Reading */
+
+static bool readReplayBytes(FILE *file, uint64_t offset, void *data, size_t size)
+{
+  return fseeko(file, (off_t)offset, SEEK_SET) == 0 && fread(data, 1, size, file) == size;
+}
+
+// Read the header and the index of a recorded file
+bool openReplayFile(char *fileName, struct ReplayFile *replay)
+{
+  memset(replay, 0, sizeof(struct ReplayFile));
+
+  replay->file = fopen(fileName, "rb");
+  if (replay->file == NULL)
+  {
+    printf("Error: Could not open %s\n", fileName);
+    return false;
+  }
+
+  bool valid = readReplayBytes(replay->file, 0, &replay->header, sizeof(replay->header))
+    && replay->header.magic == REPLAY_MAGIC
+    && replay->header.pieceSize == sizeof(struct Piece)
+    && replay->header.gameSize == sizeof(struct Game)
+    && fseeko(replay->file, -(off_t)sizeof(replay->footer), SEEK_END) == 0
+    && fread(&replay->footer, 1, sizeof(replay->footer), replay->file) == sizeof(replay->footer)
+    && replay->footer.magic == REPLAY_MAGIC;
+
+  if (valid)
+  {
+    replay->games = malloc((replay->footer.gameCount + 1) * sizeof(struct ReplayGameEntry));
+    replay->keyframes = malloc((replay->footer.keyframeCount + 1) * sizeof(struct ReplayKeyframeEntry));
+    if (replay->games == NULL || replay->keyframes == NULL)
+    {
+      printf("Error: Memory allocation failed\n");
+      exit(1);
+    }
+
+    valid = readReplayBytes(replay->file, replay->footer.gameTableOffset, replay->games, replay->footer.gameCount * sizeof(struct ReplayGameEntry))
+      && readReplayBytes(replay->file, replay->footer.keyframeTableOffset, replay->keyframes, replay->footer.keyframeCount * sizeof(struct ReplayKeyframeEntry));
+  }
+
+  if (!valid)
+  {
+    printf("Error: %s is not a replay file of this build\n", fileName);
+    closeReplayFile(replay);
+    return false;
+  }
+
+  return true;
+}
+
+void closeReplayFile(struct ReplayFile *replay)
+{
+  if (replay->file != NULL)
+  {
+    fclose(replay->file);
+  }
+  free(replay->games);
+  free(replay->keyframes);
+  replay->file = NULL;
+  replay->games = NULL;
+  replay->keyframes = NULL;
+}
+
+// Last keyframe of the game at or before the given number
+// of completed rounds
+static int findReplayKeyframe(struct ReplayFile *replay, struct ReplayGameEntry *entry, int rounds)
+{
+  int low = entry->firstKeyframe;
+  int high = entry->firstKeyframe + entry->keyframeCount - 1;
+
+  while (low < high)
+  {
+    int middle = (low + high + 1) / 2;
+
+    if (replay->keyframes[middle].rounds <= rounds)
+    {
+      low = middle;
+    }
+    else
+    {
+      high = middle - 1;
+    }
+  }
+
+  return low;
+}
+
+// End of the records that follow the keyframe
+static uint64_t getReplaySegmentEnd(struct ReplayFile *replay, struct ReplayGameEntry *entry, int keyframeIndex)
+{
+  if ((uint32_t)keyframeIndex + 1 < entry->firstKeyframe + entry->keyframeCount)
+  {
+    return replay->keyframes[keyframeIndex + 1].offset;
+  }
+
+  return entry->offset + entry->size;
+}
+
+static void restoreReplayKeyframe(struct GameSession *session, struct ReplayKeyframe *keyframe, int32_t weights[][WEIGHT_NO])
+{
+  session->game = keyframe->game;
+  resetPlayers(session->players);
+
+  for (int color = 0; color < PLAYER_NO; color++)
+  {
+    memcpy(session->players[color].pieces, keyframe->pieces[color], sizeof(keyframe->pieces[color]));
+    session->players[color].previousPieceIndex = keyframe->previousPieceIndex[color];
+    memcpy(session->players[color].weights, weights[color], sizeof(session->players[color].weights));
+  }
+
+  rebuildBoard(&session->board, session->players);
+  initializeTurnState(&session->turn, 0, MAX_GAME_ROUNDS);
+  session->randomState = keyframe->randomState;
+}
+
+// Position of the next record after the one at position
+static size_t skipReplayRecord(uint8_t *data, size_t position)
+{
+  uint8_t record = data[position];
+
+  switch (record & 3)
+  {
+    case REPLAY_RECORD_KEYFRAME:
+      return position + 1 + sizeof(struct ReplayKeyframe);
+    case REPLAY_RECORD_END:
+      return position + 1;
+    default:
+      return position + 2 + 2 * data[position + 1];
+  }
+}
+
+// Put the session at the start of the round: restore the
+// last keyframe before it and play the rounds in between
+// again. The records they give must match the recorded
+// ones, or the rules or behaviors changed since recording
+bool seekReplayGame
+(
+  struct ReplayFile *replay, int gameIndex, int round,
+  struct GameSession *session, struct ReplaySeekStats *stats
+)
+{
+  long startNs = getReplayTimeNs();
+
+  if (gameIndex < 0 || (uint32_t)gameIndex >= replay->footer.gameCount)
+  {
+    printf("Error: The file has no game %d\n", gameIndex);
+    return false;
+  }
+
+  struct ReplayGameEntry *entry = &replay->games[gameIndex];
+
+  if (round < 1 || round > entry->rounds)
+  {
+    printf("Error: Game %d has no round %d\n", gameIndex, round);
+    return false;
+  }
+
+  int keyframeIndex = findReplayKeyframe(replay, entry, round - 1);
+  uint64_t offset = replay->keyframes[keyframeIndex].offset;
+  size_t length = getReplaySegmentEnd(replay, entry, keyframeIndex) - offset;
+  uint8_t *data = malloc(length);
+  struct ReplayKeyframe keyframe;
+
+  if (data == NULL)
+  {
+    printf("Error: Memory allocation failed\n");
+    exit(1);
+  }
+
+  if
+  (
+    length < 1 + sizeof(keyframe) || !readReplayBytes(replay->file, offset, data, length)
+    || data[0] != REPLAY_RECORD_KEYFRAME
+  )
+  {
+    printf("Error: Could not read the keyframe of game %d\n", gameIndex);
+    free(data);
+    return false;
+  }
+
+  memcpy(&keyframe, data + 1, sizeof(keyframe));
+  restoreReplayKeyframe(session, &keyframe, replay->header.weights);
+
+  struct ReplayEncoder encoder;
+  struct TurnObserver observer = {onReplayPhase, &encoder};
+
+  initializeReplayEncoder(&encoder, replay->header.keyframeInterval);
+  encoder.lastKeyframeRounds = keyframe.game.rounds;
+  encoder.stopRounds = round - 1;
+
+  setTurnObserver(&observer);
+  session->turn.maxRounds = round - 1;
+  advanceGameSession(session);
+  setTurnObserver(NULL);
+
+  session->turn.phase = TURN_ROUND_START;
+  session->turn.maxRounds = MAX_GAME_ROUNDS;
+
+  size_t recordsStart = 1 + sizeof(keyframe);
+  bool matches = encoder.length <= length - recordsStart && memcmp(encoder.data, data + recordsStart, encoder.length) == 0;
+
+  stats->keyframeRounds = keyframe.game.rounds;
+  stats->replayedRounds = session->game.rounds - keyframe.game.rounds;
+  stats->replayedThrows = 0;
+  for (size_t position = 0; position < encoder.length; position = skipReplayRecord(encoder.data, position))
+  {
+    stats->replayedThrows += (encoder.data[position] & 3) == REPLAY_RECORD_THROW;
+  }
+  stats->readBytes = length;
+  stats->roundOffset = offset + recordsStart + encoder.length;
+  stats->seekNs = getReplayTimeNs() - startNs;
+
+  freeReplayEncoder(&encoder);
+  free(data);
+
+  if (!matches)
+  {
+    printf("Error: Game %d played again differs from its recording before round %d\n", gameIndex, round);
+    return false;
+  }
+
+  return true;
+}
+
+/* Output */
+
+static void displayReplayChanges(uint8_t *changes, int8_t pieceCells[][PIECE_NO])
+{
+  char from[16], to[16];
+
+  for (int changeIndex = 0; changeIndex < changes[0]; changeIndex++)
+  {
+    uint8_t id = changes[1 + 2 * changeIndex];
+    int8_t cellNo = changes[2 + 2 * changeIndex];
+
+    if (id == REPLAY_MYSTERY_CHANGE)
+    {
+      if (cellNo == BASE)
+      {
+        printf("  mystery cell removed\n");
+      }
+      else
+      {
+        printf("  mystery cell at L%d\n", cellNo);
+      }
+      continue;
+    }
+
+    int color = REPLAY_CHANGE_PIECE(id) / PIECE_NO;
+    int pieceIndex = REPLAY_CHANGE_PIECE(id) % PIECE_NO;
+
+    printf
+    (
+      "  %s %c%d %s -> %s\n", getReplayCauseName(REPLAY_CHANGE_CAUSE(id)), getName(color)[0], pieceIndex + 1,
+      formatCellName(pieceCells[color][pieceIndex], from), formatCellName(cellNo, to)
+    );
+    pieceCells[color][pieceIndex] = cellNo;
+  }
+}
+
+// Print the recorded throws of the round the session is at
+static void displayReplayRound(struct ReplayFile *replay, struct ReplayGameEntry *entry, struct GameSession *session, uint64_t offset)
+{
+  uint64_t end = entry->offset + entry->size;
+  int8_t pieceCells[PLAYER_NO][PIECE_NO];
+
+  for (int keyframeIndex = entry->firstKeyframe; keyframeIndex < (int)(entry->firstKeyframe + entry->keyframeCount); keyframeIndex++)
+  {
+    if (replay->keyframes[keyframeIndex].offset > offset)
+    {
+      end = replay->keyframes[keyframeIndex].offset;
+      break;
+    }
+  }
+
+  for (int color = 0; color < PLAYER_NO; color++)
+  {
+    for (int pieceIndex = 0; pieceIndex < PIECE_NO; pieceIndex++)
+    {
+      pieceCells[color][pieceIndex] = session->players[color].pieces[pieceIndex].cellNo;
+    }
+  }
+
+  size_t length = end - offset;
+  uint8_t *data = malloc(length > 0 ? length : 1);
+
+  if (data == NULL)
+  {
+    printf("Error: Memory allocation failed\n");
+    exit(1);
+  }
+
+  if (!readReplayBytes(replay->file, offset, data, length))
+  {
+    printf("Error: Could not read the records of round %d\n", session->game.rounds + 1);
+    free(data);
+    return;
+  }
+
+  printf("Recorded throws of round %d:\n", session->game.rounds + 1);
+
+  for (size_t position = 0; position < length; position = skipReplayRecord(data, position))
+  {
+    uint8_t record = data[position];
+
+    if (((record & 3) == REPLAY_RECORD_ROUND && position > 0) || (record & 3) == REPLAY_RECORD_KEYFRAME)
+    {
+      break;
+    }
+
+    if ((record & 3) == REPLAY_RECORD_END)
+    {
+      printf("Game over\n");
+      break;
+    }
+
+    if ((record & 3) == REPLAY_RECORD_THROW)
+    {
+      printf("%s rolled %d\n", getName(record >> 2 & 3), record >> 4 & 7);
+    }
+    displayReplayChanges(data + position + 1, pieceCells);
+  }
+
+  free(data);
+}
+
+static void displayReplaySummary(struct ReplayFile *replay)
+{
+  long totalRounds = 0;
+  int longestGame = 0;
+
+  for (uint32_t gameIndex = 0; gameIndex < replay->footer.gameCount; gameIndex++)
+  {
+    totalRounds += replay->games[gameIndex].rounds;
+    if (replay->games[gameIndex].rounds > replay->games[longestGame].rounds)
+    {
+      longestGame = gameIndex;
+    }
+  }
+
+  printf
+  (
+    "%u games, %ld rounds, %u keyframes every %u rounds\n",
+    replay->footer.gameCount, totalRounds, replay->footer.keyframeCount, replay->header.keyframeInterval
+  );
+
+  if (replay->footer.gameCount > 0)
+  {
+    printf
+    (
+      "Longest game is %d with %d rounds (seed %llu)\n", longestGame,
+      replay->games[longestGame].rounds, (unsigned long long)replay->games[longestGame].seed
+    );
+  }
+}
+
+// Print the index of the file, or seek to the round of the
+// game and print the position and the throws of the round
+bool showReplay(char *fileName, int gameIndex, int round)
+{
+  struct ReplayFile replay;
+  struct GameSession session;
+  struct ReplaySeekStats stats;
+
+  if (!openReplayFile(fileName, &replay))
+  {
+    return false;
+  }
+
+  if (gameIndex < 0)
+  {
+    displayReplaySummary(&replay);
+    closeReplayFile(&replay);
+    return true;
+  }
+
+  // the engine has to make the same moves as when recording
+  loadEndgameTable(ENDGAME_TABLE_FILE);
+  setGameOutput(false);
+
+  bool found = seekReplayGame(&replay, gameIndex, round, &session, &stats);
+  if (found)
+  {
+    struct ReplayGameEntry *entry = &replay.games[gameIndex];
+
+    printf
+    (
+      "Game %d (seed %llu, %d rounds): round %d from the keyframe after round %d, "
+      "%d rounds and %d throws played again, %ld bytes read in %.1f us\n\n",
+      gameIndex, (unsigned long long)entry->seed, entry->rounds, round, stats.keyframeRounds,
+      stats.replayedRounds, stats.replayedThrows, stats.readBytes, stats.seekNs / 1e3
+    );
+
+    setGameOutput(true);
+    displayPlayerStatusAfterRound(session.players, &session.game, &session.board);
+    displayMysteryCellStatusAfterRound(session.game.mysteryCellNo, session.game.mysteryRounds);
+    gameLog("\n");
+
+    displayReplayRound(&replay, entry, &session, stats.roundOffset);
+  }
+
+  closeReplayFile(&replay);
+  return found;
+}
@@ -0,0 +1,169 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "types.h"
+
+#define REPLAY_FILE "games.replay"
+#define REPLAY_MAGIC 0x33594C5052444CULL // "LDRPLY3"
+#define REPLAY_KEYFRAME_INTERVAL 64 // rounds between keyframes
+#define REPLAY_MYSTERY_CHANGE 0xFF // change id of the mystery cell
+#define REPLAY_MAX_CHANGES 64 // of one record
+#define REPLAY_CHANGE_PIECE(id) ((id) & 0x0F) // color * PIECE_NO + piece index
+#define REPLAY_CHANGE_CAUSE(id) ((id) >> 4)
+
+// Replay container of many recorded games.
+//
+// header | game 0 records | game 1 records | ... |
+// keyframe table | game table | footer
+//
+// The records of a game are a byte stream. The first byte
+// has the kind in its low 2 bits:
+//
+// KEYFRAME  followed by a struct ReplayKeyframe, written at
+//           the start of every keyframeInterval-th round
+// ROUND     start of the next round, then the changes of
+//           the round start
+// THROW     bits 2-3 player, bits 4-6 dice, then the changes
+//           of the move and of what followed it in the turn
+// END       game over
+//
+// Changes are a count byte and count pairs of (id, cell).
+// The id is cause << 4 | color * PIECE_NO + piece index, or
+// REPLAY_MYSTERY_CHANGE, and the cell is the new cell as int8
+// (BASE when the mystery cell goes). A piece can change more
+// than once in a throw, a move and then a teleport.
+//
+// The footer is at the end of the file, so games can be
+// appended while the index is only written once
+enum ReplayRecordKind
+{
+  REPLAY_RECORD_ROUND,
+  REPLAY_RECORD_THROW,
+  REPLAY_RECORD_KEYFRAME,
+  REPLAY_RECORD_END
+};
+
+// Why a piece changed its cell. Pieces of other colors than
+// the player of the throw only change by captures
+enum ReplayChangeCause
+{
+  REPLAY_CAUSE_MOVE,
+  REPLAY_CAUSE_CAPTURE,
+  REPLAY_CAUSE_TELEPORT, // by the mystery cell the piece landed on
+  REPLAY_CAUSE_SPLIT // of a block after three sixes
+};
+
+struct ReplayFileHeader
+{
+  uint64_t magic;
+  uint32_t keyframeInterval;
+  uint16_t pieceSize; // layout check of the keyframes
+  uint16_t gameSize;
+  int32_t weights[PLAYER_NO][WEIGHT_NO];
+} __attribute__((aligned(8)));
+
+// Everything the turn engine needs to go on from the start
+// of a round. The board is rebuilt from the pieces
+struct ReplayKeyframe
+{
+  uint64_t randomState;
+  struct Game game;
+  struct Piece pieces[PLAYER_NO][PIECE_NO];
+  int previousPieceIndex[PLAYER_NO];
+};
+
+struct ReplayKeyframeEntry
+{
+  int32_t rounds; // completed rounds of the keyframe
+  uint32_t reserved;
+  uint64_t offset; // of the KEYFRAME record in the file
+};
+
+struct ReplayGameEntry
+{
+  uint64_t seed;
+  uint64_t offset;
+  uint64_t size;
+  int32_t rounds;
+  int32_t winners[PLAYER_NO];
+  uint32_t firstKeyframe;
+  uint32_t keyframeCount;
+};
+
+struct ReplayFooter
+{
+  uint64_t keyframeTableOffset;
+  uint64_t gameTableOffset;
+  uint32_t keyframeCount;
+  uint32_t gameCount;
+  uint64_t magic;
+};
+
+// Turn observer that writes the records of one game to
+// memory. Keyframe offsets are relative to the game start
+struct ReplayEncoder
+{
+  uint8_t *data;
+  size_t length;
+  size_t capacity;
+  struct ReplayKeyframeEntry *keyframes;
+  int keyframeCount;
+  int keyframeCapacity;
+  int keyframeInterval;
+  int lastKeyframeRounds;
+  int stopRounds; // stop recording at the start of this round, for seeks
+  bool started;
+  bool stopped;
+  bool throwPending;
+  uint8_t throwRecord;
+  int throwPlayerIndex;
+  enum ReplayChangeCause laterCause; // of the changes after the move
+  int changeCount;
+  uint8_t changes[2 * REPLAY_MAX_CHANGES];
+  enum TurnPhase previousPhase;
+  int8_t mysteryCellNo;
+  int8_t pieceCells[PLAYER_NO][PIECE_NO];
+};
+
+struct ReplayFile
+{
+  FILE *file;
+  struct ReplayFileHeader header;
+  struct ReplayFooter footer;
+  struct ReplayGameEntry *games;
+  struct ReplayKeyframeEntry *keyframes;
+};
+
+// What a seek cost
+struct ReplaySeekStats
+{
+  int keyframeRounds;
+  int replayedRounds;
+  int replayedThrows;
+  long readBytes;
+  uint64_t roundOffset; // of the records of the round
+  long seekNs;
+};
+
+// Function declarations for recording and seeking replays
+
+void initializeReplayEncoder(struct ReplayEncoder *encoder, int keyframeInterval);
+void resetReplayEncoder(struct ReplayEncoder *encoder);
+void freeReplayEncoder(struct ReplayEncoder *encoder);
+char *getReplayCauseName(enum ReplayChangeCause cause);
+void onReplayPhase(void *context, struct Game *game, struct Player *players, struct TurnState *turn);
+bool recordReplayGames(char *fileName, uint64_t firstSeed, int gameCount, int keyframeInterval, int threadCount);
+bool openReplayFile(char *fileName, struct ReplayFile *replay);
+void closeReplayFile(struct ReplayFile *replay);
+bool seekReplayGame
+(
+  struct ReplayFile *replay, int gameIndex, int round,
+  struct GameSession *session, struct ReplaySeekStats *stats
+);
+bool showReplay(char *fileName, int gameIndex, int round);
+
+#endif // !REPLAY_H
@@ -0,0 +1,209 @@
+#include "scheduler.h"
+#include "game.h"
+#include "endgame.h"
+#include <pthread.h>
+#include <string.h>
+
+struct SchedulerWorker
+{
+  pthread_t thread;
+  uint64_t firstSeed;
+  int nextGame;
+  int lastGame;
+  int (*weights)[WEIGHT_NO];
+  uint8_t evaluatedColors;
+  struct BatchEvaluator *evaluator;
+  int batchSize;
+  struct GameResult *results;
+};
+
+static void recordScheduledResult(struct SchedulerWorker *worker, struct ScheduledGame *slot)
+{
+  struct GameResult *result = &worker->results[slot->gameIndex];
+
+  result->seed = worker->firstSeed + slot->gameIndex;
+  result->rounds = slot->session.game.rounds;
+  for (int winIndex = 0; winIndex < PLAYER_NO; winIndex++)
+  {
+    result->winners[winIndex] = slot->session.game.winners[winIndex];
+  }
+}
+
+// Start the next game of the worker in the slot, or leave
+// the slot inactive when all games have been started
+static bool startScheduledGame(struct SchedulerWorker *worker, struct ScheduledGame *slot)
+{
+  if (worker->nextGame == worker->lastGame)
+  {
+    slot->active = false;
+    return false;
+  }
+
+  slot->gameIndex = worker->nextGame++;
+  slot->active = true;
+  startGameSession
+  (
+    &slot->session, worker->firstSeed + slot->gameIndex, worker->weights,
+    worker->evaluatedColors, MAX_GAME_ROUNDS
+  );
+
+  return true;
+}
+
+// Play the game of the slot until its next decision. Games
+// that end are replaced by the next game of the worker
+static void advanceScheduledGame(struct SchedulerWorker *worker, struct ScheduledGame *slot)
+{
+  while (slot->active)
+  {
+    enum TurnEvent event = advanceGameSession(&slot->session);
+
+    if (event == TURN_EVENT_DECISION)
+    {
+      return;
+    }
+
+    if (event == TURN_EVENT_GAME_OVER)
+    {
+      recordScheduledResult(worker, slot);
+      startScheduledGame(worker, slot);
+    }
+  }
+}
+
+static void *runSchedulerWorker(void *argument)
+{
+  struct SchedulerWorker *worker = argument;
+  int batchSize = worker->batchSize;
+  struct ScheduledGame *slots = calloc(batchSize, sizeof(struct ScheduledGame));
+  struct DecisionRequest *requests = calloc(batchSize, sizeof(struct DecisionRequest));
+  int *actions = calloc(batchSize, sizeof(int));
+  int *slotIndexes = calloc(batchSize, sizeof(int));
+
+  if (slots == NULL || requests == NULL || actions == NULL || slotIndexes == NULL)
+  {
+    printf("Error: Memory allocation failed\n");
+    exit(1);
+  }
+
+  setGameOutput(false);
+
+  for (int slotIndex = 0; slotIndex < batchSize; slotIndex++)
+  {
+    if (startScheduledGame(worker, &slots[slotIndex]))
+    {
+      advanceScheduledGame(worker, &slots[slotIndex]);
+    }
+  }
+
+  while (true)
+  {
+    // every active game waits on a decision here
+    int count = 0;
+    for (int slotIndex = 0; slotIndex < batchSize; slotIndex++)
+    {
+      struct GameSession *session = &slots[slotIndex].session;
+      if (!slots[slotIndex].active)
+      {
+        continue;
+      }
+
+      requests[count] = (struct DecisionRequest){
+        slots[slotIndex].gameIndex,
+        session->players,
+        session->turn.playerIndex,
+        session->turn.diceNumber,
+        &session->board,
+        session->game.mysteryCellNo,
+        session->turn.legalMask,
+      };
+      slotIndexes[count] = slotIndex;
+      count++;
+    }
+
+    if (count == 0)
+    {
+      break;
+    }
+
+    worker->evaluator->evaluate(worker->evaluator->context, requests, count, actions);
+
+    for (int index = 0; index < count; index++)
+    {
+      struct ScheduledGame *slot = &slots[slotIndexes[index]];
+
+      resumeGameSession(&slot->session, actions[index]);
+      advanceScheduledGame(worker, slot);
+    }
+  }
+
+  free(slots);
+  free(requests);
+  free(actions);
+  free(slotIndexes);
+
+  return NULL;
+}
+
+// Play gameCount games where the moves of the evaluated
+// colors are chosen by the evaluator. Each worker keeps up to
+// batchSize games in flight on one thread and evaluates their
+// pending decisions together. Game i is always played with
+// seed firstSeed + i, so results do not depend on the batch
+// size or thread count when the evaluator is deterministic.
+// Batching pays off for evaluators with a cost per call, such
+// as an agent process. The in-process MLP costs the same per
+// decision at any batch size (see evaluatePolicyBatch) and a
+// large batch only adds the cache misses of the games in flight
+void runScheduledGames
+(
+  uint64_t firstSeed, int gameCount, int weights[][WEIGHT_NO],
+  uint8_t evaluatedColors, struct BatchEvaluator *evaluator,
+  int batchSize, int threadCount, struct GameResult *results
+)
+{
+  if (batchSize < 1)
+  {
+    batchSize = 1;
+  }
+
+  if (batchSize > SCHEDULER_MAX_BATCH)
+  {
+    batchSize = SCHEDULER_MAX_BATCH;
+  }
+
+  if (threadCount < 1)
+  {
+    threadCount = 1;
+  }
+
+  if (threadCount > gameCount)
+  {
+    threadCount = gameCount > 0 ? gameCount : 1;
+  }
+
+  loadEndgameTable(ENDGAME_TABLE_FILE);
+
+  struct SchedulerWorker workers[threadCount];
+
+  for (int workerIndex = 0; workerIndex < threadCount; workerIndex++)
+  {
+    workers[workerIndex] = (struct SchedulerWorker){
+      .firstSeed = firstSeed,
+      .nextGame = (int)((long)gameCount * workerIndex / threadCount),
+      .lastGame = (int)((long)gameCount * (workerIndex + 1) / threadCount),
+      .weights = weights,
+      .evaluatedColors = evaluatedColors,
+      .evaluator = evaluator,
+      .batchSize = batchSize,
+      .results = results,
+    };
+
+    pthread_create(&workers[workerIndex].thread, NULL, runSchedulerWorker, &workers[workerIndex]);
+  }
+
+  for (int workerIndex = 0; workerIndex < threadCount; workerIndex++)
+  {
+    pthread_join(workers[workerIndex].thread, NULL);
+  }
+}
@@ -0,0 +1,33 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include "types.h"
+#include "simulation.h"
+
+#define SCHEDULER_MAX_BATCH 4096
+
+// One of the games a scheduler worker keeps in flight
+struct ScheduledGame
+{
+  struct GameSession session;
+  int gameIndex;
+  bool active;
+};
+
+// Function declarations for playing games with batched
+// decisions
+
+void runScheduledGames
+(
+  uint64_t firstSeed,
+  int gameCount,
+  int weights[][WEIGHT_NO],
+  uint8_t evaluatedColors,
+  struct BatchEvaluator *evaluator,
+  int batchSize,
+  int threadCount,
+  struct GameResult *results
+);
+
+#endif // !SCHEDULER_H
@@ -0,0 +1,315 @@
+#include "selfplay.h"
+#include "game.h"
+#include "simulation.h"
+#include "endgame.h"
+#include <pthread.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+struct SelfPlayWorker
+{
+  pthread_t thread;
+  struct SampleRing *ring;
+  uint64_t firstSeed;
+  int firstGame;
+  int lastGame;
+  int (*weights)[WEIGHT_NO];
+
+  // tickets of the game being played, back-filled at its end
+  uint64_t *tickets;
+  int ticketCount;
+  int ticketCapacity;
+  uint64_t seed;
+  int moveNo;
+};
+
+/* Ring file */
+
+// Map the ring file, creating it when it does not exist or
+// has another layout. An existing ring keeps its samples
+// and new tickets continue after its head. Only one
+// generator may write to a ring at a time
+bool openSampleRing(char *fileName, uint64_t capacity, struct SampleRing *ring)
+{
+  int file = open(fileName, O_RDWR | O_CREAT, 0644);
+  if (file < 0)
+  {
+    printf("Error: Could not open %s\n", fileName);
+    return false;
+  }
+
+  size_t mappedSize = sizeof(struct SampleRingHeader) + capacity * sizeof(struct TrainingSample);
+  struct SampleRingHeader existing = {0};
+  bool reuse = pread(file, &existing, sizeof(existing), 0) == sizeof(existing)
+    && existing.magic == SAMPLE_RING_MAGIC
+    && existing.sampleSize == sizeof(struct TrainingSample)
+    && existing.capacity == capacity;
+
+  // truncating to zero first clears the samples of an old layout
+  if (!reuse && (ftruncate(file, 0) != 0 || ftruncate(file, mappedSize) != 0))
+  {
+    printf("Error: Could not resize %s\n", fileName);
+    close(file);
+    return false;
+  }
+
+  void *mapping = mmap(NULL, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+  close(file);
+
+  if (mapping == MAP_FAILED)
+  {
+    printf("Error: Could not map %s\n", fileName);
+    return false;
+  }
+
+  ring->header = mapping;
+  ring->samples = (struct TrainingSample *)(ring->header + 1);
+  ring->mappedSize = mappedSize;
+
+  if (!reuse)
+  {
+    ring->header->magic = SAMPLE_RING_MAGIC;
+    ring->header->sampleSize = sizeof(struct TrainingSample);
+    ring->header->capacity = capacity;
+    atomic_store(&ring->header->head, 0);
+  }
+  else
+  {
+    // slots left locked by a generator that was killed
+    for (uint64_t index = 0; index < capacity; index++)
+    {
+      uint64_t expected = SAMPLE_LOCKED;
+      atomic_compare_exchange_strong(&ring->samples[index].sequence, &expected, 0);
+    }
+  }
+
+  return true;
+}
+
+void closeSampleRing(struct SampleRing *ring)
+{
+  munmap(ring->header, ring->mappedSize);
+  ring->header = NULL;
+  ring->samples = NULL;
+}
+
+struct TrainingSample *getSampleOfTicket(struct SampleRing *ring, uint64_t ticket)
+{
+  return &ring->samples[ticket % ring->header->capacity];
+}
+
+// Check after reading a sample in place. sequence is the
+// value loaded with acquire before the fields were read
+bool isSampleComplete(struct TrainingSample *sample, uint64_t ticket, uint64_t sequence)
+{
+  atomic_thread_fence(memory_order_acquire);
+
+  return sequence == 2 * ticket + 2 && atomic_load_explicit(&sample->sequence, memory_order_relaxed) == sequence;
+}
+
+// Take a slot from readers and other writers, returning
+// the sequence it had
+static uint64_t lockSample(struct TrainingSample *sample)
+{
+  uint64_t sequence = atomic_load_explicit(&sample->sequence, memory_order_relaxed);
+
+  while (true)
+  {
+    if (sequence == SAMPLE_LOCKED)
+    {
+      sequence = atomic_load_explicit(&sample->sequence, memory_order_relaxed);
+      continue;
+    }
+
+    if (atomic_compare_exchange_weak_explicit(&sample->sequence, &sequence, SAMPLE_LOCKED, memory_order_acq_rel, memory_order_relaxed))
+    {
+      return sequence;
+    }
+  }
+}
+
+/* Sample writer */
+
+static void addWorkerTicket(struct SelfPlayWorker *worker, uint64_t ticket)
+{
+  if (worker->ticketCount == worker->ticketCapacity)
+  {
+    worker->ticketCapacity = worker->ticketCapacity > 0 ? worker->ticketCapacity * 2 : 1024;
+    worker->tickets = realloc(worker->tickets, worker->ticketCapacity * sizeof(uint64_t));
+    if (worker->tickets == NULL)
+    {
+      printf("Error: Memory allocation failed\n");
+      exit(1);
+    }
+  }
+
+  worker->tickets[worker->ticketCount++] = ticket;
+}
+
+// Move observer of the worker threads. Moves without a
+// choice (nothing can move) are not written
+static void recordTrainingSample
+(
+  void *context, struct Player *players, int playerIndex, int diceNumber,
+  struct Board *board, int mysteryCellNo, int pieceIndex, bool blockMove
+)
+{
+  struct SelfPlayWorker *worker = context;
+  struct Player *player = &players[playerIndex];
+  uint8_t legalMask = getLegalMoveMask(player, diceNumber, board);
+
+  worker->moveNo++;
+  if (legalMask == 0)
+  {
+    return;
+  }
+
+  int action = pieceIndex;
+  if (blockMove && canBlockMove(player, pieceIndex, diceNumber, board))
+  {
+    action += PIECE_NO;
+  }
+
+  uint64_t ticket = atomic_fetch_add_explicit(&worker->ring->header->head, 1, memory_order_relaxed);
+  struct TrainingSample *sample = getSampleOfTicket(worker->ring, ticket);
+
+  lockSample(sample);
+
+  sample->seed = worker->seed;
+  for (int color = 0; color < PLAYER_NO; color++)
+  {
+    for (int index = 0; index < PIECE_NO; index++)
+    {
+      struct Piece *piece = &players[color].pieces[index];
+      sample->pieceCells[color][index] = piece->cellNo;
+      sample->pieceFlags[color][index] = getPieceFlags(piece, board);
+    }
+  }
+  sample->moveNo = worker->moveNo;
+  sample->mysteryCellNo = mysteryCellNo == EMPTY ? BASE : mysteryCellNo;
+  sample->playerIndex = playerIndex;
+  sample->diceNumber = diceNumber;
+  sample->action = action;
+  sample->legalMask = legalMask;
+  sample->outcome = SAMPLE_NO_OUTCOME;
+
+  atomic_store_explicit(&sample->sequence, 2 * ticket + 1, memory_order_release);
+
+  addWorkerTicket(worker, ticket);
+}
+
+// Write the final rank of the mover into every sample of
+// the game still in the ring and mark them complete
+static void backfillOutcomes(struct SelfPlayWorker *worker, struct GameResult *result)
+{
+  uint8_t ranks[PLAYER_NO] = {SAMPLE_NO_OUTCOME};
+
+  for (int winIndex = 0; winIndex < PLAYER_NO; winIndex++)
+  {
+    if (result->winners[winIndex] != EMPTY)
+    {
+      ranks[result->winners[winIndex]] = winIndex + 1;
+    }
+  }
+
+  for (int index = 0; index < worker->ticketCount; index++)
+  {
+    uint64_t ticket = worker->tickets[index];
+    struct TrainingSample *sample = getSampleOfTicket(worker->ring, ticket);
+    uint64_t sequence = lockSample(sample);
+
+    // the slot was reused by a later ticket
+    if (sequence != 2 * ticket + 1)
+    {
+      atomic_store_explicit(&sample->sequence, sequence, memory_order_release);
+      continue;
+    }
+
+    sample->outcome = ranks[sample->playerIndex];
+    atomic_store_explicit(&sample->sequence, 2 * ticket + 2, memory_order_release);
+  }
+
+  worker->ticketCount = 0;
+}
+
+static void *runSelfPlayWorker(void *argument)
+{
+  struct SelfPlayWorker *worker = argument;
+  struct MoveObserver observer = {recordTrainingSample, worker};
+  struct GameResult result;
+
+  setMoveObserver(&observer);
+
+  for (int gameIndex = worker->firstGame; gameIndex < worker->lastGame; gameIndex++)
+  {
+    worker->seed = worker->firstSeed + gameIndex;
+    worker->moveNo = 0;
+
+    simulateGame(worker->seed, worker->weights, &result);
+    backfillOutcomes(worker, &result);
+  }
+
+  setMoveObserver(NULL);
+  free(worker->tickets);
+
+  return NULL;
+}
+
+// Play games with the color behaviors on every core and
+// stream their moves to the ring file. Game i is played
+// with seed firstSeed + i, so a run with the same seeds
+// writes the same samples
+void generateSelfPlaySamples(char *fileName, uint64_t firstSeed, int gameCount, uint64_t capacity, int threadCount)
+{
+  struct SampleRing ring;
+  int weights[PLAYER_NO][WEIGHT_NO];
+
+  if (gameCount < 1 || capacity < 1 || !openSampleRing(fileName, capacity, &ring))
+  {
+    return;
+  }
+
+  if (threadCount < 1)
+  {
+    threadCount = getDefaultThreadCount();
+  }
+
+  if (threadCount > gameCount)
+  {
+    threadCount = gameCount;
+  }
+
+  loadPieceWeights(WEIGHTS_CONFIG_FILE, weights);
+  loadEndgameTable(ENDGAME_TABLE_FILE);
+
+  uint64_t firstTicket = atomic_load(&ring.header->head);
+
+  struct SelfPlayWorker workers[threadCount];
+  memset(workers, 0, sizeof(workers));
+
+  for (int workerIndex = 0; workerIndex < threadCount; workerIndex++)
+  {
+    workers[workerIndex].ring = &ring;
+    workers[workerIndex].firstSeed = firstSeed;
+    workers[workerIndex].firstGame = (int)((long)gameCount * workerIndex / threadCount);
+    workers[workerIndex].lastGame = (int)((long)gameCount * (workerIndex + 1) / threadCount);
+    workers[workerIndex].weights = weights;
+
+    pthread_create(&workers[workerIndex].thread, NULL, runSelfPlayWorker, &workers[workerIndex]);
+  }
+
+  for (int workerIndex = 0; workerIndex < threadCount; workerIndex++)
+  {
+    pthread_join(workers[workerIndex].thread, NULL);
+  }
+
+  uint64_t lastTicket = atomic_load(&ring.header->head);
+  printf("Wrote %llu samples of %d games to %s\n", (unsigned long long)(lastTicket - firstTicket), gameCount, fileName);
+  printf("Ring holds tickets %llu to %llu\n",
+    (unsigned long long)(lastTicket > capacity ? lastTicket - capacity : 0),
+    (unsigned long long)lastTicket);
+
+  closeSampleRing(&ring);
+}
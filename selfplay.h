@@ -0,0 +1,66 @@
+#ifndef SELFPLAY_H
+#define SELFPLAY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "types.h"
+
+#define SAMPLE_RING_FILE "samples.ring"
+#define SAMPLE_RING_MAGIC 0x31474E4952444CULL // "LDRING1"
+#define SAMPLE_RING_CAPACITY (1 << 20) // samples, 64 MiB
+#define SAMPLE_LOCKED UINT64_MAX
+#define SAMPLE_NO_OUTCOME 0
+
+// One behavior move of a self-play game. The sequence of
+// the sample written with ticket t is 2t + 1 until the
+// outcome of its game is known and 2t + 2 after that, and
+// SAMPLE_LOCKED while a writer holds the slot.
+//
+// A consumer reads ticket t from slot t % capacity in place:
+// load sequence (acquire) and check it is 2t + 2, read the
+// fields, then load sequence again and drop the sample if it
+// changed (the slot was reused by a later ticket).
+struct TrainingSample
+{
+  _Atomic uint64_t sequence;
+  uint64_t seed; // of the game, to group samples by game
+  int8_t pieceCells[PLAYER_NO][PIECE_NO]; // BASE, track, home straight or HOME, by color
+  uint8_t pieceFlags[PLAYER_NO][PIECE_NO]; // PIECE_FLAG bits
+  uint16_t moveNo; // behavior moves made so far in the game
+  int8_t mysteryCellNo; // BASE when there is none
+  uint8_t playerIndex;
+  uint8_t diceNumber; // after the mystery effects
+  uint8_t action; // piece index, plus PIECE_NO for a block move
+  uint8_t legalMask; // bit per action
+  uint8_t outcome; // final rank of playerIndex, SAMPLE_NO_OUTCOME if the game was cut
+  uint8_t reserved[8];
+} __attribute__((aligned(64)));
+
+// head is the next ticket. Samples follow the header
+struct SampleRingHeader
+{
+  uint64_t magic;
+  uint32_t sampleSize;
+  uint32_t reserved;
+  uint64_t capacity;
+  _Atomic uint64_t head;
+} __attribute__((aligned(64)));
+
+struct SampleRing
+{
+  struct SampleRingHeader *header;
+  struct TrainingSample *samples;
+  size_t mappedSize;
+};
+
+// Function declarations for the self-play sample generator
+
+bool openSampleRing(char *fileName, uint64_t capacity, struct SampleRing *ring);
+void closeSampleRing(struct SampleRing *ring);
+struct TrainingSample *getSampleOfTicket(struct SampleRing *ring, uint64_t ticket);
+bool isSampleComplete(struct TrainingSample *sample, uint64_t ticket, uint64_t sequence);
+void generateSelfPlaySamples(char *fileName, uint64_t firstSeed, int gameCount, uint64_t capacity, int threadCount);
+
+#endif // !SELFPLAY_H
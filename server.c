@@ -0,0 +1,790 @@
+#define _GNU_SOURCE
+#include "server.h"
+#include "game.h"
+#include "agent.h"
+#include "endgame.h"
+#include <errno.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+struct GameServer
+{
+  int listenSocket;
+  int epollFile;
+  int maxSessions;
+  int sessionCount;
+  struct ServerSession **sessions; // by session no
+  int *freeSessionNos;
+  int freeSessionCount;
+  int *readySessionNos; // ring of the sessions with rounds to play
+  bool *readyQueued; // by session no, whether it is in the ring
+  int readyFirst;
+  int readyCount;
+  int weights[PLAYER_NO][WEIGHT_NO];
+  long gameCount;
+  long turnCount;
+};
+
+static volatile sig_atomic_t serverStopped = false;
+
+static void stopGameServer(int signalNo)
+{
+  (void)signalNo;
+  serverStopped = true;
+}
+
+// Sessions and stand-in clients need a file per socket
+static void raiseFileLimit()
+{
+  struct rlimit limit;
+
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max)
+  {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+}
+
+static bool fillSocketAddress(struct sockaddr_un *address, char *socketPath)
+{
+  memset(address, 0, sizeof(struct sockaddr_un));
+  address->sun_family = AF_UNIX;
+
+  if (strlen(socketPath) >= sizeof(address->sun_path))
+  {
+    printf("Error: Socket path %s is too long\n", socketPath);
+    return false;
+  }
+
+  strcpy(address->sun_path, socketPath);
+  return true;
+}
+
+/* Session output */
+
+static void watchSession(struct GameServer *server, struct ServerSession *session, uint32_t events)
+{
+  struct epoll_event event = {events, {.ptr = session}};
+
+  epoll_ctl(server->epollFile, EPOLL_CTL_MOD, session->socket, &event);
+}
+
+static bool queueSessionOutput(struct ServerSession *session, char *format, ...)
+{
+  va_list arguments;
+  va_start(arguments, format);
+  int written = vsnprintf(session->output + session->outputLength, SERVER_OUTPUT_SIZE - session->outputLength, format, arguments);
+  va_end(arguments);
+
+  if (written < 0 || session->outputLength + written >= SERVER_OUTPUT_SIZE)
+  {
+    return false;
+  }
+
+  session->outputLength += written;
+  return true;
+}
+
+// Write what the socket takes. The rest waits for EPOLLOUT
+// and the lines of the session are not handled meanwhile
+static bool flushSessionOutput(struct GameServer *server, struct ServerSession *session)
+{
+  while (session->outputOffset < session->outputLength)
+  {
+    ssize_t written = send
+    (
+      session->socket, session->output + session->outputOffset,
+      session->outputLength - session->outputOffset, MSG_NOSIGNAL
+    );
+
+    if (written > 0)
+    {
+      session->outputOffset += written;
+    }
+    else if (written < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    else if (written < 0 && errno == EAGAIN)
+    {
+      if (!session->outputPending)
+      {
+        session->outputPending = true;
+        watchSession(server, session, EPOLLOUT);
+      }
+      return true;
+    }
+    else
+    {
+      return false;
+    }
+  }
+
+  session->outputOffset = 0;
+  session->outputLength = 0;
+
+  if (session->outputPending)
+  {
+    session->outputPending = false;
+    watchSession(server, session, EPOLLIN);
+  }
+
+  return true;
+}
+
+/* Session games */
+
+// Queue the session to play its next rounds after the
+// events already waiting
+static void queueReadySession(struct GameServer *server, struct ServerSession *session)
+{
+  session->stepping = true;
+  if (!server->readyQueued[session->sessionNo])
+  {
+    server->readyQueued[session->sessionNo] = true;
+    server->readySessionNos[(server->readyFirst + server->readyCount++) % server->maxSessions] = session->sessionNo;
+  }
+}
+
+// Play the game of the session until a color of the client
+// has to move or the game is over, SERVER_STEP_ROUNDS rounds
+// at most. A game that has more rounds to play on its own,
+// like one without colors of the client, goes to the ready
+// list so it does not hold up the other sessions
+static bool advanceServerSession(struct GameServer *server, struct ServerSession *session)
+{
+  struct GameSession *game = &session->game;
+  int stepRounds = game->game.rounds + SERVER_STEP_ROUNDS;
+
+  session->stepping = false;
+  game->turn.maxRounds = stepRounds < MAX_GAME_ROUNDS ? stepRounds : MAX_GAME_ROUNDS;
+
+  while (true)
+  {
+    enum TurnEvent event = advanceGameSession(game);
+
+    if (event == TURN_EVENT_DECISION)
+    {
+      struct DecisionRequest request = {
+        session->sessionNo,
+        game->players,
+        game->turn.playerIndex,
+        game->turn.diceNumber,
+        &game->board,
+        game->game.mysteryCellNo,
+        game->turn.legalMask,
+      };
+      char line[AGENT_REQUEST_LINE_SIZE];
+
+      formatDecisionRequest(line, &request);
+      server->turnCount++;
+      return queueSessionOutput(session, "turn %s\n", line);
+    }
+
+    // stopped by the step and not by the end of the game
+    if (event == TURN_EVENT_GAME_OVER && game->turn.maxRounds < MAX_GAME_ROUNDS && game->game.winIndex < PLAYER_NO - 1)
+    {
+      game->turn.phase = TURN_ROUND_START;
+      queueReadySession(server, session);
+      return true;
+    }
+
+    if (event == TURN_EVENT_GAME_OVER)
+    {
+      int *winners = game->game.winners;
+
+      session->playing = false;
+      server->gameCount++;
+      return queueSessionOutput
+      (
+        session, "over %d %d %d %d %d\n", game->game.rounds,
+        winners[0] < 0 ? -1 : winners[0], winners[1] < 0 ? -1 : winners[1],
+        winners[2] < 0 ? -1 : winners[2], winners[3] < 0 ? -1 : winners[3]
+      );
+    }
+  }
+}
+
+static bool parseColorList(char *colorList, uint8_t *colors)
+{
+  *colors = 0;
+
+  if (strcasecmp(colorList, "none") == 0)
+  {
+    return true;
+  }
+
+  for (char *name = strtok(colorList, ","); name != NULL; name = strtok(NULL, ","))
+  {
+    int colorIndex = 0;
+    while (colorIndex < PLAYER_NO && strcasecmp(name, getName(colorIndex)) != 0)
+    {
+      colorIndex++;
+    }
+
+    if (colorIndex == PLAYER_NO)
+    {
+      return false;
+    }
+
+    *colors |= 1 << colorIndex;
+  }
+
+  return true;
+}
+
+// Handle one line of the client. Returns false when the
+// session should be closed
+static bool handleSessionLine(struct GameServer *server, struct ServerSession *session, char *line)
+{
+  unsigned long long seed;
+  char colorList[64];
+  int action;
+
+  if (sscanf(line, "play %llu %63s", &seed, colorList) == 2)
+  {
+    uint8_t remoteColors;
+
+    if (session->playing)
+    {
+      return queueSessionOutput(session, "error game in progress\n");
+    }
+
+    if (!parseColorList(colorList, &remoteColors))
+    {
+      return queueSessionOutput(session, "error unknown color\n");
+    }
+
+    startGameSession(&session->game, seed, server->weights, remoteColors, MAX_GAME_ROUNDS);
+    session->playing = true;
+    return advanceServerSession(server, session);
+  }
+
+  if (sscanf(line, "move %d", &action) == 1)
+  {
+    if (!session->playing)
+    {
+      return queueSessionOutput(session, "error no game in progress\n");
+    }
+
+    if (session->stepping || session->game.turn.phase != TURN_DECISION)
+    {
+      return queueSessionOutput(session, "error no move expected\n");
+    }
+
+    resumeGameSession(&session->game, action >= 0 ? action : EMPTY);
+    return advanceServerSession(server, session);
+  }
+
+  if (strcmp(line, "quit") == 0)
+  {
+    return false;
+  }
+
+  return queueSessionOutput(session, "error unknown command\n");
+}
+
+/* Sessions */
+
+static void closeServerSession(struct GameServer *server, struct ServerSession *session)
+{
+  epoll_ctl(server->epollFile, EPOLL_CTL_DEL, session->socket, NULL);
+  close(session->socket);
+
+  server->sessions[session->sessionNo] = NULL;
+  server->freeSessionNos[server->freeSessionCount++] = session->sessionNo;
+  server->sessionCount--;
+  free(session);
+}
+
+static void acceptServerSessions(struct GameServer *server)
+{
+  while (true)
+  {
+    int socket = accept4(server->listenSocket, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (socket < 0)
+    {
+      // EAGAIN once the backlog is empty, or out of files
+      return;
+    }
+
+    struct ServerSession *session = server->freeSessionCount > 0 ? malloc(sizeof(struct ServerSession)) : NULL;
+    if (session == NULL)
+    {
+      send(socket, "error server full\n", 18, MSG_NOSIGNAL);
+      close(socket);
+      continue;
+    }
+
+    session->socket = socket;
+    session->sessionNo = server->freeSessionNos[--server->freeSessionCount];
+    session->playing = false;
+    session->stepping = false;
+    session->outputPending = false;
+    session->inputLength = 0;
+    session->outputLength = 0;
+    session->outputOffset = 0;
+
+    server->sessions[session->sessionNo] = session;
+    server->sessionCount++;
+
+    struct epoll_event event = {EPOLLIN, {.ptr = session}};
+    epoll_ctl(server->epollFile, EPOLL_CTL_ADD, socket, &event);
+
+    queueSessionOutput(session, "ludo %d\n", AGENT_PROTOCOL_VERSION);
+    if (!flushSessionOutput(server, session))
+    {
+      closeServerSession(server, session);
+    }
+  }
+}
+
+// Handle the complete lines of the input until one leaves
+// output the socket could not take. Returns false when the
+// session should be closed
+static bool handleSessionInput(struct GameServer *server, struct ServerSession *session)
+{
+  char *line = session->input;
+  char *end;
+
+  while (!session->outputPending && (end = memchr(line, '\n', session->input + session->inputLength - line)) != NULL)
+  {
+    *end = '\0';
+    if (end > line && end[-1] == '\r')
+    {
+      end[-1] = '\0';
+    }
+
+    if (!handleSessionLine(server, session, line) || !flushSessionOutput(server, session))
+    {
+      return false;
+    }
+
+    line = end + 1;
+  }
+
+  session->inputLength -= line - session->input;
+  memmove(session->input, line, session->inputLength);
+
+  // a line longer than the buffer is not part of the protocol
+  return session->outputPending || session->inputLength < SERVER_INPUT_SIZE;
+}
+
+// Handle the lines held back by pending output, then read
+// the input of the session until the socket is empty or
+// output is pending again. Returns false when the session
+// should be closed
+static bool readServerSession(struct GameServer *server, struct ServerSession *session)
+{
+  if (!handleSessionInput(server, session))
+  {
+    return false;
+  }
+
+  while (!session->outputPending)
+  {
+    ssize_t count = recv(session->socket, session->input + session->inputLength, SERVER_INPUT_SIZE - session->inputLength, 0);
+
+    if (count == 0)
+    {
+      return false;
+    }
+
+    if (count < 0)
+    {
+      return errno == EAGAIN || errno == EINTR;
+    }
+
+    session->inputLength += count;
+    if (!handleSessionInput(server, session))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Play the next rounds of the sessions on the ready list,
+// once each. Sessions queued again wait for the next pass
+static void stepReadySessions(struct GameServer *server)
+{
+  for (int count = server->readyCount; count > 0; count--)
+  {
+    int sessionNo = server->readySessionNos[server->readyFirst];
+    struct ServerSession *session = server->sessions[sessionNo];
+
+    server->readyFirst = (server->readyFirst + 1) % server->maxSessions;
+    server->readyCount--;
+    server->readyQueued[sessionNo] = false;
+
+    // closed, or a new session with the same no
+    if (session == NULL || !session->stepping)
+    {
+      continue;
+    }
+
+    if (!advanceServerSession(server, session) || !flushSessionOutput(server, session))
+    {
+      closeServerSession(server, session);
+    }
+  }
+}
+
+/* Server */
+
+static bool openGameServer(struct GameServer *server, char *socketPath, int maxSessions)
+{
+  struct sockaddr_un address;
+
+  if (!fillSocketAddress(&address, socketPath))
+  {
+    return false;
+  }
+
+  server->listenSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  unlink(socketPath);
+
+  if
+  (
+    server->listenSocket < 0
+    || bind(server->listenSocket, (struct sockaddr *)&address, sizeof(address)) != 0
+    || listen(server->listenSocket, SOMAXCONN) != 0
+  )
+  {
+    printf("Error: Could not listen on %s\n", socketPath);
+    return false;
+  }
+
+  server->epollFile = epoll_create1(EPOLL_CLOEXEC);
+  struct epoll_event event = {EPOLLIN, {.ptr = NULL}};
+  epoll_ctl(server->epollFile, EPOLL_CTL_ADD, server->listenSocket, &event);
+
+  server->maxSessions = maxSessions;
+  server->sessionCount = 0;
+  server->sessions = calloc(maxSessions, sizeof(struct ServerSession *));
+  server->freeSessionNos = malloc(maxSessions * sizeof(int));
+  server->readySessionNos = malloc(maxSessions * sizeof(int));
+  server->readyQueued = calloc(maxSessions, sizeof(bool));
+  if (server->sessions == NULL || server->freeSessionNos == NULL || server->readySessionNos == NULL || server->readyQueued == NULL)
+  {
+    printf("Error: Memory allocation failed\n");
+    exit(1);
+  }
+
+  // lowest session nos are handed out first
+  for (int index = 0; index < maxSessions; index++)
+  {
+    server->freeSessionNos[index] = maxSessions - 1 - index;
+  }
+  server->freeSessionCount = maxSessions;
+  server->readyFirst = 0;
+  server->readyCount = 0;
+
+  return true;
+}
+
+static void closeGameServer(struct GameServer *server, char *socketPath)
+{
+  for (int sessionNo = 0; sessionNo < server->maxSessions; sessionNo++)
+  {
+    if (server->sessions[sessionNo] != NULL)
+    {
+      closeServerSession(server, server->sessions[sessionNo]);
+    }
+  }
+
+  close(server->epollFile);
+  close(server->listenSocket);
+  unlink(socketPath);
+  free(server->sessions);
+  free(server->freeSessionNos);
+  free(server->readySessionNos);
+  free(server->readyQueued);
+}
+
+// Serve games on the Unix socket until SIGINT or SIGTERM.
+// One thread runs every session from an epoll loop, a game
+// advances when its client answers a turn, and rounds the
+// client takes no part in are played a step per loop pass
+bool runGameServer(char *socketPath, int maxSessions)
+{
+  static struct GameServer server;
+  struct epoll_event events[SERVER_EVENT_NO];
+
+  if (maxSessions < 1 || maxSessions > SERVER_MAX_SESSIONS)
+  {
+    maxSessions = SERVER_MAX_SESSIONS;
+  }
+
+  raiseFileLimit();
+  if (!openGameServer(&server, socketPath, maxSessions))
+  {
+    return false;
+  }
+
+  loadPieceWeights(WEIGHTS_CONFIG_FILE, server.weights);
+  loadEndgameTable(ENDGAME_TABLE_FILE);
+  setGameOutput(false);
+
+  // no SA_RESTART, so the signal ends epoll_wait
+  struct sigaction action = {0};
+  action.sa_handler = stopGameServer;
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+
+  printf("Serving up to %d sessions on %s\n", maxSessions, socketPath);
+  fflush(stdout);
+
+  while (!serverStopped)
+  {
+    int eventCount = epoll_wait(server.epollFile, events, SERVER_EVENT_NO, server.readyCount > 0 ? 0 : -1);
+
+    for (int index = 0; index < eventCount; index++)
+    {
+      struct ServerSession *session = events[index].data.ptr;
+
+      if (session == NULL)
+      {
+        acceptServerSessions(&server);
+      }
+      else if (events[index].events & EPOLLOUT)
+      {
+        // pending output first, then the input it held back
+        if (!flushSessionOutput(&server, session) || (!session->outputPending && !readServerSession(&server, session)))
+        {
+          closeServerSession(&server, session);
+        }
+      }
+      else if (events[index].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+      {
+        if (!readServerSession(&server, session))
+        {
+          closeServerSession(&server, session);
+        }
+      }
+    }
+
+    stepReadySessions(&server);
+  }
+
+  printf("Served %ld games and %ld turns\n", server.gameCount, server.turnCount);
+  closeGameServer(&server, socketPath);
+  return true;
+}
+
+/* Stand-in clients */
+
+struct StandInClient
+{
+  int socket;
+  int gamesLeft;
+  int inputLength;
+  long sentNs; // when the last line was sent
+  char input[SERVER_OUTPUT_SIZE];
+};
+
+struct ClientStatistics
+{
+  long turnCount;
+  long gameCount;
+  long latencySumNs;
+  long *latencyCounts; // by microsecond
+};
+
+static long getClientTimeNs()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return now.tv_sec * 1000000000L + now.tv_nsec;
+}
+
+static bool sendClientLine(struct StandInClient *client, char *line, int length)
+{
+  client->sentNs = getClientTimeNs();
+
+  // lines are short and answered before the next one is sent
+  return send(client->socket, line, length, MSG_NOSIGNAL) == length;
+}
+
+static bool startClientGame(struct StandInClient *client, uint64_t seed)
+{
+  char line[64];
+  int length = snprintf(line, sizeof(line), "play %llu yellow,blue,red,green\n", (unsigned long long)seed);
+
+  client->gamesLeft--;
+  return sendClientLine(client, line, length);
+}
+
+static void recordClientLatency(struct ClientStatistics *statistics, struct StandInClient *client)
+{
+  long latencyNs = getClientTimeNs() - client->sentNs;
+  long bucket = latencyNs / 1000;
+
+  statistics->latencySumNs += latencyNs;
+  statistics->latencyCounts[bucket < CLIENT_LATENCY_BUCKET_NO ? bucket : CLIENT_LATENCY_BUCKET_NO - 1]++;
+}
+
+// Answer one server line. Returns false when the client is done
+static bool handleClientLine(struct StandInClient *client, char *line, uint64_t seed, struct ClientStatistics *statistics)
+{
+  int gameIndex, playerIndex, diceNumber, legalMask;
+
+  if (sscanf(line, "turn %d %d %d %d", &gameIndex, &playerIndex, &diceNumber, &legalMask) == 4)
+  {
+    char answer[32];
+    int length = snprintf(answer, sizeof(answer), "move %d\n", selectReferenceAction(legalMask));
+
+    recordClientLatency(statistics, client);
+    statistics->turnCount++;
+    return sendClientLine(client, answer, length);
+  }
+
+  if (strncmp(line, "over ", 5) == 0)
+  {
+    statistics->gameCount++;
+    return client->gamesLeft > 0 && startClientGame(client, seed);
+  }
+
+  if (strncmp(line, "ludo ", 5) == 0)
+  {
+    return startClientGame(client, seed);
+  }
+
+  printf("Error: Unexpected server line %s\n", line);
+  return false;
+}
+
+static double getLatencyPercentile(struct ClientStatistics *statistics, double fraction)
+{
+  long target = (long)(statistics->turnCount * fraction);
+  long count = 0;
+
+  for (int bucket = 0; bucket < CLIENT_LATENCY_BUCKET_NO; bucket++)
+  {
+    count += statistics->latencyCounts[bucket];
+    if (count > target)
+    {
+      return bucket;
+    }
+  }
+
+  return CLIENT_LATENCY_BUCKET_NO;
+}
+
+// Connect sessionCount clients that each play gamesPerSession
+// games moving every color with the first legal action, and
+// show the turn latency seen by the clients. All clients play
+// at once, so the latency includes the wait behind the turns
+// of the other sessions
+bool runStandInClients(char *socketPath, int sessionCount, int gamesPerSession)
+{
+  struct sockaddr_un address;
+  struct ClientStatistics statistics = {0};
+  struct epoll_event events[SERVER_EVENT_NO];
+
+  if (!fillSocketAddress(&address, socketPath))
+  {
+    return false;
+  }
+
+  raiseFileLimit();
+
+  struct StandInClient *clients = calloc(sessionCount, sizeof(struct StandInClient));
+  statistics.latencyCounts = calloc(CLIENT_LATENCY_BUCKET_NO, sizeof(long));
+  int epollFile = epoll_create1(EPOLL_CLOEXEC);
+
+  if (clients == NULL || statistics.latencyCounts == NULL)
+  {
+    printf("Error: Memory allocation failed\n");
+    exit(1);
+  }
+
+  int openCount = 0;
+  for (int index = 0; index < sessionCount; index++)
+  {
+    struct StandInClient *client = &clients[index];
+
+    client->socket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    client->gamesLeft = gamesPerSession;
+
+    // a blocking connect waits while the server backlog is full
+    if (client->socket < 0 || connect(client->socket, (struct sockaddr *)&address, sizeof(address)) != 0)
+    {
+      printf("Error: Could not connect client %d to %s\n", index, socketPath);
+      close(client->socket);
+      client->socket = -1;
+      continue;
+    }
+
+    struct epoll_event event = {EPOLLIN, {.ptr = client}};
+    epoll_ctl(epollFile, EPOLL_CTL_ADD, client->socket, &event);
+    openCount++;
+  }
+
+  long startNs = getClientTimeNs();
+
+  while (openCount > 0)
+  {
+    int eventCount = epoll_wait(epollFile, events, SERVER_EVENT_NO, -1);
+
+    for (int index = 0; index < eventCount; index++)
+    {
+      struct StandInClient *client = events[index].data.ptr;
+      uint64_t seed = (uint64_t)(client - clients) * gamesPerSession + client->gamesLeft;
+      ssize_t count = recv(client->socket, client->input + client->inputLength, SERVER_OUTPUT_SIZE - client->inputLength, 0);
+      bool open = count > 0;
+
+      if (open)
+      {
+        client->inputLength += count;
+
+        char *line = client->input;
+        char *end;
+        while (open && (end = memchr(line, '\n', client->input + client->inputLength - line)) != NULL)
+        {
+          *end = '\0';
+          open = handleClientLine(client, line, seed, &statistics);
+          line = end + 1;
+        }
+
+        client->inputLength -= line - client->input;
+        memmove(client->input, line, client->inputLength);
+      }
+
+      if (!open)
+      {
+        epoll_ctl(epollFile, EPOLL_CTL_DEL, client->socket, NULL);
+        close(client->socket);
+        openCount--;
+      }
+    }
+  }
+
+  double seconds = (getClientTimeNs() - startNs) / 1e9;
+
+  printf("Clients: %d, games: %ld, turns: %ld in %.2f s (%.0f turns/s)\n", sessionCount, statistics.gameCount, statistics.turnCount, seconds, statistics.turnCount / seconds);
+  if (statistics.turnCount > 0)
+  {
+    printf
+    (
+      "Turn latency: mean %.1f us, p50 %.0f us, p99 %.0f us\n",
+      statistics.latencySumNs / 1000.0 / statistics.turnCount,
+      getLatencyPercentile(&statistics, 0.5), getLatencyPercentile(&statistics, 0.99)
+    );
+  }
+
+  close(epollFile);
+  free(clients);
+  free(statistics.latencyCounts);
+  return true;
+}
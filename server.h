@@ -0,0 +1,55 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "types.h"
+
+#define SERVER_SOCKET_FILE "ludo.sock"
+#define SERVER_MAX_SESSIONS 16384
+#define SERVER_EVENT_NO 256 // epoll events handled per wait
+#define SERVER_INPUT_SIZE 128
+#define SERVER_OUTPUT_SIZE 512
+#define SERVER_STEP_ROUNDS 8 // rounds a game plays without its client before the loop moves on
+#define CLIENT_LATENCY_BUCKET_NO 1000000 // microseconds up to 1 s, the last bucket takes the rest
+
+// Line protocol of a session, one game at a time over a
+// Unix stream socket. Fields are separated by single spaces
+// and every message ends with '\n'.
+//
+// server: ludo <version>
+// client: play <seed> <colors>
+//         colors is a comma separated list of the colors the
+//         client moves (yellow,red), or "none"
+// server: turn <request line of the agent protocol>
+// client: move <action>
+//         -1 or an illegal action leaves the move to the
+//         built-in behavior, like the agent protocol
+// server: over <rounds> <winner 1> ... <winner 4>
+//         color indexes in finishing order, -1 when the game
+//         was cut at MAX_GAME_ROUNDS
+// client: play ... for the next game, or quit
+//
+// Unknown or misplaced lines are answered with error <reason>.
+// A human can play with socat - UNIX-CONNECT:ludo.sock
+struct ServerSession
+{
+  int socket;
+  int sessionNo;
+  bool playing; // the game waits for a move of the client
+  bool stepping; // the game has rounds to play on the ready list
+  bool outputPending; // waiting for the socket to take the rest of output
+  uint16_t inputLength;
+  uint16_t outputLength;
+  uint16_t outputOffset;
+  char input[SERVER_INPUT_SIZE];
+  char output[SERVER_OUTPUT_SIZE];
+  struct GameSession game;
+};
+
+// Function declarations for the local game server
+
+bool runGameServer(char *socketPath, int maxSessions);
+bool runStandInClients(char *socketPath, int sessionCount, int gamesPerSession);
+
+#endif // !SERVER_H
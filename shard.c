@@ -0,0 +1,364 @@
+#include "shard.h"
+#include "game.h"
+#include "simulation.h"
+#include "steal.h"
+#include <string.h>
+
+// A shard file read back for merging
+struct ShardFile
+{
+  struct ShardFileHeader header;
+  struct ShardGameRecord *records;
+};
+
+// Read "i/N" with 0 <= i < N
+bool parseShardSpec(char *text, int *shardIndex, int *shardCount)
+{
+  char *end;
+  long index = strtol(text, &end, 10);
+
+  if (end == text || *end != '/')
+  {
+    return false;
+  }
+
+  char *countText = end + 1;
+  long count = strtol(countText, &end, 10);
+
+  if (end == countText || *end != '\0' || count < 1 || index < 0 || index >= count)
+  {
+    return false;
+  }
+
+  *shardIndex = (int)index;
+  *shardCount = (int)count;
+  return true;
+}
+
+static uint16_t packShardWinners(int *winners)
+{
+  uint16_t packed = 0;
+
+  for (int winIndex = 0; winIndex < PLAYER_NO; winIndex++)
+  {
+    int color = winners[winIndex] == EMPTY ? SHARD_EMPTY_WINNER : winners[winIndex];
+    packed |= (uint16_t)(color << (4 * winIndex));
+  }
+
+  return packed;
+}
+
+static void displayShardTotals(struct ShardFileHeader *header)
+{
+  long gameCount = header->lastGame - header->firstGame;
+
+  printf
+  (
+    "Games %u to %u of %u (seeds from %llu), %.1f rounds per game\n",
+    header->firstGame, header->lastGame, header->gameCount,
+    (unsigned long long)header->firstSeed, gameCount > 0 ? (double)header->roundCount / gameCount : 0.0
+  );
+  printf("Ranks (1st, 2nd, 3rd, 4th)\n");
+  for (int color = 0; color < PLAYER_NO; color++)
+  {
+    printf
+    (
+      "  %-6s %8lld %8lld %8lld %8lld\n", getName(color),
+      (long long)header->rankCounts[color][0], (long long)header->rankCounts[color][1],
+      (long long)header->rankCounts[color][2], (long long)header->rankCounts[color][3]
+    );
+  }
+}
+
+static bool writeShardFile(char *fileName, struct ShardFileHeader *header, struct ShardGameRecord *records)
+{
+  FILE *file = fopen(fileName, "wb");
+  if (file == NULL)
+  {
+    printf("Error: Could not create %s\n", fileName);
+    return false;
+  }
+
+  size_t recordCount = header->hasRecords ? header->lastGame - header->firstGame : 0;
+  bool written = fwrite(header, sizeof(struct ShardFileHeader), 1, file) == 1
+    && fwrite(records, sizeof(struct ShardGameRecord), recordCount, file) == recordCount;
+
+  if (fclose(file) != 0 || !written)
+  {
+    printf("Error: Could not write %s\n", fileName);
+    return false;
+  }
+
+  return true;
+}
+
+/* Shards
+  */
+
+// Play the games of one shard and write their totals, and
+// a record per game when asked, to the file
+bool runShard
+(
+  char *fileName, int shardIndex, int shardCount, int gameCount,
+  uint64_t firstSeed, bool withRecords, int threadCount
+)
+{
+  struct ShardFileHeader header;
+
+  if (gameCount < 1 || shardIndex < 0 || shardIndex >= shardCount)
+  {
+    printf("Error: No games in shard %d of %d\n", shardIndex, shardCount);
+    return false;
+  }
+
+  memset(&header, 0, sizeof(header));
+  header.magic = SHARD_MAGIC;
+  header.firstSeed = firstSeed;
+  header.gameCount = gameCount;
+  header.shardIndex = shardIndex;
+  header.shardCount = shardCount;
+  header.firstGame = (uint32_t)((long)gameCount * shardIndex / shardCount);
+  header.lastGame = (uint32_t)((long)gameCount * (shardIndex + 1) / shardCount);
+  header.hasRecords = withRecords;
+  loadPieceWeights(WEIGHTS_CONFIG_FILE, (int (*)[WEIGHT_NO])header.weights);
+
+  int shardGames = header.lastGame - header.firstGame;
+  struct GameResult *results = malloc((shardGames > 0 ? shardGames : 1) * sizeof(struct GameResult));
+  struct ShardGameRecord *records = malloc((shardGames > 0 ? shardGames : 1) * sizeof(struct ShardGameRecord));
+
+  if (results == NULL || records == NULL)
+  {
+    printf("Error: Memory allocation failed\n");
+    exit(1);
+  }
+
+  if (threadCount < 1)
+  {
+    threadCount = getDefaultThreadCount();
+  }
+
+  if
+  (
+    shardGames > 0
+    && !runStealingGameBatch
+    (
+      firstSeed + header.firstGame, shardGames,
+      (int (*)[WEIGHT_NO])header.weights, threadCount, results
+    )
+  )
+  {
+    printf("Error: Games of shard %d of %d were not all played\n", shardIndex, shardCount);
+    free(results);
+    free(records);
+    return false;
+  }
+
+  for (int gameIndex = 0; gameIndex < shardGames; gameIndex++)
+  {
+    header.roundCount += results[gameIndex].rounds;
+    for (int winIndex = 0; winIndex < PLAYER_NO; winIndex++)
+    {
+      if (results[gameIndex].winners[winIndex] != EMPTY)
+      {
+        header.rankCounts[results[gameIndex].winners[winIndex]][winIndex]++;
+      }
+    }
+
+    records[gameIndex].rounds = (uint16_t)results[gameIndex].rounds;
+    records[gameIndex].winners = packShardWinners(results[gameIndex].winners);
+  }
+
+  bool written = writeShardFile(fileName, &header, records);
+  if (written)
+  {
+    printf("Shard %d of %d written to %s\n", shardIndex, shardCount, fileName);
+    displayShardTotals(&header);
+  }
+
+  free(results);
+  free(records);
+  return written;
+}
+
+/* Merging
+  */
+
+static bool readShardFile(char *fileName, struct ShardFile *shard)
+{
+  FILE *file = fopen(fileName, "rb");
+
+  shard->records = NULL;
+  if (file == NULL)
+  {
+    printf("Error: Could not open %s\n", fileName);
+    return false;
+  }
+
+  bool valid = fread(&shard->header, sizeof(shard->header), 1, file) == 1
+    && shard->header.magic == SHARD_MAGIC
+    && shard->header.firstGame <= shard->header.lastGame
+    && shard->header.lastGame <= shard->header.gameCount;
+
+  if (valid && shard->header.hasRecords)
+  {
+    size_t recordCount = shard->header.lastGame - shard->header.firstGame;
+
+    shard->records = malloc((recordCount > 0 ? recordCount : 1) * sizeof(struct ShardGameRecord));
+    if (shard->records == NULL)
+    {
+      printf("Error: Memory allocation failed\n");
+      exit(1);
+    }
+    valid = fread(shard->records, sizeof(struct ShardGameRecord), recordCount, file) == recordCount;
+  }
+
+  fclose(file);
+  if (!valid)
+  {
+    printf("Error: %s is not a complete shard file\n", fileName);
+  }
+
+  return valid;
+}
+
+static int compareShardFiles(const void *first, const void *second)
+{
+  return (int)((struct ShardFile *)first)->header.shardIndex - (int)((struct ShardFile *)second)->header.shardIndex;
+}
+
+// Check that the shards are all the shards of one run
+static bool checkShardFiles(struct ShardFile *shards, int fileCount)
+{
+  struct ShardFileHeader *first = &shards[0].header;
+
+  if ((int)first->shardCount != fileCount)
+  {
+    printf("Error: The run has %u shards, %d were given\n", first->shardCount, fileCount);
+    return false;
+  }
+
+  for (int fileIndex = 0; fileIndex < fileCount; fileIndex++)
+  {
+    struct ShardFileHeader *header = &shards[fileIndex].header;
+
+    if
+    (
+      header->firstSeed != first->firstSeed || header->gameCount != first->gameCount
+      || header->shardCount != first->shardCount || header->hasRecords != first->hasRecords
+      || memcmp(header->weights, first->weights, sizeof(first->weights)) != 0
+    )
+    {
+      printf("Error: Shard %u is not from the same run as shard %u\n", header->shardIndex, first->shardIndex);
+      return false;
+    }
+
+    // sorted by index, so a missing or repeated shard breaks this
+    if ((int)header->shardIndex != fileIndex)
+    {
+      printf("Error: Shard %d is missing or given twice\n", fileIndex);
+      return false;
+    }
+
+    uint32_t firstGame = (uint32_t)((long)header->gameCount * fileIndex / header->shardCount);
+    uint32_t lastGame = (uint32_t)((long)header->gameCount * (fileIndex + 1) / header->shardCount);
+    if (header->firstGame != firstGame || header->lastGame != lastGame)
+    {
+      printf("Error: Shard %d does not have the games of its index\n", fileIndex);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Combine the shard files of a run into the file a single
+// process (shard 0/1) would have written
+bool mergeShardFiles(char *outputName, int fileCount, char **fileNames)
+{
+  struct ShardFile *shards = calloc(fileCount > 0 ? fileCount : 1, sizeof(struct ShardFile));
+  bool merged = false;
+
+  if (shards == NULL)
+  {
+    printf("Error: Memory allocation failed\n");
+    exit(1);
+  }
+
+  int readCount = 0;
+  while (readCount < fileCount && readShardFile(fileNames[readCount], &shards[readCount]))
+  {
+    readCount++;
+  }
+
+  if (fileCount < 1)
+  {
+    printf("Error: No shard files to merge\n");
+  }
+  else if (readCount == fileCount)
+  {
+    qsort(shards, fileCount, sizeof(struct ShardFile), compareShardFiles);
+    merged = checkShardFiles(shards, fileCount);
+  }
+
+  if (merged)
+  {
+    struct ShardFileHeader header = shards[0].header;
+    struct ShardGameRecord *records = NULL;
+
+    header.shardIndex = 0;
+    header.shardCount = 1;
+    header.firstGame = 0;
+    header.lastGame = header.gameCount;
+    header.roundCount = 0;
+    memset(header.rankCounts, 0, sizeof(header.rankCounts));
+
+    if (header.hasRecords)
+    {
+      records = malloc(header.gameCount * sizeof(struct ShardGameRecord));
+      if (records == NULL)
+      {
+        printf("Error: Memory allocation failed\n");
+        exit(1);
+      }
+    }
+
+    for (int fileIndex = 0; fileIndex < fileCount; fileIndex++)
+    {
+      struct ShardFile *shard = &shards[fileIndex];
+
+      header.roundCount += shard->header.roundCount;
+      for (int color = 0; color < PLAYER_NO; color++)
+      {
+        for (int rank = 0; rank < PLAYER_NO; rank++)
+        {
+          header.rankCounts[color][rank] += shard->header.rankCounts[color][rank];
+        }
+      }
+
+      if (records != NULL)
+      {
+        memcpy
+        (
+          &records[shard->header.firstGame], shard->records,
+          (shard->header.lastGame - shard->header.firstGame) * sizeof(struct ShardGameRecord)
+        );
+      }
+    }
+
+    merged = writeShardFile(outputName, &header, records);
+    if (merged)
+    {
+      printf("Merged %d shards into %s\n", fileCount, outputName);
+      displayShardTotals(&header);
+    }
+    free(records);
+  }
+
+  for (int fileIndex = 0; fileIndex < fileCount; fileIndex++)
+  {
+    free(shards[fileIndex].records);
+  }
+  free(shards);
+
+  return merged;
+}
@@ -0,0 +1,51 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "types.h"
+
+#define SHARD_MAGIC 0x3244524853444CULL // "LDSHRD2"
+#define SHARD_FILE_FORMAT "shard-%d-of-%d.bin"
+#define SHARD_EMPTY_WINNER 0xF
+
+// Game i of a run of gameCount games is played with seed
+// firstSeed + i. Shard s of n plays the games
+// [gameCount * s / n, gameCount * (s + 1) / n), so the shards
+// of a run cover every game once whatever n is. A merged file
+// is shard 0 of 1, byte for byte the file of a single process
+struct ShardFileHeader
+{
+  uint64_t magic;
+  uint64_t firstSeed;
+  uint32_t gameCount; // of the whole run
+  uint32_t shardIndex;
+  uint32_t shardCount;
+  uint32_t firstGame;
+  uint32_t lastGame;
+  uint32_t hasRecords; // a ShardGameRecord per game follows
+  int32_t weights[PLAYER_NO][WEIGHT_NO];
+  int64_t roundCount;
+  int64_t rankCounts[PLAYER_NO][PLAYER_NO]; // color, rank
+} __attribute__((aligned(8)));
+
+// One game of a shard file. The colors that finished at each
+// rank are packed 4 bits per rank from the lowest bits, with
+// SHARD_EMPTY_WINNER for ranks nobody reached
+struct ShardGameRecord
+{
+  uint16_t rounds;
+  uint16_t winners;
+};
+
+// Function declarations for sharded runs
+
+bool parseShardSpec(char *text, int *shardIndex, int *shardCount);
+bool runShard
+(
+  char *fileName, int shardIndex, int shardCount, int gameCount,
+  uint64_t firstSeed, bool withRecords, int threadCount
+);
+bool mergeShardFiles(char *outputName, int fileCount, char **fileNames);
+
+#endif // !SHARD_H
@@ -0,0 +1,273 @@
+#include "simulation.h"
+#include "game.h"
+#include "endgame.h"
+#include <pthread.h>
+#include <unistd.h>
+#include <string.h>
+
+struct BatchWorker
+{
+  pthread_t thread;
+  uint64_t firstSeed;
+  int firstGame;
+  int lastGame;
+  int (*weights)[WEIGHT_NO];
+  struct GameResult *results;
+};
+
+int getDefaultThreadCount()
+{
+  long threadCount = sysconf(_SC_NPROCESSORS_ONLN);
+
+  return threadCount > 0 ? (int)threadCount : 1;
+}
+
+// Play a full game without output. The same seed and
+// weights always produce the same game
+void simulateGame(uint64_t seed, int weights[][WEIGHT_NO], struct GameResult *result)
+{
+  struct Game game = createGame();
+  struct Board board;
+  struct Player *players = initializePlayers();
+
+  initializeBoard(&board);
+  applyPieceWeights(players, weights);
+
+  setGameOutput(false);
+  seedGameRandom(seed);
+
+  initialGameLoop(players, &game);
+  mainGameLoop(players, &game, &board);
+
+  result->seed = seed;
+  result->rounds = game.rounds;
+  for (int winIndex = 0; winIndex < PLAYER_NO; winIndex++)
+  {
+    result->winners[winIndex] = game.winners[winIndex];
+  }
+
+  free(players);
+}
+
+static void *runBatchWorker(void *argument)
+{
+  struct BatchWorker *worker = argument;
+
+  for (int gameIndex = worker->firstGame; gameIndex < worker->lastGame; gameIndex++)
+  {
+    simulateGame(worker->firstSeed + gameIndex, worker->weights, &worker->results[gameIndex]);
+  }
+
+  return NULL;
+}
+
+// Game i of the batch is always played with seed firstSeed + i
+// so results are independent of the thread count
+void runGameBatch
+(
+  uint64_t firstSeed, int gameCount, int weights[][WEIGHT_NO],
+  int threadCount, struct GameResult *results
+)
+{
+  if (threadCount < 1)
+  {
+    threadCount = 1;
+  }
+
+  if (threadCount > gameCount)
+  {
+    threadCount = gameCount > 0 ? gameCount : 1;
+  }
+
+  // map the endgame table once for all workers
+  loadEndgameTable(ENDGAME_TABLE_FILE);
+
+  struct BatchWorker workers[threadCount];
+  int chunk = gameCount / threadCount;
+  int remainder = gameCount % threadCount;
+
+  for (int workerIndex = 0, firstGame = 0; workerIndex < threadCount; workerIndex++)
+  {
+    int lastGame = firstGame + chunk + (workerIndex < remainder ? 1 : 0);
+
+    workers[workerIndex].firstSeed = firstSeed;
+    workers[workerIndex].firstGame = firstGame;
+    workers[workerIndex].lastGame = lastGame;
+    workers[workerIndex].weights = weights;
+    workers[workerIndex].results = results;
+
+    pthread_create(&workers[workerIndex].thread, NULL, runBatchWorker, &workers[workerIndex]);
+    firstGame = lastGame;
+  }
+
+  for (int workerIndex = 0; workerIndex < threadCount; workerIndex++)
+  {
+    pthread_join(workers[workerIndex].thread, NULL);
+  }
+}
+
+// Whether the position matches the copy taken before the moves
+static bool isSessionRestored(struct GameSession *session, struct GameSession *saved)
+{
+  return memcmp(&session->board, &saved->board, sizeof(saved->board)) == 0 &&
+    memcmp(session->players, saved->players, sizeof(saved->players)) == 0 &&
+    memcmp(&session->game, &saved->game, sizeof(saved->game)) == 0 &&
+    getGameRandomState() == saved->randomState;
+}
+
+// Make and unmake every legal move of a decision one at a
+// time, then all of them on top of each other, and count
+// the positions that did not come back
+static int checkDecisionUndo(struct GameSession *session, struct UndoStack *stack)
+{
+  struct GameSession saved = *session;
+  int playerIndex = session->turn.playerIndex;
+  struct Player *player = &session->players[playerIndex];
+  int diceNumber = getDiceValueOfPlayer(player, session->turn.diceNumber);
+  int mismatchCount = 0;
+
+  setGameRandomState(session->randomState);
+
+  for (int action = 0; action < PIECE_NO * 2; action++)
+  {
+    if (!(session->turn.legalMask & (1 << action)))
+    {
+      continue;
+    }
+
+    makeMove(stack, &session->game, session->players, playerIndex, action % PIECE_NO, diceNumber, action >= PIECE_NO, &session->board);
+    unmakeMove(stack, &session->board);
+    mismatchCount += !isSessionRestored(session, &saved);
+  }
+
+  for (int action = 0; action < PIECE_NO * 2; action++)
+  {
+    if (getLegalMoveMask(player, diceNumber, &session->board) & (1 << action))
+    {
+      makeMove(stack, &session->game, session->players, playerIndex, action % PIECE_NO, diceNumber, action >= PIECE_NO, &session->board);
+    }
+  }
+
+  while (stack->frameCount > 0)
+  {
+    unmakeMove(stack, &session->board);
+  }
+  mismatchCount += !isSessionRestored(session, &saved);
+
+  return mismatchCount;
+}
+
+// Play games with every color suspended at its decisions,
+// checking that makeMove and unmakeMove restore each
+// position before the behavior move is played
+int checkUndoGames(uint64_t firstSeed, int gameCount)
+{
+  struct UndoStack *stack = malloc(sizeof(struct UndoStack));
+  int decisionCount = 0;
+  int mismatchCount = 0;
+
+  if (stack == NULL)
+  {
+    printf("Error: Memory allocation failed\n");
+    exit(1);
+  }
+
+  loadEndgameTable(ENDGAME_TABLE_FILE);
+  setGameOutput(false);
+  initializeUndoStack(stack);
+
+  for (int gameIndex = 0; gameIndex < gameCount; gameIndex++)
+  {
+    struct GameSession session;
+    enum TurnEvent event;
+
+    startGameSession(&session, firstSeed + gameIndex, NULL, ALL_PLAYERS_ACTIVE, MAX_GAME_ROUNDS);
+
+    while ((event = advanceGameSession(&session)) != TURN_EVENT_GAME_OVER)
+    {
+      if (event != TURN_EVENT_DECISION)
+      {
+        continue;
+      }
+
+      int moveMismatchCount = checkDecisionUndo(&session, stack);
+
+      if (moveMismatchCount > 0)
+      {
+        printf("Seed %llu round %d: %d moves not undone\n",
+          (unsigned long long)(firstSeed + gameIndex),
+          session.game.rounds,
+          moveMismatchCount
+        );
+      }
+
+      decisionCount++;
+      mismatchCount += moveMismatchCount;
+      resumeGameSession(&session, -1);
+    }
+  }
+
+  printf("Made and unmade the moves of %d decisions in %d games: %d mismatches\n", decisionCount, gameCount, mismatchCount);
+  free(stack);
+
+  return mismatchCount;
+}
+
+// FNV-1a hash of the rounds and ranks of each game in order,
+// equal for two runs only when every game played out the same
+uint64_t getResultsFingerprint(struct GameResult *results, int gameCount)
+{
+  uint64_t hash = 1469598103934665603ULL;
+
+  for (int gameIndex = 0; gameIndex < gameCount; gameIndex++)
+  {
+    hash = (hash ^ (uint64_t)results[gameIndex].rounds) * 1099511628211ULL;
+    for (int winIndex = 0; winIndex < PLAYER_NO; winIndex++)
+    {
+      // EMPTY ranks of games cut at MAX_GAME_ROUNDS are offset like the colors
+      hash = (hash ^ (uint64_t)(results[gameIndex].winners[winIndex] + 7)) * 1099511628211ULL;
+    }
+  }
+
+  return hash;
+}
+
+int getWinCountOfColor(struct GameResult *results, int gameCount, enum Color color)
+{
+  int winCount = 0;
+
+  for (int gameIndex = 0; gameIndex < gameCount; gameIndex++)
+  {
+    // player index matches color index in initializePlayers
+    if (results[gameIndex].winners[0] == (int)color)
+    {
+      winCount++;
+    }
+  }
+
+  return winCount;
+}
+
+// Print how often each color finished at each rank
+void displayColorRanks(struct GameResult *results, int gameCount)
+{
+  int rankCounts[PLAYER_NO][PLAYER_NO] = {{0}};
+
+  for (int gameIndex = 0; gameIndex < gameCount; gameIndex++)
+  {
+    for (int winIndex = 0; winIndex < PLAYER_NO; winIndex++)
+    {
+      if (results[gameIndex].winners[winIndex] != EMPTY)
+      {
+        rankCounts[results[gameIndex].winners[winIndex]][winIndex]++;
+      }
+    }
+  }
+
+  printf("Ranks over %d games (1st, 2nd, 3rd, 4th)\n", gameCount);
+  for (int color = 0; color < PLAYER_NO; color++)
+  {
+    printf("  %-6s %6d %6d %6d %6d\n", getName(color),
+      rankCounts[color][0], rankCounts[color][1], rankCounts[color][2], rankCounts[color][3]);
+  }
+}
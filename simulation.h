@@ -0,0 +1,33 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <stdint.h>
+#include "types.h"
+
+#define DEFAULT_FIRST_SEED 1 // seed of the first game of commands not given one
+
+struct GameResult
+{
+  uint64_t seed;
+  int rounds;
+  int winners[PLAYER_NO];
+} __attribute__((aligned(4)));
+
+// Function declarations for running silent games in parallel
+
+int getDefaultThreadCount();
+void simulateGame(uint64_t seed, int weights[][WEIGHT_NO], struct GameResult *result);
+void runGameBatch
+(
+  uint64_t firstSeed,
+  int gameCount,
+  int weights[][WEIGHT_NO],
+  int threadCount,
+  struct GameResult *results
+);
+int checkUndoGames(uint64_t firstSeed, int gameCount);
+uint64_t getResultsFingerprint(struct GameResult *results, int gameCount);
+int getWinCountOfColor(struct GameResult *results, int gameCount, enum Color color);
+void displayColorRanks(struct GameResult *results, int gameCount);
+
+#endif // !SIMULATION_H
@@ -0,0 +1,461 @@
+#include "spectate.h"
+#include "game.h"
+#include "simulation.h"
+#include "endgame.h"
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+struct BroadcastWorker
+{
+  pthread_t thread;
+  struct SpectatorRing *ring;
+  uint64_t firstSeed;
+  int firstGame;
+  int lastGame;
+  int (*weights)[WEIGHT_NO];
+  struct GameResult *results;
+};
+
+static volatile sig_atomic_t spectatorStopped = false;
+
+/* Ring */
+
+// Map the shared memory ring. The publisher creates it, or
+// keeps an existing ring of the same layout so attached
+// readers go on from its head. Readers map it read only
+bool openSpectatorRing(char *name, uint64_t capacity, bool create, struct SpectatorRing *ring)
+{
+  int file = shm_open(name, create ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+  if (file < 0)
+  {
+    printf("Error: Could not open the shared memory %s\n", name);
+    return false;
+  }
+
+  struct SpectatorRingHeader existing = {0};
+  bool reuse = pread(file, &existing, sizeof(existing), 0) == sizeof(existing)
+    && existing.magic == SPECTATOR_RING_MAGIC
+    && existing.deltaSize == sizeof(struct SpectatorDelta)
+    && (existing.capacity == capacity || !create);
+
+  if (!create && !reuse)
+  {
+    printf("Error: %s is not a spectator ring\n", name);
+    close(file);
+    return false;
+  }
+
+  capacity = reuse ? existing.capacity : capacity;
+  size_t mappedSize = sizeof(struct SpectatorRingHeader) + capacity * sizeof(struct SpectatorDelta);
+
+  if (!reuse && (ftruncate(file, 0) != 0 || ftruncate(file, mappedSize) != 0))
+  {
+    printf("Error: Could not resize the shared memory %s\n", name);
+    close(file);
+    return false;
+  }
+
+  void *mapping = mmap(NULL, mappedSize, create ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, file, 0);
+  close(file);
+
+  if (mapping == MAP_FAILED)
+  {
+    printf("Error: Could not map the shared memory %s\n", name);
+    return false;
+  }
+
+  ring->header = mapping;
+  ring->deltas = (struct SpectatorDelta *)(ring->header + 1);
+  ring->mappedSize = mappedSize;
+
+  if (!reuse)
+  {
+    ring->header->magic = SPECTATOR_RING_MAGIC;
+    ring->header->deltaSize = sizeof(struct SpectatorDelta);
+    ring->header->capacity = capacity;
+    atomic_store(&ring->header->head, 0);
+  }
+
+  return true;
+}
+
+void closeSpectatorRing(struct SpectatorRing *ring)
+{
+  munmap(ring->header, ring->mappedSize);
+  ring->header = NULL;
+  ring->deltas = NULL;
+}
+
+/* Publisher */
+
+// Claim the next ticket and write the delta in its slot.
+// The engine never waits: a slot still being read is
+// overwritten and the reader sees the sequence change
+static void publishDelta
+(
+  struct SpectatorGame *spectatorGame, struct Game *game, enum SpectatorDeltaKind kind,
+  int color, int pieceIndex, int fromCellNo, int toCellNo, int value
+)
+{
+  struct SpectatorRingHeader *header = spectatorGame->ring->header;
+  uint64_t ticket = atomic_fetch_add_explicit(&header->head, 1, memory_order_relaxed);
+  struct SpectatorDelta *delta = &spectatorGame->ring->deltas[ticket % header->capacity];
+
+  atomic_store_explicit(&delta->sequence, 2 * ticket + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+
+  delta->gameId = spectatorGame->gameId;
+  delta->round = game->rounds;
+  delta->kind = kind;
+  delta->color = color;
+  delta->pieceIndex = pieceIndex;
+  delta->fromCellNo = fromCellNo;
+  delta->toCellNo = toCellNo;
+  delta->value = value;
+
+  atomic_store_explicit(&delta->sequence, 2 * ticket + 2, memory_order_release);
+}
+
+// Turn observer: publish what changed since the last phase.
+// Pieces changed by a move are the move and its captures,
+// any other change is a mystery cell teleport
+static void onSpectatorPhase(void *context, struct Game *game, struct Player *players, struct TurnState *turn)
+{
+  struct SpectatorGame *spectatorGame = context;
+  enum TurnPhase previousPhase = spectatorGame->previousPhase;
+  bool moved = previousPhase == TURN_THROW || previousPhase == TURN_DECISION;
+
+  spectatorGame->previousPhase = turn->phase;
+
+  // pieces, the mystery cell and the ranks only change in
+  // moves, in AFTER_MOVE and at the round start
+  if (spectatorGame->started && !moved && previousPhase != TURN_AFTER_MOVE && previousPhase != TURN_ROUND_START)
+  {
+    return;
+  }
+
+  if (!spectatorGame->started)
+  {
+    for (int color = 0; color < PLAYER_NO; color++)
+    {
+      for (int pieceIndex = 0; pieceIndex < PIECE_NO; pieceIndex++)
+      {
+        spectatorGame->pieceCells[color][pieceIndex] = players[color].pieces[pieceIndex].cellNo;
+      }
+    }
+
+    spectatorGame->started = true;
+    spectatorGame->mysteryCellNo = game->mysteryCellNo;
+    spectatorGame->winIndex = game->winIndex;
+    publishDelta(spectatorGame, game, DELTA_GAME_START, 0, EMPTY, BASE, BASE, 0);
+    moved = false;
+  }
+
+  for (int color = 0; color < PLAYER_NO; color++)
+  {
+    for (int pieceIndex = 0; pieceIndex < PIECE_NO; pieceIndex++)
+    {
+      int cellNo = players[color].pieces[pieceIndex].cellNo;
+      int previousCellNo = spectatorGame->pieceCells[color][pieceIndex];
+
+      if (cellNo == previousCellNo)
+      {
+        continue;
+      }
+
+      if (moved && color == turn->playerIndex)
+      {
+        publishDelta(spectatorGame, game, DELTA_MOVE, color, pieceIndex, previousCellNo, cellNo, turn->diceNumber);
+      }
+      else
+      {
+        publishDelta(spectatorGame, game, moved && cellNo == BASE ? DELTA_CAPTURE : DELTA_TELEPORT, color, pieceIndex, previousCellNo, cellNo, 0);
+      }
+      spectatorGame->pieceCells[color][pieceIndex] = cellNo;
+    }
+  }
+
+  if (game->mysteryCellNo != spectatorGame->mysteryCellNo)
+  {
+    int cellNo = game->mysteryCellNo == EMPTY ? BASE : game->mysteryCellNo;
+
+    publishDelta(spectatorGame, game, DELTA_MYSTERY, 0, EMPTY, BASE, cellNo, game->mysteryRounds);
+    spectatorGame->mysteryCellNo = game->mysteryCellNo;
+  }
+
+  for (; spectatorGame->winIndex < game->winIndex; spectatorGame->winIndex++)
+  {
+    int color = game->winners[spectatorGame->winIndex];
+    publishDelta(spectatorGame, game, DELTA_FINISH, color, EMPTY, BASE, HOME, spectatorGame->winIndex + 1);
+  }
+
+  if (turn->phase == TURN_GAME_OVER && !spectatorGame->over)
+  {
+    publishDelta(spectatorGame, game, DELTA_GAME_OVER, 0, EMPTY, BASE, BASE, 0);
+    spectatorGame->over = true;
+  }
+}
+
+// Publish the next game of the thread as gameId
+void followSpectatorGame(struct SpectatorGame *spectatorGame, struct SpectatorRing *ring, uint32_t gameId)
+{
+  memset(spectatorGame, 0, sizeof(struct SpectatorGame));
+  spectatorGame->ring = ring;
+  spectatorGame->gameId = gameId;
+  spectatorGame->previousPhase = TURN_ROUND_START;
+}
+
+static void *runBroadcastWorker(void *argument)
+{
+  struct BroadcastWorker *worker = argument;
+  struct SpectatorGame spectatorGame;
+  struct TurnObserver observer = {onSpectatorPhase, &spectatorGame};
+
+  setTurnObserver(&observer);
+
+  for (int gameIndex = worker->firstGame; gameIndex < worker->lastGame; gameIndex++)
+  {
+    followSpectatorGame(&spectatorGame, worker->ring, gameIndex);
+    simulateGame(worker->firstSeed + gameIndex, worker->weights, &worker->results[gameIndex]);
+  }
+
+  setTurnObserver(NULL);
+  return NULL;
+}
+
+// Simulate games like runGameBatch while publishing their
+// deltas to the ring, with the game index as game id
+void runBroadcastGames(char *name, uint64_t firstSeed, int gameCount, int threadCount)
+{
+  struct SpectatorRing ring;
+  int weights[PLAYER_NO][WEIGHT_NO];
+
+  if (!openSpectatorRing(name, SPECTATOR_RING_CAPACITY, true, &ring))
+  {
+    return;
+  }
+
+  if (threadCount < 1)
+  {
+    threadCount = getDefaultThreadCount();
+  }
+
+  if (threadCount > gameCount)
+  {
+    threadCount = gameCount > 0 ? gameCount : 1;
+  }
+
+  struct GameResult *results = calloc(gameCount > 0 ? gameCount : 1, sizeof(struct GameResult));
+  struct BroadcastWorker workers[threadCount];
+
+  if (results == NULL)
+  {
+    printf("Error: Memory allocation failed\n");
+    exit(1);
+  }
+
+  loadPieceWeights(WEIGHTS_CONFIG_FILE, weights);
+  loadEndgameTable(ENDGAME_TABLE_FILE);
+  uint64_t firstTicket = atomic_load(&ring.header->head);
+
+  for (int workerIndex = 0; workerIndex < threadCount; workerIndex++)
+  {
+    workers[workerIndex] = (struct BroadcastWorker){
+      .ring = &ring,
+      .firstSeed = firstSeed,
+      .firstGame = (int)((long)gameCount * workerIndex / threadCount),
+      .lastGame = (int)((long)gameCount * (workerIndex + 1) / threadCount),
+      .weights = weights,
+      .results = results,
+    };
+
+    pthread_create(&workers[workerIndex].thread, NULL, runBroadcastWorker, &workers[workerIndex]);
+  }
+
+  for (int workerIndex = 0; workerIndex < threadCount; workerIndex++)
+  {
+    pthread_join(workers[workerIndex].thread, NULL);
+  }
+
+  displayColorRanks(results, gameCount);
+  printf("Published %llu deltas to %s\n", (unsigned long long)(atomic_load(&ring.header->head) - firstTicket), name);
+
+  free(results);
+  closeSpectatorRing(&ring);
+}
+
+/* Reader */
+
+// Attach at the head, so only deltas published from now on
+// are read
+bool attachSpectatorReader(struct SpectatorReader *reader, char *name)
+{
+  if (!openSpectatorRing(name, 0, false, &reader->ring))
+  {
+    return false;
+  }
+
+  reader->nextTicket = atomic_load(&reader->ring.header->head);
+  reader->lostCount = 0;
+  return true;
+}
+
+void detachSpectatorReader(struct SpectatorReader *reader)
+{
+  closeSpectatorRing(&reader->ring);
+}
+
+// Copy the next delta. SPECTATOR_EMPTY when it is not
+// published yet, SPECTATOR_LOST when it was overwritten
+// before it could be read, then the next call goes on
+// with the oldest delta left
+enum SpectatorReadResult readSpectatorDelta(struct SpectatorReader *reader, struct SpectatorDelta *delta)
+{
+  struct SpectatorRingHeader *header = reader->ring.header;
+  uint64_t head = atomic_load_explicit(&header->head, memory_order_acquire);
+  uint64_t ticket = reader->nextTicket;
+
+  if (ticket >= head)
+  {
+    return SPECTATOR_EMPTY;
+  }
+
+  if (head - ticket > header->capacity)
+  {
+    reader->lostCount += head - header->capacity - ticket;
+    reader->nextTicket = head - header->capacity;
+    return SPECTATOR_LOST;
+  }
+
+  struct SpectatorDelta *slot = &reader->ring.deltas[ticket % header->capacity];
+  uint64_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+
+  if (sequence < 2 * ticket + 2)
+  {
+    // still being written
+    return SPECTATOR_EMPTY;
+  }
+
+  if (sequence == 2 * ticket + 2)
+  {
+    memcpy((char *)delta + sizeof(delta->sequence), (char *)slot + sizeof(slot->sequence), sizeof(struct SpectatorDelta) - sizeof(slot->sequence));
+    atomic_thread_fence(memory_order_acquire);
+
+    if (atomic_load_explicit(&slot->sequence, memory_order_relaxed) == sequence)
+    {
+      atomic_store_explicit(&delta->sequence, sequence, memory_order_relaxed);
+      reader->nextTicket++;
+      return SPECTATOR_READ;
+    }
+  }
+
+  // a later ticket reused the slot
+  reader->lostCount++;
+  reader->nextTicket++;
+  return SPECTATOR_LOST;
+}
+
+static void stopSpectator(int signalNo)
+{
+  (void)signalNo;
+  spectatorStopped = true;
+}
+
+static void displaySpectatorDelta(struct SpectatorDelta *delta)
+{
+  char *colorName = getName(delta->color);
+  char from[16], to[16];
+
+  printf("game %u round %u: ", delta->gameId, delta->round);
+
+  switch (delta->kind)
+  {
+    case DELTA_GAME_START:
+      printf("start\n");
+      break;
+    case DELTA_MOVE:
+      printf
+      (
+        "%s rolled %d, move %c%d %s -> %s\n", colorName, delta->value, colorName[0], delta->pieceIndex + 1,
+        formatCellName(delta->fromCellNo, from), formatCellName(delta->toCellNo, to)
+      );
+      break;
+    case DELTA_CAPTURE:
+    case DELTA_TELEPORT:
+      printf
+      (
+        "%s %c%d %s -> %s\n", delta->kind == DELTA_CAPTURE ? "capture" : "teleport",
+        colorName[0], delta->pieceIndex + 1,
+        formatCellName(delta->fromCellNo, from), formatCellName(delta->toCellNo, to)
+      );
+      break;
+    case DELTA_MYSTERY:
+      if (delta->toCellNo == BASE)
+      {
+        printf("mystery cell removed\n");
+      }
+      else
+      {
+        printf("mystery cell at L%d for %d rounds\n", delta->toCellNo, delta->value);
+      }
+      break;
+    case DELTA_FINISH:
+      printf("%s finished at rank %d\n", colorName, delta->value);
+      break;
+    case DELTA_GAME_OVER:
+      printf("over\n");
+      break;
+  }
+}
+
+// Print the deltas of one game, or of every game when
+// gameId is negative, until interrupted. delayUs slows the
+// reader down to show that only the reader loses deltas
+void runSpectator(char *name, long gameId, int delayUs)
+{
+  struct SpectatorReader reader;
+  struct SpectatorDelta delta;
+  uint64_t readCount = 0;
+
+  if (!attachSpectatorReader(&reader, name))
+  {
+    return;
+  }
+
+  signal(SIGINT, stopSpectator);
+  signal(SIGTERM, stopSpectator);
+
+  while (!spectatorStopped)
+  {
+    enum SpectatorReadResult result = readSpectatorDelta(&reader, &delta);
+
+    if (result == SPECTATOR_EMPTY)
+    {
+      fflush(stdout);
+      usleep(1000);
+      continue;
+    }
+
+    if (result == SPECTATOR_READ)
+    {
+      readCount++;
+      if (gameId < 0 || delta.gameId == gameId)
+      {
+        displaySpectatorDelta(&delta);
+      }
+
+      if (delayUs > 0)
+      {
+        usleep(delayUs);
+      }
+    }
+  }
+
+  printf("Read %llu deltas, lost %llu\n", (unsigned long long)readCount, (unsigned long long)reader.lostCount);
+  detachSpectatorReader(&reader);
+}
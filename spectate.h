@@ -0,0 +1,101 @@
+#ifndef SPECTATE_H
+#define SPECTATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "types.h"
+
+#define SPECTATOR_RING_NAME "/ludo-spectate"
+#define SPECTATOR_RING_MAGIC 0x31435053444CULL // "LDSPC1"
+#define SPECTATOR_RING_CAPACITY (1 << 16) // deltas, 2 MiB
+
+enum SpectatorDeltaKind
+{
+  DELTA_GAME_START,
+  DELTA_MOVE, // piece of the player to move, fromCellNo to toCellNo, value is the dice
+  DELTA_CAPTURE, // piece sent back to BASE by the move
+  DELTA_TELEPORT, // piece moved by a mystery cell
+  DELTA_MYSTERY, // toCellNo is the new mystery cell or BASE, value its rounds
+  DELTA_FINISH, // color has all pieces home, value is its rank
+  DELTA_GAME_OVER
+};
+
+// One change of a followed game. The sequence of the delta
+// written with ticket t is 2t + 1 while it is written and
+// 2t + 2 once complete, like the samples of the self-play
+// ring. Cells are BASE, 0 to 51, the home straight or HOME
+struct SpectatorDelta
+{
+  _Atomic uint64_t sequence;
+  uint32_t gameId;
+  uint16_t round;
+  uint8_t kind;
+  uint8_t color;
+  int8_t pieceIndex;
+  int8_t fromCellNo;
+  int8_t toCellNo;
+  uint8_t value;
+} __attribute__((aligned(32)));
+
+// head is the next ticket. Deltas follow the header
+struct SpectatorRingHeader
+{
+  uint64_t magic;
+  uint32_t deltaSize;
+  uint32_t reserved;
+  uint64_t capacity;
+  _Atomic uint64_t head;
+} __attribute__((aligned(64)));
+
+struct SpectatorRing
+{
+  struct SpectatorRingHeader *header;
+  struct SpectatorDelta *deltas;
+  size_t mappedSize;
+};
+
+// Turn observer context of one publishing thread. The
+// positions of the last phase are diffed with the current ones
+struct SpectatorGame
+{
+  struct SpectatorRing *ring;
+  uint32_t gameId;
+  bool started;
+  bool over;
+  enum TurnPhase previousPhase;
+  int mysteryCellNo;
+  int winIndex;
+  int8_t pieceCells[PLAYER_NO][PIECE_NO];
+};
+
+// Reader position in the ring. A reader that falls more
+// than the capacity behind skips to the oldest delta
+// still in the ring and counts the ones it lost
+struct SpectatorReader
+{
+  struct SpectatorRing ring;
+  uint64_t nextTicket;
+  uint64_t lostCount;
+};
+
+enum SpectatorReadResult
+{
+  SPECTATOR_READ,
+  SPECTATOR_EMPTY,
+  SPECTATOR_LOST
+};
+
+// Function declarations for broadcasting games to spectators
+
+bool openSpectatorRing(char *name, uint64_t capacity, bool create, struct SpectatorRing *ring);
+void closeSpectatorRing(struct SpectatorRing *ring);
+void followSpectatorGame(struct SpectatorGame *spectatorGame, struct SpectatorRing *ring, uint32_t gameId);
+void runBroadcastGames(char *name, uint64_t firstSeed, int gameCount, int threadCount);
+bool attachSpectatorReader(struct SpectatorReader *reader, char *name);
+enum SpectatorReadResult readSpectatorDelta(struct SpectatorReader *reader, struct SpectatorDelta *delta);
+void detachSpectatorReader(struct SpectatorReader *reader);
+void runSpectator(char *name, long gameId, int delayUs);
+
+#endif // !SPECTATE_H
@@ -0,0 +1,586 @@
+#define _GNU_SOURCE
+#include "steal.h"
+#include "game.h"
+#include "endgame.h"
+#include <pthread.h>
+#include <string.h>
+
+// Games of a batch shared by its workers
+struct StealBatch
+{
+  uint64_t firstSeed;
+  int (*weights)[WEIGHT_NO];
+  struct GameResult *results;
+  struct GameDeque *deques;
+  int *workerNodes; // NULL when the workers are not pinned
+  int threadCount;
+  bool stealing; // false keeps every worker on its own chunk
+  long startNs;
+};
+
+struct StealWorker
+{
+  pthread_t thread;
+  struct StealBatch *batch;
+  int workerIndex;
+  struct StealWorkerStats stats;
+  struct BatchTotals totals;
+};
+
+// Memory a worker writes for every game, allocated by the
+// worker itself after pinning so that its pages are placed
+// on the node of its CPU when they are first touched
+struct StealArena
+{
+  struct GameSession session;
+  struct StealWorkerStats stats;
+  struct BatchTotals totals;
+} __attribute__((aligned(STEAL_CACHE_LINE)));
+
+// Set by usePinnedGameBatches for the whole process
+static bool pinnedBatches = false;
+
+static long getStealTimeNs()
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000000L + now.tv_nsec;
+}
+
+/* Deque operations
+  */
+
+// Take the last game of the own deque, or -1 when it is
+// empty. Only a race for the last game needs the CAS
+static long takeOwnGame(struct GameDeque *deque)
+{
+  long bottom = atomic_load(&deque->bottom) - 1;
+
+  atomic_store(&deque->bottom, bottom);
+  long top = atomic_load(&deque->top);
+
+  if (top > bottom)
+  {
+    atomic_store(&deque->bottom, bottom + 1);
+    return -1;
+  }
+
+  if (top == bottom)
+  {
+    bool taken = atomic_compare_exchange_strong(&deque->top, &top, top + 1);
+
+    atomic_store(&deque->bottom, bottom + 1);
+    return taken ? bottom : -1;
+  }
+
+  return bottom;
+}
+
+// Take the first game of another deque, or -1 when it is
+// empty. A lost race means another worker took that game,
+// so the deque is tried again
+static long stealGame(struct GameDeque *deque)
+{
+  while (true)
+  {
+    long top = atomic_load(&deque->top);
+    long bottom = atomic_load(&deque->bottom);
+
+    if (top >= bottom)
+    {
+      return -1;
+    }
+
+    if (atomic_compare_exchange_strong(&deque->top, &top, top + 1))
+    {
+      return top;
+    }
+  }
+}
+
+// Games are never pushed back, so a deque found empty stays
+// empty and one pass over the others without a game means
+// the batch is done. Pinned workers try the workers of their
+// own node first
+static long findGameToSteal(struct StealBatch *batch, int workerIndex, uint64_t *randomState)
+{
+  *randomState ^= *randomState << 13;
+  *randomState ^= *randomState >> 7;
+  *randomState ^= *randomState << 17;
+  int firstVictim = (int)(*randomState % batch->threadCount);
+  int passCount = batch->workerNodes != NULL ? 2 : 1;
+
+  for (int pass = 0; pass < passCount; pass++)
+  {
+    for (int offset = 0; offset < batch->threadCount; offset++)
+    {
+      int victim = (firstVictim + offset) % batch->threadCount;
+      if (victim == workerIndex)
+      {
+        continue;
+      }
+
+      // the first of two passes is over the own node
+      bool sameNode = passCount == 1 || batch->workerNodes[victim] == batch->workerNodes[workerIndex];
+      if (sameNode != (pass == 0))
+      {
+        continue;
+      }
+
+      long gameIndex = stealGame(&batch->deques[victim]);
+      if (gameIndex >= 0)
+      {
+        return gameIndex;
+      }
+    }
+  }
+
+  return -1;
+}
+
+/* Workers
+  */
+
+// Play a game in the session of the worker, which is reset
+// by every game instead of allocating players for each one
+static void playArenaGame(struct StealBatch *batch, struct StealArena *arena, long gameIndex)
+{
+  struct GameSession *session = &arena->session;
+  uint64_t seed = batch->firstSeed + gameIndex;
+
+  startGameSession(session, seed, batch->weights, 0, MAX_GAME_ROUNDS);
+  while (advanceGameSession(session) != TURN_EVENT_GAME_OVER)
+  {
+  }
+
+  arena->totals.gameCount++;
+  arena->totals.roundCount += session->game.rounds;
+  for (int winIndex = 0; winIndex < PLAYER_NO; winIndex++)
+  {
+    if (session->game.winners[winIndex] != EMPTY)
+    {
+      arena->totals.rankCounts[session->game.winners[winIndex]][winIndex]++;
+    }
+  }
+
+  if (batch->results == NULL)
+  {
+    return;
+  }
+
+  struct GameResult *result = &batch->results[gameIndex];
+  result->seed = seed;
+  result->rounds = session->game.rounds;
+  for (int winIndex = 0; winIndex < PLAYER_NO; winIndex++)
+  {
+    result->winners[winIndex] = session->game.winners[winIndex];
+  }
+}
+
+static void pinStealWorker(struct StealWorker *worker)
+{
+  cpu_set_t cpuSet;
+
+  CPU_ZERO(&cpuSet);
+  CPU_SET(worker->stats.cpu, &cpuSet);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) != 0)
+  {
+    worker->stats.cpu = -1;
+  }
+}
+
+static void *runStealWorker(void *argument)
+{
+  struct StealWorker *worker = argument;
+  struct StealBatch *batch = worker->batch;
+  struct GameDeque *ownDeque = &batch->deques[worker->workerIndex];
+  uint64_t randomState = 0x9E3779B97F4A7C15ULL * (worker->workerIndex + 1);
+
+  if (worker->stats.cpu >= 0)
+  {
+    pinStealWorker(worker);
+  }
+
+  struct StealArena *arena = aligned_alloc(STEAL_CACHE_LINE, sizeof(struct StealArena));
+  if (arena == NULL)
+  {
+    printf("Error: Memory allocation failed\n");
+    exit(1);
+  }
+
+  memset(arena, 0, sizeof(struct StealArena));
+  arena->stats = worker->stats;
+  setGameOutput(false);
+
+  while (true)
+  {
+    long gameIndex = takeOwnGame(ownDeque);
+    bool stolen = false;
+
+    if (gameIndex < 0 && batch->stealing)
+    {
+      gameIndex = findGameToSteal(batch, worker->workerIndex, &randomState);
+      stolen = true;
+    }
+
+    if (gameIndex < 0)
+    {
+      break;
+    }
+
+    long gameStartNs = getStealTimeNs();
+    playArenaGame(batch, arena, gameIndex);
+    arena->stats.busyNs += getStealTimeNs() - gameStartNs;
+    arena->stats.playedGames++;
+    arena->stats.stolenGames += stolen;
+  }
+
+  arena->stats.finishNs = getStealTimeNs() - batch->startNs;
+  worker->stats = arena->stats;
+  worker->totals = arena->totals;
+  free(arena);
+  return NULL;
+}
+
+static void addBatchTotals(struct BatchTotals *sum, struct BatchTotals *totals)
+{
+  sum->gameCount += totals->gameCount;
+  sum->roundCount += totals->roundCount;
+  for (int color = 0; color < PLAYER_NO; color++)
+  {
+    for (int rank = 0; rank < PLAYER_NO; rank++)
+    {
+      sum->rankCounts[color][rank] += totals->rankCounts[color][rank];
+    }
+  }
+}
+
+// Split the games in contiguous chunks like runGameBatch and
+// play them, stealing from other chunks when allowed. With a
+// topology the workers are pinned to its CPUs and their
+// totals are summed by node before the nodes are summed.
+// Returns false when a worker could not be started and its
+// games were left unplayed
+static bool runGameDeques
+(
+  uint64_t firstSeed, int gameCount, int weights[][WEIGHT_NO], int threadCount,
+  bool stealing, struct CpuTopology *topology, struct GameResult *results,
+  struct StealWorkerStats *stats, struct BatchTotals *totals
+)
+{
+  if (threadCount < 1)
+  {
+    threadCount = getDefaultThreadCount();
+  }
+
+  if (threadCount > gameCount)
+  {
+    threadCount = gameCount > 0 ? gameCount : 1;
+  }
+
+  loadEndgameTable(ENDGAME_TABLE_FILE);
+
+  struct GameDeque *deques = aligned_alloc(STEAL_CACHE_LINE, threadCount * sizeof(struct GameDeque));
+  struct StealWorker workers[threadCount];
+  int workerNodes[threadCount];
+  bool started[threadCount];
+
+  if (deques == NULL)
+  {
+    printf("Error: Memory allocation failed\n");
+    exit(1);
+  }
+
+  struct StealBatch batch = {
+    firstSeed, weights, results, deques, topology != NULL ? workerNodes : NULL,
+    threadCount, stealing, 0
+  };
+
+  for (int workerIndex = 0; workerIndex < threadCount; workerIndex++)
+  {
+    atomic_init(&deques[workerIndex].top, (long)gameCount * workerIndex / threadCount);
+    atomic_init(&deques[workerIndex].bottom, (long)gameCount * (workerIndex + 1) / threadCount);
+  }
+
+  batch.startNs = getStealTimeNs();
+  for (int workerIndex = 0; workerIndex < threadCount; workerIndex++)
+  {
+    workers[workerIndex] = (struct StealWorker){.batch = &batch, .workerIndex = workerIndex};
+    workers[workerIndex].stats.cpu = -1;
+    if (topology != NULL)
+    {
+      int cpuIndex = workerIndex % topology->cpuCount;
+
+      workers[workerIndex].stats.cpu = topology->cpus[cpuIndex];
+      workers[workerIndex].stats.node = topology->cpuNodes[cpuIndex];
+      workerNodes[workerIndex] = topology->cpuNodes[cpuIndex];
+    }
+
+    // with stealing the other workers take its chunk
+    started[workerIndex] = pthread_create(&workers[workerIndex].thread, NULL, runStealWorker, &workers[workerIndex]) == 0;
+    if (!started[workerIndex])
+    {
+      printf("Error: Could not start game worker %d\n", workerIndex);
+    }
+  }
+
+  int nodeCount = topology != NULL ? topology->nodeCount : 1;
+  struct BatchTotals nodeTotals[nodeCount];
+
+  memset(nodeTotals, 0, sizeof(nodeTotals));
+  for (int workerIndex = 0; workerIndex < threadCount; workerIndex++)
+  {
+    if (!started[workerIndex])
+    {
+      continue;
+    }
+
+    pthread_join(workers[workerIndex].thread, NULL);
+    addBatchTotals(&nodeTotals[workers[workerIndex].stats.node], &workers[workerIndex].totals);
+    if (stats != NULL)
+    {
+      stats[workerIndex] = workers[workerIndex].stats;
+    }
+  }
+
+  if (totals != NULL)
+  {
+    memset(totals, 0, sizeof(struct BatchTotals));
+    for (int node = 0; node < nodeCount; node++)
+    {
+      addBatchTotals(totals, &nodeTotals[node]);
+    }
+  }
+
+  bool played = true;
+  for (int workerIndex = 0; workerIndex < threadCount; workerIndex++)
+  {
+    played &= atomic_load(&deques[workerIndex].top) >= atomic_load(&deques[workerIndex].bottom);
+  }
+
+  free(deques);
+  return played;
+}
+
+// Same games and results as runGameBatch: game i is played
+// with seed firstSeed + i and written to results[i] by
+// whichever worker takes it. Workers that finish their chunk
+// take games from the others, so one long game no longer
+// holds back the games queued behind it. After
+// usePinnedGameBatches the batch runs as runPinnedGameBatch
+bool runStealingGameBatch
+(
+  uint64_t firstSeed, int gameCount, int weights[][WEIGHT_NO],
+  int threadCount, struct GameResult *results
+)
+{
+  if (pinnedBatches)
+  {
+    return runPinnedGameBatch(firstSeed, gameCount, weights, threadCount, results, NULL);
+  }
+
+  return runGameDeques(firstSeed, gameCount, weights, threadCount, true, NULL, results, NULL, NULL);
+}
+
+// runStealingGameBatch with every worker pinned to a CPU of
+// the topology read from sysfs, and the ranks and rounds of
+// the games summed into totals. results may be NULL when
+// only the totals are needed, so that no worker writes to
+// memory of another node while playing
+bool runPinnedGameBatch
+(
+  uint64_t firstSeed, int gameCount, int weights[][WEIGHT_NO],
+  int threadCount, struct GameResult *results, struct BatchTotals *totals
+)
+{
+  struct CpuTopology topology;
+  bool pinned = loadCpuTopology(&topology);
+
+  return runGameDeques(firstSeed, gameCount, weights, threadCount, true, pinned ? &topology : NULL, results, NULL, totals);
+}
+
+// Opt in to pinned workers for the batches of tune, compare,
+// shard and fingerprint runs. Results stay the same by game
+void usePinnedGameBatches(bool pinned)
+{
+  pinnedBatches = pinned;
+}
+
+/* Benchmark
+  */
+
+static int compareRounds(const void *first, const void *second)
+{
+  return ((struct GameResult *)first)->rounds - ((struct GameResult *)second)->rounds;
+}
+
+static void displaySchedulingStats(char *name, struct StealWorkerStats *stats, int threadCount)
+{
+  long firstFinishNs = stats[0].finishNs;
+  long lastFinishNs = stats[0].finishNs;
+  long busyNs = 0;
+  int stolenGames = 0;
+
+  for (int workerIndex = 0; workerIndex < threadCount; workerIndex++)
+  {
+    firstFinishNs = stats[workerIndex].finishNs < firstFinishNs ? stats[workerIndex].finishNs : firstFinishNs;
+    lastFinishNs = stats[workerIndex].finishNs > lastFinishNs ? stats[workerIndex].finishNs : lastFinishNs;
+    busyNs += stats[workerIndex].busyNs;
+    stolenGames += stats[workerIndex].stolenGames;
+  }
+
+  printf
+  (
+    "  %-14s %8.3f s %8.3f s %8.3f s %7.1f%% %7d\n", name,
+    lastFinishNs / 1e9, firstFinishNs / 1e9, (lastFinishNs - firstFinishNs) / 1e9,
+    100.0 * (1.0 - (double)busyNs / ((double)lastFinishNs * threadCount)), stolenGames
+  );
+}
+
+// Play the same games with static chunks and with work
+// stealing and compare when the workers ran out of games.
+// The tail is the time from the first idle worker to the end
+// of the batch
+void benchmarkGameScheduling(uint64_t firstSeed, int gameCount, int threadCount)
+{
+  int weights[PLAYER_NO][WEIGHT_NO];
+
+  if (gameCount < 1)
+  {
+    printf("Error: No games to play\n");
+    return;
+  }
+
+  if (threadCount < 1)
+  {
+    threadCount = getDefaultThreadCount();
+  }
+
+  if (threadCount > gameCount)
+  {
+    threadCount = gameCount;
+  }
+
+  struct GameResult *staticResults = malloc(gameCount * sizeof(struct GameResult));
+  struct GameResult *stealingResults = malloc(gameCount * sizeof(struct GameResult));
+  struct StealWorkerStats staticStats[threadCount];
+  struct StealWorkerStats stealingStats[threadCount];
+
+  if (staticResults == NULL || stealingResults == NULL)
+  {
+    printf("Error: Memory allocation failed\n");
+    exit(1);
+  }
+
+  loadPieceWeights(WEIGHTS_CONFIG_FILE, weights);
+  if
+  (
+    !runGameDeques(firstSeed, gameCount, weights, threadCount, false, NULL, staticResults, staticStats, NULL)
+    || !runGameDeques(firstSeed, gameCount, weights, threadCount, true, NULL, stealingResults, stealingStats, NULL)
+  )
+  {
+    free(staticResults);
+    free(stealingResults);
+    return;
+  }
+
+  bool identical = true;
+  for (int gameIndex = 0; gameIndex < gameCount; gameIndex++)
+  {
+    identical &= staticResults[gameIndex].seed == stealingResults[gameIndex].seed;
+    identical &= staticResults[gameIndex].rounds == stealingResults[gameIndex].rounds;
+    identical &= memcmp(staticResults[gameIndex].winners, stealingResults[gameIndex].winners, sizeof(staticResults[gameIndex].winners)) == 0;
+  }
+
+  qsort(staticResults, gameCount, sizeof(struct GameResult), compareRounds);
+  printf
+  (
+    "%d games on %d threads, rounds median %d, 99th percentile %d, longest %d\n",
+    gameCount, threadCount, staticResults[gameCount / 2].rounds,
+    staticResults[(int)((long)gameCount * 99 / 100)].rounds, staticResults[gameCount - 1].rounds
+  );
+  printf("  %-14s %10s %10s %10s %8s %7s\n", "scheduling", "batch", "first idle", "tail", "idle", "stolen");
+  displaySchedulingStats("static chunks", staticStats, threadCount);
+  displaySchedulingStats("work stealing", stealingStats, threadCount);
+  printf("Results by game index %s\n", identical ? "identical" : "DIFFER");
+
+  free(staticResults);
+  free(stealingResults);
+}
+
+// Play the same games unpinned and pinned to the topology,
+// alternating the two so that both see the same machine
+// load, and compare their best throughput
+void benchmarkWorkerPinning(uint64_t firstSeed, int gameCount, int threadCount)
+{
+  struct CpuTopology topology;
+  int weights[PLAYER_NO][WEIGHT_NO];
+  double bestRates[2] = {0, 0};
+  struct BatchTotals totals[2];
+  char *names[2] = {"unpinned", "pinned"};
+
+  if (gameCount < 1)
+  {
+    printf("Error: No games to play\n");
+    return;
+  }
+
+  if (!loadCpuTopology(&topology))
+  {
+    printf("Error: Could not read the CPU topology\n");
+    return;
+  }
+
+  if (threadCount < 1)
+  {
+    threadCount = topology.cpuCount;
+  }
+
+  if (threadCount > gameCount)
+  {
+    threadCount = gameCount;
+  }
+
+  struct StealWorkerStats stats[threadCount];
+
+  displayCpuTopology(&topology);
+  loadPieceWeights(WEIGHTS_CONFIG_FILE, weights);
+
+  for (int repeat = 0; repeat < STEAL_BENCHMARK_REPEATS; repeat++)
+  {
+    for (int mode = 0; mode < 2; mode++)
+    {
+      long startNs = getStealTimeNs();
+
+      if (!runGameDeques(firstSeed, gameCount, weights, threadCount, true, mode == 1 ? &topology : NULL, NULL, stats, &totals[mode]))
+      {
+        return;
+      }
+
+      double rate = gameCount / ((getStealTimeNs() - startNs) / 1e9);
+      bestRates[mode] = rate > bestRates[mode] ? rate : bestRates[mode];
+    }
+  }
+
+  printf("%d games on %d threads, best of %d runs\n", gameCount, threadCount, STEAL_BENCHMARK_REPEATS);
+  for (int mode = 0; mode < 2; mode++)
+  {
+    printf
+    (
+      "  %-9s %10.0f games per second, %.1f rounds per game\n", names[mode],
+      bestRates[mode], (double)totals[mode].roundCount / totals[mode].gameCount
+    );
+  }
+  printf("  pinned gain %+.1f%%\n", 100.0 * (bestRates[1] / bestRates[0] - 1.0));
+
+  printf("  pinned workers:");
+  for (int workerIndex = 0; workerIndex < threadCount; workerIndex++)
+  {
+    printf(" %d@cpu%d/node%d", stats[workerIndex].playedGames, stats[workerIndex].cpu, stats[workerIndex].node);
+  }
+  printf("\n");
+
+  bool identical = memcmp(&totals[0], &totals[1], sizeof(struct BatchTotals)) == 0;
+  printf("Totals %s\n", identical ? "identical" : "DIFFER");
+}
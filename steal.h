@@ -0,0 +1,67 @@
+#ifndef STEAL_H
+#define STEAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "types.h"
+#include "simulation.h"
+#include "topology.h"
+
+#define STEAL_CACHE_LINE 64
+#define STEAL_BENCHMARK_REPEATS 3
+
+// Deque of one worker over its share of the game indexes.
+// The games of a batch are known up front and never pushed
+// again, so the deque is the range [top, bottom) of games
+// not taken yet. The owner takes from the bottom and other
+// workers steal from the top (Chase and Lev)
+struct GameDeque
+{
+  _Atomic long top;
+  _Atomic long bottom;
+} __attribute__((aligned(STEAL_CACHE_LINE)));
+
+// What one worker did during a batch, times from the start
+struct StealWorkerStats
+{
+  int cpu; // -1 when the worker was not pinned
+  int node;
+  int playedGames;
+  int stolenGames;
+  long busyNs;
+  long finishNs;
+};
+
+// Outcome of a batch summed by the workers as they play
+struct BatchTotals
+{
+  long gameCount;
+  long roundCount;
+  long rankCounts[PLAYER_NO][PLAYER_NO]; // color, rank
+};
+
+// Function declarations for playing batches with work stealing
+
+bool runStealingGameBatch
+(
+  uint64_t firstSeed,
+  int gameCount,
+  int weights[][WEIGHT_NO],
+  int threadCount,
+  struct GameResult *results
+);
+bool runPinnedGameBatch
+(
+  uint64_t firstSeed,
+  int gameCount,
+  int weights[][WEIGHT_NO],
+  int threadCount,
+  struct GameResult *results,
+  struct BatchTotals *totals
+);
+void usePinnedGameBatches(bool pinned);
+void benchmarkGameScheduling(uint64_t firstSeed, int gameCount, int threadCount);
+void benchmarkWorkerPinning(uint64_t firstSeed, int gameCount, int threadCount);
+
+#endif // !STEAL_H
@@ -0,0 +1,153 @@
+#define _GNU_SOURCE
+#include "topology.h"
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Parse a sysfs CPU list such as "0-7,16-23" into the set
+static bool parseCpuList(char *text, cpu_set_t *cpuSet)
+{
+  char *cursor = text;
+
+  CPU_ZERO(cpuSet);
+  while (*cursor != '\0' && *cursor != '\n')
+  {
+    char *end;
+    long first = strtol(cursor, &end, 10);
+    long last = first;
+
+    if (end == cursor || first < 0)
+    {
+      return false;
+    }
+
+    if (*end == '-')
+    {
+      cursor = end + 1;
+      last = strtol(cursor, &end, 10);
+      if (end == cursor || last < first)
+      {
+        return false;
+      }
+    }
+
+    for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++)
+    {
+      CPU_SET(cpu, cpuSet);
+    }
+
+    cursor = *end == ',' ? end + 1 : end;
+  }
+
+  return true;
+}
+
+static bool readNodeCpus(int node, cpu_set_t *cpuSet)
+{
+  char path[256];
+  char text[4096];
+
+  snprintf(path, sizeof(path), "%s/node%d/cpulist", TOPOLOGY_NODE_DIRECTORY, node);
+  FILE *file = fopen(path, "r");
+  if (file == NULL)
+  {
+    return false;
+  }
+
+  bool parsed = fgets(text, sizeof(text), file) != NULL && parseCpuList(text, cpuSet);
+  fclose(file);
+
+  return parsed;
+}
+
+// Read the nodes of the CPUs in the affinity mask of the
+// process. Without node directories in sysfs all the CPUs
+// are put on node 0
+bool loadCpuTopology(struct CpuTopology *topology)
+{
+  cpu_set_t allowed;
+  cpu_set_t nodeCpus;
+  int gatheredCpus[TOPOLOGY_MAX_CPUS];
+  int gatheredNodes[TOPOLOGY_MAX_CPUS];
+  int gatheredCount = 0;
+
+  topology->cpuCount = 0;
+  topology->nodeCount = 0;
+
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+  {
+    return false;
+  }
+
+  for (int node = 0; node < TOPOLOGY_MAX_NODES; node++)
+  {
+    if (!readNodeCpus(node, &nodeCpus))
+    {
+      continue;
+    }
+
+    for (int cpu = 0; cpu < CPU_SETSIZE && gatheredCount < TOPOLOGY_MAX_CPUS; cpu++)
+    {
+      if (CPU_ISSET(cpu, &nodeCpus) && CPU_ISSET(cpu, &allowed))
+      {
+        gatheredCpus[gatheredCount] = cpu;
+        gatheredNodes[gatheredCount] = node;
+        gatheredCount++;
+        topology->nodeCount = node + 1;
+      }
+    }
+  }
+
+  if (gatheredCount == 0)
+  {
+    for (int cpu = 0; cpu < CPU_SETSIZE && gatheredCount < TOPOLOGY_MAX_CPUS; cpu++)
+    {
+      if (CPU_ISSET(cpu, &allowed))
+      {
+        gatheredCpus[gatheredCount] = cpu;
+        gatheredNodes[gatheredCount] = 0;
+        gatheredCount++;
+      }
+    }
+    topology->nodeCount = 1;
+  }
+
+  // take the CPUs of the nodes in turns, the gathered CPUs
+  // are sorted by node
+  bool taken[TOPOLOGY_MAX_CPUS] = {false};
+  while (topology->cpuCount < gatheredCount)
+  {
+    int lastNode = -1;
+
+    for (int index = 0; index < gatheredCount; index++)
+    {
+      if (!taken[index] && gatheredNodes[index] != lastNode)
+      {
+        taken[index] = true;
+        lastNode = gatheredNodes[index];
+        topology->cpus[topology->cpuCount] = gatheredCpus[index];
+        topology->cpuNodes[topology->cpuCount] = lastNode;
+        topology->cpuCount++;
+      }
+    }
+  }
+
+  return gatheredCount > 0;
+}
+
+void displayCpuTopology(struct CpuTopology *topology)
+{
+  printf("%d CPUs on %d NUMA nodes\n", topology->cpuCount, topology->nodeCount);
+  for (int node = 0; node < topology->nodeCount; node++)
+  {
+    printf("  node %d:", node);
+    for (int index = 0; index < topology->cpuCount; index++)
+    {
+      if (topology->cpuNodes[index] == node)
+      {
+        printf(" %d", topology->cpus[index]);
+      }
+    }
+    printf("\n");
+  }
+}
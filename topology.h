@@ -0,0 +1,27 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <stdbool.h>
+
+#define TOPOLOGY_MAX_NODES 64
+#define TOPOLOGY_MAX_CPUS 1024
+#define TOPOLOGY_NODE_DIRECTORY "/sys/devices/system/node"
+
+// CPUs the process may run on with their NUMA node. The CPUs
+// are interleaved across the nodes (first CPU of every node,
+// then the second...), so worker i pinned to cpus[i % cpuCount]
+// spreads fewer workers than CPUs over all the nodes
+struct CpuTopology
+{
+  int cpuCount;
+  int nodeCount; // highest node with CPUs plus one
+  int cpus[TOPOLOGY_MAX_CPUS];
+  int cpuNodes[TOPOLOGY_MAX_CPUS];
+};
+
+// Function declarations for reading the CPU layout
+
+bool loadCpuTopology(struct CpuTopology *topology);
+void displayCpuTopology(struct CpuTopology *topology);
+
+#endif // !TOPOLOGY_H
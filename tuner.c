@@ -0,0 +1,303 @@
+#include "tuner.h"
+#include "simulation.h"
+#include "steal.h"
+#include "game.h"
+#include <string.h>
+#include <time.h>
+#include <math.h>
+
+struct TunerOptions getDefaultTunerOptions()
+{
+  struct TunerOptions options = {
+    RED,
+    20,
+    16,
+    2000,
+    getDefaultThreadCount(),
+    (uint64_t)time(NULL),
+    WEIGHTS_CONFIG_FILE
+  };
+
+  return options;
+}
+
+static int clampWeight(int value)
+{
+  if (value > TUNER_WEIGHT_LIMIT)
+  {
+    return TUNER_WEIGHT_LIMIT;
+  }
+
+  if (value < -TUNER_WEIGHT_LIMIT)
+  {
+    return -TUNER_WEIGHT_LIMIT;
+  }
+
+  return value;
+}
+
+static void mutateCandidate(struct Candidate *candidate, enum Color color)
+{
+  for (int weightIndex = 0; weightIndex < WEIGHT_NO; weightIndex++)
+  {
+    if (!isWeightUsed(color, weightIndex) || gameRandom() % 100 >= TUNER_MUTATION_RATE)
+    {
+      continue;
+    }
+
+    int step = (gameRandom() % (TUNER_MAX_STEP * 2 + 1)) - TUNER_MAX_STEP;
+    candidate->weights[weightIndex] = clampWeight(candidate->weights[weightIndex] + step);
+  }
+}
+
+static struct Candidate *selectByTournament(struct Candidate *population, int populationSize)
+{
+  struct Candidate *selected = &population[gameRandom() % populationSize];
+
+  for (int round = 1; round < TUNER_TOURNAMENT_SIZE; round++)
+  {
+    struct Candidate *challenger = &population[gameRandom() % populationSize];
+
+    if (challenger->fitness > selected->fitness)
+    {
+      selected = challenger;
+    }
+  }
+
+  return selected;
+}
+
+static int compareCandidates(const void *first, const void *second)
+{
+  return ((struct Candidate *)second)->fitness - ((struct Candidate *)first)->fitness;
+}
+
+// Play the games of one candidate, other colors keep the base weights
+static int evaluateWeights
+(
+  int *candidateWeights, int baseWeights[][WEIGHT_NO], struct TunerOptions *options,
+  uint64_t firstSeed, int gameCount, struct GameResult *results
+)
+{
+  int weights[PLAYER_NO][WEIGHT_NO];
+
+  memcpy(weights, baseWeights, sizeof(weights));
+  memcpy(weights[options->color], candidateWeights, sizeof(weights[options->color]));
+
+  if (!runStealingGameBatch(firstSeed, gameCount, weights, options->threadCount, results))
+  {
+    printf("Error: Candidate games were not all played\n");
+    exit(1);
+  }
+
+  return getWinCountOfColor(results, gameCount, options->color);
+}
+
+// Keep the best generation candidates with distinct weights,
+// their fitness comes from different seeds so it only ranks
+// them for the final games
+static void addFinalist(struct Candidate *finalists, int *finalistCount, struct Candidate *candidate)
+{
+  for (int finalistIndex = 0; finalistIndex < *finalistCount; finalistIndex++)
+  {
+    if (memcmp(finalists[finalistIndex].weights, candidate->weights, sizeof(candidate->weights)) == 0)
+    {
+      finalists[finalistIndex].fitness = candidate->fitness > finalists[finalistIndex].fitness ? candidate->fitness : finalists[finalistIndex].fitness;
+      return;
+    }
+  }
+
+  if (*finalistCount < TUNER_FINALIST_NO)
+  {
+    finalists[(*finalistCount)++] = *candidate;
+  }
+  else if (candidate->fitness > finalists[TUNER_FINALIST_NO - 1].fitness)
+  {
+    finalists[TUNER_FINALIST_NO - 1] = *candidate;
+  }
+
+  qsort(finalists, *finalistCount, sizeof(struct Candidate), compareCandidates);
+}
+
+// Play the finalists and the reference on a common set of seeds
+// none of the generations used, the best finalist must beat the
+// reference there to replace it. Only the games won by exactly
+// one of them (split games) differ, so a finalist counts as
+// better once its extra wins exceed TUNER_SIGNIFICANCE standard
+// deviations of their difference, sqrt(split games) when both
+// play alike. Smaller leads are dice luck over several finalists
+static struct Candidate selectFinalist
+(
+  struct Candidate *finalists, int finalistCount, int baseWeights[][WEIGHT_NO],
+  struct TunerOptions *options, struct GameResult *results
+)
+{
+  int gameCount = options->gamesPerCandidate * TUNER_FINAL_GAME_FACTOR;
+  uint64_t firstSeed = options->seed + (uint64_t)options->generations * options->gamesPerCandidate;
+  int referenceWins = evaluateWeights(baseWeights[options->color], baseWeights, options, firstSeed, gameCount, results);
+  bool *referenceWon = malloc(gameCount * sizeof(bool));
+  struct Candidate best;
+
+  if (referenceWon == NULL)
+  {
+    printf("Error: Memory allocation failed\n");
+    exit(1);
+  }
+
+  for (int gameIndex = 0; gameIndex < gameCount; gameIndex++)
+  {
+    referenceWon[gameIndex] = results[gameIndex].winners[0] == (int)options->color;
+  }
+
+  memcpy(best.weights, baseWeights[options->color], sizeof(best.weights));
+  best.fitness = 0;
+
+  printf("Final games: reference wins %d/%d\n", referenceWins, gameCount);
+  for (int finalistIndex = 0; finalistIndex < finalistCount; finalistIndex++)
+  {
+    struct Candidate *finalist = &finalists[finalistIndex];
+    int wins = evaluateWeights(finalist->weights, baseWeights, options, firstSeed, gameCount, results);
+    int splitCount = 0;
+
+    for (int gameIndex = 0; gameIndex < gameCount; gameIndex++)
+    {
+      splitCount += (results[gameIndex].winners[0] == (int)options->color) != referenceWon[gameIndex];
+    }
+
+    bool significant = wins - referenceWins > TUNER_SIGNIFICANCE * sqrt(splitCount);
+
+    printf
+    (
+      "  finalist %d (%+d in its generation): %+d over %d split games%s\n",
+      finalistIndex + 1, finalist->fitness, wins - referenceWins, splitCount,
+      significant ? "" : ", not significant"
+    );
+    if (significant && wins - referenceWins > best.fitness)
+    {
+      best = *finalist;
+      best.fitness = wins - referenceWins;
+    }
+  }
+
+  free(referenceWon);
+  return best;
+}
+
+void tunePieceWeights(struct TunerOptions *options)
+{
+  int baseWeights[PLAYER_NO][WEIGHT_NO];
+  loadPieceWeights(options->outputFile, baseWeights);
+
+  struct Candidate population[options->populationSize];
+  struct Candidate nextPopulation[options->populationSize];
+  struct Candidate finalists[TUNER_FINALIST_NO];
+  int finalistCount = 0;
+  struct Candidate best;
+  struct GameResult *results = malloc(options->gamesPerCandidate * TUNER_FINAL_GAME_FACTOR * sizeof(struct GameResult));
+
+  if (results == NULL)
+  {
+    printf("Failed to allocate memory\n");
+    exit(0);
+  }
+
+  // genetic operators draw from the main thread's generator,
+  // games run on the worker threads with their own state
+  seedGameRandom(options->seed);
+
+  memcpy(best.weights, baseWeights[options->color], sizeof(best.weights));
+  best.fitness = 0;
+
+  for (int candidateIndex = 0; candidateIndex < options->populationSize; candidateIndex++)
+  {
+    population[candidateIndex] = best;
+
+    if (candidateIndex != 0)
+    {
+      mutateCandidate(&population[candidateIndex], options->color);
+    }
+  }
+
+  printf("Tuning %s weights: %d generations, %d candidates, %d games per candidate, %d threads\n",
+    getName(options->color),
+    options->generations,
+    options->populationSize,
+    options->gamesPerCandidate,
+    options->threadCount
+  );
+
+  for (int generation = 0; generation < options->generations; generation++)
+  {
+    // every candidate of a generation and the reference play the
+    // same seeds so the fitness difference is not dominated by dice luck
+    uint64_t firstSeed = options->seed + (uint64_t)generation * options->gamesPerCandidate;
+    int referenceWins = evaluateWeights(baseWeights[options->color], baseWeights, options, firstSeed, options->gamesPerCandidate, results);
+
+    for (int candidateIndex = 0; candidateIndex < options->populationSize; candidateIndex++)
+    {
+      int wins = evaluateWeights(population[candidateIndex].weights, baseWeights, options, firstSeed, options->gamesPerCandidate, results);
+      population[candidateIndex].fitness = wins - referenceWins;
+    }
+
+    qsort(population, options->populationSize, sizeof(struct Candidate), compareCandidates);
+
+    if (population[0].fitness > 0)
+    {
+      addFinalist(finalists, &finalistCount, &population[0]);
+    }
+
+    printf("Generation %d: reference wins %d/%d, best candidate %+d\n",
+      generation + 1,
+      referenceWins,
+      options->gamesPerCandidate,
+      population[0].fitness
+    );
+
+    for (int candidateIndex = 0; candidateIndex < options->populationSize; candidateIndex++)
+    {
+      if (candidateIndex < TUNER_ELITE_NO)
+      {
+        nextPopulation[candidateIndex] = population[candidateIndex];
+        continue;
+      }
+
+      struct Candidate *first = selectByTournament(population, options->populationSize);
+      struct Candidate *second = selectByTournament(population, options->populationSize);
+
+      // uniform crossover
+      for (int weightIndex = 0; weightIndex < WEIGHT_NO; weightIndex++)
+      {
+        nextPopulation[candidateIndex].weights[weightIndex] =
+          (gameRandom() % 2) ? first->weights[weightIndex] : second->weights[weightIndex];
+      }
+
+      mutateCandidate(&nextPopulation[candidateIndex], options->color);
+    }
+
+    memcpy(population, nextPopulation, sizeof(population));
+  }
+
+  // a single generation best is mostly dice luck, so the
+  // finalists are compared again on the same fresh seeds
+  best = selectFinalist(finalists, finalistCount, baseWeights, options, results);
+  memcpy(baseWeights[options->color], best.weights, sizeof(best.weights));
+
+  if (best.fitness == 0)
+  {
+    printf("No finalist beat the reference significantly, %s weights in %s kept\n", getName(options->color), options->outputFile);
+  }
+  else if (!savePieceWeights(options->outputFile, baseWeights))
+  {
+    printf("Failed to write weights to %s\n", options->outputFile);
+  }
+  else
+  {
+    printf("Best %s weights (%+d wins over reference in the final games) written to %s\n",
+      getName(options->color),
+      best.fitness,
+      options->outputFile
+    );
+  }
+
+  free(results);
+}
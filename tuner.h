@@ -0,0 +1,38 @@
+#ifndef TUNER_H
+#define TUNER_H
+
+#include <stdint.h>
+#include "types.h"
+
+#define TUNER_ELITE_NO 2
+#define TUNER_TOURNAMENT_SIZE 3
+#define TUNER_MUTATION_RATE 30 // percentage per weight
+#define TUNER_MAX_STEP 2
+#define TUNER_WEIGHT_LIMIT (MAX_PRIORITY * 2)
+#define TUNER_FINALIST_NO 4 // generation bests played again at the end
+#define TUNER_FINAL_GAME_FACTOR 4 // final games per candidate game
+#define TUNER_SIGNIFICANCE 2.5 // standard deviations a finalist must win by, split over the finalists
+
+struct TunerOptions
+{
+  enum Color color;
+  int generations;
+  int populationSize;
+  int gamesPerCandidate;
+  int threadCount;
+  uint64_t seed;
+  char *outputFile;
+};
+
+struct Candidate
+{
+  int weights[WEIGHT_NO];
+  int fitness; // wins minus reference wins on the same seeds
+};
+
+// Genetic algorithm tuner for the piece importance weights
+
+struct TunerOptions getDefaultTunerOptions();
+void tunePieceWeights(struct TunerOptions *options);
+
+#endif // !TUNER_H
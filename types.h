@@ -12,6 +12,16 @@
 #define APPROACH_DIFFERENCE 2
 #define MYSTERY_LOCATIONS 6
 #define MAX_PRIORITY 10
+// expected throws to roll the 6 that leaves base, a geometric
+// wait with p = 1/MAX_DICE_VALUE has mean 1/p
+#define THROWS_TO_LEAVE_BASE ((float)MAX_DICE_VALUE)
+#define WEIGHTS_CONFIG_FILE "weights.cfg"
+#define ALL_SLOTS_FREE ((1 << PIECE_NO) - 1)
+#define ALL_PLAYERS_ACTIVE ((1 << PLAYER_NO) - 1)
+#define ALL_CELLS_EMPTY ((1ULL << MAX_STANDARD_CELL) - 1)
+#define MAX_GAME_ROUNDS 10000 // stops games that would loop forever
+#define UNDO_MAX_DEPTH 64
+#define UNDO_MAX_ENTRIES 4096
 
 enum Color {
   YELLOW,
@@ -42,6 +52,26 @@ enum ApproachLocations {
   GREEN_APPROACH = GREEN_START - APPROACH_DIFFERENCE
 };
 
+// Index of each tunable constant used when
+// scoring piece importance in the behaviors
+enum PieceWeight
+{
+  ATTACK_WEIGHT,
+  MOVE_FROM_BASE_WEIGHT,
+  FORM_BLOCK_WEIGHT,
+  SKIP_BLOCK_WEIGHT,
+  STAY_IN_BLOCK_WEIGHT,
+  FULL_MOVE_WEIGHT,
+  PARTIAL_MOVE_WEIGHT,
+  SINGLE_PIECE_WEIGHT,
+  BLOCK_MOVABLE_WEIGHT,
+  PREFER_TO_MOVE_WEIGHT,
+  ROTATION_WEIGHT,
+  IMMOBILE_WEIGHT,
+  REMAINING_THROWS_WEIGHT,
+  WEIGHT_NO
+};
+
 struct MysteryEffects
 {
   bool effectActive;
@@ -51,9 +81,21 @@ struct MysteryEffects
   int diceDivider;
 } __attribute__((aligned(4)));
 
+// State of a piece beyond its cell, for observers outside
+// the engine
+enum PieceFlag
+{
+  PIECE_FLAG_CLOCKWISE = 1 << 0,
+  PIECE_FLAG_CAPTURED = 1 << 1,
+  PIECE_FLAG_IN_BLOCK = 1 << 2,
+  PIECE_FLAG_EFFECT_ACTIVE = 1 << 3,
+  PIECE_FLAG_FROZEN = 1 << 4
+};
+
 struct Piece
 {
   int cellNo;
+  int cellIndex; // slot in the board cell, EMPTY when off the board
   int captured;
   int noOfApproachPasses;
   bool clockWise;
@@ -73,6 +115,7 @@ struct Game
   int order[PLAYER_NO];
   int winners[PLAYER_NO];
   int prevMysteryCell;
+  uint8_t activePlayers; // bit i set while player i has pieces left to bring home
 } __attribute__((aligned(4)));
 
 struct Player
@@ -80,8 +123,186 @@ struct Player
   int startIndex;
   struct Piece pieces[4];
   enum Color color;
+  int previousPieceIndex; // for blue player
+  int weights[WEIGHT_NO];
 } __attribute__((aligned(4)));
 
+// A standard cell of the board. Counters are kept in
+// sync with the slot array by setCellPiece()
+struct Cell
+{
+  struct Piece *pieces[PIECE_NO];
+  uint8_t colorCount[PLAYER_NO];
+  uint8_t pieceCount;
+  uint8_t freeSlots; // bit i set when pieces[i] is NULL
+} __attribute__((aligned(8)));
+
+struct Board
+{
+  struct Cell cells[MAX_STANDARD_CELL];
+  uint64_t emptyCells; // bit i set when cell i has no pieces
+
+  // running totals per color, updated where pieces
+  // leave the base, reach home, capture or get captured
+  uint8_t piecesInBase[PLAYER_NO];
+  uint8_t piecesAtHome[PLAYER_NO];
+  uint8_t piecesInPlay; // pieces of all colors out of base and not yet home
+  int captureCount[PLAYER_NO];
+} __attribute__((aligned(8)));
+
+enum UndoKind
+{
+  UNDO_SLOT,
+  UNDO_PIECE
+};
+
+// Boolean piece fields kept by a piece undo entry
+enum UndoPieceFlag
+{
+  UNDO_FLAG_CLOCKWISE = 1 << 0,
+  UNDO_FLAG_BLOCK_CLOCKWISE = 1 << 1,
+  UNDO_FLAG_EFFECT_ACTIVE = 1 << 2,
+  UNDO_FLAG_PIECE_ACTIVE = 1 << 3
+};
+
+// One change made by a move. Slot changes keep the cell,
+// the slot and the piece that was in it. Piece changes keep
+// the fields a move can change, the slot index of the piece
+// comes back with its slot changes
+struct UndoEntry
+{
+  struct Piece *piece;
+  uint8_t kind;
+  uint8_t flags;
+  int8_t cellNo;
+  int8_t cellIndex;
+  int8_t effectActiveRounds;
+  int8_t diceMultiplier;
+  int8_t diceDivider;
+  int16_t captured;
+  int16_t noOfApproachPasses;
+};
+
+// Board totals before a move, the game itself is only
+// read by a move
+struct UndoFrame
+{
+  int firstEntry;
+  uint64_t randomState;
+  uint8_t piecesInBase[PLAYER_NO];
+  uint8_t piecesAtHome[PLAYER_NO];
+  uint8_t piecesInPlay;
+  int captureCount[PLAYER_NO];
+};
+
+// Fixed size stack for make/unmake search without
+// copying the board
+struct UndoStack
+{
+  struct UndoFrame frames[UNDO_MAX_DEPTH];
+  struct UndoEntry entries[UNDO_MAX_ENTRIES];
+  int frameCount;
+  int entryCount;
+};
+
+enum TurnPhase
+{
+  TURN_ROUND_START,
+  TURN_PLAYER_START,
+  TURN_THROW,
+  TURN_DECISION,
+  TURN_AFTER_MOVE,
+  TURN_PLAYER_END,
+  TURN_GAME_OVER
+};
+
+enum TurnEvent
+{
+  TURN_EVENT_DECISION, // a suspended color has to choose a move
+  TURN_EVENT_FINISHED, // a suspended color brought its last piece home
+  TURN_EVENT_GAME_OVER
+};
+
+// Where a game stopped, so that it can be resumed later
+// from any thread (with its random state restored)
+struct TurnState
+{
+  enum TurnPhase phase;
+  int orderIndex;
+  int playerIndex;
+  int diceNumber;
+  int minConsecutive;
+  int captureCount;
+  int maxRounds;
+  uint8_t suspendedColors; // bit per color whose moves are chosen by the caller
+  uint8_t legalMask; // of the pending decision
+};
+
+// A game that can be suspended at its decisions and
+// resumed later, interleaved with other sessions on the
+// same thread. Each session keeps its own random stream
+struct GameSession
+{
+  struct Game game;
+  struct Board board;
+  struct Player players[PLAYER_NO];
+  struct TurnState turn;
+  uint64_t randomState;
+};
+
+// A move to choose for a game suspended at a decision
+struct DecisionRequest
+{
+  int gameIndex;
+  struct Player *players;
+  int playerIndex;
+  int diceNumber;
+  struct Board *board;
+  int mysteryCellNo;
+  uint8_t legalMask;
+};
+
+// Chooses the moves of many suspended games in one call,
+// writing one action per request (see MovePolicy)
+struct BatchEvaluator
+{
+  void (*evaluate)(void *context, struct DecisionRequest *requests, int count, int *actions);
+  void *context;
+};
+
+// Called by moveParse with the position before the chosen
+// move is applied. diceNumber is after the mystery effects
+struct MoveObserver
+{
+  void (*onMove)
+  (
+    void *context, struct Player *players, int playerIndex, int diceNumber,
+    struct Board *board, int mysteryCellNo, int pieceIndex, bool blockMove
+  );
+  void *context;
+};
+
+// Called by advanceGame before each phase of the turn
+// engine runs, with the state the previous phase left
+struct TurnObserver
+{
+  void (*onPhase)(void *context, struct Game *game, struct Player *players, struct TurnState *turn);
+  void *context;
+};
+
+// Chooses the moves of a color in place of its behavior.
+// Returns an action with a set bit in legalMask: piece
+// index, plus PIECE_NO to move the block of the piece
+struct MovePolicy
+{
+  int (*selectMove)
+  (
+    void *context, struct Player *players, int playerIndex, int diceNumber,
+    struct Board *board, int mysteryCellNo, uint8_t legalMask
+  );
+  void *context;
+};
+
 struct RedPriority
 {
   bool canMoveFromBase;
@@ -126,4 +347,24 @@ union PiecePriority
   struct BluePriority *bluePriority;
 } __attribute__((aligned(8)));
 
+union PriorityStorage
+{
+  struct RedPriority redPriorities[PIECE_NO];
+  struct GreenPriority greenPriorities[PIECE_NO];
+  struct YellowPriority yellowPriorities[PIECE_NO];
+  struct BluePriority bluePriorities[PIECE_NO];
+} __attribute__((aligned(8)));
+
+// Everything a behavior works out before it selects
+// a piece, split out of moveParse so that the choice can
+// be made by something other than the behavior
+struct MoveDecision
+{
+  union PriorityStorage storage;
+  union PiecePriority piecePriorities; // points into storage
+  int pieceImportance[PIECE_NO];
+  bool canAttack[PIECE_NO]; // red pieces that would capture
+  int diceNumber; // after the mystery effects of the pieces
+};
+
 #endif // !TYPES_H
\ No newline at end of file